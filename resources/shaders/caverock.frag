@@ -8,18 +8,8 @@ out vec4 FragColor;
 
 uniform sampler2D texture1;   // Texture sampler
 uniform vec3 object_color;    // Object color
-uniform vec3 view_pos;        // Camera position
-
-// Main (directional) light in the scene
-struct DirectionalLight 
-{ 
-    vec3 colour;
-    vec3 direction;
-    float strength;
-};
-
-// Define light as uniform
-uniform DirectionalLight light;
+
+#include "frame_data.glsl"
 
 // Fixed ambient light parameters
 const vec3 ambient_light_color = vec3(1.0, 1.0, 1.0);  // White ambient light
@@ -0,0 +1,19 @@
+// Per-frame data shared by the scene shaders (see FrameUniforms in shaders.h),
+// uploaded once per frame to the UBO at UBO_BINDING_FRAME_DATA
+
+// Main (directional) light in the scene
+struct DirectionalLight 
+{ 
+    vec3 colour;
+    vec3 direction;
+    float strength;
+};
+
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 camera_pos;
+    float time;
+    DirectionalLight light;
+};
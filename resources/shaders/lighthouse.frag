@@ -1,32 +1,150 @@
-#version 330 core
+#version 430 core
+
+// Ambient & diffuse lighting by default; defining COOK_TORRANCE or OREN_NAYAR (see the
+// lighthouse programs in cgra350final.cpp) selects the other light models of the UI
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+flat in uint Layer;
 
 out vec4 FragColor;
 
-uniform sampler2D texture1;   // Texture sampler
-uniform vec3 object_color;    // Object color
-uniform vec3 view_pos;        // Camera position
-
-// Main (directional) light in the scene
-struct DirectionalLight 
-{ 
-    vec3 colour;
-    vec3 direction;
-    float strength;
-};
+uniform sampler2DArray materials;   // Material textures, one layer each
+uniform vec3 object_color;          // Object color
+#if defined(COOK_TORRANCE) || defined(OREN_NAYAR)
+uniform float roughness;            
+#endif
+#ifdef COOK_TORRANCE
+uniform float metalness;            
+uniform float reflectivity;         
+#endif
 
-// Define light as uniform
-uniform DirectionalLight light;
+#include "frame_data.glsl"
 
 // Fixed ambient light parameters
 const vec3 ambient_light_color = vec3(1.0, 1.0, 1.0);  // White ambient light
+#if defined(COOK_TORRANCE) || defined(OREN_NAYAR)
+const float ambient_strength = 0.2;                    // Ambient light intensity
+#else
 const float ambient_strength = 0.5;                    // Ambient light intensity
+#endif
+
+#ifdef COOK_TORRANCE
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = 3.14159 * denom * denom;
+
+    return num / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness) {
+    float r = roughness + 1.0;
+    float k = (r * r) / 8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+vec3 FresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
+}
+#endif
 
 void main()
 {
+#if defined(COOK_TORRANCE)
+    // Normalization of normal, light source direction and line of sight direction
+    vec3 N = normalize(Normal);
+    vec3 L = normalize(-light.direction); // Use directions in DirectionalLight
+    vec3 V = normalize(camera_pos - FragPos);
+    vec3 H = normalize(V + L);
+
+    // Calculate Fresnel reflectance
+    vec3 F0 = mix(vec3(0.04), object_color, metalness);  // Use base reflectance based on metallicity
+    vec3 F = FresnelSchlick(max(dot(H, V), 0.0), F0);
+
+    // Calculate Normal Distribution Function (NDF)
+    float NDF = DistributionGGX(N, H, roughness);
+
+    // Calculate the geometric masking function
+    float G = GeometrySmith(N, V, L, roughness);
+
+    // Cook-Torrance BRDF
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.001;
+    vec3 specular = numerator / denominator;
+
+    // Diffuse reflection component calculated using DirectionalLight
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 diffuse = (1.0 - F) * object_color * light.colour * light.strength * NdotL;
+
+    // The ambient light component is not affected by DirectionalLight
+    vec3 ambient = ambient_light_color * ambient_strength;
+
+    // Texture sampling and final color
+    vec3 textureColor = texture(materials, vec3(TexCoord, Layer)).rgb;
+    vec3 final_color = (ambient + diffuse + specular) * textureColor;
+
+    FragColor = vec4(final_color, 1.0);
+#elif defined(OREN_NAYAR)
+    // Normalization of normal, light source direction and line of sight direction
+    vec3 N = normalize(Normal);
+    vec3 L = normalize(-light.direction);  // Use directions in DirectionalLight
+    vec3 V = normalize(camera_pos - FragPos);
+
+    // Calculate the Angle between the surface normal and the line of sight and the light source
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotV = max(dot(N, V), 0.0);
+
+    // Calculate the angles theta_r and theta_i
+    float theta_i = acos(NdotL);
+    float theta_r = acos(NdotV);
+
+    // Calculate alpha and beta
+    float alpha = max(theta_i, theta_r);
+    float beta = min(theta_i, theta_r);
+
+    // Parameters A and B of the Oren-Nayar model are calculated based on roughness
+    float sigma2 = roughness * roughness;
+    float A = 1.0 - (sigma2 / (2.0 * (sigma2 + 0.33)));
+    float B = 0.45 * sigma2 / (sigma2 + 0.09);
+
+    // Calculate the projection of the line of sight and light source in the normal direction of the surface
+    vec3 V_perp = V - N * NdotV;
+    vec3 L_perp = L - N * NdotL;
+    float cosPhiDiff = dot(normalize(V_perp), normalize(L_perp));
+
+    // Oren-Nayar diffuse reflection formula
+    float rough_diffuse = A + B * max(0.0, cosPhiDiff) * sin(alpha) * tan(beta);
+    vec3 diffuse = rough_diffuse * light.colour * light.strength * NdotL * object_color;
+
+    // The ambient light component is not affected by DirectionalLight
+    vec3 ambient = ambient_light_color * ambient_strength;
+
+    // Texture sampling and final color
+    vec3 textureColor = texture(materials, vec3(TexCoord, Layer)).rgb;
+    vec3 final_color = (ambient + diffuse) * textureColor;
+
+    FragColor = vec4(final_color, 1.0);
+#else
     // Calculate normal vector and illumination direction
     vec3 normal = normalize(Normal);
     vec3 lightDir = normalize(-light.direction);  // Direction of light
@@ -39,9 +157,10 @@ void main()
     vec3 diffuse = diff * light.colour * light.strength;
 
     // Sample texture color
-    vec3 textureColor = texture(texture1, TexCoord).rgb;
+    vec3 textureColor = texture(materials, vec3(TexCoord, Layer)).rgb;
 
     // Calculate the final color, adding the ambient light and the directional light
     vec3 final_color = (ambient + diffuse) * textureColor;
     FragColor = vec4(final_color, 1.0);
+#endif
 }
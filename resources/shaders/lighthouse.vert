@@ -1,22 +1,29 @@
-#version 330 core
+#version 430 core
 
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoord;
+#include "mesh_vertex.glsl"
+layout(location = 3) in uint aPart;     // index of the part's draw (see ObjMesh::initialiseMultiDraw)
+
+// Material (texture array layer) of each part, see MaterialSet
+layout(std430, binding = 3) readonly buffer PartMaterials
+{
+    uint part_layer[];
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+flat out uint Layer;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "frame_data.glsl"
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    FragPos = vec3(model * vec4(getPosition(), 1.0));
+    Normal = mat3(transpose(inverse(model))) * getNormal();  
     TexCoord = aTexCoord;
+    Layer = part_layer[aPart];
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
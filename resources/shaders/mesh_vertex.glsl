@@ -0,0 +1,42 @@
+// Vertex attributes of ObjMesh meshes, as uploaded plain or, in programs built with
+// PACKED_VERTICES, packed (see PackedVertex in mesh_optimiser.h). Read them through
+// getPosition(), getNormal() & aTexCoord.
+
+#ifdef PACKED_VERTICES
+layout(location = 0) in vec3 aPackedPos;        // unorm16, in the part's bounding box
+layout(location = 1) in vec2 aPackedNormal;     // octahedral, snorm16
+layout(location = 2) in vec2 aTexCoord;         // half floats
+layout(location = 4) in vec3 aBoxMin;           // bounding box of the part (constant per draw)
+layout(location = 5) in vec3 aBoxSize;
+
+vec3 getPosition()
+{
+    return aBoxMin + aPackedPos * aBoxSize;
+}
+
+vec3 getNormal()
+{
+    // unfold the lower half of the octahedron
+    vec3 n = vec3(aPackedNormal, 1.0 - abs(aPackedNormal.x) - abs(aPackedNormal.y));
+    if (n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+#else
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoord;
+
+vec3 getPosition()
+{
+    return aPos;
+}
+
+vec3 getNormal()
+{
+    return aNormal;
+}
+#endif
@@ -1,25 +1,7 @@
 #version 430 core
 
-in VS_OUT
-{
-	vec3 wc_pos;
-	vec3 wc_normal;
-	vec2 tex_coords;
-} fs_in;
-
-out vec4 frag_colour;
-
-uniform vec3 wc_camera_pos;
-
-// Main (directional) light in the scene
-struct DirectionalLight 
-{ 
-    vec3 colour;
-    vec3 direction;
-    float strength;
-};
-
-uniform DirectionalLight light;
+#include "ocean_surface.glsl"
+#include "frame_data.glsl"
 
 // Some material constants
 
@@ -36,23 +18,12 @@ const float shininess = 16;								// specular shininess coeff
 const vec3 I_a = vec3(0.45, 0.63, 0.86);				// ambient light intensity/colour
 const float K_a = 0.75;									// ambient light reflection coeff
 
-uniform vec3 water_base_colour;
-
-
-// tonemapping and display encoding combined
-vec3 tonemap(vec3 linear_rgb)
-{
-    // no tonemap
-	// display encoding
-    return pow(linear_rgb, vec3(1.0/2.2)); 
-}
-
 void main()
 {
 	vec3 I_result;
 
 	// calculate normal and view vectors
-	vec3 N = normalize(fs_in.wc_normal);
+	vec3 N = surfaceNormal();
     vec3 V = normalize(wc_camera_pos - fs_in.wc_pos);
     vec3 L = normalize(-light.direction);
     vec3 R = reflect(-L, N);
@@ -0,0 +1,75 @@
+// Inputs and helpers shared by the ocean surface shaders (ocean_*.frag). Each variant
+// defines what it samples before including this:
+//   OCEAN_NORMAL_MAP      ripples from normalMap perturb the surface normal
+//   OCEAN_SCREEN_TEXTURE  the scene below, tex_S, sampled in screen space
+
+in VS_OUT
+{
+	vec3 wc_pos;
+	vec3 wc_normal;
+	vec2 tex_coords;
+} fs_in;
+
+#ifdef OCEAN_SCREEN_TEXTURE
+layout (pixel_center_integer) in vec4 gl_FragCoord;
+#endif
+
+out vec4 frag_colour;
+
+uniform vec3 wc_camera_pos;
+
+uniform vec3 water_base_colour;
+uniform float water_base_colour_amt;
+
+#ifdef OCEAN_NORMAL_MAP
+uniform sampler2D normalMap;  // Ripple Normal Map
+#endif
+
+#ifdef OCEAN_SCREEN_TEXTURE
+uniform sampler2D tex_S;
+uniform vec2 viewport_dimensions;
+
+const float delta = 0.05;
+#endif
+
+// tonemapping and display encoding combined
+vec3 tonemap(vec3 linear_rgb)
+{
+    // no tonemap
+	// display encoding
+    return pow(linear_rgb, vec3(1.0/2.2)); 
+}
+
+// surface normal, with the ripples of the normal map when there is one
+vec3 surfaceNormal()
+{
+	vec3 N = normalize(fs_in.wc_normal);
+#ifdef OCEAN_NORMAL_MAP
+	// Sample normal map and adjust the normal
+	vec3 normalFromMap = texture(normalMap, fs_in.tex_coords).rgb;
+	normalFromMap = normalize(normalFromMap * 2.0 - 1.0);  // Convert from [0,1] to [-1,1]
+
+	// Combine the normal from the map with the original normal
+	N = normalize(N + normalFromMap);
+#endif
+	return N;
+}
+
+// colour tinted towards the water's base colour by water_base_colour_amt
+vec3 mixBaseColour(vec3 colour)
+{
+	return water_base_colour_amt * water_base_colour + (1-water_base_colour_amt) * colour;
+}
+
+#ifdef OCEAN_SCREEN_TEXTURE
+// refracted colour: the scene below, offset along the normal
+vec3 refractedColour(vec3 N)
+{
+	// calculate projected texture coordinates (screen/vieewport space)
+	vec2 projected_tex_coords = gl_FragCoord.xy / viewport_dimensions;
+	// calc new sample coords
+	vec2 sample_tex_coords = projected_tex_coords + N.xz * delta;
+
+	return mixBaseColour(texture(tex_S, sample_tex_coords).rgb);
+}
+#endif
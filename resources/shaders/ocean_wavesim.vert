@@ -31,10 +31,11 @@ out VS_OUT
 	vec2 tex_coords;
 } vs_out;
 
-// transformation matrices & time
+// transformation matrices
 uniform mat4 m_matrix;
 uniform mat4 vp_matrix;
-uniform float time;
+
+#include "frame_data.glsl"
 
 // wave simulation parameters
 const int NUM_WAVES = 16;
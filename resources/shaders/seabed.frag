@@ -11,16 +11,7 @@ out vec4 frag_colour;
 
 uniform vec3 wc_camera_pos;
 
-// Main (directional) light in the scene
-struct DirectionalLight 
-{ 
-    vec3 colour;
-    vec3 direction;
-    float strength;
-};
-
-//  light Ϊ uniform
-uniform DirectionalLight light;
+#include "frame_data.glsl"
 
 const vec3 diffuse_colour = vec3(0.37, 0.30, 0.21);		// diffuse intensity/colour
 const float K_diff = 0.6;								// diffuse reflection coefficient
@@ -10,16 +10,7 @@ uniform sampler2D texture1;   // Texture sampler
 //uniform vec3 light_dir;       // Direction of light source
 //uniform vec3 light_color;     // Light source color
 
-// Main (directional) light in the scene
-struct DirectionalLight 
-{ 
-    vec3 colour;
-    vec3 direction;
-    float strength;
-};
-
-// Define light as uniform
-uniform DirectionalLight light;
+#include "frame_data.glsl"
 
 uniform vec3 ambient_light_color = vec3(1.0, 1.0, 1.0);
 uniform float ambient_strength = 0.2;
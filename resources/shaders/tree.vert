@@ -1,22 +1,19 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoord;
+#include "mesh_vertex.glsl"
 
 out vec3 Normal;
 out vec2 TexCoord;
 out vec3 ViewDir;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 camera_pos;
+
+#include "frame_data.glsl"
 
 void main()
 {
-    vec3 world_pos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 world_pos = vec3(model * vec4(getPosition(), 1.0));
+    Normal = mat3(transpose(inverse(model))) * getNormal();
     TexCoord = aTexCoord;
     ViewDir = camera_pos - vec3(world_pos);
 
@@ -156,17 +156,15 @@ void Rain::computeRainOnGPU(float deltaTime, float seaLevel, const glm::vec3& ra
     m_computeShader.use();
 
     // set uniform variables
-    //m_computeShader.setFloat("deltaTime", deltaTime);
-
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "deltaTime"), deltaTime);
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "seaLevel"), seaLevel);
-    glUniform3fv(glGetUniformLocation(m_computeShader.getHandle(), "rainPosition"), 1, glm::value_ptr(rainPosition));
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "cloudRadius"), cloudRadius);
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "minSpeed"), minSpeed);
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "maxSpeed"), maxSpeed);
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "minLifetime"), 3.0f);
-    glUniform1f(glGetUniformLocation(m_computeShader.getHandle(), "maxLifetime"), 5.0f);
-    glUniform1ui(glGetUniformLocation(m_computeShader.getHandle(), "maxSplashes"), m_splash_max);
+    m_computeShader.setFloat("deltaTime", deltaTime);
+    m_computeShader.setFloat("seaLevel", seaLevel);
+    m_computeShader.setVec3("rainPosition", rainPosition);
+    m_computeShader.setFloat("cloudRadius", cloudRadius);
+    m_computeShader.setFloat("minSpeed", minSpeed);
+    m_computeShader.setFloat("maxSpeed", maxSpeed);
+    m_computeShader.setFloat("minLifetime", 3.0f);
+    m_computeShader.setFloat("maxLifetime", 5.0f);
+    m_computeShader.setUint("maxSplashes", m_splash_max);
 
     // set Compute Shader
     glDispatchCompute((GLuint)m_raindrops.size() / 256 + 1, 1, 1);
@@ -210,10 +208,10 @@ void Rain::renderRaindrops(const glm::mat4& projection, const glm::mat4& view, f
     glEnable(GL_PROGRAM_POINT_SIZE);
 
     // set uniform variables
-    glUniformMatrix4fv(glGetUniformLocation(m_raindropShader.getHandle(), "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_raindropShader.getHandle(), "projection"), 1, GL_FALSE, &projection[0][0]);
-    glUniform1f(glGetUniformLocation(m_raindropShader.getHandle(), "raindrop_length"), raindrop_length);
-    glUniform3fv(glGetUniformLocation(m_raindropShader.getHandle(), "raindrop_color"), 1, glm::value_ptr(raindrop_color));
+    m_raindropShader.setMat4("view", view);
+    m_raindropShader.setMat4("projection", projection);
+    m_raindropShader.setFloat("raindrop_length", raindrop_length);
+    m_raindropShader.setVec3("raindrop_color", raindrop_color);
 
     // bind ssbo to binding 0
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_raindrop_ssbo);
@@ -241,10 +239,10 @@ void Rain::renderSplashes(const glm::mat4& projection, const glm::mat4& view, co
     m_splash_texture.bind();
 
     // set uniform variables
-    glUniformMatrix4fv(glGetUniformLocation(m_splashShader.getHandle(), "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_splashShader.getHandle(), "projection"), 1, GL_FALSE, &projection[0][0]);
-    glUniform3fv(glGetUniformLocation(m_splashShader.getHandle(), "cameraRight"), 1, glm::value_ptr(cameraRight));
-    glUniform3fv(glGetUniformLocation(m_splashShader.getHandle(), "cameraUp"), 1, glm::value_ptr(cameraUp));
+    m_splashShader.setMat4("view", view);
+    m_splashShader.setMat4("projection", projection);
+    m_splashShader.setVec3("cameraRight", cameraRight);
+    m_splashShader.setVec3("cameraUp", cameraUp);
 
     // bind ssbo to binding 1
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_splash_ssbo);
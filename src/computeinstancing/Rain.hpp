@@ -20,9 +20,9 @@ struct Splash {
 class Rain
 {
 private:
-	ShaderProgram m_computeShader;
-	ShaderProgram m_raindropShader;
-	ShaderProgram m_splashShader;
+	ShaderProgram &m_computeShader;		// not owned
+	ShaderProgram &m_raindropShader;
+	ShaderProgram &m_splashShader;
 
 	GLuint m_raindrop_num;
 	std::vector<Raindrop> m_raindrops;
@@ -36,7 +36,7 @@ private:
 	GLuint m_splash_vao, m_splash_vbo, m_splash_ssbo;
 	GLuint m_debug_ssbo;
 
-	Texture2D m_splash_texture;
+	const Texture2D &m_splash_texture;	// not owned
 
 	void setupShadersAndBuffers();
 
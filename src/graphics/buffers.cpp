@@ -1,4 +1,5 @@
 #include "buffers.h"
+#include "gl_call_counts.h"
 
 #include <iostream>
 
@@ -13,6 +14,22 @@ VAO::~VAO()
 	glDeleteVertexArrays(1, &m_id);
 }
 
+VAO::VAO(VAO &&other) noexcept : m_id(other.m_id)
+{
+	other.m_id = 0;
+}
+
+VAO &VAO::operator=(VAO &&other) noexcept
+{
+	if (this != &other)
+	{
+		glDeleteVertexArrays(1, &m_id);
+		m_id = other.m_id;
+		other.m_id = 0;
+	}
+	return *this;
+}
+
 void VAO::bind() const 
 {
 	glBindVertexArray(m_id);
@@ -46,6 +63,23 @@ Buffer::~Buffer()
 	glDeleteBuffers(1, &m_id);
 }
 
+Buffer::Buffer(Buffer &&other) noexcept : m_id(other.m_id), m_buffer_type(other.m_buffer_type)
+{
+	other.m_id = 0;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept
+{
+	if (this != &other)
+	{
+		glDeleteBuffers(1, &m_id);
+		m_id = other.m_id;
+		m_buffer_type = other.m_buffer_type;
+		other.m_id = 0;
+	}
+	return *this;
+}
+
 void Buffer::bind() const
 {
 	glBindBuffer(m_buffer_type, m_id);
@@ -71,17 +105,50 @@ EBO::EBO() : Buffer(GL_ELEMENT_ARRAY_BUFFER)
 {
 }
 
+// --- Uniform Buffer Object ---
+UBO::UBO(size_t size) : Buffer(GL_UNIFORM_BUFFER), m_size(size)
+{
+	bind();
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	unbind();
+}
+
+void UBO::update(const void *data, size_t size) const
+{
+	if (size > m_size)
+	{
+		std::cout << "ERROR::UBO::UPDATE" << std::endl
+			<< size << " bytes given to a buffer of " << m_size << std::endl;
+		return;
+	}
+	bind();
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	unbind();
+	getGLCallCounts().buffer_uploads++;
+}
+
+void UBO::bindBase(GLuint binding) const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, getHandle());
+}
+
+size_t UBO::getSize() const
+{
+	return m_size;
+}
+
 
 // --- Framebuffer Object ---
 
 FBO::FBO()
-	: m_colour_attachment()
+	: m_own_colour_attachment(new Texture2D()), m_colour_attachment(nullptr)
 {
+	m_colour_attachment = m_own_colour_attachment.get();
 	this->create();
 }
 
 FBO::FBO(Texture2D &colour_texture)
-	: m_colour_attachment(colour_texture)
+	: m_colour_attachment(&colour_texture)
 {
 	this->create();
 }
@@ -95,14 +162,14 @@ void FBO::create()
 	// create renderbuffer object for depth & stencil attachments
 	glGenRenderbuffers(1, &m_rbo_depth_stencil_attachment);
 	glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_depth_stencil_attachment);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_colour_attachment.getWidth(), m_colour_attachment.getHeight());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_colour_attachment->getWidth(), m_colour_attachment->getHeight());
 	glBindRenderbuffer(GL_RENDERBUFFER, 0); // unbind RBO
 
 	// --- attachments ---
 	glBindFramebuffer(GL_FRAMEBUFFER, m_id);
 
 	// attach tex as colour attachment
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colour_attachment.getHandle(), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colour_attachment->getHandle(), 0);
 
 	// attach rbo as depth & stencil attachments
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rbo_depth_stencil_attachment);
@@ -124,18 +191,45 @@ FBO::~FBO()
 	glDeleteFramebuffers(1, &m_id);
 }
 
+FBO::FBO(FBO &&other) noexcept
+	: m_id(other.m_id), m_own_colour_attachment(std::move(other.m_own_colour_attachment)),
+	m_colour_attachment(other.m_colour_attachment), m_rbo_depth_stencil_attachment(other.m_rbo_depth_stencil_attachment)
+{
+	other.m_id = 0;
+	other.m_colour_attachment = nullptr;
+	other.m_rbo_depth_stencil_attachment = 0;
+}
+
+FBO &FBO::operator=(FBO &&other) noexcept
+{
+	if (this != &other)
+	{
+		glDeleteRenderbuffers(1, &m_rbo_depth_stencil_attachment);
+		glDeleteFramebuffers(1, &m_id);
+		m_id = other.m_id;
+		m_own_colour_attachment = std::move(other.m_own_colour_attachment);
+		m_colour_attachment = other.m_colour_attachment;
+		m_rbo_depth_stencil_attachment = other.m_rbo_depth_stencil_attachment;
+		other.m_id = 0;
+		other.m_colour_attachment = nullptr;
+		other.m_rbo_depth_stencil_attachment = 0;
+	}
+	return *this;
+}
+
+// colour_texture must outlive the FBO (an attachment it created itself is kept until then)
 void FBO::setColourAttachment(Texture2D &colour_texture)
 {
-	m_colour_attachment = colour_texture;
+	m_colour_attachment = &colour_texture;
 	// update fbo attachment
 	glBindFramebuffer(GL_FRAMEBUFFER, m_id);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colour_attachment.getHandle(), 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colour_attachment->getHandle(), 0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 Texture2D &FBO::getColourAttachment()
 {
-	return m_colour_attachment;
+	return *m_colour_attachment;
 }
 
 
@@ -5,8 +5,12 @@
 #include "textures.h"
 
 #include <glad/glad.h>
+#include <memory>
 #include <vector>
 
+// The wrappers below own their GL objects and are move-only: a moved-from object holds
+// handle 0 and deletes nothing. Pass them by reference to share them.
+
 // --- Vertex Array Object ---
 class VAO
 {
@@ -16,6 +20,10 @@ private:
 public:
 	VAO();
 	~VAO();
+	VAO(const VAO &) = delete;
+	VAO &operator=(const VAO &) = delete;
+	VAO(VAO &&other) noexcept;
+	VAO &operator=(VAO &&other) noexcept;
 	void bind() const;
 	void unbind() const;
 	GLuint getHandle() const;
@@ -34,6 +42,10 @@ protected:
 
 public:
 	~Buffer();
+	Buffer(const Buffer &) = delete;
+	Buffer &operator=(const Buffer &) = delete;
+	Buffer(Buffer &&other) noexcept;
+	Buffer &operator=(Buffer &&other) noexcept;
 	void bind() const;
 	void unbind() const;
 	template<typename T>
@@ -60,20 +72,42 @@ public:
 	EBO();
 };
 
+// --- Uniform Buffer Object ---
+// std140 block data, shared by every program whose block is bound to the same binding point
+// (see ShaderProgram::bindUniformBlock)
+class UBO : public Buffer
+{
+private:
+	size_t m_size;
+
+public:
+	UBO(size_t size);
+	// size bytes from the start of the buffer, at most the size it was created with
+	void update(const void *data, size_t size) const;
+	void bindBase(GLuint binding) const;
+	size_t getSize() const;
+};
+
 // --- Framebuffer Object ---
 class FBO
 {
 private:
 	GLuint m_id;
-	Texture2D m_colour_attachment;
+	std::unique_ptr<Texture2D> m_own_colour_attachment;	// only when created without a texture
+	Texture2D *m_colour_attachment;						// not owned, unless it is the one above
 	GLuint m_rbo_depth_stencil_attachment;
 
 	void create();
 
 public:
 	FBO();
+	// colour_texture must outlive the FBO
 	FBO(Texture2D &colour_texture);
 	~FBO();
+	FBO(const FBO &) = delete;
+	FBO &operator=(const FBO &) = delete;
+	FBO(FBO &&other) noexcept;
+	FBO &operator=(FBO &&other) noexcept;
 
 	void setColourAttachment(Texture2D &colour_texture);
 	Texture2D &getColourAttachment();
@@ -0,0 +1,35 @@
+#ifndef GL_CALL_COUNTS
+#define GL_CALL_COUNTS
+#pragma once
+
+// GL calls made through the graphics wrappers (ShaderProgram uniforms & binds, UBO uploads,
+// texture binds),
+// counted on the CPU. The render loop takes a copy at the end of each frame for the UI and
+// starts again from zero.
+struct GLCallCounts
+{
+	int uniform_sets = 0;		// ShaderProgram::set* calls
+	int uniform_uploads = 0;	// glUniform* (sets of inactive uniforms are skipped)
+	int location_queries = 0;	// glGetUniformLocation
+	int program_binds = 0;		// glUseProgram
+	int buffer_uploads = 0;		// glBufferSubData of uniform buffers
+	int texture_binds = 0;		// glBindTexture of Texture2D & Texture2DArray
+
+	int getTotal() const
+	{
+		return uniform_uploads + location_queries + program_binds + buffer_uploads + texture_binds;
+	}
+	// what getTotal() would be without the location cache: a query & an upload per set
+	int getTotalUncached() const
+	{
+		return getTotal() - uniform_uploads + 2 * uniform_sets;
+	}
+};
+
+// Counts of the current frame, per thread (the shader compile thread has its own)
+inline GLCallCounts &getGLCallCounts()
+{
+	static thread_local GLCallCounts counts;
+	return counts;
+}
+#endif
@@ -0,0 +1,74 @@
+#include "materials.h"
+#include "texture_streamer.h"
+#include "../utils/texture_pack.h"
+
+
+// ------------------------------------------
+// --- MaterialSet class ---
+
+MaterialSet::MaterialSet(int num_parts)
+    : m_part_layers(num_parts, 0)
+{
+    glGenBuffers(1, &m_ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_part_layers.size() * sizeof(GLuint), m_part_layers.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+MaterialSet::~MaterialSet()
+{
+    glDeleteBuffers(1, &m_ssbo);
+}
+
+int MaterialSet::addTexture(string filename)
+{
+    auto found = m_layers.find(TexturePack::normaliseName(filename));
+    if (found != m_layers.end())
+    {
+        return found->second;
+    }
+
+    int layer = (int)m_filenames.size();
+    m_layers[TexturePack::normaliseName(filename)] = layer;
+    m_filenames.push_back(filename);
+    return layer;
+}
+
+void MaterialSet::load(TextureStreamer &streamer, int width, int height)
+{
+    m_textures = std::make_unique<Texture2DArray>(m_filenames, width, height, streamer);
+}
+
+void MaterialSet::setPartLayer(int part, int layer)
+{
+    if (m_part_layers[part] != (GLuint)layer)
+    {
+        m_part_layers[part] = layer;
+        m_dirty = true;
+    }
+}
+
+int MaterialSet::getPartLayer(int part) const
+{
+    return m_part_layers[part];
+}
+
+void MaterialSet::bind(int tex_unit, GLuint binding)
+{
+    if (m_dirty)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ssbo);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_part_layers.size() * sizeof(GLuint), m_part_layers.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        m_dirty = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_ssbo);
+
+    glActiveTexture(GL_TEXTURE0 + tex_unit);
+    m_textures->bind();
+}
+
+const Texture2DArray &MaterialSet::getTextures() const
+{
+    return *m_textures;
+}
@@ -0,0 +1,52 @@
+#ifndef MATERIALS
+#define MATERIALS
+#pragma once
+
+#include "textures.h"
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+class TextureStreamer;
+
+// --- Material Set ---
+// The material textures of a prop in one texture array, and the layer each part of the prop
+// samples in a shader storage buffer (one uint per part, indexed by the part's draw in
+// ObjMesh::renderMultiDraw). Switching a part's material rewrites its index and nothing else.
+class MaterialSet
+{
+private:
+	std::vector<string> m_filenames;			// one per layer
+	std::unordered_map<string, int> m_layers;	// layer of each normalised filename
+	std::unique_ptr<Texture2DArray> m_textures;
+	std::vector<GLuint> m_part_layers;
+	GLuint m_ssbo;
+	bool m_dirty = true;
+
+public:
+	MaterialSet(int num_parts);
+	~MaterialSet();
+
+	// owns its buffer: not copyable
+	MaterialSet(const MaterialSet &) = delete;
+	MaterialSet &operator=(const MaterialSet &) = delete;
+
+	// Layer of filename, added unless an earlier call added it already (before load() only)
+	int addTexture(string filename);
+	// Create the array from the added textures, every layer resized to width x height
+	void load(TextureStreamer &streamer, int width = 1024, int height = 1024);
+
+	void setPartLayer(int part, int layer);
+	int getPartLayer(int part) const;
+
+	// Bind the array to texture unit tex_unit and the part layers to storage buffer binding
+	// point binding, uploading them first if they changed since the last call
+	void bind(int tex_unit, GLuint binding);
+	const Texture2DArray &getTextures() const;
+};
+#endif
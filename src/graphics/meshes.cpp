@@ -1,6 +1,9 @@
 #include "meshes.h"
 #include "../main/constants.h"
+#include "../utils/mesh_optimiser.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -375,4 +378,178 @@ void ObjMesh::loadMtl(const std::string& filepath) {
 	}
 
 	file.close();
-}
\ No newline at end of file
+}
+
+void uploadObjVertices(const std::vector<ObjVertex>& vertices, bool packed, glm::vec3& boxMin, glm::vec3& boxSize, PackingError* error) {
+	if (packed) {
+		std::vector<PackedVertex> packedVertices;
+		MeshOptimiser::packVertices(vertices, packedVertices, boxMin, boxSize, error);
+		glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ObjVertex), vertices.data(), GL_STATIC_DRAW);
+	}
+	setObjVertexAttributes(packed);
+}
+
+void setObjVertexAttributes(bool packed) {
+	if (packed) {
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tex_coord));
+	}
+	else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ObjVertex), (void*)offsetof(ObjVertex, position));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ObjVertex), (void*)offsetof(ObjVertex, normal));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ObjVertex), (void*)offsetof(ObjVertex, tex_coord));
+	}
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+}
+
+void setPackedVertexBox(const glm::vec3& boxMin, const glm::vec3& boxSize) {
+	glVertexAttrib3f(4, boxMin.x, boxMin.y, boxMin.z);
+	glVertexAttrib3f(5, boxSize.x, boxSize.y, boxSize.z);
+}
+
+// layout of GL_DRAW_INDIRECT_BUFFER entries
+struct DrawCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+void ObjMesh::initialiseMultiDraw(const std::vector<std::string>& partNames) {
+	// per-draw attributes: the draw index & the box of the part's packed vertices
+	struct DrawData {
+		GLuint id;
+		glm::vec3 boxMin;
+		glm::vec3 boxSize;
+	};
+
+	std::vector<ObjVertex> vertices;
+	std::vector<PackedVertex> packedVertices;
+	std::vector<unsigned int> allIndices;
+	std::vector<DrawCommand> commands;
+	std::vector<DrawData> drawData;
+	size_t maxPartVertices = 0;
+	for (size_t i = 0; i < partNames.size(); i++) {
+		DrawCommand command = { 0, 1, (GLuint)allIndices.size(), (GLint)(packed ? packedVertices.size() : vertices.size()), (GLuint)i };
+		DrawData data = { (GLuint)i, glm::vec3(0.0f), glm::vec3(1.0f) };
+		auto found = parts.find(partNames[i]);
+		if (found != parts.end()) {
+			// (a missing part stays an empty draw, so later parts keep their index)
+			const MeshPart& part = found->second;
+			if (packed) {
+				std::vector<PackedVertex> partVertices;
+				MeshOptimiser::packVertices(part.vertices, partVertices, data.boxMin, data.boxSize);
+				packedVertices.insert(packedVertices.end(), partVertices.begin(), partVertices.end());
+			}
+			else {
+				vertices.insert(vertices.end(), part.vertices.begin(), part.vertices.end());
+			}
+			maxPartVertices = std::max(maxPartVertices, part.vertices.size());
+			allIndices.insert(allIndices.end(), part.indices.begin(), part.indices.end());
+			command.count = (GLuint)part.indices.size();
+		}
+		commands.push_back(command);
+		drawData.push_back(data);
+	}
+
+	glGenVertexArrays(1, &multi_vao);
+	glBindVertexArray(multi_vao);
+
+	glGenBuffers(1, &multi_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, multi_vbo);
+	if (packed) {
+		glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ObjVertex), vertices.data(), GL_STATIC_DRAW);
+	}
+	setObjVertexAttributes(packed);
+
+	// Draw index: one value per instance, starting at the command's baseInstance
+	// (gl_DrawID needs GL 4.6 or ARB_shader_draw_parameters; this works from GL 4.2)
+	glGenBuffers(1, &multi_draw_ids);
+	glBindBuffer(GL_ARRAY_BUFFER, multi_draw_ids);
+	glBufferData(GL_ARRAY_BUFFER, drawData.size() * sizeof(DrawData), drawData.data(), GL_STATIC_DRAW);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(DrawData), (void*)offsetof(DrawData, id));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(3);
+	if (packed) {
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)offsetof(DrawData, boxMin));
+		glVertexAttribDivisor(4, 1);
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)offsetof(DrawData, boxSize));
+		glVertexAttribDivisor(5, 1);
+		glEnableVertexAttribArray(5);
+	}
+
+	glGenBuffers(1, &multi_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, multi_ebo);
+	// indices stay relative to their part (see baseVertex), so 16 bits do if every part fits
+	if (maxPartVertices <= 65536) {
+		std::vector<unsigned short> shortIndices(allIndices.begin(), allIndices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+		multi_index_type = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int), allIndices.data(), GL_STATIC_DRAW);
+		multi_index_type = GL_UNSIGNED_INT;
+	}
+
+	glBindVertexArray(0);
+
+	glGenBuffers(1, &multi_indirect);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, multi_indirect);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	multi_draw_count = (GLsizei)commands.size();
+	multi_part_names = partNames;
+	multi_instance_counts.assign(commands.size(), 1);
+}
+
+size_t ObjMesh::renderMultiDraw() {
+	glBindVertexArray(multi_vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, multi_indirect);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, multi_index_type, (void*)0, multi_draw_count, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+
+	size_t triangles = 0;
+	for (size_t i = 0; i < multi_part_names.size(); i++) {
+		auto found = parts.find(multi_part_names[i]);
+		if (found != parts.end() && multi_instance_counts[i] > 0) {
+			triangles += found->second.indices.size() / 3;
+		}
+	}
+	return triangles;
+}
+
+bool ObjMesh::isMultiDrawPart(const std::string& partName) const {
+	return std::find(multi_part_names.begin(), multi_part_names.end(), partName) != multi_part_names.end();
+}
+
+void ObjMesh::updateMultiDraw() {
+	bool bound = false;
+	for (size_t i = 0; i < multi_part_names.size(); i++) {
+		auto found = parts.find(multi_part_names[i]);
+		GLuint instanceCount = found != parts.end() && found->second.visible ? 1 : 0;
+		if (instanceCount == multi_instance_counts[i]) {
+			continue;
+		}
+		if (!bound) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, multi_indirect);
+			bound = true;
+		}
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, i * sizeof(DrawCommand) + offsetof(DrawCommand, instanceCount), sizeof(GLuint), &instanceCount);
+		multi_instance_counts[i] = instanceCount;
+	}
+	if (bound) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+}
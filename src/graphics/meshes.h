@@ -4,7 +4,11 @@
 
 #include <glad/glad.h>
 #include "buffers.h"
+#include "../utils/obj_loader.h"
+#include "../utils/mesh_optimiser.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -21,51 +25,113 @@ struct Material {
     Material() : ambient(0.1f), diffuse(0.8f), specular(0.5f), shininess(32.0f) {}
 };
 
+// Upload vertices to the bound GL_ARRAY_BUFFER and point attributes 0-2 of the bound VAO at
+// them: as they are, or packed (see PackedVertex) in a box returned for the shaders
+void uploadObjVertices(const std::vector<ObjVertex>& vertices, bool packed, glm::vec3& boxMin, glm::vec3& boxSize, PackingError* error = nullptr);
+void setObjVertexAttributes(bool packed);
+// Bounding box of packed vertices for the next draws: the values of attributes 4 & 5, which
+// stay constant while their arrays are disabled
+void setPackedVertexBox(const glm::vec3& boxMin, const glm::vec3& boxSize);
+
 struct MeshPart {
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
+    std::vector<ObjVertex> vertices;    // interleaved into one VBO
     std::vector<unsigned int> indices;
-    GLuint vao, vbo_positions, vbo_normals, vbo_texCoords, ebo_indices;
+    GLuint vao = 0, vbo = 0, ebo_indices = 0;
+    GLenum index_type = GL_UNSIGNED_INT;    // GL_UNSIGNED_SHORT for parts of up to 65536 vertices
+
+    // Upload PackedVertex (half the size) instead; draw with a PACKED_VERTICES program
+    bool packed = false;
+    glm::vec3 box_min = glm::vec3(0.0f), box_size = glm::vec3(1.0f);
+    PackingError packing_error;
+
+    // Coarser levels of detail, after the indices in the same EBO. render() draws level lod
+    // (0: indices, i: lods[i - 1]), picked by selectLod
+    std::vector<ObjMeshLod> lods;
+    int lod = 0;
+    std::vector<GLsizei> level_counts;
+    std::vector<size_t> level_offsets;     // in bytes
+    glm::vec3 aabb_min = glm::vec3(0.0f), aabb_max = glm::vec3(0.0f);    // bounds of the vertices
+    glm::vec3 centre = glm::vec3(0.0f);    // bounding sphere
+    float radius = 0.0f;
+
+    // Whether renderPart & renderMultiDraw draw the part (Scene sets it for the parts of the
+    // multi-draw from its culling)
+    bool visible = true;
 
     // ʼÿMeshPartVAOVBO
     void initialise() {
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
-        glGenBuffers(1, &vbo_positions);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
-        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(0);
-
-        if (!normals.empty()) {
-            glGenBuffers(1, &vbo_normals);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo_normals);
-            glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-            glEnableVertexAttribArray(1);
-        }
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        uploadObjVertices(vertices, packed, box_min, box_size, &packing_error);
 
-        if (!texCoords.empty()) {
-            glGenBuffers(1, &vbo_texCoords);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo_texCoords);
-            glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-            glEnableVertexAttribArray(2);
+        // every level, one after the other
+        std::vector<unsigned int> levels(indices.begin(), indices.end());
+        level_counts.assign(1, (GLsizei)indices.size());
+        for (const ObjMeshLod& level : lods) {
+            levels.insert(levels.end(), level.indices.begin(), level.indices.end());
+            level_counts.push_back((GLsizei)level.indices.size());
+        }
+        index_type = vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        size_t indexSize = index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        level_offsets.assign(1, 0);
+        for (size_t i = 1; i < level_counts.size(); i++) {
+            level_offsets.push_back(level_offsets[i - 1] + level_counts[i - 1] * indexSize);
         }
+        lod = 0;
 
         glGenBuffers(1, &ebo_indices);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_indices);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        if (index_type == GL_UNSIGNED_SHORT) {
+            std::vector<unsigned short> shortIndices(levels.begin(), levels.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+        }
+        else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, levels.size() * sizeof(unsigned int), levels.data(), GL_STATIC_DRAW);
+        }
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            aabb_min = i == 0 ? vertices[i].position : glm::min(aabb_min, vertices[i].position);
+            aabb_max = i == 0 ? vertices[i].position : glm::max(aabb_max, vertices[i].position);
+        }
+        centre = (aabb_min + aabb_max) * 0.5f;
+        radius = glm::length(aabb_max - aabb_min) * 0.5f;
 
         glBindVertexArray(0);
     }
 
+    // Coarsest level whose error covers at most maxPixels on screen, with pixelsPerUnit the
+    // size of a model unit there. So that a part at the threshold does not flicker between
+    // two levels, a coarser level is only taken once its error is a margin (hysteresis) under.
+    void selectLod(float pixelsPerUnit, float maxPixels, float hysteresis) {
+        int levels = (int)level_counts.size();
+        lod = std::min(lod, levels - 1);
+        while (lod > 0 && lods[lod - 1].error * pixelsPerUnit > maxPixels) {
+            lod--;
+        }
+        while (lod + 1 < levels && lods[lod].error * pixelsPerUnit < maxPixels * (1.0f - hysteresis)) {
+            lod++;
+        }
+    }
+
+    // GPU memory of the vertices & indices
+    size_t getBytes() const {
+        size_t numIndices = indices.size();
+        for (const ObjMeshLod& level : lods) {
+            numIndices += level.indices.size();
+        }
+        return vertices.size() * (packed ? sizeof(PackedVertex) : sizeof(ObjVertex)) + numIndices * (index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+
     // Ⱦ
     void render() {
         glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        if (packed) {
+            setPackedVertexBox(box_min, box_size);
+        }
+        glDrawElements(GL_TRIANGLES, level_counts[lod], index_type, (void*)level_offsets[lod]);
         glBindVertexArray(0);
     }
 };
@@ -183,6 +249,11 @@ public:
     std::vector<glm::vec2> texCoords;  // 
     std::vector<unsigned int> indices; // 
 
+    // Upload the whole mesh, the parts (set before initialising them) & the multi-draw as
+    // PackedVertex; draw with PACKED_VERTICES programs
+    bool packed = false;
+    glm::vec3 box_min = glm::vec3(0.0f), box_size = glm::vec3(1.0f);
+
     // 캯
     ObjMesh(const std::vector<glm::vec3>& pos,
         const std::vector<glm::vec3>& norm,
@@ -196,29 +267,44 @@ public:
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
-        // ɲ󶨶㻺 (VBO)
-        glGenBuffers(1, &vbo_positions);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
-        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // з
-        if (!normals.empty()) {
-            glGenBuffers(1, &vbo_normals);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo_normals);
-            glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-            glEnableVertexAttribArray(1);
+        if (packed) {
+            // one buffer of packed vertices
+            std::vector<ObjVertex> vertices(positions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                vertices[i].position = positions[i];
+                vertices[i].normal = i < normals.size() ? normals[i] : glm::vec3(0.0f);
+                vertices[i].tex_coord = i < texCoords.size() ? texCoords[i] : glm::vec2(0.0f);
+            }
+            glGenBuffers(1, &vbo_positions);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
+            uploadObjVertices(vertices, true, box_min, box_size);
+            vbo_normals = vbo_texCoords = 0;
         }
-
-        // 
-        if (!texCoords.empty()) {
-            glGenBuffers(1, &vbo_texCoords);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo_texCoords);
-            glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-            glEnableVertexAttribArray(2);
+        else {
+            // ɲ󶨶㻺 (VBO)
+            glGenBuffers(1, &vbo_positions);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
+            glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+            glEnableVertexAttribArray(0);
+
+            // з
+            if (!normals.empty()) {
+                glGenBuffers(1, &vbo_normals);
+                glBindBuffer(GL_ARRAY_BUFFER, vbo_normals);
+                glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+                glEnableVertexAttribArray(1);
+            }
+
+            // 
+            if (!texCoords.empty()) {
+                glGenBuffers(1, &vbo_texCoords);
+                glBindBuffer(GL_ARRAY_BUFFER, vbo_texCoords);
+                glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
+                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+                glEnableVertexAttribArray(2);
+            }
         }
 
         // ɲԪػ (EBO)
@@ -233,6 +319,9 @@ public:
     // Ⱦ
     void render() {
         glBindVertexArray(vao);
+        if (packed) {
+            setPackedVertexBox(box_min, box_size);
+        }
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
     }
@@ -254,6 +343,11 @@ public:
         glDeleteBuffers(1, &vbo_normals);
         glDeleteBuffers(1, &vbo_texCoords);
         glDeleteBuffers(1, &ebo_indices);
+        glDeleteVertexArrays(1, &multi_vao);
+        glDeleteBuffers(1, &multi_vbo);
+        glDeleteBuffers(1, &multi_draw_ids);
+        glDeleteBuffers(1, &multi_ebo);
+        glDeleteBuffers(1, &multi_indirect);
     }
 
     std::map<std::string, MeshPart> parts;  // 洢ͬĲ硰wallswoodglass
@@ -264,18 +358,26 @@ public:
         const std::vector<glm::vec2>& uv,
         const std::vector<unsigned int>& ind)
     {
-        parts[partName].positions = pos;
-        parts[partName].normals = norm;
-        parts[partName].texCoords = uv;
-        parts[partName].indices = ind;
+        MeshPart& part = parts[partName];
+        part.vertices.resize(pos.size());
+        for (size_t i = 0; i < pos.size(); i++) {
+            part.vertices[i].position = pos[i];
+            part.vertices[i].normal = i < norm.size() ? norm[i] : glm::vec3(0.0f);
+            part.vertices[i].tex_coord = i < uv.size() ? uv[i] : glm::vec2(0.0f);
+        }
+        part.indices = ind;
         parts[partName].initialise();  // ʼòλVAOVBO
     }
 
     // ȾָĲ
-    void renderPart(const std::string& partName) {
-        if (parts.find(partName) != parts.end()) {
-            parts[partName].render();
+    // (returns the number of triangles drawn: 0 for a missing or culled part)
+    size_t renderPart(const std::string& partName) {
+        auto found = parts.find(partName);
+        if (found == parts.end() || !found->second.visible) {
+            return 0;
         }
+        found->second.render();
+        return found->second.level_counts[found->second.lod] / 3;
     }
 
     // ļ
@@ -284,6 +386,22 @@ public:
 
     // زļĺ
     void loadMtl(const std::string& filepath);
+
+    // Parts drawn together by renderMultiDraw()
+    GLuint multi_vao = 0, multi_vbo = 0, multi_draw_ids = 0, multi_ebo = 0, multi_indirect = 0;
+    GLsizei multi_draw_count = 0;
+    GLenum multi_index_type = GL_UNSIGNED_INT;
+    std::vector<std::string> multi_part_names;
+    std::vector<GLuint> multi_instance_counts;  // as in the indirect buffer: 0 for culled parts
+
+    // Pack the given parts into one VAO, one indirect draw each. Draw i reads i from
+    // attribute 3 (an instanced attribute offset by the draw's base instance), so shaders can
+    // look up per-part data such as the material layer without a uniform per part.
+    void initialiseMultiDraw(const std::vector<std::string>& partNames);
+    bool isMultiDrawPart(const std::string& partName) const;
+    // Parts not visible draw no instance (only the changed commands are uploaded)
+    void updateMultiDraw();
+    size_t renderMultiDraw();  // returns the number of triangles drawn
 };
 
 #endif
\ No newline at end of file
@@ -23,26 +23,27 @@ SkyBoxRenderer::SkyBoxRenderer(ShaderProgram &shader_prog)
 }
 
 SkyBoxRenderer::SkyBoxRenderer(ShaderProgram &shader_prog, CubeMapTexture &cubemap_texture)
-	: Renderer(shader_prog), m_cubemap_texture(cubemap_texture)
+	: Renderer(shader_prog), m_cubemap_texture(&cubemap_texture)
 {
     this->prepare();
 }
 
 SkyBoxRenderer::SkyBoxRenderer(ShaderProgram &shader_prog, const string cubemap_faces_filenames[6])
-	: Renderer(shader_prog), m_cubemap_texture(cubemap_faces_filenames)
+	: Renderer(shader_prog), m_own_cubemap_texture(new CubeMapTexture(cubemap_faces_filenames))
 {
+    m_cubemap_texture = m_own_cubemap_texture.get();
     this->prepare();
 }
 
 void SkyBoxRenderer::setCubeMapTexture(CubeMapTexture &new_cubemap_texture)
 {
-	m_cubemap_texture = new_cubemap_texture;
+	m_cubemap_texture = &new_cubemap_texture;
 }
 
 void SkyBoxRenderer::setCubeMapTexture(const string new_cubemap_faces_filenames[6])
 {
-	CubeMapTexture new_tex(new_cubemap_faces_filenames);
-	m_cubemap_texture = new_tex;
+	m_own_cubemap_texture.reset(new CubeMapTexture(new_cubemap_faces_filenames));
+	m_cubemap_texture = m_own_cubemap_texture.get();
 }
 
 void SkyBoxRenderer::prepare()
@@ -63,7 +64,7 @@ void SkyBoxRenderer::render(const Camera &render_cam)
     
     // bind objects
     glActiveTexture(GL_TEXTURE0);
-    m_cubemap_texture.bind();
+    m_cubemap_texture->bind();
 
     // set shader as active one
     m_shader_prog.use();
@@ -81,7 +82,7 @@ void SkyBoxRenderer::render(const Camera &render_cam)
 
 CubeMapTexture &SkyBoxRenderer::getCubeMapTexture()
 {
-    return m_cubemap_texture;
+    return *m_cubemap_texture;
 }
 
 
@@ -186,8 +187,7 @@ void OceanRenderer::render(const Camera &render_cam)
     m_shader_prog.setMat4("m_matrix", model_matrix);
     m_shader_prog.setMat4("vp_matrix", vp_matrix);
 
-    // set other uniforms
-    m_shader_prog.setFloat("time", glfwGetTime());
+    // set other uniforms (time comes from the FrameData block)
     m_shader_prog.setVec3("wc_camera_pos", render_cam.getPosition());
 
     // render mesh
@@ -227,7 +227,7 @@ ReflectiveOceanRenderer::ReflectiveOceanRenderer(ShaderProgram &shader_prog, std
 }
 
 ReflectiveOceanRenderer::ReflectiveOceanRenderer(ShaderProgram &shader_prog, std::shared_ptr<GridMesh> ocean_mesh_ptr, CubeMapTexture &skybox)
-    : OceanRenderer(shader_prog, ocean_mesh_ptr), m_cubemap_texture(skybox)
+    : OceanRenderer(shader_prog, ocean_mesh_ptr), m_cubemap_texture(&skybox)
 {
     this->prepare();
 }
@@ -249,11 +249,11 @@ void ReflectiveOceanRenderer::render(const Camera &render_cam)
 {
     // bind skybox texture
     glActiveTexture(GL_TEXTURE0);
-    m_cubemap_texture.bind();
+    m_cubemap_texture->bind();
 
     // 󶨷ͼԪ1
     glActiveTexture(GL_TEXTURE1);
-    m_normal_map_texture.bind();  // ȷ `m_normal_map_texture` Ǽصķͼ
+    if (m_normal_map_texture) m_normal_map_texture->bind();  // ȷ `m_normal_map_texture` Ǽصķͼ
     m_shader_prog.setInt("normalMap", 1);  // ͼ󶨵1Ԫ
 
     // render using base renderer
@@ -262,7 +262,7 @@ void ReflectiveOceanRenderer::render(const Camera &render_cam)
 
 void ReflectiveOceanRenderer::setSkyboxTexture(CubeMapTexture &skybox)
 {
-    m_cubemap_texture = skybox;
+    m_cubemap_texture = &skybox;
 }
 
 void ReflectiveOceanRenderer::setWaterBaseColourAmount(float new_amt)
@@ -307,7 +307,7 @@ void RefractiveOceanRenderer::render(const Camera &render_cam)
 
      // 󶨷ͼԪ1
     glActiveTexture(GL_TEXTURE1);
-    m_normal_map_texture.bind();  // ȷ `m_normal_map_texture` Ǽصķͼ
+    if (m_normal_map_texture) m_normal_map_texture->bind();  // ȷ `m_normal_map_texture` Ǽصķͼ
     m_shader_prog.setInt("normalMap", 1);  // ͼ󶨵1Ԫ
 
     // render using base renderer
@@ -346,7 +346,7 @@ FullOceanRenderer::FullOceanRenderer(ShaderProgram &shader_prog, std::shared_ptr
 }
 
 FullOceanRenderer::FullOceanRenderer(ShaderProgram &shader_prog, std::shared_ptr<GridMesh> ocean_mesh_ptr, CubeMapTexture &skybox)
-    : OceanRenderer(shader_prog, ocean_mesh_ptr), m_cubemap_texture(skybox), m_texture_S(), m_fbo(m_texture_S)
+    : OceanRenderer(shader_prog, ocean_mesh_ptr), m_cubemap_texture(&skybox), m_texture_S(), m_fbo(m_texture_S)
 {
     this->prepare();
 }
@@ -383,7 +383,7 @@ void FullOceanRenderer::render(const Camera &render_cam)
     // --- for reflection ---
     // bind skybox texture
     glActiveTexture(GL_TEXTURE0);
-    m_cubemap_texture.bind();
+    m_cubemap_texture->bind();
 
     // --- for refraction ---
     // bind texture S
@@ -411,7 +411,7 @@ Texture2D &FullOceanRenderer::getTextureS()
 
 void FullOceanRenderer::setSkyboxTexture(CubeMapTexture &skybox)
 {
-    m_cubemap_texture = skybox;
+    m_cubemap_texture = &skybox;
 }
 
 void FullOceanRenderer::setWaterBaseColourAmount(float new_amt)
@@ -425,8 +425,8 @@ void FullOceanRenderer::setWaterBaseColourAmount(float new_amt)
 // --- Seabed renderer ---
 
 SeabedRenderer::SeabedRenderer(ShaderProgram &shader_prog, Texture2D &perlin_tex)
-    : Renderer(shader_prog), m_perlin_texture(perlin_tex), 
-    m_seabed_texture(), m_use_seabed_texture(false),
+    : Renderer(shader_prog), m_perlin_texture(&perlin_tex), 
+    m_seabed_texture(nullptr), m_use_seabed_texture(false),
     m_seabed_mesh(CGRA350Constants::DEFAULT_SEABED_GRID_WIDTH, CGRA350Constants::DEFAULT_SEABED_GRID_LENGTH)
 {
     m_seabed_mesh.initialise();
@@ -434,8 +434,8 @@ SeabedRenderer::SeabedRenderer(ShaderProgram &shader_prog, Texture2D &perlin_tex
 }
 
 SeabedRenderer::SeabedRenderer(ShaderProgram &shader_prog, Texture2D &perlin_tex, Texture2D &seabed_tex)
-    : Renderer(shader_prog), m_perlin_texture(perlin_tex), 
-    m_seabed_texture(seabed_tex), m_use_seabed_texture(true),
+    : Renderer(shader_prog), m_perlin_texture(&perlin_tex), 
+    m_seabed_texture(&seabed_tex), m_use_seabed_texture(true),
     m_seabed_mesh(CGRA350Constants::DEFAULT_SEABED_GRID_WIDTH, CGRA350Constants::DEFAULT_SEABED_GRID_LENGTH)
 {
     m_seabed_mesh.initialise();
@@ -489,13 +489,13 @@ void SeabedRenderer::render(const Camera &render_cam)
 
     // bind perlin noise texture
     glActiveTexture(GL_TEXTURE0);
-    m_perlin_texture.bind();
+    m_perlin_texture->bind();
 
     // bind seabed texture
     if (m_use_seabed_texture)
     {
         glActiveTexture(GL_TEXTURE1);
-        m_seabed_texture.bind();
+        m_seabed_texture->bind();
     }
 
     // render mesh
@@ -519,12 +519,12 @@ void SeabedRenderer::setSeabedLength(int new_seabed_length)
 
 void SeabedRenderer::setPerlinTexture(Texture2D &perlin_tex)
 {
-    m_perlin_texture = perlin_tex;
+    m_perlin_texture = &perlin_tex;
 }
 
 void SeabedRenderer::setSeabedTexture(Texture2D &seabed_tex)
 {
-    m_seabed_texture = seabed_tex;
+    m_seabed_texture = &seabed_tex;
     if (m_use_seabed_texture != true)
     {
         m_use_seabed_texture = true;
@@ -545,7 +545,7 @@ void SeabedRenderer::removeSeabedTexture()
 // --- Screen Quad renderer (for visual debugging) ---
 
 ScreenQuadRenderer::ScreenQuadRenderer(ShaderProgram &shader_prog, Texture2D &screen_tex)
-    : Renderer(shader_prog), m_quad_mesh(), m_screen_tex(screen_tex)
+    : Renderer(shader_prog), m_quad_mesh(), m_screen_tex(&screen_tex)
 {
     m_quad_mesh.initialise();
     this->prepare();
@@ -568,7 +568,7 @@ void ScreenQuadRenderer::render(const Camera &render_cam)
 
     // bind screeen texture
     glActiveTexture(GL_TEXTURE0);
-    m_screen_tex.bind();
+    m_screen_tex->bind();
 
     // render
     m_quad_mesh.render();
@@ -17,7 +17,7 @@
 class Renderer
 {
 protected:
-	ShaderProgram m_shader_prog;
+	ShaderProgram &m_shader_prog;	// not owned (see ShaderCache)
 
 public:
 	Renderer(ShaderProgram &shader_prog);
@@ -36,13 +36,18 @@ public:
 };
 
 
+// ------------------------------------
+// Renderers keep non-owning pointers to the textures they are given, which must outlive
+// them (or be replaced first); only textures they create themselves are owned.
+
 // ------------------------------------
 // --- Skybox renderer ---
 class SkyBoxRenderer : public Renderer
 {
 private:
-	CubeMapMesh m_cubemap_mesh = CubeMapMesh::getInstance();
-	CubeMapTexture m_cubemap_texture;
+	CubeMapMesh &m_cubemap_mesh = CubeMapMesh::getInstance();
+	CubeMapTexture *m_cubemap_texture;						// not owned (unless it is the one below)
+	std::unique_ptr<CubeMapTexture> m_own_cubemap_texture;	// when given face filenames
 
 	void prepare();
 
@@ -93,8 +98,8 @@ public:
 class ReflectiveOceanRenderer : public OceanRenderer
 {
 private:
-	CubeMapTexture m_cubemap_texture;
-	Texture2D m_normal_map_texture;  //Add: ˮ沨Ʒͼ
+	CubeMapTexture *m_cubemap_texture;	// not owned
+	Texture2D *m_normal_map_texture = nullptr;  //Add: ˮ沨Ʒͼ
 
 	void prepare();
 
@@ -110,7 +115,7 @@ public:
 	//Add: ÷ͼ
 	void setNormalMapTexture(Texture2D &normal_map)
 	{
-		m_normal_map_texture = normal_map;
+		m_normal_map_texture = &normal_map;
 	}
 
 };
@@ -121,7 +126,7 @@ class RefractiveOceanRenderer : public OceanRenderer
 private:
 	Texture2D m_texture_S;
 	FBO m_fbo;
-	Texture2D m_normal_map_texture;  //Add: ˮ沨Ʒͼ
+	Texture2D *m_normal_map_texture = nullptr;  //Add: ˮ沨Ʒͼ
 
 	void prepare();
 
@@ -140,7 +145,7 @@ public:
 	//Add: ÷ͼ
 	void setNormalMapTexture(Texture2D &normal_map)
 	{
-		m_normal_map_texture = normal_map;
+		m_normal_map_texture = &normal_map;
 	}
 
 };
@@ -151,7 +156,7 @@ class FullOceanRenderer : public OceanRenderer
 {
 private:
 	// for reflection
-	CubeMapTexture m_cubemap_texture;
+	CubeMapTexture *m_cubemap_texture;	// not owned
 	// for refraction
 	Texture2D m_texture_S;
 	FBO m_fbo;
@@ -189,9 +194,9 @@ private:
 	int m_seabed_width = CGRA350Constants::DEFAULT_OCEAN_WIDTH + CGRA350Constants::SEABED_EXTENSION_FROM_OCEAN;
 	int m_seabed_length = CGRA350Constants::DEFAULT_OCEAN_LENGTH + CGRA350Constants::SEABED_EXTENSION_FROM_OCEAN;
 
-	Texture2D m_perlin_texture;
+	Texture2D *m_perlin_texture;	// not owned
 	bool m_use_seabed_texture;
-	Texture2D m_seabed_texture;
+	Texture2D *m_seabed_texture;	// not owned
 
 	void prepare();
 
@@ -217,7 +222,7 @@ class ScreenQuadRenderer : public Renderer
 {
 private:
 	ScreenQuadMesh m_quad_mesh;
-	Texture2D m_screen_tex;
+	Texture2D *m_screen_tex;	// not owned
 	void prepare();
 
 public:
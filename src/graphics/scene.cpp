@@ -0,0 +1,259 @@
+#include "scene.h"
+#include "../main/constants.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+// ------------------------------------------
+// --- Scene class ---
+
+int Scene::addNode(const glm::mat4 &local, int parent)
+{
+    Node node = { parent < (int)m_nodes.size() ? parent : -1, local, local, true };
+    m_nodes.push_back(node);
+    return (int)m_nodes.size() - 1;
+}
+
+void Scene::setLocalTransform(int node, const glm::mat4 &local)
+{
+    m_nodes[node].local = local;
+    m_nodes[node].dirty = true;
+}
+
+// as of the last update()
+const glm::mat4 &Scene::getWorldTransform(int node) const
+{
+    return m_nodes[node].world;
+}
+
+int Scene::addMaterial(const SceneMaterial &material)
+{
+    m_materials.push_back(material);
+    return (int)m_materials.size() - 1;
+}
+
+SceneMaterial &Scene::getMaterial(int material)
+{
+    return m_materials[material];
+}
+
+int Scene::addEntity(int node, ObjMesh &mesh, const string &part_name, int material, unsigned int layers)
+{
+    auto part = mesh.parts.find(part_name);
+    if (part == mesh.parts.end())
+    {
+        std::cout << "Scene: no part " << part_name << " to draw" << std::endl;
+        return -1;
+    }
+
+    // render() draws all of a mesh's multi-draw parts in one call, with the node & material of
+    // the first, so each part is added once and they all share those
+    bool multi_draw = mesh.isMultiDrawPart(part_name);
+    for (const Entity &other : m_entities)
+    {
+        if (multi_draw && other.mesh == &mesh && other.multi_draw &&
+            (other.part == &part->second || other.node != node || other.material != material))
+        {
+            std::cout << "Scene: " << part_name << " would split its mesh's multi-draw (added twice, or at another node or material)" << std::endl;
+            return -1;
+        }
+    }
+
+    auto found = std::find(m_meshes.begin(), m_meshes.end(), &mesh);
+    int mesh_id = (int)(found - m_meshes.begin());
+    if (found == m_meshes.end())
+    {
+        m_meshes.push_back(&mesh);
+    }
+
+    Entity entity = { node, &mesh, &part->second, part_name, material, mesh_id, multi_draw, layers };
+    m_entities.push_back(entity);
+    // placed at the next update
+    m_bounds.add(part->second.aabb_min, part->second.aabb_max, glm::mat4(1.0f));
+    m_nodes[node].dirty = true;
+    return (int)m_entities.size() - 1;
+}
+
+void Scene::setVisibleLayers(unsigned int layers)
+{
+    m_visible_layers = layers;
+}
+
+void Scene::updateTransforms()
+{
+    // parents come before their children, so are up to date by the time the children are
+    for (Node &node : m_nodes)
+    {
+        if (node.parent >= 0 && m_nodes[node.parent].dirty)
+        {
+            node.dirty = true;
+        }
+        if (node.dirty)
+        {
+            node.world = node.parent >= 0 ? m_nodes[node.parent].world * node.local : node.local;
+        }
+    }
+
+    for (size_t i = 0; i < m_entities.size(); i++)
+    {
+        const Entity &entity = m_entities[i];
+        if (m_nodes[entity.node].dirty)
+        {
+            m_bounds.set(i, entity.part->aabb_min, entity.part->aabb_max, m_nodes[entity.node].world);
+        }
+    }
+
+    for (Node &node : m_nodes)
+    {
+        node.dirty = false;
+    }
+}
+
+void Scene::update(const glm::mat4 &view_projection, const glm::vec3 &camera_pos, float projection_scale)
+{
+    updateTransforms();
+    Culling::cull(m_bounds, Culling::extractFrustum(view_projection), camera_pos, projection_scale,
+        CGRA350Constants::PROP_CULL_MIN_PIXELS, m_visible, &m_culling_stats);
+
+    m_draw_list.clear();
+    for (size_t i = 0; i < m_entities.size(); i++)
+    {
+        Entity &entity = m_entities[i];
+        bool visible = m_visible[i] && (entity.layers & m_visible_layers) != 0;
+        if (entity.multi_draw)
+        {
+            // the multi-draw skips it
+            entity.part->visible = visible;
+        }
+        if (!visible)
+        {
+            continue;
+        }
+
+        if (!entity.multi_draw)
+        {
+            // the shaders take the xyz of model * position, so a model matrix with w != 1 still
+            // scales by the length of its first column
+            const glm::mat4 &world = m_nodes[entity.node].world;
+            float scale = glm::length(glm::vec3(world[0]));
+            glm::vec3 centre = glm::vec3(world * glm::vec4(entity.part->centre, 1.0f));
+            float distance = std::max(glm::length(centre - camera_pos) - entity.part->radius * scale, CGRA350Constants::CAMERA_NEAR_PLANE);
+            entity.part->selectLod(scale * projection_scale / distance, CGRA350Constants::LOD_MAX_PIXEL_ERROR, CGRA350Constants::LOD_HYSTERESIS);
+        }
+
+        const SceneMaterial &material = m_materials[entity.material];
+        uint64_t program = material.program->getHandle() & 0xFFFF;
+        uint64_t key = program << 48 | (uint64_t)(entity.material & 0xFFFF) << 32 | (uint64_t)(entity.mesh_id & 0xFFFF) << 16 | (i & 0xFFFF);
+        m_draw_list.push_back({ key, (int)i });
+    }
+
+    // binds in the order the entities were added, for comparison
+    m_draw_stats = SceneDrawStats();
+    const ShaderProgram *program = nullptr;
+    int material = -1;
+    for (const DrawItem &item : m_draw_list)
+    {
+        const Entity &entity = m_entities[item.entity];
+        if (m_materials[entity.material].program != program)
+        {
+            program = m_materials[entity.material].program;
+            material = -1;
+            m_draw_stats.unsorted_program_binds++;
+        }
+        if (entity.material != material)
+        {
+            material = entity.material;
+            m_draw_stats.unsorted_material_binds++;
+        }
+    }
+
+    std::sort(m_draw_list.begin(), m_draw_list.end(), [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+}
+
+void Scene::bindMaterial(int material)
+{
+    SceneMaterial &scene_material = m_materials[material];
+    ShaderProgram &program = *scene_material.program;
+    for (const auto &texture : scene_material.textures)
+    {
+        glActiveTexture(GL_TEXTURE0 + texture.first);
+        texture.second->bind();
+    }
+
+    auto last = m_program_materials.find(program.getHandle());
+    if (last == m_program_materials.end() || last->second != material)
+    {
+        for (const auto &uniform : scene_material.int_uniforms)
+        {
+            program.setInt(uniform.first, uniform.second);
+        }
+        for (const auto &uniform : scene_material.vec3_uniforms)
+        {
+            program.setVec3(uniform.first, uniform.second);
+        }
+        m_program_materials[program.getHandle()] = material;
+    }
+
+    if (scene_material.bind)
+    {
+        scene_material.bind(program);
+    }
+}
+
+void Scene::render()
+{
+    ShaderProgram *program = nullptr;
+    int material = -1;
+    for (size_t i = 0; i < m_draw_list.size(); i++)
+    {
+        const Entity &entity = m_entities[m_draw_list[i].entity];
+        SceneMaterial &entity_material = m_materials[entity.material];
+        if (entity_material.program != program)
+        {
+            program = entity_material.program;
+            program->use();
+            material = -1;
+            m_draw_stats.program_binds++;
+        }
+        if (entity.material != material)
+        {
+            bindMaterial(entity.material);
+            material = entity.material;
+            m_draw_stats.material_binds++;
+        }
+        program->setMat4("model", m_nodes[entity.node].world);
+
+        if (entity.multi_draw)
+        {
+            // one draw for the run of the mesh's parts (addEntity keeps them to one node & material)
+            while (i + 1 < m_draw_list.size())
+            {
+                const Entity &next = m_entities[m_draw_list[i + 1].entity];
+                if (next.mesh != entity.mesh || next.material != entity.material || !next.multi_draw)
+                {
+                    break;
+                }
+                i++;
+            }
+            entity.mesh->updateMultiDraw();
+            m_draw_stats.triangles += (unsigned int)entity.mesh->renderMultiDraw();
+        }
+        else
+        {
+            entity.part->render();
+            m_draw_stats.triangles += (unsigned int)(entity.part->level_counts[entity.part->lod] / 3);
+        }
+        m_draw_stats.draws++;
+    }
+}
+
+const CullingStats &Scene::getCullingStats() const
+{
+    return m_culling_stats;
+}
+
+const SceneDrawStats &Scene::getDrawStats() const
+{
+    return m_draw_stats;
+}
@@ -0,0 +1,122 @@
+#ifndef SCENE
+#define SCENE
+#pragma once
+
+#include "meshes.h"
+#include "shaders.h"
+#include "textures.h"
+#include "../utils/culling.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+// --- Scene Material ---
+// What a draw binds besides its mesh: the program, the textures at their units and the
+// uniforms. The constant uniforms are only set when the program last drew another material
+// (uniform values stay with the program); bind() sets the ones that change between frames.
+struct SceneMaterial
+{
+	ShaderProgram *program = nullptr;
+	std::vector<std::pair<int, std::shared_ptr<Texture2D>>> textures;	// (texture unit, texture)
+	std::vector<std::pair<string, int>> int_uniforms;
+	std::vector<std::pair<string, glm::vec3>> vec3_uniforms;
+	std::function<void(ShaderProgram &)> bind;
+};
+
+// Draws of the last Scene::render, and the program & material binds they took, against the
+// binds had they gone in the order the entities were added (as the render loop used to draw)
+struct SceneDrawStats
+{
+	int draws = 0;		// a multi-draw counts once
+	unsigned int triangles = 0;
+	int program_binds = 0;
+	int material_binds = 0;
+	int unsorted_program_binds = 0;
+	int unsorted_material_binds = 0;
+};
+
+// --- Scene ---
+// What the render loop draws, set up once: a graph of transform nodes, the materials, and the
+// entities (a part of an ObjMesh, drawn with a material at a node). Each frame, update()
+// recomputes the world transforms of the nodes moved since the last one (and their children's),
+// culls the entities and picks their levels of detail, and lists the visible ones sorted by
+// (program, material, mesh) for render(), so each program and material is bound once per run
+// of draws that share it. Parts of a mesh's multi-draw are drawn by it, one draw per run.
+class Scene
+{
+private:
+	struct Node
+	{
+		int parent;
+		glm::mat4 local;
+		glm::mat4 world;
+		bool dirty;
+	};
+
+	struct Entity
+	{
+		int node;
+		ObjMesh *mesh;
+		MeshPart *part;
+		string part_name;
+		int material;
+		int mesh_id;		// index in m_meshes
+		bool multi_draw;
+		unsigned int layers;
+	};
+
+	struct DrawItem
+	{
+		uint64_t key;		// program, material, mesh & entity, most significant first
+		int entity;
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<SceneMaterial> m_materials;
+	std::vector<Entity> m_entities;
+	std::vector<ObjMesh *> m_meshes;
+	unsigned int m_visible_layers = ~0u;
+
+	CullingBounds m_bounds;		// one per entity
+	std::vector<uint8_t> m_visible;
+	CullingStats m_culling_stats;
+
+	std::vector<DrawItem> m_draw_list;
+	SceneDrawStats m_draw_stats;
+	std::unordered_map<GLuint, int> m_program_materials;	// material each program last drew
+
+	void updateTransforms();
+	void bindMaterial(int material);
+
+public:
+	// parent: an earlier node, or -1
+	int addNode(const glm::mat4 &local, int parent = -1);
+	void setLocalTransform(int node, const glm::mat4 &local);
+	const glm::mat4 &getWorldTransform(int node) const;
+
+	int addMaterial(const SceneMaterial &material);
+	SceneMaterial &getMaterial(int material);
+
+	// The part (initialised) drawn with material at node; -1 if mesh has no such part, or if the
+	// part is in the mesh's multi-draw and is already in the scene or another of its parts is at
+	// a different node or material. layers: bits of the entity, drawn while any of them is visible
+	int addEntity(int node, ObjMesh &mesh, const string &part_name, int material, unsigned int layers = 1);
+	void setVisibleLayers(unsigned int layers);
+
+	// projection_scale: pixels per unit at a distance of 1
+	void update(const glm::mat4 &view_projection, const glm::vec3 &camera_pos, float projection_scale);
+	void render();
+
+	const CullingStats &getCullingStats() const;
+	const SceneDrawStats &getDrawStats() const;
+};
+#endif
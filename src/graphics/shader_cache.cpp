@@ -0,0 +1,208 @@
+#include "shader_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#define SHADER_BINARY_MAGIC 0x31425053		// "SPB1"
+
+// Header of a saved program binary, followed by length bytes of binary
+struct ShaderBinaryHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint64_t length;
+};
+
+static const uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+// FNV-1a of s, continuing from h; strings are terminated so that ("ab", "c") and ("a", "bc") differ
+static uint64_t hashString(uint64_t h, const string &s)
+{
+    const uint64_t prime = 0x100000001b3ull;
+    for (unsigned char c : s)
+    {
+        h = (h ^ c) * prime;
+    }
+    return (h ^ 0xff) * prime;
+}
+
+
+// ------------------------------------------
+// --- ShaderCache class ---
+
+ShaderCache::ShaderCache(string folder, bool reloadable)
+    : m_folder(folder), m_save_binaries(false), m_reloadable(reloadable)
+{
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    if (!m_folder.empty() && num_formats > 0)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(m_folder, error);
+        m_save_binaries = !error;
+        if (error)
+        {
+            std::cout << "ShaderCache: could not create '" << m_folder << "', programs are compiled every run" << std::endl;
+        }
+    }
+
+    // binaries only load on the driver that saved them
+    const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : names)
+    {
+        const GLubyte *value = glGetString(name);
+        m_driver += (value ? (const char *)value : "") + string("\n");
+    }
+}
+
+ShaderProgram &ShaderCache::getProgram(const std::vector<string> &files, const std::vector<string> &defines)
+{
+    uint64_t key = HASH_SEED;
+    for (const string &file : files)
+    {
+        key = hashString(key, file);
+    }
+    key = hashString(key, "");
+    for (const string &define : defines)
+    {
+        key = hashString(key, define);
+    }
+
+    CachedProgram &cached = m_programs[key];
+    std::unique_ptr<ShaderProgram> &program = cached.program;
+    if (program)
+    {
+        return *program;
+    }
+    cached.files = files;
+    cached.defines = defines;
+
+    auto start_time = std::chrono::steady_clock::now();
+    string name;
+    for (const string &file : files)
+    {
+        name += (name.empty() ? "'" : " & '") + file + "'";
+    }
+
+    // the binary's key covers the sources (includes expanded) & the driver too, so edited
+    // shaders compile again
+    string path;
+    uint64_t binary_key = 0;
+    bool sources_read = true;
+    if (m_save_binaries)
+    {
+        binary_key = hashString(key, m_driver);
+        for (const string &file : files)
+        {
+            string source;
+            std::vector<string> included;
+            sources_read = Shader::preprocess(file, defines, source, included) && sources_read;
+            binary_key = hashString(binary_key, source);
+        }
+        char filename[32];
+        snprintf(filename, sizeof(filename), "%016llx.bin", (unsigned long long)binary_key);
+        path = (std::filesystem::path(m_folder) / filename).string();
+
+        GLenum binary_format;
+        std::vector<char> binary;
+        if (sources_read && loadBinary(path, binary_key, binary_format, binary))
+        {
+            program = std::make_unique<ShaderProgram>(name, binary_format, binary);
+            program->setKeepUniformValues(m_reloadable);
+            if (program->isLinked())
+            {
+                m_num_loaded++;
+                m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+                return *program;
+            }
+        }
+    }
+
+    std::vector<Shader> shaders;
+    for (const string &file : files)
+    {
+        shaders.emplace_back(file, defines);
+    }
+    program = std::make_unique<ShaderProgram>(shaders, m_save_binaries);
+    program->setKeepUniformValues(m_reloadable);
+    if (m_save_binaries && sources_read && program->isLinked())
+    {
+        saveBinary(path, binary_key, *program);
+    }
+    m_num_compiled++;
+    m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return *program;
+}
+
+bool ShaderCache::loadBinary(const string &path, uint64_t key, GLenum &binary_format, std::vector<char> &binary) const
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    ShaderBinaryHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == SHADER_BINARY_MAGIC && header.key == key && header.length > 0 && header.length < (1u << 30);
+    if (ok)
+    {
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        binary_format = header.format;
+    }
+    fclose(file);
+    return ok;
+}
+
+void ShaderCache::saveBinary(const string &path, uint64_t key, const ShaderProgram &program) const
+{
+    GLenum binary_format;
+    std::vector<char> binary;
+    if (!program.getBinary(binary_format, binary))
+    {
+        return;
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return;
+    }
+    ShaderBinaryHeader header = { SHADER_BINARY_MAGIC, binary_format, key, binary.size() };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        // a partial file would only be rejected on load, but costs a read every run
+        std::remove(path.c_str());
+    }
+}
+
+const std::unordered_map<uint64_t, ShaderCache::CachedProgram> &ShaderCache::getPrograms() const
+{
+    return m_programs;
+}
+
+int ShaderCache::bindUniformBlock(const string &block, GLuint binding) const
+{
+    int num_bound = 0;
+    for (const auto &cached : m_programs)
+    {
+        if (cached.second.program->bindUniformBlock(block, binding))
+        {
+            num_bound++;
+        }
+    }
+    return num_bound;
+}
+
+void ShaderCache::printSummary() const
+{
+    std::cout << "Shader programs: " << m_num_compiled << " compiled, " << m_num_loaded
+        << " loaded from binaries, in " << m_seconds << " s" << std::endl;
+}
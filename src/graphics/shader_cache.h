@@ -0,0 +1,62 @@
+#ifndef SHADER_CACHE
+#define SHADER_CACHE
+#pragma once
+
+#include "shaders.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+// --- Shader Cache ---
+// Hands out programs shared by their stage files & defines, so a combination is compiled and
+// linked once and switching between programs costs nothing. Linked programs are also saved
+// as driver binaries in the cache folder, keyed by a hash of the sources, the defines & the
+// driver, and later runs load them instead of compiling (falling back to compiling when the
+// driver rejects a binary). Programs live as long as the cache.
+class ShaderCache
+{
+public:
+	struct CachedProgram
+	{
+		std::unique_ptr<ShaderProgram> program;
+		std::vector<string> files;
+		std::vector<string> defines;
+	};
+
+private:
+	string m_folder;
+	bool m_save_binaries;
+	bool m_reloadable;
+	string m_driver;		// vendor, renderer & version strings
+	std::unordered_map<uint64_t, CachedProgram> m_programs;	// key: files & defines
+
+	// how the programs were made
+	int m_num_compiled = 0;
+	int m_num_loaded = 0;
+	double m_seconds = 0;
+
+	bool loadBinary(const string &path, uint64_t key, GLenum &binary_format, std::vector<char> &binary) const;
+	void saveBinary(const string &path, uint64_t key, const ShaderProgram &program) const;
+
+public:
+	// folder "" keeps programs in memory only; reloadable: programs keep their uniform values
+	// so that they can be rebuilt from edited files (see ShaderWatcher)
+	ShaderCache(string folder, bool reloadable = false);
+
+	// files: one per stage, in the shaders folder; defines: as for Shader
+	ShaderProgram &getProgram(const std::vector<string> &files, const std::vector<string> &defines = {});
+
+	const std::unordered_map<uint64_t, CachedProgram> &getPrograms() const;
+
+	// Bind the named uniform block of every program that declares it; returns how many do
+	int bindUniformBlock(const string &block, GLuint binding) const;
+
+	// Prints how many programs were compiled & loaded from binaries, and the time taken
+	void printSummary() const;
+};
+#endif
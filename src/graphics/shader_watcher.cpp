@@ -0,0 +1,209 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+extern string SHADERS_FOLDER_PATH;
+
+// Modification time of a file in the shaders folder (the minimum when it cannot be read, e.g.
+// while an editor replaces it)
+static std::filesystem::file_time_type getWriteTime(const string &filename)
+{
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(SHADERS_FOLDER_PATH + filename, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+
+// ------------------------------------------
+// --- ShaderWatcher class ---
+
+ShaderWatcher::ShaderWatcher(ShaderCache &cache, GLFWwindow *window, int poll_ms)
+    : m_poll_ms(poll_ms)
+{
+    for (const auto &cached : cache.getPrograms())
+    {
+        WatchedProgram watched;
+        watched.program = cached.second.program.get();
+        watched.files = cached.second.files;
+        watched.defines = cached.second.defines;
+        for (const string &file : watched.files)
+        {
+            watched.name += (watched.name.empty() ? "'" : " & '") + file + "'";
+        }
+        findDependencies(watched);
+        m_watched.push_back(std::move(watched));
+    }
+
+    // the compile context: same hints as the main window's, but never shown
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_context = glfwCreateWindow(1, 1, "Shader compiler", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (m_context == nullptr)
+    {
+        std::cout << "ShaderWatcher: could not create a shared context, shader hot reload is off" << std::endl;
+        return;
+    }
+    m_worker = std::thread(&ShaderWatcher::workerLoop, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    if (m_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = true;
+        }
+        m_stop_signal.notify_all();
+        m_worker.join();
+    }
+    for (RebuiltProgram &rebuilt : m_rebuilt)
+    {
+        glDeleteSync(rebuilt.fence);
+    }
+    m_rebuilt.clear();
+    if (m_context != nullptr)
+    {
+        glfwDestroyWindow(m_context);
+    }
+}
+
+void ShaderWatcher::update()
+{
+    std::deque<RebuiltProgram> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        while (!m_rebuilt.empty())
+        {
+            // the compile thread flushed the fence, so a zero timeout is enough
+            GLenum status = glClientWaitSync(m_rebuilt.front().fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                break;
+            }
+            ready.push_back(std::move(m_rebuilt.front()));
+            m_rebuilt.pop_front();
+        }
+    }
+
+    for (RebuiltProgram &rebuilt : ready)
+    {
+        glDeleteSync(rebuilt.fence);
+        rebuilt.target->swapProgram(*rebuilt.program);
+        rebuilt.program.reset();	// deletes the old program object
+        m_num_reloaded++;
+        std::cout << "Reloaded shader program " << rebuilt.name << std::endl;
+    }
+}
+
+bool ShaderWatcher::isWatching() const
+{
+    return m_worker.joinable();
+}
+
+int ShaderWatcher::getNumReloaded() const
+{
+    return m_num_reloaded;
+}
+
+void ShaderWatcher::workerLoop()
+{
+    glfwMakeContextCurrent(m_context);
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (!m_stop)
+    {
+        m_stop_signal.wait_for(lock, std::chrono::milliseconds(m_poll_ms));
+        if (m_stop)
+        {
+            break;
+        }
+        lock.unlock();
+        for (WatchedProgram &watched : m_watched)
+        {
+            if (hasChanged(watched))
+            {
+                rebuild(watched);
+            }
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+bool ShaderWatcher::hasChanged(WatchedProgram &watched) const
+{
+    bool changed = false;
+    for (size_t i = 0; i < watched.dependencies.size(); i++)
+    {
+        std::filesystem::file_time_type time = getWriteTime(watched.dependencies[i]);
+        if (time != std::filesystem::file_time_type::min() && time != watched.times[i])
+        {
+            watched.times[i] = time;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Compile & link the program again on the compile thread's context
+void ShaderWatcher::rebuild(WatchedProgram &watched)
+{
+    std::vector<Shader> shaders;
+    for (const string &file : watched.files)
+    {
+        shaders.emplace_back(file, watched.defines);
+    }
+    std::unique_ptr<ShaderProgram> program = std::make_unique<ShaderProgram>(shaders);
+
+    // edits may add or remove includes
+    findDependencies(watched);
+
+    if (!program->isLinked())
+    {
+        std::cout << "Keeping the previous version of shader program " << watched.name << std::endl;
+        return;
+    }
+
+    // the main context may only use the program once the GPU is done building it
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_rebuilt.push_back({ watched.program, watched.name, std::move(program), fence });
+}
+
+// Files of the program & their includes; files watched already keep their time
+void ShaderWatcher::findDependencies(WatchedProgram &watched)
+{
+    std::vector<string> old_dependencies;
+    std::vector<std::filesystem::file_time_type> old_times;
+    old_dependencies.swap(watched.dependencies);
+    old_times.swap(watched.times);
+    for (const string &file : watched.files)
+    {
+        string source;
+        std::vector<string> files;
+        Shader::preprocess(file, watched.defines, source, files);
+        if (files.empty())
+        {
+            files.push_back(file);	// unreadable for now: watch it anyway
+        }
+        for (const string &dependency : files)
+        {
+            if (std::find(watched.dependencies.begin(), watched.dependencies.end(), dependency) == watched.dependencies.end())
+            {
+                watched.dependencies.push_back(dependency);
+            }
+        }
+    }
+    for (const string &dependency : watched.dependencies)
+    {
+        auto old = std::find(old_dependencies.begin(), old_dependencies.end(), dependency);
+        watched.times.push_back(old != old_dependencies.end() ? old_times[old - old_dependencies.begin()] : getWriteTime(dependency));
+    }
+}
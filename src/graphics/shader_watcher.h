@@ -0,0 +1,77 @@
+#ifndef SHADER_WATCHER
+#define SHADER_WATCHER
+#pragma once
+
+#include "shader_cache.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+// --- Shader Watcher ---
+// Hot reload: a thread polls the files (includes too) of every program of a ShaderCache and
+// rebuilds the programs whose files changed on a hidden context sharing objects with the main
+// window. update() then swaps the rebuilt programs in on the GL thread once the GPU has them
+// (see ShaderProgram::swapProgram), so editing a shader never stalls the render loop. A
+// program that fails to compile or link is reported and the old one is kept.
+class ShaderWatcher
+{
+public:
+	// Watches the programs created so far; the cache should be reloadable (see ShaderCache).
+	// Call from the GL thread, with the main window's context current.
+	ShaderWatcher(ShaderCache &cache, GLFWwindow *window, int poll_ms = 250);
+	~ShaderWatcher();
+	ShaderWatcher(const ShaderWatcher &) = delete;
+	ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+	// Swap in the programs rebuilt since the last call; once a frame
+	void update();
+
+	bool isWatching() const;
+	int getNumReloaded() const;
+
+private:
+	struct WatchedProgram
+	{
+		ShaderProgram *program;
+		string name;
+		std::vector<string> files;
+		std::vector<string> defines;
+		std::vector<string> dependencies;	// files & their includes
+		std::vector<std::filesystem::file_time_type> times;
+	};
+
+	struct RebuiltProgram
+	{
+		ShaderProgram *target;
+		string name;
+		std::unique_ptr<ShaderProgram> program;
+		GLsync fence;
+	};
+
+	void workerLoop();
+	bool hasChanged(WatchedProgram &watched) const;
+	void rebuild(WatchedProgram &watched);
+	static void findDependencies(WatchedProgram &watched);
+
+	GLFWwindow *m_context = nullptr;		// hidden window of the compile thread
+	int m_poll_ms;
+	std::vector<WatchedProgram> m_watched;	// compile thread only, once started
+
+	std::thread m_worker;
+	std::mutex m_lock;
+	std::condition_variable m_stop_signal;
+	bool m_stop = false;
+	std::deque<RebuiltProgram> m_rebuilt;
+	int m_num_reloaded = 0;
+};
+#endif
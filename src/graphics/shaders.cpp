@@ -1,4 +1,6 @@
 #include "shaders.h"
+#include "gl_call_counts.h"
+#include <algorithm>
 #include <iostream>
 
 using std::string;
@@ -8,27 +10,121 @@ string SHADERS_FOLDER_PATH = PROJECT_SOURCE_DIR "/resources/shaders/";
 // ------------------------------------------
 // --- Shader Class ---
 
-Shader::Shader(string filename) : m_filename(filename)
+Shader::Shader(string filename, const std::vector<string> &defines) : m_filename(filename), m_defines(defines), m_type(0), m_id(0)
 {
 	loadAndCompile();
 }
 
-
-// Load the shader source code from the file, set the shader type and compile the shader
-void Shader::loadAndCompile()
+bool Shader::readSource(const string &filename, string &source)
 {
 	// Attempt to read shader file
-	std::ifstream in_file_stream(SHADERS_FOLDER_PATH + m_filename);
+	std::ifstream in_file_stream(SHADERS_FOLDER_PATH + filename);
 	if (!in_file_stream)
 	{
 		std::cout << "ERROR::SHADER::COULD_NOT_OPEN_FILE" << std::endl
-			<< "File '" << m_filename << "' not found" << std::endl;
-		return;
+			<< "File '" << filename << "' not found" << std::endl;
+		return false;
 	}
 	std::stringstream in_string_stream;
 	in_string_stream << in_file_stream.rdbuf();
-	in_file_stream.close();
-	string shader_source_str = in_string_stream.str();
+	source = in_string_stream.str();
+	return true;
+}
+
+
+// Append filename to out with its includes expanded; files already in files are skipped
+static bool expandIncludes(const string &filename, string &out, std::vector<string> &files)
+{
+	string source;
+	if (!Shader::readSource(filename, source))
+	{
+		return false;
+	}
+	string file_number = std::to_string(files.size());
+	files.push_back(filename);
+
+	std::istringstream lines(source);
+	string line;
+	int line_number = 0;
+	while (std::getline(lines, line))
+	{
+		line_number++;
+		size_t start = line.find_first_not_of(" \t");
+		if (start == string::npos || line.compare(start, 8, "#include") != 0)
+		{
+			out += line + "\n";
+			continue;
+		}
+
+		size_t open = line.find('"', start + 8);
+		size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+		if (close == string::npos)
+		{
+			std::cout << "ERROR::SHADER::BAD_INCLUDE" << std::endl
+				<< "'" << filename << "' line " << line_number << ": " << line << std::endl;
+			return false;
+		}
+		string include = line.substr(open + 1, close - open - 1);
+		if (std::find(files.begin(), files.end(), include) != files.end())
+		{
+			out += "\n";	// included already (or by itself): keep the line count
+			continue;
+		}
+		out += "#line 1 " + std::to_string(files.size()) + "\n";
+		if (!expandIncludes(include, out, files))
+		{
+			return false;
+		}
+		out += "#line " + std::to_string(line_number + 1) + " " + file_number + "\n";
+	}
+	return true;
+}
+
+bool Shader::preprocess(const string &filename, const std::vector<string> &defines, string &source, std::vector<string> &files)
+{
+	source.clear();
+	files.clear();
+	if (!expandIncludes(filename, source, files))
+	{
+		return false;
+	}
+
+	// Defines go after the #version line, which has to come first
+	if (!defines.empty())
+	{
+		size_t insert_at = 0;
+		size_t version = source.find("#version");
+		if (version != string::npos)
+		{
+			insert_at = source.find('\n', version);
+			if (insert_at == string::npos)
+			{
+				source += '\n';
+				insert_at = source.size() - 1;
+			}
+			insert_at++;
+		}
+		int next_line = 1 + (int)std::count(source.begin(), source.begin() + insert_at, '\n');
+		string define_lines;
+		for (const string &define : defines)
+		{
+			define_lines += "#define " + define + "\n";
+		}
+		define_lines += "#line " + std::to_string(next_line) + " 0\n";
+		source.insert(insert_at, define_lines);
+	}
+	return true;
+}
+
+
+// Load the shader source code from the file, set the shader type and compile the shader
+void Shader::loadAndCompile()
+{
+	string shader_source_str;
+	if (!preprocess(m_filename, m_defines, shader_source_str, m_files))
+	{
+		return;
+	}
 	const char *shader_source_c_str = shader_source_str.c_str();
 
 	// Determine shader type based on file extension
@@ -62,8 +158,13 @@ void Shader::loadAndCompile()
 	{
 		glGetShaderInfoLog(m_id, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::COMPILATION_FAILED" << std::endl
-			<< "Shader: '" << m_filename << "'" << std::endl
-			<< infoLog << std::endl;
+			<< "Shader: '" << m_filename << "'" << std::endl;
+		// errors are reported as file number(line)
+		for (size_t i = 1; i < m_files.size(); i++)
+		{
+			std::cout << "File " << i << ": '" << m_files[i] << "'" << std::endl;
+		}
+		std::cout << infoLog << std::endl;
 	}
 }
 
@@ -82,11 +183,16 @@ string Shader::getFilename() const
 	return m_filename;
 }
 
+const std::vector<string> &Shader::getFiles() const
+{
+	return m_files;
+}
+
 
 // ------------------------------------------
 // --- ShaderProgram Class ---
 
-ShaderProgram::ShaderProgram(const std::vector<Shader> &shaders) : m_shaders(shaders)
+ShaderProgram::ShaderProgram(const std::vector<Shader> &shaders, bool retrievable_binary) : m_shaders(shaders), m_linked(false)
 {
 	// Create string name representation for this program
 	std::stringstream stream;
@@ -99,14 +205,30 @@ ShaderProgram::ShaderProgram(const std::vector<Shader> &shaders) : m_shaders(sha
 	m_str_name = stream.str();
 
 	// Create the program OpenGL object
-	ShaderProgram::createProgram();
+	ShaderProgram::createProgram(retrievable_binary);
+}
+
+ShaderProgram::ShaderProgram(const string &name, GLenum binary_format, const std::vector<char> &binary) : m_str_name(name)
+{
+	m_id = glCreateProgram();
+	glProgramBinary(m_id, binary_format, binary.data(), (GLsizei)binary.size());
+
+	// a binary from another driver (version) fails to load, without an error message
+	int success;
+	glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+	m_linked = success != 0;
+	cacheUniformLocations();
 }
 
 // Create a new shader program object and link the shaders together
-void ShaderProgram::createProgram()
+void ShaderProgram::createProgram(bool retrievable_binary)
 {
 	// Create shader program OpenGL object
 	m_id = glCreateProgram();
+	if (retrievable_binary)
+	{
+		glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
 	// Attach shaders
 	for (const Shader &shader : m_shaders)
@@ -121,6 +243,7 @@ void ShaderProgram::createProgram()
 	int success;
 	char infoLog[512];
 	glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+	m_linked = success != 0;
 	if (!success) {
 		glGetProgramInfoLog(m_id, 512, NULL, infoLog);
 
@@ -128,6 +251,60 @@ void ShaderProgram::createProgram()
 			<< "Program: " << m_str_name << std::endl
 			<< infoLog << std::endl;
 	}
+	cacheUniformLocations();
+}
+
+// Look up the active uniforms & uniform blocks of the linked program through interface queries
+void ShaderProgram::cacheUniformLocations()
+{
+	m_uniform_locations.clear();
+	m_uniform_blocks.clear();
+	if (!m_linked)
+	{
+		return;
+	}
+
+	GLint num_uniforms = 0;
+	GLint max_name_length = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &num_uniforms);
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+	std::vector<char> name(max_name_length + 1);
+	const GLenum properties[] = { GL_LOCATION, GL_ARRAY_SIZE };
+	for (GLint i = 0; i < num_uniforms; i++)
+	{
+		GLint values[2];
+		glGetProgramResourceiv(m_id, GL_UNIFORM, i, 2, properties, 2, nullptr, values);
+		if (values[0] < 0)
+		{
+			continue;	// member of a uniform block
+		}
+		glGetProgramResourceName(m_id, GL_UNIFORM, i, (GLsizei)name.size(), nullptr, name.data());
+		string uniform(name.data());
+		m_uniform_locations[uniform] = values[0];
+
+		// arrays are listed as "name[0]": also take "name" and the other elements
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+		{
+			string base = uniform.substr(0, uniform.size() - 3);
+			m_uniform_locations[base] = values[0];
+			for (GLint element = 1; element < values[1]; element++)
+			{
+				string element_name = base + "[" + std::to_string(element) + "]";
+				m_uniform_locations[element_name] = glGetUniformLocation(m_id, element_name.c_str());
+				getGLCallCounts().location_queries++;
+			}
+		}
+	}
+
+	GLint num_blocks = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &num_blocks);
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &max_name_length);
+	name.resize(max_name_length + 1);
+	for (GLint i = 0; i < num_blocks; i++)
+	{
+		glGetProgramResourceName(m_id, GL_UNIFORM_BLOCK, i, (GLsizei)name.size(), nullptr, name.data());
+		m_uniform_blocks[string(name.data())] = (GLuint)i;
+	}
 }
 
 ShaderProgram::~ShaderProgram()
@@ -144,6 +321,7 @@ ShaderProgram::~ShaderProgram()
 void ShaderProgram::use()
 {
 	glUseProgram(m_id);
+	getGLCallCounts().program_binds++;
 }
 
 void ShaderProgram::use_end()
@@ -157,6 +335,26 @@ GLuint ShaderProgram::getHandle() const
 	return m_id;
 }
 
+bool ShaderProgram::isLinked() const
+{
+	return m_linked;
+}
+
+// Driver specific binary of the linked program, to be given back to the binary constructor
+bool ShaderProgram::getBinary(GLenum &binary_format, std::vector<char> &binary) const
+{
+	GLint length = 0;
+	glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!m_linked || length <= 0)
+	{
+		return false;
+	}
+	binary.resize(length);
+	glGetProgramBinary(m_id, length, &length, &binary_format, binary.data());
+	binary.resize(length);
+	return length > 0;
+}
+
 // Tell shader it can find the data for the vertex attribute (with dimensionality 'attribute_size') 
 // at 'location' by using the values in 'buffer'. 
 void ShaderProgram::bindData(GLuint location, const Buffer &buffer, GLuint attribute_size) const
@@ -170,55 +368,170 @@ void ShaderProgram::bindData(GLuint location, const Buffer &buffer, GLuint attri
 }
 
 
+GLint ShaderProgram::getUniformLocation(const string &name) const
+{
+	auto it = m_uniform_locations.find(name);
+	return it != m_uniform_locations.end() ? it->second : -1;
+}
+
+bool ShaderProgram::bindUniformBlock(const string &block, GLuint binding)
+{
+	auto it = m_uniform_blocks.find(block);
+	if (it == m_uniform_blocks.end())
+	{
+		return false;
+	}
+	glUniformBlockBinding(m_id, it->second, binding);
+	m_block_bindings[block] = binding;
+	return true;
+}
+
+void ShaderProgram::setKeepUniformValues(bool keep)
+{
+	m_keep_uniform_values = keep;
+	if (!keep)
+	{
+		m_uniform_values.clear();
+	}
+}
+
+void ShaderProgram::swapProgram(ShaderProgram &rebuilt)
+{
+	std::swap(m_shaders, rebuilt.m_shaders);
+	std::swap(m_id, rebuilt.m_id);
+	std::swap(m_linked, rebuilt.m_linked);
+	std::swap(m_uniform_locations, rebuilt.m_uniform_locations);
+	std::swap(m_uniform_blocks, rebuilt.m_uniform_blocks);
+
+	// a relinked program starts from the shaders' initial values & binding 0
+	for (const auto &block : m_block_bindings)
+	{
+		auto it = m_uniform_blocks.find(block.first);
+		if (it != m_uniform_blocks.end())
+		{
+			glUniformBlockBinding(m_id, it->second, block.second);
+		}
+	}
+	for (const auto &value : m_uniform_values)
+	{
+		GLint location = getUniformLocation(value.first);
+		if (location >= 0)
+		{
+			uploadUniform(location, value.second.type, value.second.count, value.second.data.data());
+		}
+	}
+}
+
+// Bytes of one element of each UniformType
+static const size_t UNIFORM_TYPE_SIZES[] = { 4, 4, 4, 8, 12, 16, 36, 64 };
+
+void ShaderProgram::setUniform(const string &target, UniformType type, GLsizei count, const void *data) const
+{
+	GLCallCounts &counts = getGLCallCounts();
+	counts.uniform_sets++;
+	GLint location = getUniformLocation(target);
+	if (location < 0)
+	{
+		return;
+	}
+	if (m_keep_uniform_values)
+	{
+		UniformValue &value = m_uniform_values[target];
+		value.type = type;
+		value.count = count;
+		const unsigned char *bytes = (const unsigned char *)data;
+		value.data.assign(bytes, bytes + UNIFORM_TYPE_SIZES[(int)type] * count);
+	}
+	uploadUniform(location, type, count, data);
+	counts.uniform_uploads++;
+}
+
+void ShaderProgram::uploadUniform(GLint location, UniformType type, GLsizei count, const void *data) const
+{
+	switch (type)
+	{
+	case UniformType::INT:
+		glProgramUniform1iv(m_id, location, count, (const GLint *)data);
+		break;
+	case UniformType::UINT:
+		glProgramUniform1uiv(m_id, location, count, (const GLuint *)data);
+		break;
+	case UniformType::FLOAT:
+		glProgramUniform1fv(m_id, location, count, (const GLfloat *)data);
+		break;
+	case UniformType::VEC2:
+		glProgramUniform2fv(m_id, location, count, (const GLfloat *)data);
+		break;
+	case UniformType::VEC3:
+		glProgramUniform3fv(m_id, location, count, (const GLfloat *)data);
+		break;
+	case UniformType::VEC4:
+		glProgramUniform4fv(m_id, location, count, (const GLfloat *)data);
+		break;
+	case UniformType::MAT3:
+		glProgramUniformMatrix3fv(m_id, location, count, GL_FALSE, (const GLfloat *)data);
+		break;
+	case UniformType::MAT4:
+		glProgramUniformMatrix4fv(m_id, location, count, GL_FALSE, (const GLfloat *)data);
+		break;
+	}
+}
+
+
 // --- methods for setting uniforms in shader program
 // set uniform named 'target' to the given value 'v'
 
 void ShaderProgram::setInt(const string &target, int v) const
 {
-	glUniform1i(glGetUniformLocation(m_id, target.c_str()), v);
+	setUniform(target, UniformType::INT, 1, &v);
+}
+
+void ShaderProgram::setUint(const string &target, unsigned int v) const
+{
+	setUniform(target, UniformType::UINT, 1, &v);
 }
 
 void ShaderProgram::setFloat(const string &target, float v) const
 {
-	glUniform1f(glGetUniformLocation(m_id, target.c_str()), v);
+	setUniform(target, UniformType::FLOAT, 1, &v);
 }
 
 void ShaderProgram::setVec2(const string &target, const glm::vec2 &v) const
 {
-	glUniform2fv(glGetUniformLocation(m_id, target.c_str()), 1, &v[0]);
+	setUniform(target, UniformType::VEC2, 1, &v[0]);
 }
 
 void ShaderProgram::setVec3(const string &target, const glm::vec3 &v) const
 {
-	glUniform3fv(glGetUniformLocation(m_id, target.c_str()), 1, &v[0]);
+	setUniform(target, UniformType::VEC3, 1, &v[0]);
 }
 
 void ShaderProgram::setVec4(const string &target, const glm::vec4 &v) const
 {
-	glUniform4fv(glGetUniformLocation(m_id, target.c_str()), 1, &v[0]);
+	setUniform(target, UniformType::VEC4, 1, &v[0]);
 }
 
 void ShaderProgram::setMat3(const string &target, const glm::mat3 &v) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(m_id, target.c_str()), 1, GL_FALSE, &v[0][0]);
+	setUniform(target, UniformType::MAT3, 1, &v[0][0]);
 }
 
 void ShaderProgram::setMat4(const string &target, const glm::mat4 &v) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(m_id, target.c_str()), 1, GL_FALSE, &v[0][0]);
+	setUniform(target, UniformType::MAT4, 1, &v[0][0]);
 }
 
 void ShaderProgram::setIntArray(const string &target, int v[], int length) const
 {
-	glUniform1iv(glGetUniformLocation(m_id, target.c_str()), length, v);
+	setUniform(target, UniformType::INT, length, v);
 }
 
 void ShaderProgram::setFloatArray(const string &target, float v[], int length) const
 {
-	glUniform1fv(glGetUniformLocation(m_id, target.c_str()), length, v);
+	setUniform(target, UniformType::FLOAT, length, v);
 }
 
 void ShaderProgram::setVec2Array(const string &target, glm::vec2 v[], int length) const
 {
-	glUniform2fv(glGetUniformLocation(m_id, target.c_str()), length, (const GLfloat *) &v[0]);
-}
+	setUniform(target, UniformType::VEC2, length, &v[0]);
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -19,37 +20,89 @@ class Shader
 {
 private:
 	string m_filename;
+	std::vector<string> m_defines;
+	std::vector<string> m_files;	// the file & the ones it includes
 	GLenum m_type;
 	GLuint m_id;
 
 	void loadAndCompile();
 
 public:
-	Shader(string filename);
+	// defines: "NAME" or "NAME value", inserted after the #version line
+	Shader(string filename, const std::vector<string> &defines = {});
 	~Shader();
 	GLuint getHandle() const;
 	string getFilename() const;
+	const std::vector<string> &getFiles() const;
+
+	// Source of a file in the shaders folder; false (printing an error) if it cannot be read
+	static bool readSource(const string &filename, string &source);
+	// Source to compile: the file with its #include "file" lines expanded (each file once, with
+	// #line directives numbering the files in the order of files) and the defines added
+	static bool preprocess(const string &filename, const std::vector<string> &defines, string &source, std::vector<string> &files);
 };
 
 class ShaderProgram
 {
 private:
+	enum class UniformType { INT, UINT, FLOAT, VEC2, VEC3, VEC4, MAT3, MAT4 };
+	struct UniformValue
+	{
+		UniformType type;
+		GLsizei count;
+		std::vector<unsigned char> data;
+	};
+
 	std::vector<Shader> m_shaders;
 	GLuint m_id;
 	string m_str_name;
+	bool m_linked;
+	// resolved once after linking, so setting a uniform is a map lookup rather than a GL query
+	std::unordered_map<string, GLint> m_uniform_locations;
+	std::unordered_map<string, GLuint> m_uniform_blocks;
+
+	// state that a rebuilt program takes over (see swapProgram)
+	bool m_keep_uniform_values = false;
+	mutable std::unordered_map<string, UniformValue> m_uniform_values;
+	std::unordered_map<string, GLuint> m_block_bindings;
 
-	void createProgram();
+	void createProgram(bool retrievable_binary);
+	void cacheUniformLocations();
+	void setUniform(const string &target, UniformType type, GLsizei count, const void *data) const;
+	void uploadUniform(GLint location, UniformType type, GLsizei count, const void *data) const;
 
 public:
-	ShaderProgram(const std::vector<Shader> &shaders);
+	// retrievable_binary: the program will be saved with getBinary()
+	ShaderProgram(const std::vector<Shader> &shaders, bool retrievable_binary = false);
+	// Program from a binary saved by getBinary(); the driver may reject it (see isLinked())
+	ShaderProgram(const string &name, GLenum binary_format, const std::vector<char> &binary);
 	~ShaderProgram();
+
+	// owns its program object: not copyable (renderers keep a reference)
+	ShaderProgram(const ShaderProgram &) = delete;
+	ShaderProgram &operator=(const ShaderProgram &) = delete;
+
 	void use();
 	void use_end();
 	GLuint getHandle() const;
+	bool isLinked() const;
+	bool getBinary(GLenum &binary_format, std::vector<char> &binary) const;
+
+	// Remember the uniform values set from now on, for swapProgram()
+	void setKeepUniformValues(bool keep);
+	// Take the program object of rebuilt (e.g. relinked from edited files) and give it this
+	// program's uniform values & block bindings; rebuilt gets the old object and deletes it
+	void swapProgram(ShaderProgram &rebuilt);
 
 	void bindData(GLuint location, const Buffer &buffer, GLuint attribute_size) const;
 
+	// -1 for names that are not active uniforms of the program (setting them does nothing)
+	GLint getUniformLocation(const string &name) const;
+	// Read the named uniform block from the UBO bound to binding; false if the program has no such block
+	bool bindUniformBlock(const string &block, GLuint binding);
+
 	void setInt(const string &target, int v) const;
+	void setUint(const string &target, unsigned int v) const;
 	void setFloat(const string &target, float v) const;
 	void setVec2(const string &target, const glm::vec2 &v) const;
 	void setVec3(const string &target, const glm::vec3 &v) const;
@@ -61,4 +114,19 @@ public:
 	void setVec2Array(const string &target, glm::vec2 v[], int length) const;
 };
 
+// CPU copy of the std140 "FrameData" block declared by the scene shaders: set once per frame
+// and uploaded to the UBO bound at CGRA350Constants::UBO_BINDING_FRAME_DATA
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 camera_pos;
+	float time;					// seconds since start
+	glm::vec3 light_colour;		// DirectionalLight light
+	float padding;
+	glm::vec3 light_direction;
+	float light_strength;
+};
+static_assert(sizeof(FrameUniforms) == 176, "FrameUniforms must match the std140 layout of FrameData");
+
 #endif
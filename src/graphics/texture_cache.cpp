@@ -0,0 +1,72 @@
+#include "texture_cache.h"
+#include "texture_streamer.h"
+#include "../utils/texture_pack.h"
+
+#include <iostream>
+#include <set>
+
+
+// ------------------------------------------
+// --- TextureCache class ---
+
+TextureCache::TextureCache(TextureStreamer &streamer)
+    : m_streamer(streamer)
+{
+}
+
+std::shared_ptr<Texture2D> TextureCache::getTexture2D(string filename)
+{
+    m_num_requests++;
+    std::weak_ptr<Texture2D> &entry = m_textures[TexturePack::normaliseName(filename)];
+    std::shared_ptr<Texture2D> texture = entry.lock();
+    if (texture)
+    {
+        m_shared.push_back(texture->getStreamStatus());
+        return texture;
+    }
+
+    texture = std::make_shared<Texture2D>(filename, m_streamer);
+    entry = texture;
+    return texture;
+}
+
+std::shared_ptr<CubeMapTexture> TextureCache::getCubeMap(const string filenames[6])
+{
+    m_num_requests++;
+    string key;
+    for (int i = 0; i < 6; i++)
+    {
+        key += (i > 0 ? "|" : "") + TexturePack::normaliseName(filenames[i]);
+    }
+    std::weak_ptr<CubeMapTexture> &entry = m_cube_maps[key];
+    std::shared_ptr<CubeMapTexture> texture = entry.lock();
+    if (texture)
+    {
+        m_shared.push_back(texture->getStreamStatus());
+        return texture;
+    }
+
+    texture = std::make_shared<CubeMapTexture>(filenames, m_streamer);
+    entry = texture;
+    return texture;
+}
+
+void TextureCache::printSummary() const
+{
+    std::set<const TextureStreamStatus *> unique;
+    size_t saved_bytes = 0;
+    double saved_seconds = 0;
+    for (const std::shared_ptr<const TextureStreamStatus> &status : m_shared)
+    {
+        unique.insert(status.get());
+        if (status->ready)
+        {
+            saved_bytes += status->bytes;
+            saved_seconds += status->load_seconds;
+        }
+    }
+
+    std::cout << "Texture cache: " << m_num_requests << " requests, " << m_shared.size()
+        << " shared (" << unique.size() << " textures used more than once); saved "
+        << saved_bytes / 1e6 << " MB of texture memory and " << saved_seconds << " s of loading" << std::endl;
+}
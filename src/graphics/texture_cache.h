@@ -0,0 +1,43 @@
+#ifndef TEXTURE_CACHE
+#define TEXTURE_CACHE
+#pragma once
+
+#include "textures.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+class TextureStreamer;
+struct TextureStreamStatus;
+
+// --- Texture Cache ---
+// Hands out textures shared by filename, so an image used by several materials is decoded
+// and uploaded once. The cache only keeps weak references: a texture is deleted with its
+// last shared_ptr, and a later request for it loads it again.
+class TextureCache
+{
+private:
+	TextureStreamer &m_streamer;
+	std::unordered_map<string, std::weak_ptr<Texture2D>> m_textures;
+	std::unordered_map<string, std::weak_ptr<CubeMapTexture>> m_cube_maps;	// key: the six faces joined by '|'
+
+	// requests & the textures that requests found already loaded
+	int m_num_requests = 0;
+	std::vector<std::shared_ptr<const TextureStreamStatus>> m_shared;
+
+public:
+	TextureCache(TextureStreamer &streamer);
+
+	std::shared_ptr<Texture2D> getTexture2D(string filename);
+	// (order of faces in array is: right, left, top, bottom, back, front)
+	std::shared_ptr<CubeMapTexture> getCubeMap(const string filenames[6]);
+
+	// Prints how many requests were shared and the texture memory & load time that saved
+	// (of shared textures that have finished streaming)
+	void printSummary() const;
+};
+#endif
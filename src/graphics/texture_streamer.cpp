@@ -0,0 +1,556 @@
+#include "texture_streamer.h"
+#include "textures.h"
+#include "../utils/image_io.h"
+#include "../utils/texture_pack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// S3TC formats (EXT_texture_compression_s3tc / EXT_texture_sRGB), not in the glad headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// GL internal format of a pack entry (0 for uncompressed levels)
+static GLenum getCompressedFormat(const TexturePackEntry &entry)
+{
+    bool srgb = (entry.flags & TEXTURE_PACK_SRGB) != 0;
+    switch (entry.format)
+    {
+    case TEXTURE_PACK_BC1:
+        return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_PACK_BC3:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_PACK_BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case TEXTURE_PACK_BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    default:
+        return 0;
+    }
+}
+
+
+// ------------------------------------------
+// --- TextureStreamer class ---
+
+TextureStreamer::TextureStreamer(int num_threads, size_t ring_size)
+    : m_ring_size(ring_size)
+{
+    if (num_threads <= 0)
+    {
+        num_threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        m_workers.emplace_back(&TextureStreamer::workerLoop, this);
+    }
+
+    // persistently mapped staging buffer (GL 4.4 / ARB_buffer_storage)
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &m_pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_ring_size, nullptr, flags);
+        m_ring = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_ring_size, flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (m_ring == nullptr)
+        {
+            glDeleteBuffers(1, &m_pbo);
+            m_pbo = 0;
+        }
+    }
+    if (m_pbo == 0)
+    {
+        std::cout << "TextureStreamer: persistent mapping unavailable, uploading from client memory" << std::endl;
+    }
+
+    // sRGB S3TC needs EXT_texture_sRGB as well, which every driver with S3TC has
+    m_s3tc = GLAD_GL_EXT_texture_compression_s3tc != 0;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    std::deque<std::pair<std::shared_ptr<Request>, int>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stop = true;
+        dropped.swap(m_jobs);
+    }
+    m_job_signal.notify_all();
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+
+    // free images that were never uploaded
+    for (auto &job : dropped)
+    {
+        m_decoded.push_back(job.first);
+    }
+    for (std::shared_ptr<Request> &request : m_decoded)
+    {
+        for (Image &image : request->images)
+        {
+            stbi_image_free(image.data);
+            image.data = nullptr;
+        }
+    }
+
+    releaseSegments(true);
+    if (m_pbo != 0)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &m_pbo);
+    }
+}
+
+void TextureStreamer::setPack(const TexturePack *pack)
+{
+    m_pack = pack && pack->isOpen() ? pack : nullptr;
+}
+
+void TextureStreamer::request2D(GLuint texture, string filename, std::shared_ptr<TextureStreamStatus> status)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->texture = texture;
+    request->target = GL_TEXTURE_2D;
+    request->flip_vertically = true;
+    request->images.resize(1);
+    request->images[0].filename = filename;
+    request->status = status;
+    queue(request);
+}
+
+// (order of faces in array is: right, left, top, bottom, back, front)
+void TextureStreamer::requestCubeMap(GLuint texture, const string filenames[6], std::shared_ptr<TextureStreamStatus> status)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->texture = texture;
+    request->target = GL_TEXTURE_CUBE_MAP;
+    request->flip_vertically = false;
+    request->images.resize(6);
+    for (int i = 0; i < 6; i++)
+    {
+        request->images[i].filename = filenames[i];
+    }
+    request->status = status;
+    queue(request);
+}
+
+// Layers are all decoded to the same size & format, so arrays never come from the pack,
+// whose levels keep each image's own size and compression
+void TextureStreamer::requestArray(GLuint texture, const std::vector<string> &filenames, int width, int height, std::shared_ptr<TextureStreamStatus> status)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->texture = texture;
+    request->target = GL_TEXTURE_2D_ARRAY;
+    request->flip_vertically = true;
+    request->layer_width = width;
+    request->layer_height = height;
+    request->images.resize(filenames.size());
+    for (int i = 0; i < (int)filenames.size(); i++)
+    {
+        request->images[i].filename = filenames[i];
+    }
+    request->status = status;
+    queue(request);
+}
+
+void TextureStreamer::queue(std::shared_ptr<Request> request)
+{
+    request->remaining = (int)request->images.size();
+    m_pending++;
+
+    // baked requests need no decoding (all images or none, so faces match)
+    bool baked = m_pack != nullptr && request->target != GL_TEXTURE_2D_ARRAY;
+    for (Image &image : request->images)
+    {
+        image.baked = baked ? m_pack->find(image.filename, request->flip_vertically) : nullptr;
+        baked = image.baked != nullptr && (m_s3tc || (image.baked->format != TEXTURE_PACK_BC1 && image.baked->format != TEXTURE_PACK_BC3));
+    }
+    if (baked)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_decoded.push_back(request);
+        m_decoded_signal.notify_all();
+        return;
+    }
+    for (Image &image : request->images)
+    {
+        image.baked = nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (int i = 0; i < (int)request->images.size(); i++)
+        {
+            m_jobs.emplace_back(request, i);
+        }
+    }
+    m_job_signal.notify_all();
+}
+
+// Decode one image at a time; the last image of a request hands it over to the GL thread
+void TextureStreamer::workerLoop()
+{
+    while (true)
+    {
+        std::pair<std::shared_ptr<Request>, int> job;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_job_signal.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+            {
+                return;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        Request &request = *job.first;
+        Image &image = request.images[job.second];
+        auto start_time = std::chrono::steady_clock::now();
+        if (request.target == GL_TEXTURE_2D_ARRAY)
+        {
+            image.data = ImageIO::loadImageResized(image.filename, request.layer_width, request.layer_height, request.flip_vertically);
+            image.width = request.layer_width;
+            image.height = request.layer_height;
+            image.num_channels = 4;
+        }
+        else
+        {
+            image.data = ImageIO::loadImage(image.filename, image.width, image.height, image.num_channels, request.flip_vertically);
+        }
+        image.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+        if (--request.remaining == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_decoded.push_back(job.first);
+            m_decoded_signal.notify_all();
+        }
+    }
+}
+
+void TextureStreamer::update(size_t budget)
+{
+    releaseSegments(false);
+
+    size_t uploaded = 0;
+    while (true)
+    {
+        std::shared_ptr<Request> request;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_decoded.empty() || (uploaded > 0 && uploaded >= budget))
+            {
+                break;
+            }
+            request = m_decoded.front();
+            m_decoded.pop_front();
+        }
+        uploaded += upload(*request);
+        m_pending--;
+    }
+}
+
+void TextureStreamer::finish()
+{
+    while (m_pending > 0)
+    {
+        update(SIZE_MAX);
+        if (m_pending > 0)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_decoded_signal.wait(lock, [this] { return !m_decoded.empty(); });
+        }
+    }
+}
+
+int TextureStreamer::getPending() const
+{
+    return m_pending;
+}
+
+// Copy a decoded request into the ring and specify the texture from there. The texture's
+// previous binding and the unpack state are restored, since the render loop relies on
+// textures bound to fixed units at setup.
+size_t TextureStreamer::upload(Request &request)
+{
+    size_t total = 0;
+    TextureStreamStatus &status = *request.status;
+    if (status.cancelled)
+    {
+        for (Image &image : request.images)
+        {
+            stbi_image_free(image.data);
+        }
+        return total;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    double decode_seconds = 0;
+    GLint prev_texture, prev_alignment;
+    GLenum binding = GL_TEXTURE_BINDING_2D;
+    if (request.target == GL_TEXTURE_CUBE_MAP)
+    {
+        binding = GL_TEXTURE_BINDING_CUBE_MAP;
+    }
+    else if (request.target == GL_TEXTURE_2D_ARRAY)
+    {
+        binding = GL_TEXTURE_BINDING_2D_ARRAY;
+    }
+    glGetIntegerv(binding, &prev_texture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_alignment);
+    glBindTexture(request.target, request.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (request.target == GL_TEXTURE_2D_ARRAY)
+    {
+        total = uploadArray(request);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment);
+        glBindTexture(request.target, prev_texture);
+        return total;
+    }
+
+    bool complete = true;
+    for (int i = 0; i < (int)request.images.size(); i++)
+    {
+        Image &image = request.images[i];
+        GLenum face = request.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+
+        if (image.baked != nullptr)
+        {
+            // precomputed levels (only level 0 for cube maps, which sample without mipmaps)
+            const TexturePackEntry &entry = *image.baked;
+            GLenum img_format = GL_RGB;
+            GLenum tex_format = getCompressedFormat(entry);
+            if (tex_format == 0)
+            {
+                getTextureFormats(entry.num_channels, img_format, tex_format);
+            }
+            int num_mips = request.target == GL_TEXTURE_2D ? entry.num_mips : 1;
+            for (int m = 0; m < num_mips; m++)
+            {
+                int width = std::max(1, (int)entry.width >> m);
+                int height = std::max(1, (int)entry.height >> m);
+                uploadLevel(face, m, tex_format, entry.format == TEXTURE_PACK_RAW ? img_format : 0,
+                    width, height, m_pack->getLevel(entry, m), entry.mip_sizes[m]);
+                total += entry.mip_sizes[m];
+                status.bytes += entry.mip_sizes[m];
+            }
+            if (request.target == GL_TEXTURE_2D)
+            {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_mips - 1);
+            }
+            status.width = entry.width;
+            status.height = entry.height;
+            status.num_channels = entry.num_channels;
+            continue;
+        }
+
+        if (image.data == nullptr)
+        {
+            complete = false;
+            continue;
+        }
+
+        GLenum img_format = GL_RGB;
+        GLenum tex_format = GL_SRGB;
+        if (request.target == GL_TEXTURE_2D)
+        {
+            getTextureFormats(image.num_channels, img_format, tex_format);
+        }
+        size_t bytes = (size_t)image.width * image.height * image.num_channels;
+        uploadLevel(face, 0, tex_format, img_format, image.width, image.height, image.data, bytes);
+        if (request.target == GL_TEXTURE_2D)
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            status.bytes += bytes * 4 / 3;
+        }
+        else
+        {
+            status.bytes += bytes;
+        }
+        total += bytes;
+        decode_seconds += image.seconds;
+
+        status.width = image.width;
+        status.height = image.height;
+        status.num_channels = image.num_channels;
+        stbi_image_free(image.data);
+        image.data = nullptr;
+    }
+    status.ready = complete;
+    status.load_seconds = decode_seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment);
+    glBindTexture(request.target, prev_texture);
+    return total;
+}
+
+// Replace the placeholder layers of the bound array with the decoded ones, then build the
+// mipmaps of all layers at once. Layers whose file failed to load are filled with grey.
+size_t TextureStreamer::uploadArray(Request &request)
+{
+    auto start_time = std::chrono::steady_clock::now();
+    double decode_seconds = 0;
+    TextureStreamStatus &status = *request.status;
+    int width = request.layer_width;
+    int height = request.layer_height;
+    int num_layers = (int)request.images.size();
+    size_t layer_bytes = (size_t)width * height * 4;
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB8_ALPHA8, width, height, num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    bool complete = true;
+    std::vector<unsigned char> grey;
+    for (int i = 0; i < num_layers; i++)
+    {
+        Image &image = request.images[i];
+        if (image.data == nullptr)
+        {
+            if (grey.empty())
+            {
+                grey.assign(layer_bytes, 128);
+                for (size_t j = 3; j < layer_bytes; j += 4)
+                {
+                    grey[j] = 255;
+                }
+            }
+            uploadLayer(i, width, height, grey.data(), layer_bytes);
+            complete = false;
+            continue;
+        }
+
+        uploadLayer(i, width, height, image.data, layer_bytes);
+        decode_seconds += image.seconds;
+        stbi_image_free(image.data);
+        image.data = nullptr;
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    status.width = width;
+    status.height = height;
+    status.num_channels = 4;
+    status.bytes = layer_bytes * num_layers * 4 / 3;
+    status.ready = complete;
+    status.load_seconds = decode_seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return layer_bytes * num_layers;
+}
+
+// Specify one level of the bound texture through the ring, or from client memory when the
+// ring cannot take it. img_format 0: pixels are blocks of the compressed internal_format.
+void TextureStreamer::uploadLevel(GLenum face, int level, GLenum internal_format, GLenum img_format, int width, int height, const unsigned char *pixels, size_t bytes)
+{
+    size_t offset;
+    pixels = stage(pixels, bytes, offset);
+
+    if (img_format == 0)
+    {
+        glCompressedTexImage2D(face, level, internal_format, width, height, 0, (GLsizei)bytes, pixels);
+    }
+    else
+    {
+        glTexImage2D(face, level, internal_format, width, height, 0, img_format, GL_UNSIGNED_BYTE, pixels);
+    }
+    unstage(offset, bytes);
+}
+
+// Level 0 of one RGBA layer of the bound array, the same way
+void TextureStreamer::uploadLayer(int layer, int width, int height, const unsigned char *pixels, size_t bytes)
+{
+    size_t offset;
+    pixels = stage(pixels, bytes, offset);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    unstage(offset, bytes);
+}
+
+// Copy pixels into the ring and bind it for unpacking; returns what to pass to the GL as the
+// pixels (their offset in the ring, or pixels themselves with offset SIZE_MAX)
+const unsigned char *TextureStreamer::stage(const unsigned char *pixels, size_t bytes, size_t &offset)
+{
+    offset = reserve(bytes);
+    if (offset == SIZE_MAX)
+    {
+        return pixels;
+    }
+    memcpy(m_ring + offset, pixels, bytes);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+    return (const unsigned char *)offset;
+}
+
+// Fence the staged region once the GL has been told to read it
+void TextureStreamer::unstage(size_t offset, size_t bytes)
+{
+    if (offset != SIZE_MAX)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_segments.push_back({ offset, bytes, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+    }
+}
+
+// Offset of bytes free in the ring, waiting on the fences of uploads still reading it;
+// SIZE_MAX when there is no ring or the image does not fit
+size_t TextureStreamer::reserve(size_t bytes)
+{
+    if (m_pbo == 0 || bytes > m_ring_size)
+    {
+        return SIZE_MAX;
+    }
+    size_t offset = m_ring_head + bytes <= m_ring_size ? m_ring_head : 0;
+
+    // fences signal in order, so waiting for the newest overlapping segment frees all before it
+    int last = -1;
+    for (int i = 0; i < (int)m_segments.size(); i++)
+    {
+        const Segment &segment = m_segments[i];
+        if (segment.offset < offset + bytes && offset < segment.offset + segment.size)
+        {
+            last = i;
+        }
+    }
+    if (last >= 0)
+    {
+        while (glClientWaitSync(m_segments[last].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        for (int i = 0; i <= last; i++)
+        {
+            glDeleteSync(m_segments.front().fence);
+            m_segments.pop_front();
+        }
+    }
+
+    m_ring_head = offset + bytes;
+    return offset;
+}
+
+// Drop segments the GL has finished reading (all of them, waiting, if wait_all)
+void TextureStreamer::releaseSegments(bool wait_all)
+{
+    while (!m_segments.empty())
+    {
+        GLenum result = glClientWaitSync(m_segments.front().fence, wait_all ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait_all ? 1000000000 : 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            if (!wait_all)
+            {
+                break;
+            }
+            continue;
+        }
+        glDeleteSync(m_segments.front().fence);
+        m_segments.pop_front();
+    }
+}
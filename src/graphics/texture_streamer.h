@@ -0,0 +1,126 @@
+#ifndef TEXTURE_STREAMER
+#define TEXTURE_STREAMER
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+class TexturePack;
+struct TexturePackEntry;
+
+// Load state of a streamed texture, shared between the texture and the streamer.
+// Only touched on the GL thread.
+struct TextureStreamStatus
+{
+	bool ready = false;			// full image uploaded (stays false if the file failed to load)
+	bool cancelled = false;		// texture deleted before its upload
+	int width = 1;
+	int height = 1;
+	int num_channels = 4;
+	size_t bytes = 0;			// texture memory of the uploaded levels (generated mipmaps included)
+	double load_seconds = 0;	// decoding & upload
+};
+
+// --- Texture Streamer ---
+// Decodes texture images on a pool of loader threads. update() then uploads the decoded
+// images on the GL thread through a persistently mapped pixel-unpack buffer used as a ring,
+// so the render loop keeps drawing (with 1x1 placeholders) while textures come in.
+// Images found in a baked texture pack skip decoding: their precomputed (and usually block
+// compressed) levels are copied straight from the mapped pack.
+class TextureStreamer
+{
+public:
+	// num_threads <= 0: one per hardware thread, leaving one for the GL thread
+	TextureStreamer(int num_threads = 0, size_t ring_size = 64 << 20);
+	~TextureStreamer();
+
+	// Take images from pack when it has them; pack must outlive the streamer
+	void setPack(const TexturePack *pack);
+
+	// Queue the image(s) of an already created texture object (see Texture2D / CubeMapTexture)
+	void request2D(GLuint texture, string filename, std::shared_ptr<TextureStreamStatus> status);
+	void requestCubeMap(GLuint texture, const string filenames[6], std::shared_ptr<TextureStreamStatus> status);
+	// One layer per file, resized to width x height RGBA on the loader threads (see Texture2DArray)
+	void requestArray(GLuint texture, const std::vector<string> &filenames, int width, int height, std::shared_ptr<TextureStreamStatus> status);
+
+	// Upload decoded textures, up to budget bytes (but at least one texture) per call
+	void update(size_t budget = 32 << 20);
+	// Block until everything requested so far is uploaded
+	void finish();
+
+	// Textures requested but not uploaded yet
+	int getPending() const;
+
+private:
+	struct Image
+	{
+		string filename;
+		const TexturePackEntry *baked = nullptr;
+		unsigned char *data = nullptr;
+		int width = 0;
+		int height = 0;
+		int num_channels = 0;
+		double seconds = 0;		// decoding
+	};
+
+	struct Request
+	{
+		GLuint texture;
+		GLenum target;
+		bool flip_vertically;
+		int layer_width = 0;	// arrays only
+		int layer_height = 0;
+		std::vector<Image> images;
+		std::atomic<int> remaining;
+		std::shared_ptr<TextureStreamStatus> status;
+	};
+
+	// Fenced region of the ring still read by the GL
+	struct Segment
+	{
+		size_t offset;
+		size_t size;
+		GLsync fence;
+	};
+
+	void queue(std::shared_ptr<Request> request);
+	void workerLoop();
+	size_t upload(Request &request);
+	size_t uploadArray(Request &request);
+	void uploadLevel(GLenum face, int level, GLenum internal_format, GLenum img_format, int width, int height, const unsigned char *pixels, size_t bytes);
+	void uploadLayer(int layer, int width, int height, const unsigned char *pixels, size_t bytes);
+	const unsigned char *stage(const unsigned char *pixels, size_t bytes, size_t &offset);
+	void unstage(size_t offset, size_t bytes);
+	size_t reserve(size_t bytes);
+	void releaseSegments(bool wait_all);
+
+	// loader threads
+	std::vector<std::thread> m_workers;
+	std::mutex m_lock;
+	std::condition_variable m_job_signal;
+	std::condition_variable m_decoded_signal;
+	std::deque<std::pair<std::shared_ptr<Request>, int>> m_jobs;	// request & image index
+	std::deque<std::shared_ptr<Request>> m_decoded;
+	bool m_stop = false;
+	int m_pending = 0;
+	const TexturePack *m_pack = nullptr;
+	bool m_s3tc = false;
+
+	// upload ring (0 when buffer storage is unavailable: uploads go straight from client memory)
+	GLuint m_pbo = 0;
+	unsigned char *m_ring = nullptr;
+	size_t m_ring_size;
+	size_t m_ring_head = 0;
+	std::deque<Segment> m_segments;
+};
+#endif
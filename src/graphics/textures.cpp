@@ -1,9 +1,34 @@
 
 #include "textures.h"
+#include "texture_streamer.h"
+#include "gl_call_counts.h"
 #include "../utils/image_io.h"
 #include "../main/constants.h"
 
 
+// placeholder texel of streamed textures
+static const unsigned char PLACEHOLDER_TEXEL[4] = { 128, 128, 128, 255 };
+
+void getTextureFormats(int num_channels, GLenum &img_format, GLenum &tex_format)
+{
+    switch (num_channels)
+    {
+    case 1:
+        img_format = GL_RED;
+        tex_format = GL_RED;
+        break;
+    case 4:
+        img_format = GL_RGBA;
+        tex_format = GL_SRGB_ALPHA;
+        break;
+    default:
+        img_format = GL_RGB;
+        tex_format = GL_SRGB;
+        break;
+    }
+}
+
+
 // ------------------------------------------
 // --- Texture2D class ---
 
@@ -27,21 +52,7 @@ Texture2D::Texture2D(string filename)
     // bind data to texture & generate mipmap
     GLenum img_format;
     GLenum tex_format;
-    switch (m_num_channels)
-    {
-    case 1:
-        img_format = GL_RED;
-        tex_format = GL_RED;
-        break;
-    case 4:
-        img_format = GL_RGBA;
-        tex_format = GL_SRGB_ALPHA;
-        break;
-    default:
-        img_format = GL_RGB;
-        tex_format = GL_SRGB;
-        break;
-    }
+    getTextureFormats(m_num_channels, img_format, tex_format);
     glTexImage2D(GL_TEXTURE_2D, 0, tex_format, m_width, m_height, 0, img_format, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -52,6 +63,31 @@ Texture2D::Texture2D(string filename)
     stbi_image_free(data);
 }
 
+// Create the texture object with a placeholder now; the image is decoded on a loader thread
+// and uploaded by TextureStreamer::update()
+Texture2D::Texture2D(string filename, TextureStreamer &streamer)
+    : m_width(1), m_height(1), m_num_channels(4), m_stream(std::make_shared<TextureStreamStatus>())
+{
+    // generate OpenGL texture object
+    glGenTextures(1, &m_id);
+
+    // set wrapping & filtering parameters
+    glBindTexture(GL_TEXTURE_2D, m_id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // 1x1 placeholder (a complete texture: it has a single level)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_TEXEL);
+
+    // unbind texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    streamer.request2D(m_id, filename, m_stream);
+}
+
 Texture2D::Texture2D()
     : Texture2D(CGRA350Constants::DEFAULT_WINDOW_WIDTH, CGRA350Constants::DEFAULT_WINDOW_HEIGHT)
 {
@@ -79,12 +115,45 @@ Texture2D::Texture2D(int width, int height)
 
 Texture2D::~Texture2D()
 {
+    if (m_stream)
+    {
+        m_stream->cancelled = true;
+    }
     glDeleteTextures(1, &m_id);
 }
 
+Texture2D::Texture2D(Texture2D &&other) noexcept
+    : m_id(other.m_id), m_width(other.m_width), m_height(other.m_height),
+    m_num_channels(other.m_num_channels), m_stream(std::move(other.m_stream))
+{
+    other.m_id = 0;
+}
+
+Texture2D &Texture2D::operator=(Texture2D &&other) noexcept
+{
+    if (this != &other)
+    {
+        // release the texture object held so far
+        if (m_stream)
+        {
+            m_stream->cancelled = true;
+        }
+        glDeleteTextures(1, &m_id);
+
+        m_id = other.m_id;
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_num_channels = other.m_num_channels;
+        m_stream = std::move(other.m_stream);
+        other.m_id = 0;
+    }
+    return *this;
+}
+
 void Texture2D::bind() const
 {
     glBindTexture(GL_TEXTURE_2D, m_id);
+    getGLCallCounts().texture_binds++;
 }
 
 GLuint Texture2D::getHandle() const
@@ -94,12 +163,23 @@ GLuint Texture2D::getHandle() const
 
 int Texture2D::getWidth() const
 {
-    return m_width;
+    return m_stream ? m_stream->width : m_width;
 }
 
 int Texture2D::getHeight() const
 {
-    return m_height;
+    return m_stream ? m_stream->height : m_height;
+}
+
+bool Texture2D::isReady() const
+{
+    return !m_stream || m_stream->ready;
+}
+
+// null unless the texture is streamed
+std::shared_ptr<const TextureStreamStatus> Texture2D::getStreamStatus() const
+{
+    return m_stream;
 }
 
 
@@ -141,11 +221,68 @@ CubeMapTexture::CubeMapTexture(const string filenames[6])
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
+// Create the cubemap object with 1x1 placeholder faces now; the images are decoded on loader
+// threads and uploaded together by TextureStreamer::update()
+CubeMapTexture::CubeMapTexture(const string filenames[6], TextureStreamer &streamer)
+    : m_stream(std::make_shared<TextureStreamStatus>())
+{
+    // generate OpenGL cubemap texture object
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);
+
+    for (int i = 0; i < 6; i++)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+              0, GL_SRGB, 1, 1,
+              0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_TEXEL);
+    }
+
+    // set wrapping & filtering parameters
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    // unbind texture
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    streamer.requestCubeMap(m_id, filenames, m_stream);
+}
+
 CubeMapTexture::~CubeMapTexture()
 {
+    if (m_stream)
+    {
+        m_stream->cancelled = true;
+    }
     glDeleteTextures(1, &m_id);
 }
 
+CubeMapTexture::CubeMapTexture(CubeMapTexture &&other) noexcept
+    : m_id(other.m_id), m_stream(std::move(other.m_stream))
+{
+    other.m_id = 0;
+}
+
+CubeMapTexture &CubeMapTexture::operator=(CubeMapTexture &&other) noexcept
+{
+    if (this != &other)
+    {
+        // release the texture object held so far
+        if (m_stream)
+        {
+            m_stream->cancelled = true;
+        }
+        glDeleteTextures(1, &m_id);
+
+        m_id = other.m_id;
+        m_stream = std::move(other.m_stream);
+        other.m_id = 0;
+    }
+    return *this;
+}
+
 void CubeMapTexture::bind() const
 {
     //glActiveTexture(GL_TEXTURE0);
@@ -157,3 +294,105 @@ GLuint CubeMapTexture::getHandle() const
 {
     return m_id;
 }
+
+bool CubeMapTexture::isReady() const
+{
+    return !m_stream || m_stream->ready;
+}
+
+// null unless the texture is streamed
+std::shared_ptr<const TextureStreamStatus> CubeMapTexture::getStreamStatus() const
+{
+    return m_stream;
+}
+
+
+// ------------------------------------------
+// --- Texture2DArray class ---
+
+// Create the array object with 1x1 placeholder layers now; the images are decoded & resized
+// on loader threads and uploaded together by TextureStreamer::update()
+Texture2DArray::Texture2DArray(const std::vector<string> &filenames, int width, int height, TextureStreamer &streamer)
+    : m_num_layers((int)filenames.size()), m_stream(std::make_shared<TextureStreamStatus>())
+{
+    // generate OpenGL texture object
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    std::vector<unsigned char> placeholder;
+    for (int i = 0; i < m_num_layers; i++)
+    {
+        placeholder.insert(placeholder.end(), PLACEHOLDER_TEXEL, PLACEHOLDER_TEXEL + 4);
+    }
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB8_ALPHA8, 1, 1, m_num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+
+    // unbind texture
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    streamer.requestArray(m_id, filenames, width, height, m_stream);
+}
+
+Texture2DArray::~Texture2DArray()
+{
+    if (m_stream)
+    {
+        m_stream->cancelled = true;
+    }
+    glDeleteTextures(1, &m_id);
+}
+
+Texture2DArray::Texture2DArray(Texture2DArray &&other) noexcept
+    : m_id(other.m_id), m_num_layers(other.m_num_layers), m_stream(std::move(other.m_stream))
+{
+    other.m_id = 0;
+}
+
+Texture2DArray &Texture2DArray::operator=(Texture2DArray &&other) noexcept
+{
+    if (this != &other)
+    {
+        // release the texture object held so far
+        if (m_stream)
+        {
+            m_stream->cancelled = true;
+        }
+        glDeleteTextures(1, &m_id);
+
+        m_id = other.m_id;
+        m_num_layers = other.m_num_layers;
+        m_stream = std::move(other.m_stream);
+        other.m_id = 0;
+    }
+    return *this;
+}
+
+void Texture2DArray::bind() const
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    getGLCallCounts().texture_binds++;
+}
+
+GLuint Texture2DArray::getHandle() const
+{
+    return m_id;
+}
+
+int Texture2DArray::getLayerCount() const
+{
+    return m_num_layers;
+}
+
+bool Texture2DArray::isReady() const
+{
+    return m_stream && m_stream->ready;
+}
+
+std::shared_ptr<const TextureStreamStatus> Texture2DArray::getStreamStatus() const
+{
+    return m_stream;
+}
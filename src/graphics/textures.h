@@ -3,11 +3,18 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <memory>
 #include <string>
 #include <vector>
 
 using std::string;
 
+class TextureStreamer;
+struct TextureStreamStatus;
+
+// Image & internal formats of an 8-bit image with num_channels channels
+void getTextureFormats(int num_channels, GLenum &img_format, GLenum &tex_format);
+
 // --- 2D Texture ---
 class Texture2D
 {
@@ -16,18 +23,29 @@ private:
 	int m_width;
 	int m_height;
 	int m_num_channels;
+	std::shared_ptr<TextureStreamStatus> m_stream;	// null unless streamed
 
 public:
 	Texture2D(string filename);
+	// 1x1 placeholder until the streamer has decoded & uploaded the image
+	Texture2D(string filename, TextureStreamer &streamer);
 	Texture2D();
 	Texture2D(int width, int height);
 	~Texture2D();
 
+	// owns its texture object: move-only (a moved-from texture has handle 0)
+	Texture2D(const Texture2D &) = delete;
+	Texture2D &operator=(const Texture2D &) = delete;
+	Texture2D(Texture2D &&other) noexcept;
+	Texture2D &operator=(Texture2D &&other) noexcept;
+
 	void bind() const;
 	GLuint getHandle() const;
 
 	int getWidth() const;
 	int getHeight() const;
+	bool isReady() const;
+	std::shared_ptr<const TextureStreamStatus> getStreamStatus() const;
 };
 
 // --- Cubemap Texture ---
@@ -35,12 +53,51 @@ class CubeMapTexture
 {
 private:
 	GLuint m_id;
+	std::shared_ptr<TextureStreamStatus> m_stream;	// null unless streamed
 
 public:
 	CubeMapTexture(const string filenames[6]);
+	// 1x1 placeholder faces until the streamer has decoded & uploaded all six images
+	CubeMapTexture(const string filenames[6], TextureStreamer &streamer);
 	~CubeMapTexture();
 
+	// owns its texture object: move-only (a moved-from texture has handle 0)
+	CubeMapTexture(const CubeMapTexture &) = delete;
+	CubeMapTexture &operator=(const CubeMapTexture &) = delete;
+	CubeMapTexture(CubeMapTexture &&other) noexcept;
+	CubeMapTexture &operator=(CubeMapTexture &&other) noexcept;
+
+	void bind() const;
+	GLuint getHandle() const;
+	bool isReady() const;
+	std::shared_ptr<const TextureStreamStatus> getStreamStatus() const;
+};
+
+// --- 2D Texture Array ---
+// One layer per image, all resized to the same size, so a whole set of materials binds to one
+// unit and the shader picks the layer (see MaterialSet)
+class Texture2DArray
+{
+private:
+	GLuint m_id;
+	int m_num_layers;
+	std::shared_ptr<TextureStreamStatus> m_stream;
+
+public:
+	// 1x1 placeholder layers until the streamer has decoded & uploaded all the images
+	Texture2DArray(const std::vector<string> &filenames, int width, int height, TextureStreamer &streamer);
+	~Texture2DArray();
+
+	// owns its texture object: move-only (a moved-from texture has handle 0)
+	Texture2DArray(const Texture2DArray &) = delete;
+	Texture2DArray &operator=(const Texture2DArray &) = delete;
+	Texture2DArray(Texture2DArray &&other) noexcept;
+	Texture2DArray &operator=(Texture2DArray &&other) noexcept;
+
 	void bind() const;
 	GLuint getHandle() const;
+	int getLayerCount() const;
+	bool isReady() const;
+	std::shared_ptr<const TextureStreamStatus> getStreamStatus() const;
 };
 #endif
\ No newline at end of file
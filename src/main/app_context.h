@@ -3,6 +3,8 @@
 #pragma once
 
 #include "../graphics/camera.h"
+#include "../graphics/gl_call_counts.h"
+#include "../graphics/scene.h"
 #include "../ui/ui.h"
 #include "constants.h"
 
@@ -43,6 +45,9 @@ namespace CGRA350
 
 		unsigned int m_num_ocean_primitives = 2 * CGRA350Constants::DEFAULT_OCEAN_GRID_WIDTH * CGRA350Constants::DEFAULT_OCEAN_GRID_LENGTH;
 		unsigned int m_num_seabed_primitives = 2 * CGRA350Constants::DEFAULT_SEABED_GRID_WIDTH * CGRA350Constants::DEFAULT_SEABED_GRID_LENGTH;
+		GLCallCounts m_gl_call_counts;	// of the last frame
+		CullingStats m_prop_culling;	// of the last frame
+		SceneDrawStats m_scene_draws;	// of the last frame
 
 		bool m_appear_lighthouse = true;
 		bool m_appear_tree = true;
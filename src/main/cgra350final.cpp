@@ -1,11 +1,22 @@
 // Local Headers
 #include "cgra350final.h"
 #include "constants.h"
+#include "scene_layout.h"
 #include "../graphics/shaders.h"
+#include "../graphics/shader_cache.h"
+#include "../graphics/shader_watcher.h"
 #include "../graphics/renderers.h"
 #include "../graphics/textures.h"
+#include "../graphics/texture_streamer.h"
+#include "../graphics/texture_cache.h"
+#include "../graphics/materials.h"
+#include "../graphics/scene.h"
+#include "../utils/texture_pack.h"
+#include "../utils/obj_loader.h"
+#include "../utils/mesh_optimiser.h"
 #include "../graphics/postprocessing.h"
 #include "../volumerendering/vector.cuh"
+#include "../volumerendering/volume_parser.hpp"
 #include "../computeinstancing/Rain.hpp"
 
 #include <cuda_runtime.h>
@@ -17,9 +28,76 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+// Runs one of the cloud renderer benchmarks instead of the app, without opening a window:
+//   cgra350final --benchmark-cpu [width height]
+//   cgra350final --benchmark-nn [rpnn weights]
+//   cgra350final --benchmark-parser [scratch .vox path]
+//   cgra350final --benchmark-tr
+//   cgra350final --benchmark-hdri [.hdr path, the default environment map otherwise]
+static int runBenchmark(int argc, char **argv)
+{
+    std::string option = argv[1];
+    if (option == "--benchmark-cpu")
+    {
+        int2 size = { 128, 128 };
+        if (argc > 3)
+        {
+            size = { std::atoi(argv[2]), std::atoi(argv[3]) };
+        }
+        VolumeRender volume(CGRA350Constants::CLOUD_FOLDER_PATH + "CLOUD0");
+        volume.BenchmarkCPU(size);
+        return EXIT_SUCCESS;
+    }
+    if (option == "--benchmark-nn")
+    {
+        CPUNN nn;
+        if (argc > 2)
+        {
+            nn.LoadRPNN(argv[2]);
+        }
+        nn.Benchmark();
+        return EXIT_SUCCESS;
+    }
+    if (option == "--benchmark-parser")
+    {
+        if (argc > 2)
+        {
+            BenchmarkVolumeParser(argv[2]);
+        }
+        else
+        {
+            BenchmarkVolumeParser();
+        }
+        return EXIT_SUCCESS;
+    }
+    if (option == "--benchmark-tr")
+    {
+        VolumeRender volume(CGRA350Constants::CLOUD_FOLDER_PATH + "CLOUD0");
+        volume.BenchmarkTR();
+        return EXIT_SUCCESS;
+    }
+    if (option == "--benchmark-hdri")
+    {
+        VolumeRender volume(CGRA350Constants::CLOUD_FOLDER_PATH + "CLOUD0");
+        std::string folder_name = CGRA350Constants::ENV_FORLDER_NAME[CGRA350Constants::DEFAULT_ENV_MAP];
+        volume.BenchmarkHDRI(argc > 2 ? argv[2] : CGRA350Constants::TEXTURES_FOLDER_PATH + folder_name + "/bottom.hdr");
+        return EXIT_SUCCESS;
+    }
 
-int main()
+    std::cout << "Unknown option " << option << ", expected --benchmark-cpu, --benchmark-nn, --benchmark-parser, --benchmark-tr or --benchmark-hdri" << std::endl;
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1)
+    {
+        return runBenchmark(argc, argv);
+    }
+
     CGRA350::CGRA350App::initGLFW();
     CGRA350::CGRA350App finalProject; // load glfw & create window
     finalProject.initVolumeRendering();
@@ -73,128 +151,44 @@ namespace CGRA350
 
     ////
     // Load obj files
-    struct wavefront_vertex {
-        unsigned int p, n, t;
-    };
-
-    ObjMesh load_wavefront_obj(const std::string& filepath) {
-        using namespace std;
-        using namespace glm;
-
-        vector<vec3> positions;
-        vector<vec3> normals;
-        vector<vec2> uvs;
-        vector<wavefront_vertex> wv_vertices;
-        vector<unsigned int> indices;
-
-        std::map<std::string, MeshPart> meshParts;
-        std::string currentMaterialName;
-
-        ifstream objFile(filepath);
-        if (!objFile.is_open()) {
-            cerr << "Error: could not open " << filepath << endl;
-            throw runtime_error("Error: could not open file " + filepath);
+    // packed: upload the parts & the whole mesh as PackedVertex, for PACKED_VERTICES programs
+    ObjMesh load_wavefront_obj(const std::string& filepath, bool packed = false) {
+        // parsed in parallel, or read back from the .mesh file of an earlier run
+        ObjMeshData data;
+        ObjLoadStats stats;
+        if (!ObjLoader::loadObjCached(filepath, CGRA350Constants::MESH_CACHE_FOLDER_PATH, data, &stats)) {
+            throw std::runtime_error("Error: could not open file " + filepath);
         }
-
-        // Parse the.obj file
-        while (objFile.good()) {
-            string line;
-            getline(objFile, line);
-            istringstream objLine(line);
-            string mode;
-            objLine >> mode;
-
-            if (mode == "v") {
-                vec3 v;
-                objLine >> v.x >> v.y >> v.z;
-                positions.push_back(v);
-            }
-            else if (mode == "vn") {
-                vec3 vn;
-                objLine >> vn.x >> vn.y >> vn.z;
-                normals.push_back(vn);
-            }
-            else if (mode == "vt") {
-                vec2 vt;
-                objLine >> vt.x >> vt.y;
-                uvs.push_back(vt);
-            }
-            else if (mode == "f") {
-                vector<wavefront_vertex> face;
-                while (objLine.good()) {
-                    wavefront_vertex v;
-                    objLine >> v.p;
-
-                    if (objLine.peek() == '/') {
-                        objLine.ignore(1);
-                        if (objLine.peek() != '/') {
-                            objLine >> v.t;
-                        }
-                        if (objLine.peek() == '/') {
-                            objLine.ignore(1);
-                            objLine >> v.n;
-                        }
-                    }
-
-                    v.p -= 1;
-                    v.n -= 1;
-                    v.t -= 1;
-                    face.push_back(v);
-                }
-
-                // Treated triangular face
-                if (face.size() == 3) {
-                    for (int i = 0; i < 3; ++i) {
-                        wv_vertices.push_back(face[i]);
-                    }
-
-                    for (int i = 0; i < 3; ++i) {
-                        // Adds the face to the corresponding part of the current material
-                        meshParts[currentMaterialName].positions.push_back(positions[face[i].p]);
-                        meshParts[currentMaterialName].normals.push_back(normals[face[i].n]);
-                        meshParts[currentMaterialName].texCoords.push_back(uvs[face[i].t]);
-                        meshParts[currentMaterialName].indices.push_back(meshParts[currentMaterialName].positions.size() - 1);
-                    }
-                }
-            }
-            else if (mode == "usemtl") {
-                // Handle new materials
-                objLine >> currentMaterialName;
-            }
-        }
-
-        // Generating normal
-        if (normals.empty()) {
-            // Generate normals if not present
-            for (size_t i = 0; i < positions.size(); ++i) {
-                normals.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-            }
-
-            // Compute normals
-            for (size_t i = 0; i < indices.size(); i += 3) {
-                glm::vec3 v0 = positions[indices[i]];
-                glm::vec3 v1 = positions[indices[i + 1]];
-                glm::vec3 v2 = positions[indices[i + 2]];
-
-                glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-
-                normals[indices[i]] += normal;
-                normals[indices[i + 1]] += normal;
-                normals[indices[i + 2]] += normal;
-            }
-
-            for (size_t i = 0; i < normals.size(); ++i) {
-                normals[i] = glm::normalize(normals[i]);
+        std::cout << "Loaded '" << filepath << "' " << (stats.from_cache ? "from its .mesh file" : "and saved its .mesh file")
+            << " in " << stats.seconds * 1000.0 << " ms (" << stats.corners / 3 << " triangles, " << stats.vertices << " vertices)" << std::endl;
+
+        // The whole mesh is every part one after the other
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> uvs;
+        std::vector<unsigned int> indices;
+        std::map<std::string, MeshPart> meshParts;
+        for (const ObjMeshPart& part : data.parts) {
+            MeshPart& meshPart = meshParts[part.material];
+            meshPart.packed = packed;
+            meshPart.vertices = part.vertices;
+            meshPart.indices.assign(part.indices.begin(), part.indices.end());
+            meshPart.lods = part.lods;
+
+            unsigned int base = (unsigned int)positions.size();
+            for (const ObjVertex& vertex : part.vertices) {
+                positions.push_back(vertex.position);
+                normals.push_back(vertex.normal);
+                uvs.push_back(vertex.tex_coord);
+            }
+            for (unsigned int index : part.indices) {
+                indices.push_back(base + index);
             }
         }
 
-        // Build index
-        for (const wavefront_vertex& v : wv_vertices) {
-            indices.push_back(v.p);
-        }
-
         // Create an ObjMesh object
         ObjMesh objMesh(positions, normals, uvs, indices);
+        objMesh.packed = packed;
         objMesh.initialise();  // Initializes OpenGL data
 
         for (auto& part : meshParts) {
@@ -202,20 +196,55 @@ namespace CGRA350
             objMesh.parts[part.first] = part.second;
         }
 
+        // Vertex shader runs & GPU memory of the parts, against one vertex and 32-bit index
+        // per face corner as they were before welding and optimising
+        for (const auto& part : meshParts) {
+            const MeshPart& meshPart = part.second;
+            size_t corners = meshPart.indices.size();
+            size_t transforms = MeshOptimiser::countTransforms(meshPart.indices, meshPart.vertices.size());
+            size_t soupBytes = corners * (sizeof(ObjVertex) + sizeof(unsigned int));
+            std::cout << "  part '" << part.first << "': " << corners << " -> " << transforms << " vertex shader runs, "
+                << soupBytes / 1024 << " -> " << meshPart.getBytes() / 1024 << " KB";
+            if (meshPart.packed) {
+                // largest error of the packed vertices
+                std::cout << " packed (position " << meshPart.packing_error.position << ", normal "
+                    << meshPart.packing_error.normal_degrees << " deg, uv " << meshPart.packing_error.tex_coord << ")";
+            }
+            for (const ObjMeshLod& lod : meshPart.lods) {
+                std::cout << ", lod " << lod.indices.size() / 3 << " triangles (error " << lod.error << ")";
+            }
+            std::cout << std::endl;
+        }
+
         return objMesh;
     }
     ////
 
     void CGRA350App::renderLoop()
     {
+        // Textures are decoded on loader threads and uploaded at the start of each frame;
+        // until then they sample as 1x1 grey placeholders. Textures baked into the texture
+        // pack (see texture_baker) are uploaded from it without decoding, and the cache makes
+        // every file load once however many materials use it.
+        auto load_start_time = std::chrono::steady_clock::now();
+        TexturePack texture_pack;
+        TextureStreamer texture_streamer;
+        if (texture_pack.open(CGRA350Constants::TEXTURE_PACK_PATH))
+        {
+            texture_streamer.setPack(&texture_pack);
+        }
+        TextureCache texture_cache(texture_streamer);
+        bool first_frame = true;
+        bool textures_loaded = false;
+
+        // Programs are linked once per run, or loaded from the binaries saved by earlier runs
+        ShaderCache shader_cache(CGRA350Constants::SHADER_CACHE_FOLDER_PATH, CGRA350Constants::SHADER_HOT_RELOAD);
+
         // ------------------------------
         // Skybox
 
         // Create skybox shaders
-        std::vector<Shader> skybox_shaders;
-        skybox_shaders.emplace_back("skybox.vert");
-        skybox_shaders.emplace_back("skybox.frag");
-        ShaderProgram skybox_shader_prog(skybox_shaders);
+        ShaderProgram &skybox_shader_prog = shader_cache.getProgram({ "skybox.vert", "skybox.frag" });
 
         // Create skybox cubemap texture
         std::shared_ptr<CubeMapTexture> env_maps[] = {nullptr, nullptr, nullptr, nullptr, nullptr };
@@ -231,7 +260,7 @@ namespace CGRA350
                 folder_name + "/back.jpg"
             };
 
-            env_maps[i] = std::make_shared<CubeMapTexture>(env_map_imgs);
+            env_maps[i] = texture_cache.getCubeMap(env_map_imgs);
         }
 
         // Track last env map used
@@ -249,32 +278,20 @@ namespace CGRA350
 
         // --- Fresnel
         // Create ocean surface shaders
-        std::vector<Shader> ocean_shaders_fresnel;
-        ocean_shaders_fresnel.emplace_back("ocean_wavesim.vert");
-        ocean_shaders_fresnel.emplace_back("ocean_fresnel.frag");
-        ShaderProgram ocean_shader_prog_fresnel(ocean_shaders_fresnel);
+        ShaderProgram &ocean_shader_prog_fresnel = shader_cache.getProgram({ "ocean_wavesim.vert", "ocean_fresnel.frag" });
         // Create ocean renderer
         FullOceanRenderer ocean_renderer_fresnel(ocean_shader_prog_fresnel, ocean_mesh_ptr, skybox_renderer.getCubeMapTexture());
 
         // --- Reflection
-        std::vector<Shader> ocean_shaders_refl;
-        ocean_shaders_refl.emplace_back("ocean_wavesim.vert");
-        ocean_shaders_refl.emplace_back("ocean_refl.frag");
-        ShaderProgram ocean_shader_prog_refl(ocean_shaders_refl);
+        ShaderProgram &ocean_shader_prog_refl = shader_cache.getProgram({ "ocean_wavesim.vert", "ocean_refl.frag" });
         ReflectiveOceanRenderer ocean_renderer_refl(ocean_shader_prog_refl, ocean_mesh_ptr, skybox_renderer.getCubeMapTexture());
 
         // --- Refraction
-        std::vector<Shader> ocean_shaders_refr;
-        ocean_shaders_refr.emplace_back("ocean_wavesim.vert");
-        ocean_shaders_refr.emplace_back("ocean_refr.frag");
-        ShaderProgram ocean_shader_prog_refr(ocean_shaders_refr);
+        ShaderProgram &ocean_shader_prog_refr = shader_cache.getProgram({ "ocean_wavesim.vert", "ocean_refr.frag" });
         RefractiveOceanRenderer ocean_renderer_refr(ocean_shader_prog_refr, ocean_mesh_ptr);
 
         // --- Phong
-        std::vector<Shader> ocean_shaders_phong;
-        ocean_shaders_phong.emplace_back("ocean_wavesim.vert");
-        ocean_shaders_phong.emplace_back("ocean_phong.frag");
-        ShaderProgram ocean_shader_prog_phong(ocean_shaders_phong);
+        ShaderProgram &ocean_shader_prog_phong = shader_cache.getProgram({ "ocean_wavesim.vert", "ocean_phong.frag" });
         OceanRenderer ocean_renderer_phong(ocean_shader_prog_phong, ocean_mesh_ptr);
 
         // --- Other params
@@ -289,35 +306,32 @@ namespace CGRA350
         float last_water_base_colour_amt = CGRA350Constants::DEFAULT_WATER_BASE_COLOUR_AMOUNT;
 
         // Loading Normal Maps
-        Texture2D normal_map_texture = Texture2D("./water_normal1.jpg");  //Add: Water ripples
+        std::shared_ptr<Texture2D> normal_map_texture = texture_cache.getTexture2D("./water_normal1.jpg");  //Add: Water ripples
         // Passing a normal map to the reflection renderer
-        ocean_renderer_refl.setNormalMapTexture(normal_map_texture);
+        ocean_renderer_refl.setNormalMapTexture(*normal_map_texture);
 
         // Passing a normal map to the refraction renderer
-        ocean_renderer_refr.setNormalMapTexture(normal_map_texture);
+        ocean_renderer_refr.setNormalMapTexture(*normal_map_texture);
 
 
         // ------------------------------
         // Seabed
         // Create seabed shaders
-        std::vector<Shader> seabed_shaders;
-        seabed_shaders.emplace_back("seabed.vert");
-        seabed_shaders.emplace_back("seabed.frag");
-        ShaderProgram seabed_shader_prog(seabed_shaders);
+        ShaderProgram &seabed_shader_prog = shader_cache.getProgram({ "seabed.vert", "seabed.frag" });
 
         // Load & create Perlin noise texture
-        Texture2D perlin_tex = Texture2D("perlin_noise.jpg");
+        std::shared_ptr<Texture2D> perlin_tex = texture_cache.getTexture2D("perlin_noise.jpg");
 
         // Load & create Seabed textures
         string seabed_imgs_names[] = { "sand_seabed_1.jpg", "sand_seabed_2.jpg", "petrified_seabed.jpg" };
         std::shared_ptr<Texture2D> seabed_textures[] = { nullptr, nullptr, nullptr };
         for (int i = 0; i < 3; i++)
         {
-            seabed_textures[i] = std::make_shared<Texture2D>(seabed_imgs_names[i]);
+            seabed_textures[i] = texture_cache.getTexture2D(seabed_imgs_names[i]);
         }
 
         // Create seabed renderer
-        SeabedRenderer seabed_renderer(seabed_shader_prog, perlin_tex);
+        SeabedRenderer seabed_renderer(seabed_shader_prog, *perlin_tex);
 
         // Track last SEABED size values
         int last_seabed_mesh_grid_width = CGRA350Constants::DEFAULT_SEABED_GRID_WIDTH;
@@ -328,20 +342,11 @@ namespace CGRA350
 
         // ------------------------------
         // Rain
-        Texture2D splash_texture = Texture2D("raindrop_splash_spritesheet.png");
-        std::vector<Shader> rain_compute_shader;
-        rain_compute_shader.emplace_back("rain.comp");
-        ShaderProgram rain_compute_shader_prog(rain_compute_shader);
-        std::vector<Shader> raindrop_shaders;
-        raindrop_shaders.emplace_back("raindrop.vert");
-        raindrop_shaders.emplace_back("raindrop.geom");
-        raindrop_shaders.emplace_back("raindrop.frag");
-        ShaderProgram raindrop_shader_prog(raindrop_shaders);
-        std::vector<Shader> splash_shaders;
-        splash_shaders.emplace_back("splash.vert");
-        splash_shaders.emplace_back("splash.frag");
-        ShaderProgram splash_shader_prog(splash_shaders);
-        Rain rain(rain_compute_shader_prog, raindrop_shader_prog, splash_shader_prog, splash_texture);
+        std::shared_ptr<Texture2D> splash_texture = texture_cache.getTexture2D("raindrop_splash_spritesheet.png");
+        ShaderProgram &rain_compute_shader_prog = shader_cache.getProgram({ "rain.comp" });
+        ShaderProgram &raindrop_shader_prog = shader_cache.getProgram({ "raindrop.vert", "raindrop.geom", "raindrop.frag" });
+        ShaderProgram &splash_shader_prog = shader_cache.getProgram({ "splash.vert", "splash.frag" });
+        Rain rain(rain_compute_shader_prog, raindrop_shader_prog, splash_shader_prog, *splash_texture);
         int last_rain_drop_num = m_context.m_gui_param.raindrop_num;
         rain.initializeRain(last_rain_drop_num,
                             m_context.m_gui_param.rain_position,
@@ -352,300 +357,257 @@ namespace CGRA350
 
         // ------------------------------
         // Axis
-        std::vector<Shader> axis_shaders;
-        axis_shaders.emplace_back("axis.vert");
-        axis_shaders.emplace_back("axis.geom");
-        axis_shaders.emplace_back("axis.frag");
-        ShaderProgram axis_shader_prog(axis_shaders);
+        ShaderProgram &axis_shader_prog = shader_cache.getProgram({ "axis.vert", "axis.geom", "axis.frag" });
 
         // Grid
-        std::vector<Shader> grid_shaders;
-        grid_shaders.emplace_back("grid.vert");
-        grid_shaders.emplace_back("grid.geom");
-        grid_shaders.emplace_back("grid.frag");
-        ShaderProgram grid_shader_prog(grid_shaders);
+        ShaderProgram &grid_shader_prog = shader_cache.getProgram({ "grid.vert", "grid.geom", "grid.frag" });
 
         ////
         // OBJ processing
 
         //-----------------------//
-        // Loaded lighthouse model
-        ObjMesh lighthouseMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "lighthouse9.obj");
+        // Programs of packed meshes are built with PACKED_VERTICES (see mesh_vertex.glsl)
+        auto vertex_defines = [](bool packed, std::vector<std::string> defines = {}) {
+            if (packed) {
+                defines.push_back("PACKED_VERTICES");
+            }
+            return defines;
+        };
 
-        std::vector<Shader> lighthouse_shaders;
+        //-----------------------//
+        // Loaded lighthouse model
+        ObjMesh lighthouseMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "lighthouse9.obj", CGRA350Constants::PACK_LIGHTHOUSE_VERTICES);
+
+        // Programs for each light model (0: Phong, 1: Cook-Torrance, 2: Oren-Nayar), variants of
+        // lighthouse.frag all linked up front so that switching the model only switches the program
+        ShaderProgram *lighthouse_shader_progs[] = {
+            &shader_cache.getProgram({ "lighthouse.vert", "lighthouse.frag" }, vertex_defines(CGRA350Constants::PACK_LIGHTHOUSE_VERTICES)),
+            &shader_cache.getProgram({ "lighthouse.vert", "lighthouse.frag" }, vertex_defines(CGRA350Constants::PACK_LIGHTHOUSE_VERTICES, { "COOK_TORRANCE" })),
+            &shader_cache.getProgram({ "lighthouse.vert", "lighthouse.frag" }, vertex_defines(CGRA350Constants::PACK_LIGHTHOUSE_VERTICES, { "OREN_NAYAR" }))
+        };
+        ShaderProgram &lighthouse_shader_prog = *lighthouse_shader_progs[m_context.m_light_model];
+
+        // Lighthouse parts, drawn together in this order by one multi-draw; part i samples the
+        // layer of the material set's texture array at index i
+        enum { LIGHTHOUSE_IRON, LIGHTHOUSE_BLGLASS, LIGHTHOUSE_GLASS, LIGHTHOUSE_LENS, LIGHTHOUSE_MIRROR,
+            LIGHTHOUSE_REDIRON, LIGHTHOUSE_ROCK, LIGHTHOUSE_WALL, LIGHTHOUSE_WOOD, LIGHTHOUSE_NUM_PARTS };
+        lighthouseMesh.initialiseMultiDraw(SceneLayout::LIGHTHOUSE_PARTS);
 
-        if (m_context.m_light_model == 0) {
-            lighthouse_shaders.emplace_back("lighthouse.vert");
-            lighthouse_shaders.emplace_back("lighthouse.frag");
+        // Load normal maps or color maps for each part of the lighthouse
+        MaterialSet lighthouse_materials(LIGHTHOUSE_NUM_PARTS);
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_IRON, lighthouse_materials.addTexture("./Lighthouse_Material/Floor2.jpg"));
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_BLGLASS, lighthouse_materials.addTexture("./Lighthouse_Material/window4.jpg"));
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_GLASS, lighthouse_materials.addTexture("./Lighthouse_Material/Wooden_door.jpg"));
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_LENS, lighthouse_materials.addTexture("./Lighthouse_Material/Handle0.jpg"));
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_MIRROR, lighthouse_materials.addTexture("./Lighthouse_Material/window2.jpg"));
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_WOOD, lighthouse_materials.addTexture("./Lighthouse_Material/wood2.jpg"));
+
+        // Wall, roof & rock textures the UI chooses from (layers, by material index)
+        const char *lighthouse_wall_files[] = { "Windows_Dome - Map.jpg", "wood2.jpg", "25_concrete.png", "27_grey_new_brick.png",
+            "28_grey_marble.png", "30_stainless steel.jpeg", "31_brushed_medal.jpg" };
+        const char *lighthouse_roof_files[] = { "roof2.jpg", "16_medal.jpg", "18_marble.jpg", "23_rusty_medal.jpg",
+            "25_concrete.png", "30_stainless steel.jpeg", "33_glavanized_medal.jpg", "35_yellow_wood.jpg" };
+        const char *lighthouse_rock_files[] = { "Floor.jpg", "11_soil.jpg", "17_sand.jpg", "18_marble.jpg", "19_black stone.jpg",
+            "21_cobblestone.png", "22_medal.png", "34_concrete.jpeg", "35_yellow_wood.jpg" };
+        std::vector<int> lighthouse_wall_layers, lighthouse_roof_layers, lighthouse_rock_layers;
+        for (const char *file : lighthouse_wall_files)
+        {
+            lighthouse_wall_layers.push_back(lighthouse_materials.addTexture(std::string("./Lighthouse_Material/") + file));
         }
-        else if (m_context.m_light_model == 1) {
-            lighthouse_shaders.emplace_back("lighthouse_CookTorrance.vert");
-            lighthouse_shaders.emplace_back("lighthouse_CookTorrance.frag");
+        for (const char *file : lighthouse_roof_files)
+        {
+            lighthouse_roof_layers.push_back(lighthouse_materials.addTexture(std::string("./Lighthouse_Material/") + file));
         }
-        else if (m_context.m_light_model == 2) {
-            lighthouse_shaders.emplace_back("lighthouse_OrenNayar.vert");
-            lighthouse_shaders.emplace_back("lighthouse_OrenNayar.frag");
+        for (const char *file : lighthouse_rock_files)
+        {
+            lighthouse_rock_layers.push_back(lighthouse_materials.addTexture(std::string("./Lighthouse_Material/") + file));
         }
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_WALL, lighthouse_wall_layers[0]);
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_REDIRON, lighthouse_roof_layers[0]);
+        lighthouse_materials.setPartLayer(LIGHTHOUSE_ROCK, lighthouse_rock_layers[0]);
+        lighthouse_materials.load(texture_streamer);
 
-        ShaderProgram lighthouse_shader_prog(lighthouse_shaders);
+        //-----------------------//
+        // Load the tree model
+        ObjMesh treeMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "tree.obj", CGRA350Constants::PACK_TREE_VERTICES);
 
-        // Load normal maps or color maps for each part of the lighthouse
+        ShaderProgram &trunk_shader_prog = shader_cache.getProgram({ "tree.vert", "tree.frag" }, vertex_defines(CGRA350Constants::PACK_TREE_VERTICES));
 
-        Texture2D lighthouse_wall = Texture2D("./Lighthouse_Material/Windows_Dome - Map.jpg");
-        Texture2D lighthouse_iron = Texture2D("./Lighthouse_Material/Floor2.jpg");
-        Texture2D lighthouse_blglass = Texture2D("./Lighthouse_Material/window4.jpg");
-        Texture2D lighthouse_glass = Texture2D("./Lighthouse_Material/Wooden_door.jpg");
-        Texture2D lighthouse_lens = Texture2D("./Lighthouse_Material/Handle0.jpg");
-        Texture2D lighthouse_mirror = Texture2D("./Lighthouse_Material/window2.jpg");
-        Texture2D lighthouse_rediron = Texture2D("./Lighthouse_Material/roof2.jpg");
-        Texture2D lighthouse_rock = Texture2D("./Lighthouse_Material/Floor.jpg");
-        Texture2D lighthouse_wood = Texture2D("./Lighthouse_Material/wood2.jpg");
-
-        Texture2D lighthouse_wall1 = Texture2D("./Lighthouse_Material/Windows_Dome - Map.jpg");
-        Texture2D lighthouse_wall2 = Texture2D("./Lighthouse_Material/wood2.jpg");
-        Texture2D lighthouse_wall3 = Texture2D("./Lighthouse_Material/25_concrete.png");
-        Texture2D lighthouse_wall4 = Texture2D("./Lighthouse_Material/27_grey_new_brick.png");
-        Texture2D lighthouse_wall5 = Texture2D("./Lighthouse_Material/28_grey_marble.png");
-        Texture2D lighthouse_wall6 = Texture2D("./Lighthouse_Material/30_stainless steel.jpeg");
-        Texture2D lighthouse_wall7 = Texture2D("./Lighthouse_Material/31_brushed_medal.jpg");
-
-        Texture2D lighthouse_roof1 = Texture2D("./Lighthouse_Material/roof2.jpg");
-        Texture2D lighthouse_roof2 = Texture2D("./Lighthouse_Material/16_medal.jpg");
-        Texture2D lighthouse_roof3 = Texture2D("./Lighthouse_Material/18_marble.jpg");
-        Texture2D lighthouse_roof4 = Texture2D("./Lighthouse_Material/23_rusty_medal.jpg");
-        Texture2D lighthouse_roof5 = Texture2D("./Lighthouse_Material/25_concrete.png");
-        Texture2D lighthouse_roof6 = Texture2D("./Lighthouse_Material/30_stainless steel.jpeg");
-        Texture2D lighthouse_roof7 = Texture2D("./Lighthouse_Material/33_glavanized_medal.jpg");
-        Texture2D lighthouse_roof8 = Texture2D("./Lighthouse_Material/35_yellow_wood.jpg");
-
-        Texture2D lighthouse_rock1 = Texture2D("./Lighthouse_Material/Floor.jpg");
-        Texture2D lighthouse_rock2 = Texture2D("./Lighthouse_Material/11_soil.jpg");
-        Texture2D lighthouse_rock3 = Texture2D("./Lighthouse_Material/17_sand.jpg");
-        Texture2D lighthouse_rock4 = Texture2D("./Lighthouse_Material/18_marble.jpg");
-        Texture2D lighthouse_rock5 = Texture2D("./Lighthouse_Material/19_black stone.jpg");
-        Texture2D lighthouse_rock6 = Texture2D("./Lighthouse_Material/21_cobblestone.png");
-        Texture2D lighthouse_rock7 = Texture2D("./Lighthouse_Material/22_medal.png");
-        Texture2D lighthouse_rock8 = Texture2D("./Lighthouse_Material/34_concrete.jpeg");
-        Texture2D lighthouse_rock9 = Texture2D("./Lighthouse_Material/35_yellow_wood.jpg");
-
-        lighthouse_shader_prog.setFloat("roughness", m_context.m_lighthouse_roughness);
-        lighthouse_shader_prog.setFloat("metalness", m_context.m_lighthouse_medalness);
-        lighthouse_shader_prog.setFloat("reflectivity", m_context.m_lighthouse_reflectivity);
-
-        // Use the lighthouse shader program
-        lighthouse_shader_prog.use();
-        glActiveTexture(GL_TEXTURE0);
-
-        // Bind iron's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_IRON);
-        lighthouse_iron.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_IRON);
-
-        // Bind blglass's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_BLGLASS);
-        lighthouse_blglass.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_BLGLASS);
-
-        // Bind glass's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_GLASS);
-        lighthouse_glass.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_GLASS);
-
-        //  Bind lens's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_LENS);
-        lighthouse_lens.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_LENS);
-
-        //  Bind mirror's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MIRROR);
-        lighthouse_mirror.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MIRROR);
-
-        // Bind rediron's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_REDIRON);
-        lighthouse_rediron.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_REDIRON);
-
-        // Bind rock's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_ROCK);
-        lighthouse_rock.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_ROCK);
-
-        // Bind wall's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WALL);
-        lighthouse_wall.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WALL);
-
-        // Bind wood's texture
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WOOD);
-        lighthouse_wood.bind();
-        lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WOOD);
-        //*/
+        ShaderProgram &leaf_shader_prog = shader_cache.getProgram({ "tree.vert", "tree_leaf.frag" }, vertex_defines(CGRA350Constants::PACK_TREE_VERTICES));
 
-        //-----------------------//
-        // Load the tree model
-        ObjMesh treeMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "tree.obj");
-
-        std::vector<Shader> trunk_shaders;
-        trunk_shaders.emplace_back("tree.vert");
-        trunk_shaders.emplace_back("tree.frag");
-        ShaderProgram trunk_shader_prog(trunk_shaders);
-
-        std::vector<Shader> leaf_shaders;
-        leaf_shaders.emplace_back("tree.vert");
-        leaf_shaders.emplace_back("tree_leaf.frag");
-        ShaderProgram leaf_shader_prog(leaf_shaders);
-
-        Texture2D tree_trunk = Texture2D("./tree/bark_0021.jpg");
-        Texture2D tree_leaf = Texture2D("./tree/DB2X2_L01.png");
-        Texture2D tree_leaf_normal_map = Texture2D("./tree/DB2X2_L01_Nor.png");
-        Texture2D tree_leaf_specular_map = Texture2D("./tree/DB2X2_L01_Spec.png");
-
-        // Shader program using trunk
-        trunk_shader_prog.use();
-        // Bind the texture of the trunk
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE);
-        tree_trunk.bind();
-        trunk_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE);
-        
-        // Shader program using leaves 
-        leaf_shader_prog.use();
-
-        // Bind the basic color map of the leaves      
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE);
-        tree_leaf.bind();
-        leaf_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE);
-        // Bind the normal map of the leaves
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL);
-        tree_leaf_normal_map.bind();  
-        leaf_shader_prog.setInt("normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL);
-        // Bind specific light maps to leaves
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR);
-        tree_leaf_specular_map.bind(); 
-        leaf_shader_prog.setInt("specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR);
+        std::shared_ptr<Texture2D> tree_trunk = texture_cache.getTexture2D("./tree/bark_0021.jpg");
+        std::shared_ptr<Texture2D> tree_leaf = texture_cache.getTexture2D("./tree/DB2X2_L01.png");
+        std::shared_ptr<Texture2D> tree_leaf_normal_map = texture_cache.getTexture2D("./tree/DB2X2_L01_Nor.png");
+        std::shared_ptr<Texture2D> tree_leaf_specular_map = texture_cache.getTexture2D("./tree/DB2X2_L01_Spec.png");
 
         //*/
         //-----------------------//
         // Load the tree2 model
-        ObjMesh tree2Mesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "tree8.obj");
-
-        Texture2D tree2_bark = Texture2D("./tree2/bark.png");  //
-        Texture2D tree2_leaf = Texture2D("./tree2/leaf.png");   //
-        Texture2D tree2_leaf_normal_map = Texture2D("./tree2/leaf_normal.png");   //
-        Texture2D tree2_leaf_specular_map = Texture2D("./tree2/leaf_specular.png");   //
-
-        // Shader program using trunk
-        trunk_shader_prog.use();
-        // Bind the texture of the trunk
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE);
-        tree2_bark.bind();
-        trunk_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE);
-
-        // Shader program using leaf
-        leaf_shader_prog.use();
-        // Bind the texture of the leaves
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE);
-        tree2_leaf.bind();
-        leaf_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE);
-        // Bind the normal map of the leaves
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL);
-        tree2_leaf_normal_map.bind();
-        leaf_shader_prog.setInt("normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL);
-        // Bind specific light maps to leaves
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR);
-        tree2_leaf_specular_map.bind();
-        leaf_shader_prog.setInt("specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR);
+        ObjMesh tree2Mesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "tree8.obj", CGRA350Constants::PACK_TREE_VERTICES);
+
+        std::shared_ptr<Texture2D> tree2_bark = texture_cache.getTexture2D("./tree2/bark.png");  //
+        std::shared_ptr<Texture2D> tree2_leaf = texture_cache.getTexture2D("./tree2/leaf.png");   //
+        std::shared_ptr<Texture2D> tree2_leaf_normal_map = texture_cache.getTexture2D("./tree2/leaf_normal.png");   //
+        std::shared_ptr<Texture2D> tree2_leaf_specular_map = texture_cache.getTexture2D("./tree2/leaf_specular.png");   //
 
         //*/
         // Load a bunch of stone models
-        ObjMesh rocksMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "rocks.obj");
+        ObjMesh rocksMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "rocks.obj", CGRA350Constants::PACK_ROCKS_VERTICES);
 
-        std::vector<Shader> rocks_shaders;
-        rocks_shaders.emplace_back("rocks.vert");
-        rocks_shaders.emplace_back("rocks.frag");
-        ShaderProgram rocks_shader_prog(rocks_shaders);
+        ShaderProgram &rocks_shader_prog = shader_cache.getProgram({ "rocks.vert", "rocks.frag" }, vertex_defines(CGRA350Constants::PACK_ROCKS_VERTICES));
 
-        Texture2D rocks_texture = Texture2D("./rocks/Handle0.jpg");  //
-
-        // Use rock shader program
-        rocks_shader_prog.use();
-
-        // Bind the texture of the rock
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_ROCKS);
-        rocks_texture.bind();
-        rocksMesh.renderPart("AssortedRocks");
+        std::shared_ptr<Texture2D> rocks_texture = texture_cache.getTexture2D("./rocks/Handle0.jpg");  //
         //*/
 
         // Load the large stone model
-        ObjMesh caverockMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "caverock.obj");
-
-        std::vector<Shader> caverock_shaders;
-        caverock_shaders.emplace_back("caverock.vert");
-        caverock_shaders.emplace_back("caverock.frag");
-        ShaderProgram caverock_shader_prog(caverock_shaders);
+        ObjMesh caverockMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "caverock.obj", CGRA350Constants::PACK_CAVEROCK_VERTICES);
 
-        Texture2D caverock_texture = Texture2D("./rocks/Ground.jpg");  //
+        ShaderProgram &caverock_shader_prog = shader_cache.getProgram({ "caverock.vert", "caverock.frag" }, vertex_defines(CGRA350Constants::PACK_CAVEROCK_VERTICES));
 
-        // Shader program using big stones
-        caverock_shader_prog.use();
-
-        // Bind the texture of large stones
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_CAVEROCK);
-        caverock_texture.bind();
-        caverockMesh.renderPart("CavePlatform4");
+        std::shared_ptr<Texture2D> caverock_texture = texture_cache.getTexture2D("./rocks/Ground.jpg");  //
         //*/
 
         // Load the normal stone model
-        ObjMesh stoneMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "SmallArch_Obj.obj");
+        ObjMesh stoneMesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "SmallArch_Obj.obj", CGRA350Constants::PACK_STONE_VERTICES);
         //ObjMesh stoneMesh = load_wavefront_obj(BASE_PATH + "CaveWalls4_B.obj");
 
-        std::vector<Shader> stone_shaders;
-        stone_shaders.emplace_back("stone.vert");
-        stone_shaders.emplace_back("stone.frag");
-        ShaderProgram stone_shader_prog(stone_shaders);
-
-        Texture2D stone_texture = Texture2D("./stone/DSC_4736.jpg");  //
+        ShaderProgram &stone_shader_prog = shader_cache.getProgram({ "stone.vert", "stone.frag" }, vertex_defines(CGRA350Constants::PACK_STONE_VERTICES));
 
-        //Shader program using ordinary stones
-        stone_shader_prog.use();
-
-        // Bind the texture of ordinary stones
-        glActiveTexture(GL_TEXTURE0 + 1);
-        stone_texture.bind();
-        stoneMesh.render();
+        std::shared_ptr<Texture2D> stone_texture = texture_cache.getTexture2D("./stone/DSC_4736.jpg");  //
         //*/
 
         // Load normal stone 2 model
-        ObjMesh stone2Mesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "CaveWalls4_B.obj");
-
-        std::vector<Shader> stone2_shaders;
-        stone2_shaders.emplace_back("stone.vert");
-        stone2_shaders.emplace_back("stone.frag");
-        ShaderProgram stone2_shader_prog(stone_shaders);
-
-        Texture2D stone2_texture = Texture2D("./Lighthouse_Material/13_stone2_iron.jpg");  //
+        ObjMesh stone2Mesh = load_wavefront_obj(CGRA350Constants::MODEL_FOLDER_PATH + "CaveWalls4_B.obj", CGRA350Constants::PACK_STONE_VERTICES);
 
-        // Shader program using ordinary stones
-        stone2_shader_prog.use();
+        ShaderProgram &stone2_shader_prog = shader_cache.getProgram({ "stone.vert", "stone.frag" }, vertex_defines(CGRA350Constants::PACK_STONE_VERTICES));
 
-        // Bind the texture of ordinary stones
-        glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_STONE2);
-        stone2_texture.bind();
-        stone2Mesh.render();
+        std::shared_ptr<Texture2D> stone2_texture = texture_cache.getTexture2D("./Lighthouse_Material/13_stone2_iron.jpg");  //
 
         // ------------------------------
         // Postprocessing
-        std::vector<Shader> postprocessing_shaders;
-        postprocessing_shaders.emplace_back("postprocessing.vert");
-        postprocessing_shaders.emplace_back("postprocessing.frag");
-        ShaderProgram postprocessing_shader_prog(postprocessing_shaders);
+        ShaderProgram &postprocessing_shader_prog = shader_cache.getProgram({ "postprocessing.vert", "postprocessing.frag" });
         Postprocessing postprocessing(postprocessing_shader_prog, m_window.getScreenWidth(), m_window.getScreenHeight());
 
+        // Per-frame data (camera, directional light & time) read by the scene shaders from one UBO
+        UBO frame_ubo(sizeof(FrameUniforms));
+        frame_ubo.bindBase(CGRA350Constants::UBO_BINDING_FRAME_DATA);
+        shader_cache.bindUniformBlock("FrameData", CGRA350Constants::UBO_BINDING_FRAME_DATA);
+        FrameUniforms frame_uniforms;
+
+        shader_cache.printSummary();
+
+        // Rebuild programs in the background when their files change
+        std::unique_ptr<ShaderWatcher> shader_watcher;
+        if (CGRA350Constants::SHADER_HOT_RELOAD)
+        {
+            shader_watcher = std::make_unique<ShaderWatcher>(shader_cache, m_window.getWindow());
+        }
+
+        // ------------------------------
+        // Props: a scene of the parts drawn, each with its material at its model's node, set up
+        // once. Each frame it culls them, picks their levels of detail and draws them sorted by
+        // program & material
+        Scene scene;
+        const int lighthouse_node = scene.addNode(SceneLayout::getLighthouseModelMatrix());
+        const int tree_node = scene.addNode(SceneLayout::getTreeModelMatrix());
+        const int tree2_node = scene.addNode(SceneLayout::getTree2ModelMatrix());
+        const int rocks_node = scene.addNode(SceneLayout::getRocksModelMatrix());
+        const int caverock_node = scene.addNode(SceneLayout::getCaverockModelMatrix());
+        const int stone_node = scene.addNode(SceneLayout::getStoneModelMatrix());
+        const int stone2_node = scene.addNode(SceneLayout::getStone2ModelMatrix());
+
+        // The lighthouse's program follows the UI's light model (set each frame), as do its
+        // parts' layers & its surface parameters
+        SceneMaterial lighthouse_scene_material;
+        lighthouse_scene_material.program = &lighthouse_shader_prog;
+        lighthouse_scene_material.int_uniforms = { { "materials", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MATERIALS } };
+        lighthouse_scene_material.vec3_uniforms = { { "object_color", glm::vec3(0.5f, 0.5f, 0.5f) } };  // the gray material color
+        lighthouse_scene_material.bind = [&](ShaderProgram &program) {
+            // Material choices only change the parts' layers
+            if (m_context.m_wall_material >= 0 && m_context.m_wall_material < (int)lighthouse_wall_layers.size()) {
+                lighthouse_materials.setPartLayer(LIGHTHOUSE_WALL, lighthouse_wall_layers[m_context.m_wall_material]);
+            }
+            if (m_context.m_roof_material >= 0 && m_context.m_roof_material < (int)lighthouse_roof_layers.size()) {
+                lighthouse_materials.setPartLayer(LIGHTHOUSE_REDIRON, lighthouse_roof_layers[m_context.m_roof_material]);
+            }
+            if (m_context.m_bottom_material >= 0 && m_context.m_bottom_material < (int)lighthouse_rock_layers.size()) {
+                lighthouse_materials.setPartLayer(LIGHTHOUSE_ROCK, lighthouse_rock_layers[m_context.m_bottom_material]);
+            }
+            lighthouse_materials.bind(CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MATERIALS, CGRA350Constants::SSBO_BINDING_LIGHTHOUSE_MATERIALS);
+
+            program.setFloat("roughness", m_context.m_lighthouse_roughness);
+            program.setFloat("metalness", m_context.m_lighthouse_medalness);
+            program.setFloat("reflectivity", m_context.m_lighthouse_reflectivity);
+        };
+        const int lighthouse_material = scene.addMaterial(lighthouse_scene_material);
+
+        // The trees' bark & leaves (texture units, and the samplers reading them)
+        const int tree_bark_material = scene.addMaterial({ &trunk_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE, tree_trunk } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE } } });
+        const int tree_leaf_material = scene.addMaterial({ &leaf_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE, tree_leaf }, { CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL, tree_leaf_normal_map },
+                { CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR, tree_leaf_specular_map } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE }, { "normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL },
+                { "specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR } } });
+        const int tree2_bark_material = scene.addMaterial({ &trunk_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE, tree2_bark } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE } } });
+        const int tree2_leaf_material = scene.addMaterial({ &leaf_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE, tree2_leaf }, { CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL, tree2_leaf_normal_map },
+                { CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR, tree2_leaf_specular_map } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE }, { "normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL },
+                { "specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR } } });
+
+        // The stones, in the stone material color
+        const glm::vec3 stone_color = glm::vec3(0.5f, 2.5f, 0.5f);
+        const int rocks_material = scene.addMaterial({ &rocks_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_ROCKS, rocks_texture } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_ROCKS } }, { { "object_color", stone_color } } });
+        const int caverock_material = scene.addMaterial({ &caverock_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_CAVEROCK, caverock_texture } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_CAVEROCK } }, { { "object_color", stone_color } } });
+        const int stone_material = scene.addMaterial({ &stone_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_STONE, stone_texture } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_STONE } }, { { "object_color", stone_color } } });
+        const int stone2_material = scene.addMaterial({ &stone2_shader_prog,
+            { { CGRA350Constants::TEX_SAMPLE_ID_STONE2, stone2_texture } },
+            { { "texture1", CGRA350Constants::TEX_SAMPLE_ID_STONE2 } }, { { "object_color", stone_color } } });
+
+        // Layers the UI shows & hides
+        enum { SCENE_LAYER_LIGHTHOUSE = 1, SCENE_LAYER_TREES = 2, SCENE_LAYER_STONES = 4 };
+        for (const std::string &part : SceneLayout::LIGHTHOUSE_PARTS)
+        {
+            scene.addEntity(lighthouse_node, lighthouseMesh, part, lighthouse_material, SCENE_LAYER_LIGHTHOUSE);
+        }
+        scene.addEntity(tree_node, treeMesh, "bark", tree_bark_material, SCENE_LAYER_TREES);
+        scene.addEntity(tree_node, treeMesh, "leaf", tree_leaf_material, SCENE_LAYER_TREES);
+        scene.addEntity(tree2_node, tree2Mesh, "bark", tree2_bark_material, SCENE_LAYER_TREES);
+        scene.addEntity(tree2_node, tree2Mesh, "leaf", tree2_leaf_material, SCENE_LAYER_TREES);
+        scene.addEntity(rocks_node, rocksMesh, "AssortedRocks", rocks_material, SCENE_LAYER_STONES);
+        scene.addEntity(caverock_node, caverockMesh, "CavePlatform4", caverock_material, SCENE_LAYER_STONES);
+        scene.addEntity(stone_node, stoneMesh, "Arch_Small___Base", stone_material, SCENE_LAYER_STONES);
+        scene.addEntity(stone2_node, stone2Mesh, "CaveWalls4", stone2_material, SCENE_LAYER_STONES);
 
         // ------------------------------
         // Rendering Loop
         while (!m_window.shouldClose())
         {
+            // upload textures decoded since last frame
+            texture_streamer.update();
+            // swap in shader programs rebuilt since last frame
+            if (shader_watcher)
+            {
+                shader_watcher->update();
+            }
+            if (!textures_loaded && texture_streamer.getPending() == 0)
+            {
+                textures_loaded = true;
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - load_start_time;
+                std::cout << "All textures loaded after " << elapsed.count() << " s" << std::endl;
+                texture_cache.printSummary();
+            }
+
             // clear window
             m_window.clear();
 
@@ -686,6 +648,26 @@ namespace CGRA350
             glm::vec3 dLightColour(m_context.m_gui_param.dlight_color.x, m_context.m_gui_param.dlight_color.y, m_context.m_gui_param.dlight_color.z);
             float dLightStrength = m_context.m_gui_param.dlight_strength;
 
+            // --- upload the per-frame data shared by the scene shaders
+            frame_uniforms.view = view;
+            frame_uniforms.projection = proj;
+            frame_uniforms.camera_pos = m_context.m_render_camera.getPosition();
+
+            // pixels per unit at a distance of 1, for picking the levels of detail
+            const float lod_projection_scale = m_window.getScreenHeight() * 0.5f / glm::tan(glm::radians(m_context.m_render_camera.getFOV()) * 0.5f);
+            frame_uniforms.time = (float)glfwGetTime();
+            frame_uniforms.light_colour = dLightColour;
+            frame_uniforms.light_direction = dLightDirection;
+            frame_uniforms.light_strength = dLightStrength;
+            frame_ubo.update(&frame_uniforms, sizeof(frame_uniforms));
+
+            // --- cull the props' parts, all at once, pick their levels of detail & sort their draws
+            scene.getMaterial(lighthouse_material).program = lighthouse_shader_progs[m_context.m_light_model];
+            scene.setVisibleLayers((m_context.m_appear_lighthouse ? SCENE_LAYER_LIGHTHOUSE : 0) | (m_context.m_appear_tree ? SCENE_LAYER_TREES : 0)
+                | (m_context.m_appear_stone ? SCENE_LAYER_STONES : 0));
+            scene.update(proj * view, frame_uniforms.camera_pos, lod_projection_scale);
+            m_context.m_prop_culling = scene.getCullingStats();
+
             // --- update mesh data if changed in UI ---
 
             // update mesh data if the grid resolution has been changed in the UI
@@ -822,55 +804,25 @@ namespace CGRA350
                 switch (m_context.m_illumin_model)
                 {
                 case 0: {
-                    // The uniform variable is set in the render loop
-                    ocean_shader_prog_fresnel.use();
-                    ocean_shader_prog_fresnel.setVec3("light.direction", dLightDirection);
-                    ocean_shader_prog_fresnel.setVec3("light.colour", dLightColour);
-                    ocean_shader_prog_fresnel.setFloat("light.strength", dLightStrength);
-
                     ocean_renderer_fresnel.render(m_context.m_render_camera);
                 }
                     break;
                 case 1: {
-                    // The uniform variable is set in the render loop
-                    ocean_shader_prog_refl.use();
-                    ocean_shader_prog_refl.setVec3("light.direction", dLightDirection);
-                    ocean_shader_prog_refl.setVec3("light.colour", dLightColour);
-                    ocean_shader_prog_refl.setFloat("light.strength", dLightStrength);
-
                     ocean_renderer_refl.render(m_context.m_render_camera);
                 }
                     break;
                 case 2: {
-                    // The uniform variable is set in the render loop
-                    ocean_shader_prog_refr.use();
-                    ocean_shader_prog_refr.setVec3("light.direction", dLightDirection);
-                    ocean_shader_prog_refr.setVec3("light.colour", dLightColour);
-                    ocean_shader_prog_refr.setFloat("light.strength", dLightStrength);
-                    
                     ocean_renderer_refr.render(m_context.m_render_camera);
                 }
                     break;
                 default:
                 {
-                    // The uniform variable is set in the render loop
-                    ocean_shader_prog_phong.use();
-                    ocean_shader_prog_phong.setVec3("light.direction", dLightDirection);
-                    ocean_shader_prog_phong.setVec3("light.colour", dLightColour);
-                    ocean_shader_prog_phong.setFloat("light.strength", dLightStrength);
-
                     ocean_renderer_phong.render(m_context.m_render_camera);
                 }
                     break;
                 }
             }
 
-            // --- render seabed ---
-            seabed_shader_prog.use();
-            seabed_shader_prog.setVec3("light.direction", dLightDirection);
-            seabed_shader_prog.setVec3("light.colour", dLightColour);
-            seabed_shader_prog.setFloat("light.strength", dLightStrength);
-
             if (m_context.m_do_render_seabed)
             {
                 seabed_renderer.render(m_context.m_render_camera);
@@ -900,409 +852,9 @@ namespace CGRA350
                 rain.renderSplashes(proj, view, cameraRight, cameraUp, ImGui::GetIO().DeltaTime);
             }
 
-            if (m_context.m_appear_lighthouse == true) {
-                //-----------------------------//
-                std::vector<Shader> lighthouse_shaders;
-                if (m_context.m_light_model == 0) {
-                    lighthouse_shaders.emplace_back("lighthouse.vert");
-                    lighthouse_shaders.emplace_back("lighthouse.frag");
-                }
-                else if (m_context.m_light_model == 1) {
-                    lighthouse_shaders.emplace_back("lighthouse_CookTorrance.vert");
-                    lighthouse_shaders.emplace_back("lighthouse_CookTorrance.frag");
-                }
-                else if (m_context.m_light_model == 2) {
-                    lighthouse_shaders.emplace_back("lighthouse_OrenNayar.vert");
-                    lighthouse_shaders.emplace_back("lighthouse_OrenNayar.frag");
-                }
-                ShaderProgram lighthouse_shader_prog(lighthouse_shaders);
-
-                // Render lighthouse model
-                lighthouse_shader_prog.use();  // Shader program using lighthouse model
-
-                lighthouse_shader_prog.setFloat("roughness", m_context.m_lighthouse_roughness);
-                lighthouse_shader_prog.setFloat("metalness", m_context.m_lighthouse_medalness);
-                lighthouse_shader_prog.setFloat("reflectivity", m_context.m_lighthouse_reflectivity);
-
-                lighthouse_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                lighthouse_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                lighthouse_shader_prog.setFloat("light.strength", dLightStrength);
-
-                lighthouse_shader_prog.setVec3("view_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                lighthouse_shader_prog.setInt("normalMap", 0); // 0 represents the texture unit to which it is bound
-
-                // Set the gray material color
-                lighthouse_shader_prog.setVec3("object_color", glm::vec3(0.5f, 0.5f, 0.5f));
-
-                // Set model matrix
-                glm::mat4 lighthouse_model_matrix = glm::translate(glm::mat4(0.3f), glm::vec3(-80.0f, 15.0f, -420.0f)); // Translation transformation
-                lighthouse_model_matrix = glm::rotate(lighthouse_model_matrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate 90 degrees clockwise along the X axis
-                lighthouse_model_matrix = glm::rotate(lighthouse_model_matrix, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate 90 degrees clockwise along the Z axis
-                lighthouse_shader_prog.setMat4("model", lighthouse_model_matrix);
-
-                // Set the view and projection matrix
-                lighthouse_shader_prog.setMat4("view", m_context.m_render_camera.getViewMatrix());
-                lighthouse_shader_prog.setMat4("projection", m_context.m_render_camera.getProjMatrix());
-
-                // Modify Wall map
-                if (m_context.m_wall_material == 0) {
-                    lighthouse_wall = lighthouse_wall1;  //
-                }
-                else if (m_context.m_wall_material == 1) {
-                    lighthouse_wall = lighthouse_wall2;  //
-                }
-                else if (m_context.m_wall_material == 2) {
-                    lighthouse_wall = lighthouse_wall3;  //
-                }
-                else if (m_context.m_wall_material == 3) {
-                    lighthouse_wall = lighthouse_wall4;  //
-                }
-                else if (m_context.m_wall_material == 4) {
-                    lighthouse_wall = lighthouse_wall5;  //
-                }
-                else if (m_context.m_wall_material == 5) {
-                    lighthouse_wall = lighthouse_wall6;  //
-                }
-                else if (m_context.m_wall_material == 6) {
-                    lighthouse_wall = lighthouse_wall7;  //
-                }
-
-                // Modify Roof map
-                if (m_context.m_roof_material == 0) {
-                    lighthouse_rediron = lighthouse_roof1;  //
-                }
-                else if (m_context.m_roof_material == 1) {
-                    lighthouse_rediron = lighthouse_roof2;  //
-                }
-                else if (m_context.m_roof_material == 2) {
-                    lighthouse_rediron = lighthouse_roof3;  //
-                }
-                else if (m_context.m_roof_material == 3) {
-                    lighthouse_rediron = lighthouse_roof4;  //
-                }
-                else if (m_context.m_roof_material == 4) {
-                    lighthouse_rediron = lighthouse_roof5;  //
-                }
-                else if (m_context.m_roof_material == 5) {
-                    lighthouse_rediron = lighthouse_roof6;  //
-                }
-                else if (m_context.m_roof_material == 6) {
-                    lighthouse_rediron = lighthouse_roof7;  //
-                }
-                else if (m_context.m_roof_material == 7) {
-                    lighthouse_rediron = lighthouse_roof8;  //
-                }
-
-                // Modify Rock map
-                if (m_context.m_bottom_material == 0) {
-                    lighthouse_rock = lighthouse_rock1;  //
-                }
-                else if (m_context.m_bottom_material == 1) {
-                    lighthouse_rock = lighthouse_rock2;  //
-                }
-                else if (m_context.m_bottom_material == 2) {
-                    lighthouse_rock = lighthouse_rock3;  //
-                }
-                else if (m_context.m_bottom_material == 3) {
-                    lighthouse_rock = lighthouse_rock4;  //
-                }
-                else if (m_context.m_bottom_material == 4) {
-                    lighthouse_rock = lighthouse_rock5;  //
-                }
-                else if (m_context.m_bottom_material == 5) {
-                    lighthouse_rock = lighthouse_rock6;  //
-                }
-                else if (m_context.m_bottom_material == 6) {
-                    lighthouse_rock = lighthouse_rock7;  //
-                }
-                else if (m_context.m_bottom_material == 7) {
-                    lighthouse_rock = lighthouse_rock8;  //
-                }
-                else if (m_context.m_bottom_material == 8) {
-                    lighthouse_rock = lighthouse_rock9;  //
-                }
-
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_IRON);
-                lighthouse_iron.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_IRON);
-                lighthouseMesh.renderPart("Bl_iron");
-
-                // Render the bl_glass section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_BLGLASS);
-                lighthouse_blglass.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_BLGLASS);
-                lighthouseMesh.renderPart("bl_glass");
-
-                // Render the clglass section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_GLASS);
-                lighthouse_glass.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_GLASS);
-                lighthouseMesh.renderPart("clglass");
-
-                // Render the lens section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_LENS);
-                lighthouse_lens.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_LENS);
-                lighthouseMesh.renderPart("lens");
-
-                // Render the mirror section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MIRROR);
-                lighthouse_mirror.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_MIRROR);
-                lighthouseMesh.renderPart("mirror");
-
-                // Render the red_iron section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_REDIRON);
-                lighthouse_rediron.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_REDIRON);
-                lighthouseMesh.renderPart("red_iron");
-
-                // Render the rock section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_ROCK);
-                lighthouse_rock.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_ROCK);
-                lighthouseMesh.renderPart("rock");
-
-                // Render the wall section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WALL);
-                lighthouse_wall.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WALL);
-                lighthouseMesh.renderPart("walls");
-
-                // Render the wood section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WOOD);
-                lighthouse_wood.bind();
-                lighthouse_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_LIGHTHOUSE_WOOD);
-                lighthouseMesh.renderPart("wood");
-            }
-
-            //-----------------------------//
-            if (m_context.m_appear_tree == true) {
-                // Render tree 1 model
-                trunk_shader_prog.use();
-
-                trunk_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                trunk_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                trunk_shader_prog.setFloat("light.strength", dLightStrength);
-
-                trunk_shader_prog.setVec3("camera_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                // Set model matrix
-                glm::mat4 tree_model_matrix = glm::translate(glm::mat4(5.0f), glm::vec3(-5.0f, -1.1f, -12.0f));
-                tree_model_matrix = glm::scale(tree_model_matrix, glm::vec3(0.6f, 0.6f, 0.6f));
-                trunk_shader_prog.setMat4("model", tree_model_matrix);
-                // Set the view and projection matrix
-                trunk_shader_prog.setMat4("view", view);
-                trunk_shader_prog.setMat4("projection", proj);
-                // Render the trunk section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE);
-                tree_trunk.bind();
-                trunk_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE);
-                treeMesh.renderPart("bark");
-
-                // Render the leaf section
-                leaf_shader_prog.use();
-
-                leaf_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                leaf_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                leaf_shader_prog.setFloat("light.strength", dLightStrength);
-
-                leaf_shader_prog.setVec3("camera_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                // Set model matrix
-                leaf_shader_prog.setMat4("model", tree_model_matrix);
-                // Set the view and projection matrix
-                leaf_shader_prog.setMat4("view", view);
-                leaf_shader_prog.setMat4("projection", proj);
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE);
-                tree_leaf.bind();
-                leaf_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_DIFFUSE);
-                // Bind the normal map of the leaves
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL);
-                tree_leaf_normal_map.bind();
-                leaf_shader_prog.setInt("normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_NORMAL);
-                // Bind specific light maps to leaves
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR);
-                tree_leaf_specular_map.bind();
-                leaf_shader_prog.setInt("specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE1_LEAF_SPECULAR);
-                treeMesh.renderPart("leaf");
-                //*/
-            }
-
-            if (m_context.m_appear_tree == true) {
-                //-----------------------------//
-                // Render tree 2 model
-                trunk_shader_prog.use();
-
-                trunk_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                trunk_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                trunk_shader_prog.setFloat("light.strength", dLightStrength);
-
-                trunk_shader_prog.setVec3("camera_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                // Set model matrix
-                glm::mat4 tree2_model_matrix = glm::translate(glm::mat4(1.5f), glm::vec3(-18.0f, -3.5f, -25.0f));
-                trunk_shader_prog.setMat4("model", tree2_model_matrix);
-                // Set the view and projection matrix
-                trunk_shader_prog.setMat4("view", view);
-                trunk_shader_prog.setMat4("projection", proj);
-                // Render the trunk section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE);
-                tree2_bark.bind();
-                trunk_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_TRUNK_DIFFUSE);
-                tree2Mesh.renderPart("bark");
-
-                // Render the leaf section
-                leaf_shader_prog.use();
-                leaf_shader_prog.setVec3("light_dir", dLightDirection); // Set light position
-                leaf_shader_prog.setVec3("light_color", dLightColour); // Set light color
-                leaf_shader_prog.setVec3("camera_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                // Set the view and projection matrix
-                leaf_shader_prog.setMat4("model", tree2_model_matrix);
-                leaf_shader_prog.setMat4("view", view);
-                leaf_shader_prog.setMat4("projection", proj);
-                // Bind the texture of the leaves
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE);
-                tree2_leaf.bind();
-                leaf_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_DIFFUSE);
-                // Bind the normal map of the leaves
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL);
-                tree2_leaf_normal_map.bind();
-                leaf_shader_prog.setInt("normalMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_NORMAL);
-                // Bind specific light maps to leaves
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR);
-                tree2_leaf_specular_map.bind();
-                leaf_shader_prog.setInt("specularMap", CGRA350Constants::TEX_SAMPLE_ID_TREE2_LEAF_SPECULAR);
-                tree2Mesh.renderPart("leaf");
-                //*/
-            }
-
-            if (m_context.m_appear_stone == true) {
-                //-----------------------------//
-                // Render rock model
-                rocks_shader_prog.use();  // Shader program using lighthouse model
-
-                rocks_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                rocks_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                rocks_shader_prog.setFloat("light.strength", dLightStrength);
-
-                rocks_shader_prog.setVec3("view_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                rocks_shader_prog.setInt("normalMap", 0); // 0 represents the texture unit to which it is bound
-
-                // Set the stone material color
-                rocks_shader_prog.setVec3("object_color", glm::vec3(0.5f, 2.5f, 0.5f));
-
-                // Set model matrix
-                glm::mat4 rocks_model_matrix = glm::translate(glm::mat4(0.9f), glm::vec3(-280.0f, -37.0f, -180.0f));
-                rocks_model_matrix = glm::rotate(rocks_model_matrix, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
-                rocks_shader_prog.setMat4("model", rocks_model_matrix);
-
-                // Set the view and projection matrix
-                rocks_shader_prog.setMat4("view", m_context.m_render_camera.getViewMatrix());
-                rocks_shader_prog.setMat4("projection", m_context.m_render_camera.getProjMatrix());
-
-                // Render stone section
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_ROCKS);
-                rocks_texture.bind();
-                rocks_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_ROCKS);
-                rocksMesh.renderPart("AssortedRocks");
-                //*/
-            }
-
-            if (m_context.m_appear_stone == true) {
-                //-----------------------------//
-                // Render large stone models
-                caverock_shader_prog.use();  // Shader program using large stone models
-
-                caverock_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                caverock_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                caverock_shader_prog.setFloat("light.strength", dLightStrength);
-
-                caverock_shader_prog.setVec3("view_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                caverock_shader_prog.setInt("normalMap", 0); // 0 represents the texture unit to which it is bound
-
-                // Set the big stone material color
-                caverock_shader_prog.setVec3("object_color", glm::vec3(0.5f, 2.5f, 0.5f));
-
-                // Set model matrix
-                glm::mat4 caverock_model_matrix = glm::translate(glm::mat4(0.1f), glm::vec3(-120.0f, -42.0f, -150.0f));
-                caverock_model_matrix = glm::rotate(caverock_model_matrix, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
-                caverock_shader_prog.setMat4("model", caverock_model_matrix);
-
-                // Set the view and projection matrix
-                caverock_shader_prog.setMat4("view", m_context.m_render_camera.getViewMatrix());
-                caverock_shader_prog.setMat4("projection", m_context.m_render_camera.getProjMatrix());
-
-                // Render large stone parts
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_CAVEROCK);
-                caverock_texture.bind();
-                caverock_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_CAVEROCK);
-                caverockMesh.renderPart("CavePlatform4");
-                //*/
-            }
-
-            if (m_context.m_appear_stone == true) {
-                //-----------------------------//
-                // Render normal stone models
-                stone_shader_prog.use();  // Shader program using ordinary stone models
-
-                stone_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                stone_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                stone_shader_prog.setFloat("light.strength", dLightStrength);
-
-                stone_shader_prog.setVec3("view_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                stone_shader_prog.setInt("normalMap", 0); // 0 represents the texture unit to which it is bound
-
-                // Set the normal stone material color
-                stone_shader_prog.setVec3("object_color", glm::vec3(0.5f, 2.5f, 0.5f));
-
-                // Set model matrix
-                glm::mat4 stone_model_matrix = glm::translate(glm::mat4(0.2f), glm::vec3(-340.0f, -25.0f, -180.0f));
-                stone_model_matrix = glm::rotate(stone_model_matrix, glm::radians(-100.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
-                stone_shader_prog.setMat4("model", stone_model_matrix);
-
-                // Set the view and projection matrix
-                stone_shader_prog.setMat4("view", m_context.m_render_camera.getViewMatrix());
-                stone_shader_prog.setMat4("projection", m_context.m_render_camera.getProjMatrix());
-
-                // Render normal stone parts
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_STONE);
-                stone_texture.bind();
-                stone_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_STONE);
-                stoneMesh.render();
-                //*/
-            }
-
-            if (m_context.m_appear_stone == true) {
-                //-----------------------------//
-                // Render normal stone 2 models
-                stone2_shader_prog.use();  // Shader program using ordinary stone models
-
-                stone2_shader_prog.setVec3("light.direction", dLightDirection);    // Set light position
-                stone2_shader_prog.setVec3("light.colour", dLightColour);  // Set light color
-                stone2_shader_prog.setFloat("light.strength", dLightStrength);
-
-                stone2_shader_prog.setVec3("view_pos", m_context.m_render_camera.getPosition()); // Set camera position
-                stone2_shader_prog.setInt("normalMap", 0); // 0 represents the texture unit to which it is bound
-
-                // Set the normal stone material color
-                stone2_shader_prog.setVec3("object_color", glm::vec3(0.5f, 2.5f, 0.5f));
-
-                // Set model matrix
-                glm::mat4 stone2_model_matrix = glm::translate(glm::mat4(0.6f), glm::vec3(-24.0f, -7.0f, -380.0f));
-                stone2_model_matrix = glm::rotate(stone2_model_matrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate 90 degrees clockwise along the X axis
-                stone2_model_matrix = glm::rotate(stone2_model_matrix, glm::radians(-30.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate 90 degrees clockwise along the Z axis
-                stone2_model_matrix = glm::rotate(stone2_model_matrix, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
-                stone2_shader_prog.setMat4("model", stone2_model_matrix);
-
-                // Set the view and projection matrix
-                stone2_shader_prog.setMat4("view", m_context.m_render_camera.getViewMatrix());
-                stone2_shader_prog.setMat4("projection", m_context.m_render_camera.getProjMatrix());
-
-                // Render normal stone parts
-                glActiveTexture(GL_TEXTURE0 + CGRA350Constants::TEX_SAMPLE_ID_STONE2);
-                stone2_texture.bind();
-                stone2_shader_prog.setInt("texture1", CGRA350Constants::TEX_SAMPLE_ID_STONE2);
-                stone2Mesh.render();
-                //*/
-            }
+            // --- render the props
+            scene.render();
+            m_context.m_scene_draws = scene.getDrawStats();
             
             ////
 
@@ -1360,6 +912,18 @@ namespace CGRA350
             // flip front & back buffers; and draw
             m_window.update();
 
+            if (first_frame)
+            {
+                first_frame = false;
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - load_start_time;
+                std::cout << "Time to first frame: " << elapsed.count() << " s ("
+                    << texture_streamer.getPending() << " textures still loading)" << std::endl;
+            }
+
+            // GL calls of this frame, shown in the UI
+            m_context.m_gl_call_counts = getGLCallCounts();
+            getGLCallCounts() = GLCallCounts();
+
             glfwPollEvents();
         }
 
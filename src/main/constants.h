@@ -46,20 +46,35 @@ namespace CGRA350Constants
 	const int DEFAULT_ENV_MAP = 0;  // 0: sky_skybox_1, 1: sky_skybox_2, 3: sunset_skybox_1, 4: sunset_skybox_2, 5: sunset_skybox_3
 	const std::string ENV_FORLDER_NAME[] = { "sky_skybox_1", "sky_skybox_2", "sunset_skybox_1", "sunset_skybox_2", "sunset_skybox_3" };
 	const std::string TEXTURES_FOLDER_PATH = PROJECT_SOURCE_DIR "/resources/textures/";
+	const std::string TEXTURE_PACK_PATH = PROJECT_SOURCE_DIR "/resources/textures.pack";	// written by texture_baker
+	const std::string SHADER_CACHE_FOLDER_PATH = PROJECT_SOURCE_DIR "/shader_cache/";	// program binaries of ShaderCache
 	const std::string CLOUD_FOLDER_PATH = PROJECT_SOURCE_DIR "/data/";
 	const std::string MODEL_FOLDER_PATH = PROJECT_SOURCE_DIR "/resources/assets/";
+	const std::string MESH_CACHE_FOLDER_PATH = PROJECT_SOURCE_DIR "/mesh_cache/";	// .mesh files of ObjLoader
+
+	// Rebuild shader programs when their files are edited (see ShaderWatcher)
+	const bool SHADER_HOT_RELOAD = true;
+
+	// Upload the vertices of these models packed, in 16 bytes instead of 32 (see PackedVertex).
+	// Models drawn with the same programs must agree.
+	const bool PACK_LIGHTHOUSE_VERTICES = false;
+	const bool PACK_TREE_VERTICES = true;		// both trees
+	const bool PACK_ROCKS_VERTICES = true;
+	const bool PACK_CAVEROCK_VERTICES = true;
+	const bool PACK_STONE_VERTICES = true;		// both stones
+
+	// Levels of detail of the models (see MeshSimplifier): the coarsest whose error covers at
+	// most this many pixels is drawn, and a coarser one once it is this fraction under it
+	const float LOD_MAX_PIXEL_ERROR = 2.0f;
+	const float LOD_HYSTERESIS = 0.25f;
+
+	// Parts of the models outside the view frustum aren't drawn, nor those whose bounding
+	// sphere would be less than this many pixels across (see Culling)
+	const float PROP_CULL_MIN_PIXELS = 1.0f;
 
 	// ---- Texture Sample ID
 	// Lighthouse
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_IRON = 5;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_BLGLASS = 6;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_GLASS = 7;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_LENS = 8;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_MIRROR = 9;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_REDIRON = 10;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_ROCK = 11;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_WALL = 12;
-	const int TEX_SAMPLE_ID_LIGHTHOUSE_WOOD = 13;
+	const int TEX_SAMPLE_ID_LIGHTHOUSE_MATERIALS = 5;	// texture array of all the parts
 	
 	// Tree1
 	const int TEX_SAMPLE_ID_TREE1_TRUNK_DIFFUSE = 15;
@@ -84,6 +99,12 @@ namespace CGRA350Constants
 
 	// Postprocessing
 	const int TEX_SAMPLE_ID_POSTPROCESSING = 20;
+
+	// ---- Shader Storage Buffer binding points (0 - 2: rain)
+	const int SSBO_BINDING_LIGHTHOUSE_MATERIALS = 3;	// material layer of each lighthouse part
+
+	// ---- Uniform Buffer binding points
+	const int UBO_BINDING_FRAME_DATA = 0;	// FrameData block of the scene shaders (see FrameUniforms)
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef SCENE_LAYOUT
+#define SCENE_LAYOUT
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <string>
+#include <vector>
+
+// Where the props (the OBJ models of resources/assets) stand in the scene: their model
+// matrices and the parts of them drawn. Shared by the render loop and culling_benchmark
+// (src/tools/culling_benchmark.cpp), so the benchmark culls the scene that is drawn.
+namespace SceneLayout
+{
+	inline glm::mat4 getLighthouseModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(0.3f), glm::vec3(-80.0f, 15.0f, -420.0f)); // Translation transformation
+		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate 90 degrees clockwise along the X axis
+		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate 90 degrees clockwise along the Z axis
+		return model;
+	}
+
+	inline glm::mat4 getTreeModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(5.0f), glm::vec3(-5.0f, -1.1f, -12.0f));
+		return glm::scale(model, glm::vec3(0.6f, 0.6f, 0.6f));
+	}
+
+	inline glm::mat4 getTree2ModelMatrix()
+	{
+		return glm::translate(glm::mat4(1.5f), glm::vec3(-18.0f, -3.5f, -25.0f));
+	}
+
+	inline glm::mat4 getRocksModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(0.9f), glm::vec3(-280.0f, -37.0f, -180.0f));
+		return glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
+	}
+
+	inline glm::mat4 getCaverockModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(0.1f), glm::vec3(-120.0f, -42.0f, -150.0f));
+		return glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
+	}
+
+	inline glm::mat4 getStoneModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(0.2f), glm::vec3(-340.0f, -25.0f, -180.0f));
+		return glm::rotate(model, glm::radians(-100.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
+	}
+
+	inline glm::mat4 getStone2ModelMatrix()
+	{
+		glm::mat4 model = glm::translate(glm::mat4(0.6f), glm::vec3(-24.0f, -7.0f, -380.0f));
+		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate 90 degrees clockwise along the X axis
+		model = glm::rotate(model, glm::radians(-30.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate 90 degrees clockwise along the Z axis
+		return glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 90 degrees clockwise along the Y axis
+	}
+
+	// Lighthouse parts, in the order of its multi-draw
+	const std::vector<std::string> LIGHTHOUSE_PARTS = { "Bl_iron", "bl_glass", "clglass", "lens", "mirror", "red_iron", "rock", "walls", "wood" };
+
+	struct Prop
+	{
+		std::string file;		// in CGRA350Constants::MODEL_FOLDER_PATH
+		glm::mat4 model;
+		std::vector<std::string> parts;
+	};
+
+	// Every prop drawn (whichever of the UI's toggles hides them)
+	inline std::vector<Prop> getProps()
+	{
+		return {
+			{ "lighthouse9.obj", getLighthouseModelMatrix(), LIGHTHOUSE_PARTS },
+			{ "tree.obj", getTreeModelMatrix(), { "bark", "leaf" } },
+			{ "tree8.obj", getTree2ModelMatrix(), { "bark", "leaf" } },
+			{ "rocks.obj", getRocksModelMatrix(), { "AssortedRocks" } },
+			{ "caverock.obj", getCaverockModelMatrix(), { "CavePlatform4" } },
+			{ "SmallArch_Obj.obj", getStoneModelMatrix(), { "Arch_Small___Base" } },
+			{ "CaveWalls4_B.obj", getStone2ModelMatrix(), { "CaveWalls4" } }
+		};
+	}
+}
+#endif
@@ -0,0 +1,204 @@
+// Culling benchmark, without a window: loads the props of the scene (SceneLayout), places
+// their parts' boxes as the render loop does, and flies a camera along scripted paths. For
+// every frame, culls the parts with Culling::cull and reports the triangles submitted (at full
+// detail) against drawing every part, and checks that each part gets the same answer from
+// Culling::isVisible. Last, times both over many copies of the props, the SIMD packets
+// against one at a time.
+//
+//   culling_benchmark [models folder] [frames per path]
+
+#include "../main/constants.h"
+#include "../main/scene_layout.h"
+#include "../utils/culling.h"
+#include "../utils/obj_loader.h"
+#include "../volumerendering/simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct PropPart {
+	string name;		// file: part
+	glm::vec3 box_min, box_max;
+	size_t triangles;
+};
+
+// Camera pose as Camera keeps it: angles in degrees, the azimuth about the y axis from +x
+struct CameraPose {
+	glm::vec3 position;
+	float azimuthal_angle;
+	float polar_angle;
+};
+
+struct CameraPath {
+	const char* name;
+	vector<CameraPose> keys;	// passed through at even intervals
+};
+
+CameraPose Interpolate(const CameraPath& path, float t) {
+	float scaled = t * (path.keys.size() - 1);
+	size_t i = min((size_t)scaled, path.keys.size() - 2);
+	float f = scaled - i;
+	const CameraPose& a = path.keys[i];
+	const CameraPose& b = path.keys[i + 1];
+	return { glm::mix(a.position, b.position, f), glm::mix(a.azimuthal_angle, b.azimuthal_angle, f), glm::mix(a.polar_angle, b.polar_angle, f) };
+}
+
+// Camera::getViewMatrix & getProjMatrix for the pose, in the default window
+glm::mat4 GetViewProjection(const CameraPose& pose) {
+	glm::vec3 front = glm::normalize(glm::vec3(
+		glm::cos(glm::radians(pose.polar_angle)) * glm::cos(glm::radians(pose.azimuthal_angle)),
+		glm::sin(glm::radians(pose.polar_angle)),
+		glm::cos(glm::radians(pose.polar_angle)) * glm::sin(glm::radians(pose.azimuthal_angle))));
+	glm::mat4 view = glm::lookAt(pose.position, pose.position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), CGRA350Constants::DEFAULT_WINDOW_WIDTH / CGRA350Constants::DEFAULT_WINDOW_HEIGHT,
+		CGRA350Constants::CAMERA_NEAR_PLANE, CGRA350Constants::CAMERA_FAR_PLANE);
+	return proj * view;
+}
+
+vector<CameraPath> GetCameraPaths() {
+	const glm::vec3 start = CGRA350Constants::CAMERA_POSITION;
+	return {
+		// turning on the spot where the app starts
+		{ "look around", { { start, -135.0f, 6.0f }, { start, 45.0f, 6.0f }, { start, 225.0f, 6.0f } } },
+		// over the trees towards the lighthouse, then round it
+		{ "fly to lighthouse", { { start, -135.0f, -10.0f }, { glm::vec3(-20.0f, 15.0f, -40.0f), -90.0f, -5.0f },
+			{ glm::vec3(-24.0f, 12.0f, -90.0f), -90.0f, 0.0f }, { glm::vec3(10.0f, 12.0f, -126.0f), -180.0f, 0.0f } } },
+		// along the shore at head height, past the stones & rocks
+		{ "walk the shore", { { glm::vec3(0.0f, 2.0f, 0.0f), -150.0f, -5.0f }, { glm::vec3(-60.0f, 2.0f, -30.0f), -160.0f, -5.0f },
+			{ glm::vec3(-150.0f, 2.0f, -100.0f), -140.0f, 0.0f }, { glm::vec3(-220.0f, 2.0f, -150.0f), -90.0f, 0.0f } } },
+		// up at the clouds, then far out to sea looking back
+		{ "sky & sea", { { start, -135.0f, 70.0f }, { start, 45.0f, 60.0f }, { glm::vec3(300.0f, 30.0f, 300.0f), -135.0f, 0.0f },
+			{ glm::vec3(900.0f, 30.0f, 900.0f), -135.0f, 0.0f } } }
+	};
+}
+
+template<typename Run>
+double BestSeconds(int runs, Run run) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start_time = chrono::steady_clock::now();
+		run();
+		best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start_time).count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+	fs::path folder = argc > 1 ? argv[1] : CGRA350Constants::MODEL_FOLDER_PATH;
+	int frames = argc > 2 ? max(atoi(argv[2]), 2) : 600;
+
+	// the parts' boxes, placed as in the render loop
+	vector<PropPart> parts;
+	CullingBounds bounds;
+	for (const SceneLayout::Prop& prop : SceneLayout::getProps()) {
+		fs::path path = folder / prop.file;
+		ObjMeshData mesh;
+		if (!fs::exists(path) || !ObjLoader::loadObj(path.string(), mesh)) {
+			printf("Skipped %s (not found)\n", prop.file.c_str());
+			continue;
+		}
+		for (const string& part_name : prop.parts) {
+			auto found = find_if(mesh.parts.begin(), mesh.parts.end(), [&](const ObjMeshPart& part) { return part.material == part_name; });
+			if (found == mesh.parts.end() || found->vertices.empty()) {
+				printf("Skipped %s: %s (no such part)\n", prop.file.c_str(), part_name.c_str());
+				continue;
+			}
+			PropPart part = { prop.file + ": " + part_name, found->vertices[0].position, found->vertices[0].position, found->indices.size() / 3 };
+			for (const ObjVertex& vertex : found->vertices) {
+				part.box_min = glm::min(part.box_min, vertex.position);
+				part.box_max = glm::max(part.box_max, vertex.position);
+			}
+			bounds.add(part.box_min, part.box_max, prop.model);
+			parts.push_back(part);
+		}
+	}
+	if (parts.empty()) {
+		printf("No props found in %s\n", folder.string().c_str());
+		return 1;
+	}
+	size_t all_triangles = 0;
+	for (const PropPart& part : parts)
+		all_triangles += part.triangles;
+
+	// pixels per unit at a distance of 1, as the render loop works it out
+	const float projection_scale = CGRA350Constants::DEFAULT_WINDOW_HEIGHT * 0.5f / glm::tan(glm::radians(45.0f) * 0.5f);
+	const float min_pixels = CGRA350Constants::PROP_CULL_MIN_PIXELS;
+
+	printf("%zu parts, %zu triangles; %d frames per path, %s packets of %d\n", parts.size(), all_triangles, frames, simd::Name(), simd::Width);
+	printf("%-18s %8s %8s %8s  %12s %12s %12s  %7s  %s\n", "path", "visible", "outside", "small",
+		"submitted", "min", "max", "saved", "mismatches");
+	bool ok = true;
+	vector<uint8_t> visible;
+	for (const CameraPath& path : GetCameraPaths()) {
+		CullingStats totals;
+		size_t submitted = 0, min_submitted = all_triangles, max_submitted = 0, mismatches = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			CameraPose pose = Interpolate(path, frame / (float)(frames - 1));
+			Frustum frustum = Culling::extractFrustum(GetViewProjection(pose));
+			CullingStats stats;
+			Culling::cull(bounds, frustum, pose.position, projection_scale, min_pixels, visible, &stats);
+			totals.visible += stats.visible;
+			totals.frustum_culled += stats.frustum_culled;
+			totals.distance_culled += stats.distance_culled;
+
+			size_t frame_triangles = 0;
+			for (size_t i = 0; i < parts.size(); i++) {
+				if (visible[i])
+					frame_triangles += parts[i].triangles;
+				if ((visible[i] != 0) != Culling::isVisible(bounds, i, frustum, pose.position, projection_scale, min_pixels))
+					mismatches++;
+			}
+			submitted += frame_triangles;
+			min_submitted = min(min_submitted, frame_triangles);
+			max_submitted = max(max_submitted, frame_triangles);
+		}
+		ok = ok && mismatches == 0;
+		printf("%-18s %8.2f %8.2f %8.2f  %12.0f %12zu %12zu  %6.1f%%  %zu\n", path.name, totals.visible / (double)frames,
+			totals.frustum_culled / (double)frames, totals.distance_culled / (double)frames, submitted / (double)frames,
+			min_submitted, max_submitted, 100.0 * (1.0 - submitted / ((double)all_triangles * frames)), mismatches);
+	}
+
+	// a scene of many props: copies of the parts' boxes spread over a grid
+	const int grid = 64;
+	CullingBounds many;
+	for (int z = 0; z < grid; z++) {
+		for (int x = 0; x < grid; x++) {
+			glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3((x - grid / 2) * 40.0f, 0.0f, (z - grid / 2) * 40.0f));
+			for (size_t i = 0; i < parts.size(); i++) {
+				glm::vec3 centre = glm::vec3(bounds.centre_x[i], bounds.centre_y[i], bounds.centre_z[i]);
+				glm::vec3 extent = glm::vec3(bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i]);
+				many.add(centre - extent, centre + extent, offset);
+			}
+		}
+	}
+	CameraPose pose = { CGRA350Constants::CAMERA_POSITION, -135.0f, 6.0f };
+	Frustum frustum = Culling::extractFrustum(GetViewProjection(pose));
+	CullingStats many_stats;
+	double simd_seconds = BestSeconds(20, [&]() {
+		Culling::cull(many, frustum, pose.position, projection_scale, min_pixels, visible, &many_stats);
+	});
+	size_t scalar_visible = 0;
+	double scalar_seconds = BestSeconds(20, [&]() {
+		scalar_visible = 0;
+		for (size_t i = 0; i < many.count; i++)
+			scalar_visible += Culling::isVisible(many, i, frustum, pose.position, projection_scale, min_pixels) ? 1 : 0;
+	});
+	ok = ok && scalar_visible == (size_t)many_stats.visible;
+	printf("\n%zu boxes: cull %.1f us (%.2f ns each), one at a time %.1f us (%.2f ns each), %.1fx; %d visible (%zu one at a time)\n",
+		many.count, simd_seconds * 1e6, simd_seconds * 1e9 / many.count, scalar_seconds * 1e6, scalar_seconds * 1e9 / many.count,
+		scalar_seconds / simd_seconds, many_stats.visible, scalar_visible);
+
+	printf("%s\n", ok ? "All checks passed" : "CHECKS FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,388 @@
+// OBJ loading benchmark: loads every .obj of a folder with the getline/istringstream loader
+// ObjLoader replaced, with ObjLoader::loadObj and from the .mesh file it writes, and checks
+// that all three give the same triangles. Then reports, per part, the vertex shader runs
+// (through a 16 entry FIFO cache) and bytes of the legacy triangle soup, of the welded mesh
+// in file order and of the optimised mesh ObjLoader returns, and the bytes and largest errors
+// of its vertices packed by MeshOptimiser::packVertices. Last, builds the levels of detail of
+// every part and checks that each has at most 80% of the triangles of the level before, and
+// that its error bounds the distance from the full part's vertices and triangle centres to
+// its triangles (MeshSimplifier::measureDistance, here measured against every triangle), and
+// the other way from its triangles to the part's, and is within the 5% of the part's size
+// asked for, and that every part gets all MESH_MAX_LODS - 1 coarser levels (but for the
+// exceptions listed, with the reason). Empty parts are skipped.
+//
+//   mesh_benchmark [models folder] [runs]
+
+#include "../utils/obj_loader.h"
+#include "../utils/mesh_optimiser.h"
+#include "../utils/mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct LegacyPart {
+	vector<glm::vec3> positions;
+	vector<glm::vec3> normals;
+	vector<glm::vec2> tex_coords;
+};
+
+struct LegacyVertex {
+	unsigned int p, n, t;
+};
+
+// CGRA350App::load_wavefront_obj before ObjLoader, without the GL uploads: one vertex per
+// face corner, per material.
+void LegacyLoad(const string& path, map<string, LegacyPart>& parts) {
+	vector<glm::vec3> positions;
+	vector<glm::vec3> normals;
+	vector<glm::vec2> uvs;
+	string material;
+	ifstream file(path);
+	while (file.good()) {
+		string line;
+		getline(file, line);
+		istringstream obj_line(line);
+		string mode;
+		obj_line >> mode;
+		if (mode == "v") {
+			glm::vec3 v;
+			obj_line >> v.x >> v.y >> v.z;
+			positions.push_back(v);
+		}
+		else if (mode == "vn") {
+			glm::vec3 vn;
+			obj_line >> vn.x >> vn.y >> vn.z;
+			normals.push_back(vn);
+		}
+		else if (mode == "vt") {
+			glm::vec2 vt;
+			obj_line >> vt.x >> vt.y;
+			uvs.push_back(vt);
+		}
+		else if (mode == "f") {
+			vector<LegacyVertex> face;
+			while (obj_line.good()) {
+				LegacyVertex v = {};
+				obj_line >> v.p;
+				if (obj_line.peek() == '/') {
+					obj_line.ignore(1);
+					if (obj_line.peek() != '/')
+						obj_line >> v.t;
+					if (obj_line.peek() == '/') {
+						obj_line.ignore(1);
+						obj_line >> v.n;
+					}
+				}
+				v.p -= 1;
+				v.n -= 1;
+				v.t -= 1;
+				face.push_back(v);
+			}
+			if (face.size() == 3) {
+				for (int i = 0; i < 3; i++) {
+					parts[material].positions.push_back(positions[face[i].p]);
+					parts[material].normals.push_back(normals[face[i].n]);
+					parts[material].tex_coords.push_back(uvs[face[i].t]);
+				}
+			}
+		}
+		else if (mode == "usemtl")
+			obj_line >> material;
+	}
+}
+
+typedef array<float, 24> Triangle;
+
+void AddTriangle(vector<Triangle>& triangles, const glm::vec3* positions, const glm::vec3* normals, const glm::vec2* tex_coords) {
+	Triangle t;
+	for (int k = 0; k < 3; k++) {
+		float* corner = &t[k * 8];
+		corner[0] = positions[k].x, corner[1] = positions[k].y, corner[2] = positions[k].z;
+		corner[3] = normals[k].x, corner[4] = normals[k].y, corner[5] = normals[k].z;
+		corner[6] = tex_coords[k].x, corner[7] = tex_coords[k].y;
+	}
+	triangles.push_back(t);
+}
+
+// Triangles of mesh missing from the legacy ones or the other way round. ObjLoader reorders
+// the triangles of a part (keeping their corner order), so both sides are sorted first. The
+// legacy loader only keeps triangles, and these models have nothing else.
+size_t CountMismatches(const map<string, LegacyPart>& legacy, const ObjMeshData& mesh) {
+	size_t mismatches = 0;
+	size_t parts = 0;
+	for (const ObjMeshPart& part : mesh.parts) {
+		auto found = legacy.find(part.material);
+		if (found == legacy.end()) {
+			mismatches += part.indices.size() / 3;
+			continue;
+		}
+		parts++;
+		const LegacyPart& reference = found->second;
+		vector<Triangle> expected, loaded;
+		for (size_t i = 0; i + 2 < reference.positions.size(); i += 3)
+			AddTriangle(expected, &reference.positions[i], &reference.normals[i], &reference.tex_coords[i]);
+		for (size_t i = 0; i + 2 < part.indices.size(); i += 3) {
+			glm::vec3 positions[3], normals[3];
+			glm::vec2 tex_coords[3];
+			for (int k = 0; k < 3; k++) {
+				const ObjVertex& v = part.vertices[part.indices[i + k]];
+				positions[k] = v.position;
+				normals[k] = v.normal;
+				tex_coords[k] = v.tex_coord;
+			}
+			AddTriangle(loaded, positions, normals, tex_coords);
+		}
+		sort(expected.begin(), expected.end());
+		sort(loaded.begin(), loaded.end());
+		vector<Triangle> difference;
+		set_symmetric_difference(expected.begin(), expected.end(), loaded.begin(), loaded.end(), back_inserter(difference));
+		mismatches += difference.size();
+	}
+	return mismatches + (legacy.size() - parts);
+}
+
+// Vertex shader runs of the legacy part once its identical corners are welded, triangles
+// kept in file order
+size_t CountWeldedTransforms(const LegacyPart& part) {
+	map<array<float, 8>, uint32_t> welded;
+	vector<uint32_t> indices;
+	for (size_t i = 0; i < part.positions.size(); i++) {
+		array<float, 8> key = { part.positions[i].x, part.positions[i].y, part.positions[i].z,
+			part.normals[i].x, part.normals[i].y, part.normals[i].z, part.tex_coords[i].x, part.tex_coords[i].y };
+		indices.push_back(welded.emplace(key, (uint32_t)welded.size()).first->second);
+	}
+	return MeshOptimiser::countTransforms(indices, welded.size());
+}
+
+// Squared distance from p to the triangle abc, worked out apart from
+// MeshSimplifier::closestPointOnTriangle: the distance to the plane when p projects inside
+// the triangle (by the signs of the edge normals), otherwise to the nearest edge.
+float PointTriangleDistance2(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	auto segment2 = [&](const glm::vec3& u, const glm::vec3& v) {
+		glm::vec3 uv = v - u;
+		float length2 = glm::dot(uv, uv);
+		float t = length2 > 0.0f ? glm::clamp(glm::dot(p - u, uv) / length2, 0.0f, 1.0f) : 0.0f;
+		glm::vec3 d = u + uv * t - p;
+		return glm::dot(d, d);
+	};
+	glm::vec3 n = glm::cross(b - a, c - a);
+	float area2 = glm::dot(n, n);
+	if (area2 > 0.0f) {
+		bool inside = glm::dot(glm::cross(b - a, p - a), n) >= 0.0f && glm::dot(glm::cross(c - b, p - b), n) >= 0.0f &&
+			glm::dot(glm::cross(a - c, p - c), n) >= 0.0f;
+		if (inside) {
+			float plane = glm::dot(p - a, n);
+			return plane * plane / area2;
+		}
+	}
+	return min(segment2(a, b), min(segment2(b, c), segment2(c, a)));
+}
+
+// Largest distance from the samples to the triangles, every sample against every triangle.
+float LargestDistance(const vector<glm::vec3>& samples, const vector<ObjVertex>& vertices, const vector<uint32_t>& triangles) {
+	vector<glm::vec3> box_min, box_max;
+	for (size_t i = 0; i < triangles.size(); i += 3) {
+		const glm::vec3 &a = vertices[triangles[i]].position, &b = vertices[triangles[i + 1]].position, &c = vertices[triangles[i + 2]].position;
+		box_min.push_back(glm::min(a, glm::min(b, c)));
+		box_max.push_back(glm::max(a, glm::max(b, c)));
+	}
+	float largest = 0.0f;
+	for (const glm::vec3& p : samples) {
+		float closest2 = 1e30f;
+		for (size_t t = 0; t < box_min.size() && closest2 > 0.0f; t++) {
+			glm::vec3 outside = glm::max(glm::max(box_min[t] - p, p - box_max[t]), 0.0f);
+			if (glm::dot(outside, outside) >= closest2)
+				continue;
+			closest2 = min(closest2, PointTriangleDistance2(p, vertices[triangles[3 * t]].position, vertices[triangles[3 * t + 1]].position,
+				vertices[triangles[3 * t + 2]].position));
+		}
+		largest = max(largest, sqrt(closest2));
+	}
+	return largest;
+}
+
+struct LodDistance {
+	float to_lod;		// MeshSimplifier::measureDistance: the part's vertices & triangle centres to the lod
+	float to_part;		// the other way: the lod's triangle centres & edge midpoints to the part
+};
+
+LodDistance MeasureLodDistance(const ObjMeshPart& part, const vector<uint32_t>& lod) {
+	vector<glm::vec3> samples;
+	for (size_t i = 0; i < part.indices.size(); i += 3) {
+		const glm::vec3 &a = part.vertices[part.indices[i]].position, &b = part.vertices[part.indices[i + 1]].position,
+			&c = part.vertices[part.indices[i + 2]].position;
+		samples.push_back(a);
+		samples.push_back((a + b + c) / 3.0f);
+	}
+	// the lod's corners are vertices of the part, so sample inside its triangles
+	vector<glm::vec3> lod_samples;
+	for (size_t i = 0; i < lod.size(); i += 3) {
+		const glm::vec3 &a = part.vertices[lod[i]].position, &b = part.vertices[lod[i + 1]].position, &c = part.vertices[lod[i + 2]].position;
+		lod_samples.push_back((a + b + c) / 3.0f);
+		lod_samples.push_back((a + b) * 0.5f);
+		lod_samples.push_back((b + c) * 0.5f);
+		lod_samples.push_back((c + a) * 0.5f);
+	}
+	return { LargestDistance(samples, part.vertices, lod), LargestDistance(lod_samples, part.vertices, part.indices) };
+}
+
+struct BenchmarkedFile {
+	string name;
+	map<string, LegacyPart> legacy;
+	ObjMeshData mesh;
+};
+
+template<class Load>
+double BestSeconds(int runs, Load load) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start_time = chrono::steady_clock::now();
+		load();
+		best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start_time).count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+	fs::path folder = argc > 1 ? argv[1] : PROJECT_SOURCE_DIR "/resources/assets/";
+	int runs = argc > 2 ? max(atoi(argv[2]), 1) : 5;
+
+	vector<fs::path> files;
+	error_code error;
+	for (fs::directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+		if (it->is_regular_file() && it->path().extension() == ".obj")
+			files.push_back(it->path());
+	}
+	sort(files.begin(), files.end());
+	if (files.empty()) {
+		printf("No .obj files found in %s\n", folder.string().c_str());
+		return 1;
+	}
+
+	printf("Best of %d runs\n", runs);
+	printf("%-20s %8s %8s %8s  %10s %10s %10s  %7s %7s  %s\n", "file", "MB", "corners", "vertices",
+		"legacy ms", "obj ms", ".mesh ms", "obj x", "mesh x", "mismatches");
+	double total_legacy = 0, total_obj = 0, total_mesh = 0;
+	vector<BenchmarkedFile> files_loaded;
+	bool ok = true;
+	for (const fs::path& path : files) {
+		string name = path.filename().string();
+		string mesh_path = (fs::temp_directory_path() / (path.stem().string() + ".mesh")).string();
+
+		map<string, LegacyPart> legacy;
+		double legacy_seconds = BestSeconds(runs, [&]() {
+			legacy.clear();
+			LegacyLoad(path.string(), legacy);
+		});
+
+		ObjMeshData mesh;
+		ObjLoadStats stats;
+		double obj_seconds = BestSeconds(runs, [&]() {
+			ObjLoader::loadObj(path.string(), mesh, &stats);
+		});
+
+		ObjMeshData cached;
+		ObjLoader::saveMesh(mesh_path, mesh);
+		double mesh_seconds = BestSeconds(runs, [&]() {
+			ObjLoader::loadMesh(mesh_path, cached);
+		});
+		remove(mesh_path.c_str());
+
+		size_t mismatches = CountMismatches(legacy, mesh) + CountMismatches(legacy, cached);
+		ok = ok && mismatches == 0;
+		double mb = stats.bytes / (1024.0 * 1024.0);
+		printf("%-20s %8.2f %8zu %8zu  %10.2f %10.2f %10.2f  %6.1fx %6.1fx  %zu\n", name.c_str(), mb, stats.corners, stats.vertices,
+			legacy_seconds * 1e3, obj_seconds * 1e3, mesh_seconds * 1e3, legacy_seconds / obj_seconds, legacy_seconds / mesh_seconds, mismatches);
+		total_legacy += legacy_seconds;
+		total_obj += obj_seconds;
+		total_mesh += mesh_seconds;
+		files_loaded.push_back({ name, move(legacy), move(mesh) });
+	}
+	printf("Total: legacy %.1f ms, loadObj %.1f ms (%.1fx), loadMesh %.1f ms (%.1fx)\n", total_legacy * 1e3,
+		total_obj * 1e3, total_legacy / total_obj, total_mesh * 1e3, total_legacy / total_mesh);
+
+	printf("\n%-20s %-18s %9s %9s %9s  %6s  %9s %9s %9s  %9s %8s %8s\n", "file", "part", "soup VS", "welded VS", "opt. VS", "ACMR",
+		"soup KB", "opt. KB", "packed KB", "pos. err", "nrm. deg", "uv err");
+	for (const BenchmarkedFile& file : files_loaded) {
+		for (const ObjMeshPart& part : file.mesh.parts) {
+			size_t corners = part.indices.size();
+			size_t runs = MeshOptimiser::countTransforms(part.indices, part.vertices.size());
+			size_t bytes = part.vertices.size() * sizeof(ObjVertex) + corners * (part.vertices.size() <= 65536 ? 2 : 4);
+			auto found = file.legacy.find(part.material);
+			size_t welded_runs = found != file.legacy.end() ? CountWeldedTransforms(found->second) : 0;
+			vector<PackedVertex> packed;
+			glm::vec3 box_min, box_size;
+			PackingError packing_error;
+			MeshOptimiser::packVertices(part.vertices, packed, box_min, box_size, &packing_error);
+			size_t packed_bytes = bytes - part.vertices.size() * (sizeof(ObjVertex) - sizeof(PackedVertex));
+			printf("%-20s %-18s %9zu %9zu %9zu  %6.3f  %9.1f %9.1f %9.1f  %9.2e %8.3f %8.1e\n", file.name.c_str(), part.material.c_str(), corners,
+				welded_runs, runs, runs / max(corners / 3.0, 1.0), corners * (sizeof(ObjVertex) + 4) / 1024.0, bytes / 1024.0, packed_bytes / 1024.0,
+				packing_error.position, packing_error.normal_degrees, packing_error.tex_coord);
+		}
+	}
+
+	// levels of detail: triangles, the simplifier's error & the measured distance, against the
+	// size of the part (the diagonal of its box)
+	const float max_error = 0.05f;
+	const size_t min_lods = MESH_MAX_LODS - 1;
+	// "file part": why the part cannot have min_lods levels
+	const map<string, string> lod_exceptions = {
+		{ "tree8.obj leaf", "one sheet whose every edge is a uv seam, so no collapse keeps its texture and no piece can go" },
+	};
+	printf("\n%-20s %-18s %8s  %s\n", "file", "part", "size", "triangles / error / measured distance to the lod, to the part, per level");
+	double lod_seconds = 0;
+	for (BenchmarkedFile& file : files_loaded) {
+		for (ObjMeshPart& part : file.mesh.parts) {
+			if (part.vertices.empty() || part.indices.empty()) {
+				printf("%-20s %-18s (empty, skipped)\n", file.name.c_str(), part.material.c_str());
+				continue;
+			}
+			auto start_time = chrono::steady_clock::now();
+			MeshSimplifier::buildLods(part, max_error);
+			lod_seconds += chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+			glm::vec3 box_min = part.vertices[0].position, box_max = box_min;
+			for (const ObjVertex& vertex : part.vertices) {
+				box_min = glm::min(box_min, vertex.position);
+				box_max = glm::max(box_max, vertex.position);
+			}
+			float size = glm::length(box_max - box_min);
+			printf("%-20s %-18s %8.2f  %zu", file.name.c_str(), part.material.c_str(), size, part.indices.size() / 3);
+			size_t previous = part.indices.size();
+			for (const ObjMeshLod& lod : part.lods) {
+				LodDistance distance = MeasureLodDistance(part, lod.indices);
+				bool lod_ok = lod.indices.size() <= previous * 0.8 && max(distance.to_lod, distance.to_part) <= lod.error * 1.0001f &&
+					lod.error <= max_error * size;
+				ok = ok && lod_ok;
+				printf(" | %zu / %.4f / %.4f %.4f%s", lod.indices.size() / 3, lod.error, distance.to_lod, distance.to_part, lod_ok ? "" : " FAIL");
+				previous = lod.indices.size();
+			}
+			auto exception = lod_exceptions.find(file.name + " " + part.material);
+			if (exception != lod_exceptions.end())
+				printf(" (%zu levels: %s)", part.lods.size(), exception->second.c_str());
+			else if (part.lods.size() < min_lods) {
+				ok = false;
+				printf(" FAIL (%zu levels, %zu wanted)", part.lods.size(), min_lods);
+			}
+			printf("\n");
+		}
+	}
+	printf("Built the levels of detail in %.1f ms\n", lod_seconds * 1e3);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Mip pyramid check, without a window: builds the 9 mips of synthetic sources with
+// BuildMips and with the per-voxel ParallelFill / Sample() path it replaced in
+// VolumeRender::Update, checks every level is bit-identical, and times both.
+//
+//   mip_benchmark [source resolution ...]
+
+#include "../volumerendering/mip_builder.hpp"
+#include "../volumerendering/omp.hpp"
+#include "../volumerendering/vector.cuh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+inline float LegacySample(const float* data, int res, int x, int y, int z) {
+	if (x < 0 || y < 0 || z < 0 || x >= res || y >= res || z >= res) return 0;
+	return max(0.0f, data[((size_t)(x * res) + y) * res + z]);
+}
+
+// Sample(float*, int, float3) from volume.cu, as the old mip pass called it.
+float LegacySample(const float* data, int res, float3 uv) {
+	float3 pos = uv * res - 0.5;
+	int x = floor(pos.x);
+	int y = floor(pos.y);
+	int z = floor(pos.z);
+	float3 w = pos - make_float3(x, y, z);
+
+	return
+		lerp(
+			lerp(
+				lerp(LegacySample(data, res, x, y, z), LegacySample(data, res, x, y, z + 1), w.z),
+				lerp(LegacySample(data, res, x, y + 1, z), LegacySample(data, res, x, y + 1, z + 1), w.z),
+				w.y),
+			lerp(
+				lerp(LegacySample(data, res, x + 1, y, z), LegacySample(data, res, x + 1, y, z + 1), w.z),
+				lerp(LegacySample(data, res, x + 1, y + 1, z), LegacySample(data, res, x + 1, y + 1, z + 1), w.z),
+				w.y),
+			w.x);
+}
+
+// The old VolumeRender::Update schedule: halve down to 512 or 256 with Sample(), then
+// every mip is a Sample() of the one above it.
+void LegacyBuildMips(const float* datas, int resolution, float* const* mips) {
+	int res = 256;
+	while (res * 2 < resolution) res <<= 1;
+
+	const float* source = datas;
+	int source_res = resolution;
+	vector<float> temp[2];
+	for (int i = 0; res > 256; res >>= 1, i ^= 1) {
+		temp[i].resize((size_t)res * res * res);
+		ParallelFill(temp[i].data(), res, [&](int, int, int, float u, float v, float w) {
+			return LegacySample(source, source_res, float3{ u,v,w });
+		});
+		source = temp[i].data();
+		source_res = res;
+	}
+	for (int mip = 0; mip < MIP_LEVELS; mip++) {
+		res = 256 >> mip;
+		ParallelFill(mips[mip], res, [&](int, int, int, float u, float v, float w) {
+			return LegacySample(source, source_res, float3{ u,v,w });
+		});
+		source = mips[mip];
+		source_res = res;
+	}
+}
+
+// A cloud-like field with empty space and a few negative voxels, which Sample() clamps.
+vector<float> MakeSource(int res) {
+	vector<float> data((size_t)res * res * res);
+	for (int x = 0; x < res; x++)
+		for (int y = 0; y < res; y++)
+			for (int z = 0; z < res; z++) {
+				float u = (x + 0.5f) / res - 0.5f, v = (y + 0.5f) / res - 0.5f, w = (z + 0.5f) / res - 0.5f;
+				float shape = 0.4f - sqrtf(u * u + v * v * 2.0f + w * w);
+				uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+				hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+				float noise = (hash >> 8) / 16777216.0f;
+				data[((size_t)x * res + y) * res + z] = shape > 0 ? shape * 4.0f * noise : (noise < 0.02f ? -noise : 0.0f);
+			}
+	return data;
+}
+
+template<class Run>
+double BestSeconds(int runs, Run run) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start_time = chrono::steady_clock::now();
+		run();
+		best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start_time).count());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+	vector<int> sizes;
+	for (int i = 1; i < argc; i++)
+		sizes.push_back(atoi(argv[i]));
+	if (sizes.empty())
+		sizes = { 256, 512, 200, 600 };
+
+	vector<float> built[MIP_LEVELS], legacy[MIP_LEVELS];
+	float* built_mips[MIP_LEVELS];
+	float* legacy_mips[MIP_LEVELS];
+	for (int level = 0; level < MIP_LEVELS; level++) {
+		size_t res = 256 >> level;
+		built[level].resize(res * res * res);
+		legacy[level].resize(res * res * res);
+		built_mips[level] = built[level].data();
+		legacy_mips[level] = legacy[level].data();
+	}
+
+	printf("%-10s %12s %12s %8s  %s\n", "source", "BuildMips", "Sample()", "speedup", "mismatched voxels");
+	bool ok = true;
+	for (int resolution : sizes) {
+		if (resolution <= 0) {
+			printf("Skipped %d (not a resolution)\n", resolution);
+			continue;
+		}
+		vector<float> source = MakeSource(resolution);
+		double built_seconds = BestSeconds(3, [&]() { BuildMips(source.data(), resolution, built_mips); });
+		double legacy_seconds = BestSeconds(3, [&]() { LegacyBuildMips(source.data(), resolution, legacy_mips); });
+
+		size_t mismatches = 0;
+		for (int level = 0; level < MIP_LEVELS; level++) {
+			size_t count = built[level].size();
+			if (memcmp(built[level].data(), legacy[level].data(), count * sizeof(float)) == 0)
+				continue;
+			for (size_t i = 0; i < count; i++)
+				mismatches += memcmp(&built[level][i], &legacy[level][i], sizeof(float)) != 0;
+		}
+		ok = ok && mismatches == 0;
+		printf("%4d^3      %9.1f ms %9.1f ms %7.1fx  %zu\n", resolution, built_seconds * 1e3, legacy_seconds * 1e3,
+			legacy_seconds / built_seconds, mismatches);
+	}
+
+	printf("%s\n", ok ? "All checks passed" : "CHECKS FAILED");
+	return ok ? 0 : 1;
+}
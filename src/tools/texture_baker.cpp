@@ -0,0 +1,299 @@
+// Offline texture baker: decodes every image under resources/textures, builds its mip chain,
+// block compresses it with stb_dxt and writes them all into one texture pack (see
+// src/utils/texture_pack.h), which TextureStreamer maps and uploads without decoding.
+//
+//   texture_baker [--raw] [--bc5-normals] [textures folder] [output file]
+//
+// Colour images become BC1 (RGB) or BC3 (RGBA) with sRGB flags, single channel ones BC4.
+// --raw keeps the levels uncompressed; --bc5-normals stores normal maps (names containing
+// "normal" or "_Nor") as two-channel BC5, for shaders that rebuild z themselves.
+// Images in *skybox* folders are cube map faces: kept in file orientation with level 0 only,
+// as CubeMapTexture loads them. All others are flipped vertically, as Texture2D does.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb/stb_image_resize2.h"
+#define STB_DXT_IMPLEMENTATION
+#include "stb/stb_dxt.h"
+
+#include "../utils/texture_pack.h"
+#include "../volumerendering/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+	bool raw = false;
+	bool bc5_normals = false;
+};
+
+struct BakedTexture {
+	string name;
+	TexturePackEntry entry = {};
+	vector<unsigned char> levels[TEXTURE_PACK_MAX_MIPS];
+	size_t decoded_bytes = 0;		// of the level data as 8-bit pixels
+	bool ok = false;
+};
+
+string ToLower(string s) {
+	for (char& c : s)
+		c = (char)tolower((unsigned char)c);
+	return s;
+}
+
+bool IsImage(const fs::path& path) {
+	string ext = ToLower(path.extension().string());
+	return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".tga" || ext == ".bmp";
+}
+
+bool IsNormalMap(const string& name) {
+	return ToLower(name).find("normal") != string::npos || name.find("_Nor") != string::npos;
+}
+
+// 4x4 blocks of a level, edge pixels repeated into blocks that overhang the image.
+void CompressLevel(const unsigned char* pixels, int width, int height, int channels, uint32_t format, unsigned char* out) {
+	int block_bytes = format == TEXTURE_PACK_BC1 || format == TEXTURE_PACK_BC4 ? 8 : 16;
+	unsigned char block[16 * 4];
+	for (int by = 0; by < height; by += 4) {
+		for (int bx = 0; bx < width; bx += 4) {
+			for (int i = 0; i < 16; i++) {
+				int x = min(bx + (i & 3), width - 1), y = min(by + (i >> 2), height - 1);
+				const unsigned char* p = pixels + ((size_t)y * width + x) * channels;
+				if (format == TEXTURE_PACK_BC4)
+					block[i] = p[0];
+				else if (format == TEXTURE_PACK_BC5) {
+					block[i * 2] = p[0];
+					block[i * 2 + 1] = p[1];
+				}
+				else {
+					for (int c = 0; c < 3; c++)
+						block[i * 4 + c] = p[c];
+					block[i * 4 + 3] = channels == 4 ? p[3] : 255;
+				}
+			}
+			if (format == TEXTURE_PACK_BC4)
+				stb_compress_bc4_block(out, block);
+			else if (format == TEXTURE_PACK_BC5)
+				stb_compress_bc5_block(out, block);
+			else
+				stb_compress_dxt_block(out, block, format == TEXTURE_PACK_BC3, STB_DXT_HIGHQUAL);
+			out += block_bytes;
+		}
+	}
+}
+
+void Bake(const fs::path& path, const Options& options, BakedTexture& baked) {
+	bool cube_face = baked.name.find("skybox") != string::npos;
+	bool flip = !cube_face;
+	stbi_set_flip_vertically_on_load_thread(flip);
+	int width, height, channels;
+	unsigned char* data = stbi_load(path.string().c_str(), &width, &height, &channels, cube_face ? 3 : 0);
+	if (data == nullptr) {
+		printf("Failed to load %s: %s\n", baked.name.c_str(), stbi_failure_reason());
+		return;
+	}
+	if (cube_face)
+		channels = 3;
+
+	// Grey + alpha is stored as RGBA; normal maps for BC5 keep x and y only.
+	vector<unsigned char> level((size_t)width * height * channels);
+	memcpy(level.data(), data, level.size());
+	stbi_image_free(data);
+	bool normal_map = options.bc5_normals && !options.raw && channels >= 3 && IsNormalMap(baked.name);
+	if (channels == 2 || normal_map) {
+		int out_channels = normal_map ? 2 : 4;
+		vector<unsigned char> converted((size_t)width * height * out_channels);
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			const unsigned char* p = &level[i * channels];
+			unsigned char* q = &converted[i * out_channels];
+			if (normal_map) {
+				q[0] = p[0];
+				q[1] = p[1];
+			}
+			else {
+				q[0] = q[1] = q[2] = p[0];
+				q[3] = p[1];
+			}
+		}
+		level.swap(converted);
+		channels = out_channels;
+	}
+
+	uint32_t format = TEXTURE_PACK_RAW;
+	if (!options.raw) {
+		if (normal_map)
+			format = TEXTURE_PACK_BC5;
+		else if (channels == 1)
+			format = TEXTURE_PACK_BC4;
+		else
+			format = channels == 3 ? TEXTURE_PACK_BC1 : TEXTURE_PACK_BC3;
+	}
+	// Same colour spaces as getTextureFormats(): only single channel images are linear.
+	bool srgb = channels >= 3 && !normal_map;
+
+	int num_mips = 1;
+	if (!cube_face) {
+		while (num_mips < TEXTURE_PACK_MAX_MIPS && max(width, height) >> num_mips > 0)
+			num_mips++;
+	}
+
+	TexturePackEntry& entry = baked.entry;
+	entry.format = format;
+	entry.flags = (srgb ? (uint32_t)TEXTURE_PACK_SRGB : 0u) | (flip ? (uint32_t)TEXTURE_PACK_FLIPPED : 0u);
+	entry.width = width;
+	entry.height = height;
+	entry.num_channels = channels;
+	entry.num_mips = num_mips;
+
+	const stbir_pixel_layout layouts[] = { STBIR_1CHANNEL, STBIR_1CHANNEL, STBIR_2CHANNEL, STBIR_RGB, STBIR_RGBA };
+	int w = width, h = height;
+	for (int m = 0; m < num_mips; m++) {
+		if (m > 0) {
+			// Each level from the one above; colour is filtered in linear space.
+			int next_w = max(1, w / 2), next_h = max(1, h / 2);
+			vector<unsigned char> next((size_t)next_w * next_h * channels);
+			if (srgb)
+				stbir_resize_uint8_srgb(level.data(), w, h, 0, next.data(), next_w, next_h, 0, layouts[channels]);
+			else
+				stbir_resize_uint8_linear(level.data(), w, h, 0, next.data(), next_w, next_h, 0, layouts[channels]);
+			level.swap(next);
+			w = next_w;
+			h = next_h;
+		}
+
+		vector<unsigned char>& out = baked.levels[m];
+		out.resize(getTexturePackLevelSize(format, w, h, channels));
+		if (format == TEXTURE_PACK_RAW)
+			memcpy(out.data(), level.data(), out.size());
+		else
+			CompressLevel(level.data(), w, h, channels, format, out.data());
+		entry.mip_sizes[m] = (uint32_t)out.size();
+		baked.decoded_bytes += level.size();
+	}
+	baked.ok = true;
+}
+
+bool WritePack(const string& path, const vector<BakedTexture>& baked) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		printf("Cannot write %s\n", path.c_str());
+		return false;
+	}
+
+	// Level data after the header, then the directory and the names.
+	vector<TexturePackEntry> directory;
+	string names;
+	uint64_t offset = sizeof(TexturePackHeader);
+	for (const BakedTexture& t : baked) {
+		TexturePackEntry entry = t.entry;
+		entry.name_offset = (uint32_t)names.size();
+		entry.name_length = (uint32_t)t.name.size();
+		names += t.name;
+		for (uint32_t m = 0; m < entry.num_mips; m++) {
+			offset = (offset + 15) & ~(uint64_t)15;
+			entry.mip_offsets[m] = offset;
+			offset += entry.mip_sizes[m];
+		}
+		directory.push_back(entry);
+	}
+
+	TexturePackHeader header = {};
+	header.magic = TEXTURE_PACK_MAGIC;
+	header.version = TEXTURE_PACK_VERSION;
+	header.num_entries = (uint32_t)directory.size();
+	header.directory_offset = (offset + 15) & ~(uint64_t)15;
+	header.names_offset = header.directory_offset + directory.size() * sizeof(TexturePackEntry);
+
+	const unsigned char zeros[16] = {};
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	uint64_t written = sizeof(header);
+	for (size_t i = 0; ok && i < baked.size(); i++) {
+		for (uint32_t m = 0; ok && m < directory[i].num_mips; m++) {
+			ok = fwrite(zeros, 1, directory[i].mip_offsets[m] - written, file) == directory[i].mip_offsets[m] - written
+				&& fwrite(baked[i].levels[m].data(), 1, baked[i].levels[m].size(), file) == baked[i].levels[m].size();
+			written = directory[i].mip_offsets[m] + baked[i].levels[m].size();
+		}
+	}
+	ok = ok && fwrite(zeros, 1, header.directory_offset - written, file) == header.directory_offset - written
+		&& fwrite(directory.data(), sizeof(TexturePackEntry), directory.size(), file) == directory.size()
+		&& fwrite(names.data(), 1, names.size(), file) == names.size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		printf("Failed writing %s\n", path.c_str());
+	return ok;
+}
+
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	vector<string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--raw") == 0)
+			options.raw = true;
+		else if (strcmp(argv[i], "--bc5-normals") == 0)
+			options.bc5_normals = true;
+		else if (argv[i][0] == '-') {
+			printf("usage: texture_baker [--raw] [--bc5-normals] [textures folder] [output file]\n");
+			return 1;
+		}
+		else
+			paths.push_back(argv[i]);
+	}
+	fs::path folder = paths.size() > 0 ? paths[0] : PROJECT_SOURCE_DIR "/resources/textures/";
+	string output = paths.size() > 1 ? paths[1] : PROJECT_SOURCE_DIR "/resources/textures.pack";
+
+	auto start_time = chrono::steady_clock::now();
+	vector<fs::path> files;
+	error_code error;
+	for (fs::recursive_directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+		if (it->is_regular_file() && IsImage(it->path()))
+			files.push_back(it->path());
+	}
+	if (error || files.empty()) {
+		printf("No images found in %s\n", folder.string().c_str());
+		return 1;
+	}
+
+	// Names sorted for the directory's binary search.
+	vector<BakedTexture> baked(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+		baked[i].name = files[i].lexically_relative(folder).generic_string();
+	vector<size_t> order(files.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	sort(order.begin(), order.end(), [&](size_t a, size_t b) { return baked[a].name < baked[b].name; });
+
+	parallel::parallel_for((int)files.size(), [&](int i) {
+		Bake(files[i], options, baked[i]);
+	});
+
+	vector<BakedTexture> sorted;
+	size_t level_bytes = 0, decoded_bytes = 0;
+	for (size_t i : order) {
+		if (!baked[i].ok)
+			continue;
+		for (uint32_t m = 0; m < baked[i].entry.num_mips; m++)
+			level_bytes += baked[i].levels[m].size();
+		decoded_bytes += baked[i].decoded_bytes;
+		sorted.push_back(move(baked[i]));
+	}
+	if (!WritePack(output, sorted))
+		return 1;
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	printf("Baked %zu of %zu images into %s in %.2f s\n", sorted.size(), files.size(), output.c_str(), seconds);
+	printf("Level data %.1f MB (%.1f MB as 8-bit pixels, %.2fx)\n", level_bytes / 1e6, decoded_bytes / 1e6, (double)decoded_bytes / max(level_bytes, (size_t)1));
+	return 0;
+}
@@ -47,6 +47,21 @@ void UI::render()
 	ImGui::Text("GPU: %s", m_app_context->m_gui_param.device_name.c_str());
 	ImGui::Text("Average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+	// display GL calls made through the shader & buffer wrappers last frame
+	const GLCallCounts &gl_calls = m_app_context->m_gl_call_counts;
+	ImGui::Text("GL calls/frame: %d (%d without location cache)", gl_calls.getTotal(), gl_calls.getTotalUncached());
+	ImGui::Text("  uniforms %d, programs %d, UBO uploads %d, textures %d", gl_calls.uniform_uploads, gl_calls.program_binds, gl_calls.buffer_uploads,
+		gl_calls.texture_binds);
+
+	// display the model parts drawn & culled last frame
+	const CullingStats &culling = m_app_context->m_prop_culling;
+	ImGui::Text("Model parts: %d drawn, %d culled (%d off screen, %d too small)", culling.visible, culling.frustum_culled + culling.distance_culled,
+		culling.frustum_culled, culling.distance_culled);
+	const SceneDrawStats &scene_draws = m_app_context->m_scene_draws;
+	ImGui::Text("Model draws: %d, %u triangles", scene_draws.draws, scene_draws.triangles);
+	ImGui::Text("  programs %d, materials %d (%d, %d unsorted)", scene_draws.program_binds, scene_draws.material_binds,
+		scene_draws.unsorted_program_binds, scene_draws.unsorted_material_binds);
+
 	// display number of primitives rendered
 	//ImGui::Text("Ocean primitives: %i", m_app_context->m_num_ocean_primitives);
 	//ImGui::Text("Seabed primitives: %i", m_app_context->m_num_seabed_primitives);
@@ -178,6 +193,9 @@ void UI::render()
 	changed |= ImGui::SliderFloat("Tr scale", &m_app_context->m_gui_param.tr, 1, 10);
 	changed |= ImGui::SliderFloat3("Scatter rate", (float*)&m_app_context->m_gui_param.scatter_rate, 0, 1);
 	changed |= ImGui::SliderFloat("Scale (Experimental)", &m_app_context->m_gui_param.cloud_scale, 0.1, 3);
+	changed |= ImGui::Checkbox("TR sweep (CPU)", &m_app_context->m_gui_param.tr_sweep);
+	if (m_app_context->m_gui_param.tr_sweep)
+		ImGui::SliderFloat("TR budget", &m_app_context->m_gui_param.tr_budget, 0.05f, 1.0f);
 	if (changed)
 		UI::SetIsChanging(true);
 	ImGui::Separator();
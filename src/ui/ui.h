@@ -55,6 +55,10 @@ public:
 
     float tr = 1;
 
+    // TR volumes from the host light-space sweep, and the share of a sweep per frame
+    bool tr_sweep = false;
+    float tr_budget = 1;
+
     float3 scatter_rate = { 1, 1, 1 };
 
     int env_map = 0;
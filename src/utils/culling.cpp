@@ -0,0 +1,177 @@
+#include "culling.h"
+#include "../volumerendering/simd.hpp"
+
+#include <bitset>
+#include <cmath>
+
+size_t CullingBounds::add(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model)
+{
+	if (count % simd::Width == 0)
+	{
+		size_t padded = count + simd::Width;
+		for (std::vector<float> *values : { &centre_x, &centre_y, &centre_z, &extent_x, &extent_y, &extent_z, &radius })
+		{
+			values->resize(padded, 0.0f);
+		}
+	}
+	set(count, box_min, box_max, model);
+	return count++;
+}
+
+void CullingBounds::set(size_t i, const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model)
+{
+	// the box around the transformed box: its half size along each world axis is the sum of
+	// the model axes' contributions
+	glm::vec3 centre = glm::vec3(model * glm::vec4((box_min + box_max) * 0.5f, 1.0f));
+	glm::vec3 half_size = (box_max - box_min) * 0.5f;
+	glm::mat3 axes = glm::mat3(model);
+	glm::vec3 extent = glm::abs(axes[0]) * half_size.x + glm::abs(axes[1]) * half_size.y + glm::abs(axes[2]) * half_size.z;
+
+	centre_x[i] = centre.x;
+	centre_y[i] = centre.y;
+	centre_z[i] = centre.z;
+	extent_x[i] = extent.x;
+	extent_y[i] = extent.y;
+	extent_z[i] = extent.z;
+	// the sphere around the model space box, which is tighter than the world box for rotated
+	// models
+	float scale = glm::max(glm::length(axes[0]), glm::max(glm::length(axes[1]), glm::length(axes[2])));
+	radius[i] = glm::min(glm::length(half_size) * scale, glm::length(extent));
+}
+
+void CullingBounds::clear()
+{
+	for (std::vector<float> *values : { &centre_x, &centre_y, &centre_z, &extent_x, &extent_y, &extent_z, &radius })
+	{
+		values->clear();
+	}
+	count = 0;
+}
+
+namespace Culling
+{
+	Frustum extractFrustum(const glm::mat4 &view_projection)
+	{
+		// rows of the matrix (glm is column major)
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+		}
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[3] + rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+		for (glm::vec4 &plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	// Distance past which a sphere of radius 1 is less than min_pixels across
+	static float getCullDistanceScale(float projection_scale, float min_pixels)
+	{
+		return min_pixels > 0.0f ? 2.0f * projection_scale / min_pixels : INFINITY;
+	}
+
+	void cull(const CullingBounds &bounds, const Frustum &frustum, const glm::vec3 &camera_pos, float projection_scale, float min_pixels,
+		std::vector<uint8_t> &visible, CullingStats *stats)
+	{
+		using simd::vfloat;
+		using simd::vmask;
+
+		// planes (and the absolute values of their normals, for the boxes) in every lane
+		vfloat normal_x[6], normal_y[6], normal_z[6], distance[6];
+		vfloat abs_x[6], abs_y[6], abs_z[6];
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 &plane = frustum.planes[p];
+			normal_x[p] = simd::set1(plane.x);
+			normal_y[p] = simd::set1(plane.y);
+			normal_z[p] = simd::set1(plane.z);
+			distance[p] = simd::set1(plane.w);
+			abs_x[p] = simd::set1(std::fabs(plane.x));
+			abs_y[p] = simd::set1(std::fabs(plane.y));
+			abs_z[p] = simd::set1(std::fabs(plane.z));
+		}
+		const vfloat camera_x = simd::set1(camera_pos.x);
+		const vfloat camera_y = simd::set1(camera_pos.y);
+		const vfloat camera_z = simd::set1(camera_pos.z);
+		const vfloat cull_distance_scale = simd::set1(getCullDistanceScale(projection_scale, min_pixels));
+		const vfloat zero = simd::set1(0.0f);
+
+		visible.resize(bounds.count);
+		CullingStats counts;
+		for (size_t i = 0; i < bounds.count; i += simd::Width)
+		{
+			vfloat centre_x = simd::load(&bounds.centre_x[i]);
+			vfloat centre_y = simd::load(&bounds.centre_y[i]);
+			vfloat centre_z = simd::load(&bounds.centre_z[i]);
+			vfloat extent_x = simd::load(&bounds.extent_x[i]);
+			vfloat extent_y = simd::load(&bounds.extent_y[i]);
+			vfloat extent_z = simd::load(&bounds.extent_z[i]);
+			vfloat radius = simd::load(&bounds.radius[i]);
+
+			// outside a plane: the centre further behind it than the box or the sphere reaches
+			vmask outside = simd::none_mask();
+			for (int p = 0; p < 6; p++)
+			{
+				vfloat d = simd::fmadd(normal_x[p], centre_x, simd::fmadd(normal_y[p], centre_y, simd::fmadd(normal_z[p], centre_z, distance[p])));
+				vfloat box_reach = simd::fmadd(abs_x[p], extent_x, simd::fmadd(abs_y[p], extent_y, abs_z[p] * extent_z));
+				outside = outside | (d + simd::min(box_reach, radius) < zero);
+			}
+
+			// too small: further than the distance at which the sphere is min_pixels across
+			// (compared squared, so no square root)
+			vfloat dx = centre_x - camera_x;
+			vfloat dy = centre_y - camera_y;
+			vfloat dz = centre_z - camera_z;
+			vfloat distance2 = simd::fmadd(dx, dx, simd::fmadd(dy, dy, dz * dz));
+			vfloat cull_distance = radius * cull_distance_scale;
+			vmask too_small = simd::andnot(distance2 > cull_distance * cull_distance, outside);
+
+			unsigned lanes = bounds.count - i < (size_t)simd::Width ? (1u << (bounds.count - i)) - 1 : (unsigned)((1ull << simd::Width) - 1);
+			unsigned outside_bits = simd::bits(outside) & lanes;
+			unsigned too_small_bits = simd::bits(too_small) & lanes;
+			unsigned culled_bits = outside_bits | too_small_bits;
+			for (int l = 0; l < simd::Width && i + l < bounds.count; l++)
+			{
+				visible[i + l] = (culled_bits >> l & 1) ? 0 : 1;
+			}
+			counts.frustum_culled += (int)std::bitset<32>(outside_bits).count();
+			counts.distance_culled += (int)std::bitset<32>(too_small_bits).count();
+		}
+		counts.tested = (int)bounds.count;
+		counts.visible = counts.tested - counts.frustum_culled - counts.distance_culled;
+		if (stats)
+		{
+			*stats = counts;
+		}
+	}
+
+	bool isVisible(const CullingBounds &bounds, size_t i, const Frustum &frustum, const glm::vec3 &camera_pos, float projection_scale, float min_pixels)
+	{
+		glm::vec3 centre(bounds.centre_x[i], bounds.centre_y[i], bounds.centre_z[i]);
+		glm::vec3 extent(bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i]);
+		float radius = bounds.radius[i];
+
+		for (const glm::vec4 &plane : frustum.planes)
+		{
+			float d = glm::dot(glm::vec3(plane), centre) + plane.w;
+			float box_reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+			if (d + std::fmin(box_reach, radius) < 0.0f)
+			{
+				return false;
+			}
+		}
+
+		glm::vec3 offset = centre - camera_pos;
+		float cull_distance = radius * getCullDistanceScale(projection_scale, min_pixels);
+		return !(glm::dot(offset, offset) > cull_distance * cull_distance);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef CULLING
+#define CULLING
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Visibility of objects from their world space bounds, before any of them is drawn: an object
+// is culled when its box or its bounding sphere is wholly outside one of the planes of the
+// view frustum, or when the sphere would cover less than a few pixels on screen. The bounds
+// are kept one array per coordinate so that simd::Width of them are tested at once (see
+// simd.hpp); isVisible is the same test, one object at a time.
+
+// Planes of a view frustum, (normal, distance) with normals pointing inside & of length 1:
+// left, right, bottom, top, near, far
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+struct CullingBounds
+{
+	// box centres & half sizes, and the radius of the sphere around the box. Padded to a
+	// multiple of simd::Width with empty bounds
+	std::vector<float> centre_x, centre_y, centre_z;
+	std::vector<float> extent_x, extent_y, extent_z;
+	std::vector<float> radius;
+	size_t count = 0;
+
+	// Adds the box (in model space) placed by the model matrix, as the shaders place vertices
+	// (the xyz of model * position). Returns its index.
+	size_t add(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model);
+	// Moves bounds i to the box placed by model
+	void set(size_t i, const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model);
+	void clear();
+};
+
+struct CullingStats
+{
+	int tested = 0;
+	int visible = 0;
+	int frustum_culled = 0;		// outside the frustum
+	int distance_culled = 0;	// in it, but too small on screen
+};
+
+namespace Culling
+{
+	// Gribb & Hartmann: the planes are sums & differences of the rows of projection * view
+	Frustum extractFrustum(const glm::mat4 &view_projection);
+
+	// visible[i]: whether bounds i are at least partly in the frustum and at least min_pixels
+	// across on screen (0: no distance culling), with projection_scale the pixels per unit at a
+	// distance of 1 from camera_pos
+	void cull(const CullingBounds &bounds, const Frustum &frustum, const glm::vec3 &camera_pos, float projection_scale, float min_pixels,
+		std::vector<uint8_t> &visible, CullingStats *stats = nullptr);
+	bool isVisible(const CullingBounds &bounds, size_t i, const Frustum &frustum, const glm::vec3 &camera_pos, float projection_scale, float min_pixels);
+}
+#endif
@@ -1,5 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "image_io.h"
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb/stb_image_resize2.h"
 #include "../main/constants.h"
 #include <iostream>
 
@@ -8,7 +10,8 @@
 
 unsigned char *ImageIO::loadImage(string filename, int &width, int &height, int &num_channels, bool flip_vertically)
 {
-	if (flip_vertically) stbi_set_flip_vertically_on_load(true);
+	// per-thread flag, as images are decoded on the texture streamer's loader threads too
+	stbi_set_flip_vertically_on_load_thread(flip_vertically);
 
 	string filepath = CGRA350Constants::TEXTURES_FOLDER_PATH + filename;
 	
@@ -24,3 +27,29 @@ unsigned char *ImageIO::loadImage(string filename, int &width, int &height, int
 
 	return img_data;
 }
+
+unsigned char *ImageIO::loadImageResized(string filename, int width, int height, bool flip_vertically)
+{
+	stbi_set_flip_vertically_on_load_thread(flip_vertically);
+
+	string filepath = CGRA350Constants::TEXTURES_FOLDER_PATH + filename;
+
+	int img_width, img_height, num_channels;
+	unsigned char *img_data = stbi_load(filepath.c_str(), &img_width, &img_height, &num_channels, 4);
+	if (img_data == NULL)
+	{
+		std::cout << "ERROR::IMAGE_IO::COULD_NOT_OPEN_FILE" << std::endl
+			<< "File '" << filename << "' not found" << std::endl
+			<< "STBI failure reason: " << stbi_failure_reason() << std::endl;
+		return NULL;
+	}
+	if (img_width == width && img_height == height)
+	{
+		return img_data;
+	}
+
+	// both stb libraries allocate with malloc, so the result frees like a loaded image
+	unsigned char *resized = stbir_resize_uint8_srgb(img_data, img_width, img_height, 0, NULL, width, height, 0, STBIR_RGBA);
+	stbi_image_free(img_data);
+	return resized;
+}
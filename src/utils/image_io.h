@@ -13,6 +13,8 @@ using std::string;
 namespace ImageIO
 {
 	unsigned char *loadImage(string filename, int &width, int &height, int &num_channels, bool flip_vertically);
+	// RGBA, resampled (in linear space) to width x height; free with stbi_image_free
+	unsigned char *loadImageResized(string filename, int width, int height, bool flip_vertically);
 }
 
 #endif
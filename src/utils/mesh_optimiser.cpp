@@ -0,0 +1,367 @@
+#include "mesh_optimiser.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Scoring of Forsyth's paper: vertices of the last triangle score a fixed amount, others
+// less the older they are in a modelled LRU cache; vertices with few triangles left get a
+// boost, so lone triangles are not left behind.
+static const int FORSYTH_CACHE_SIZE = 32;
+static const int FORSYTH_MAX_VALENCE = 32;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+struct ForsythScores
+{
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_MAX_VALENCE + 1];
+
+	ForsythScores()
+	{
+		for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+		{
+			cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE
+				: std::pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+		}
+		valence[0] = 0.0f;
+		for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+		{
+			valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+		}
+	}
+
+	// remaining: triangles of the vertex not emitted yet
+	float getScore(int cache_position, uint32_t remaining) const
+	{
+		if (remaining == 0)
+		{
+			return -1.0f;
+		}
+		float score = cache_position >= 0 ? cache[cache_position] : 0.0f;
+		return score + valence[remaining < (uint32_t)FORSYTH_MAX_VALENCE ? remaining : FORSYTH_MAX_VALENCE];
+	}
+};
+
+// Bitwise hash & equality of vertices (so -0 and 0 stay apart, as they may be meant to)
+struct VertexBitsHash
+{
+	size_t operator()(const ObjVertex &vertex) const
+	{
+		uint32_t words[sizeof(ObjVertex) / 4];
+		memcpy(words, &vertex, sizeof(ObjVertex));
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (uint32_t word : words)
+		{
+			h = (h ^ word) * 0x100000001b3ull;
+		}
+		return (size_t)(h ^ (h >> 32));
+	}
+};
+
+struct VertexBitsEqual
+{
+	bool operator()(const ObjVertex &a, const ObjVertex &b) const
+	{
+		return memcmp(&a, &b, sizeof(ObjVertex)) == 0;
+	}
+};
+
+static float signNotZero(float x)
+{
+	return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Octahedral normal encoding: the normal is projected onto the octahedron |x| + |y| + |z| = 1,
+// whose lower half is folded over the upper one, giving a point of the [-1, 1] square
+static glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+	float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (length == 0.0f)
+	{
+		return glm::vec2(0.0f);	// (0, 0, 1)
+	}
+	n /= length;
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		e = glm::vec2((1.0f - std::abs(n.y)) * signNotZero(n.x), (1.0f - std::abs(n.x)) * signNotZero(n.y));
+	}
+	return e;
+}
+
+// as mesh_vertex.glsl does it
+static glm::vec3 decodeOctahedral(glm::vec2 e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (n.z < 0.0f)
+	{
+		n = glm::vec3((1.0f - std::abs(e.y)) * signNotZero(e.x), (1.0f - std::abs(e.x)) * signNotZero(e.y), n.z);
+	}
+	return glm::normalize(n);
+}
+
+static int16_t toSnorm16(float x)
+{
+	return (int16_t)std::round(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f);
+}
+
+static uint16_t toUnorm16(float x)
+{
+	return (uint16_t)std::round(std::min(std::max(x, 0.0f), 1.0f) * 65535.0f);
+}
+
+
+// ------------------------------------------
+// --- MeshOptimiser ---
+
+void MeshOptimiser::weldVertices(std::vector<ObjVertex> &vertices, std::vector<uint32_t> &indices)
+{
+	std::unordered_map<ObjVertex, uint32_t, VertexBitsHash, VertexBitsEqual> welded;
+	welded.reserve(vertices.size());
+	std::vector<uint32_t> remap(vertices.size());
+	std::vector<ObjVertex> unique;
+	unique.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		auto found = welded.emplace(vertices[i], (uint32_t)unique.size());
+		if (found.second)
+		{
+			unique.push_back(vertices[i]);
+		}
+		remap[i] = found.first->second;
+	}
+	if (unique.size() == vertices.size())
+	{
+		return;
+	}
+	for (uint32_t &index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.swap(unique);
+}
+
+void MeshOptimiser::optimiseVertexCache(std::vector<uint32_t> &indices, size_t num_vertices)
+{
+	static const ForsythScores scores;
+	size_t num_triangles = indices.size() / 3;
+	if (num_triangles == 0)
+	{
+		return;
+	}
+
+	// triangles of every vertex; the live ones are the first remaining[v] of its list
+	std::vector<uint32_t> remaining(num_vertices, 0);
+	for (size_t i = 0; i < num_triangles * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(num_vertices + 1, 0);
+	for (size_t v = 0; v < num_vertices; v++)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(num_triangles * 3);
+	std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < num_triangles * 3; i++)
+	{
+		adjacency[filled[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<int> cache_positions(num_vertices, -1);
+	std::vector<float> vertex_scores(num_vertices);
+	for (size_t v = 0; v < num_vertices; v++)
+	{
+		vertex_scores[v] = scores.getScore(-1, remaining[v]);
+	}
+	std::vector<float> triangle_scores(num_triangles);
+	for (size_t t = 0; t < num_triangles; t++)
+	{
+		triangle_scores[t] = vertex_scores[indices[3 * t]] + vertex_scores[indices[3 * t + 1]] + vertex_scores[indices[3 * t + 2]];
+	}
+	std::vector<bool> emitted(num_triangles, false);
+
+	int best = 0;
+	for (size_t t = 1; t < num_triangles; t++)
+	{
+		if (triangle_scores[t] > triangle_scores[best])
+		{
+			best = (int)t;
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(num_triangles * 3);
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	int cache_count = 0;
+	size_t next_unemitted = 0;
+	while (best >= 0)
+	{
+		const uint32_t *triangle = &indices[3 * best];
+		emitted[best] = true;
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			output.push_back(v);
+
+			uint32_t *live = &adjacency[offsets[v]];
+			for (uint32_t i = 0; i < remaining[v]; i++)
+			{
+				if (live[i] == (uint32_t)best)
+				{
+					live[i] = live[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// the triangle's vertices move to the front of the cache, pushing the oldest out
+		uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+		int new_count = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			new_cache[new_count++] = triangle[k];
+		}
+		for (int i = 0; i < cache_count; i++)
+		{
+			uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				new_cache[new_count++] = v;
+			}
+		}
+
+		// rescore the vertices that moved & their triangles, picking the best one next
+		for (int i = 0; i < new_count; i++)
+		{
+			uint32_t v = new_cache[i];
+			cache_positions[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+			vertex_scores[v] = scores.getScore(cache_positions[v], remaining[v]);
+		}
+		best = -1;
+		float best_score = -1.0f;
+		for (int i = 0; i < new_count; i++)
+		{
+			uint32_t v = new_cache[i];
+			const uint32_t *live = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t t = live[j];
+				const uint32_t *corners = &indices[3 * t];
+				triangle_scores[t] = vertex_scores[corners[0]] + vertex_scores[corners[1]] + vertex_scores[corners[2]];
+				if (triangle_scores[t] > best_score)
+				{
+					best_score = triangle_scores[t];
+					best = (int)t;
+				}
+			}
+		}
+
+		cache_count = new_count < FORSYTH_CACHE_SIZE ? new_count : FORSYTH_CACHE_SIZE;
+		for (int i = 0; i < cache_count; i++)
+		{
+			cache[i] = new_cache[i];
+		}
+
+		// dead end (nothing left around the cache): carry on from the next triangle in order
+		if (best < 0)
+		{
+			while (next_unemitted < num_triangles && emitted[next_unemitted])
+			{
+				next_unemitted++;
+			}
+			best = next_unemitted < num_triangles ? (int)next_unemitted : -1;
+		}
+	}
+	indices.swap(output);
+}
+
+void MeshOptimiser::optimiseVertexFetch(std::vector<ObjVertex> &vertices, std::vector<uint32_t> &indices)
+{
+	const uint32_t unused = 0xFFFFFFFFu;
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<ObjVertex> reordered;
+	reordered.reserve(vertices.size());
+	for (uint32_t &index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+void MeshOptimiser::packVertices(const std::vector<ObjVertex> &vertices, std::vector<PackedVertex> &packed, glm::vec3 &box_min, glm::vec3 &box_size, PackingError *error)
+{
+	box_min = glm::vec3(0.0f);
+	glm::vec3 box_max(0.0f);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		box_min = i == 0 ? vertices[i].position : glm::min(box_min, vertices[i].position);
+		box_max = i == 0 ? vertices[i].position : glm::max(box_max, vertices[i].position);
+	}
+	box_size = box_max - box_min;
+	glm::vec3 scale(box_size.x > 0.0f ? 1.0f / box_size.x : 0.0f, box_size.y > 0.0f ? 1.0f / box_size.y : 0.0f, box_size.z > 0.0f ? 1.0f / box_size.z : 0.0f);
+
+	packed.resize(vertices.size());
+	PackingError max_error;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const ObjVertex &vertex = vertices[i];
+		PackedVertex &p = packed[i];
+		glm::vec3 position = (vertex.position - box_min) * scale;
+		glm::vec2 normal = encodeOctahedral(vertex.normal);
+		for (int c = 0; c < 3; c++)
+		{
+			p.position[c] = toUnorm16(position[c]);
+		}
+		p.position[3] = 0;
+		p.normal[0] = toSnorm16(normal.x);
+		p.normal[1] = toSnorm16(normal.y);
+		p.tex_coord[0] = glm::packHalf1x16(vertex.tex_coord.x);
+		p.tex_coord[1] = glm::packHalf1x16(vertex.tex_coord.y);
+
+		if (error != nullptr)
+		{
+			glm::vec3 decoded_position = box_min + glm::vec3(p.position[0], p.position[1], p.position[2]) / 65535.0f * box_size;
+			glm::vec3 decoded_normal = decodeOctahedral(glm::max(glm::vec2(p.normal[0], p.normal[1]) / 32767.0f, -1.0f));
+			glm::vec2 decoded_tex_coord(glm::unpackHalf1x16(p.tex_coord[0]), glm::unpackHalf1x16(p.tex_coord[1]));
+			float normal_length = glm::length(vertex.normal);
+			float cosine = normal_length > 0.0f ? glm::dot(vertex.normal / normal_length, decoded_normal) : 1.0f;
+			max_error.position = std::max(max_error.position, glm::length(decoded_position - vertex.position));
+			max_error.normal_degrees = std::max(max_error.normal_degrees, glm::degrees(std::acos(std::min(std::max(cosine, -1.0f), 1.0f))));
+			max_error.tex_coord = std::max({ max_error.tex_coord, std::abs(decoded_tex_coord.x - vertex.tex_coord.x), std::abs(decoded_tex_coord.y - vertex.tex_coord.y) });
+		}
+	}
+	if (error != nullptr)
+	{
+		*error = max_error;
+	}
+}
+
+size_t MeshOptimiser::countTransforms(const std::vector<uint32_t> &indices, size_t num_vertices, int cache_size)
+{
+	// a vertex is still cached if fewer than cache_size vertices were added after it
+	std::vector<size_t> added(num_vertices, 0);
+	size_t time = (size_t)cache_size + 1;
+	size_t transforms = 0;
+	for (uint32_t index : indices)
+	{
+		if (time - added[index] > (size_t)cache_size)
+		{
+			added[index] = time++;
+			transforms++;
+		}
+	}
+	return transforms;
+}
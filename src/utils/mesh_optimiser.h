@@ -0,0 +1,52 @@
+#ifndef MESH_OPTIMISER
+#define MESH_OPTIMISER
+#pragma once
+
+#include "obj_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Welding & reordering of indexed triangle meshes for the GPU, run by ObjLoader on every part:
+//  - weldVertices: vertices with the same bits merged (OBJ files often list the same
+//    position, normal or uv several times, which the (p, t, n) triplets do not catch)
+//  - optimiseVertexCache: triangles in the order of Tom Forsyth's "Linear-speed vertex cache
+//    optimisation", so vertices shared by neighbouring triangles are still in the
+//    post-transform cache and their vertex shader is not run again
+//  - optimiseVertexFetch: vertices renumbered in the order the index buffer first uses
+//    them, so vertex fetches walk the vertex buffer forwards (unused vertices are dropped)
+// and packing of the vertices into half their size, for meshes that opt in (see MeshPart).
+
+// 16 bytes: the position quantised to 16 bits in the part's bounding box (w unused), the
+// normal octahedral encoded in 2 x 16-bit snorm and the texture coordinates as half floats.
+// Decoded by the vertex shaders built with PACKED_VERTICES (see mesh_vertex.glsl).
+struct PackedVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t tex_coord[2];
+};
+
+// Largest differences of the decoded vertices from the originals
+struct PackingError
+{
+	float position = 0.0f;		// distance, in model units
+	float normal_degrees = 0.0f;
+	float tex_coord = 0.0f;		// per component
+};
+
+namespace MeshOptimiser
+{
+	void weldVertices(std::vector<ObjVertex> &vertices, std::vector<uint32_t> &indices);
+	void optimiseVertexCache(std::vector<uint32_t> &indices, size_t num_vertices);
+	void optimiseVertexFetch(std::vector<ObjVertex> &vertices, std::vector<uint32_t> &indices);
+
+	// box_min & box_size: bounding box the positions are quantised in, for the shaders
+	void packVertices(const std::vector<ObjVertex> &vertices, std::vector<PackedVertex> &packed, glm::vec3 &box_min, glm::vec3 &box_size, PackingError *error = nullptr);
+
+	// Vertex shader runs of drawing indices through a FIFO post-transform cache of cache_size
+	// vertices (one per index without a cache); ACMR is this over the number of triangles
+	size_t countTransforms(const std::vector<uint32_t> &indices, size_t num_vertices, int cache_size = 16);
+}
+#endif
@@ -0,0 +1,688 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Weight of the normal & uv changes against the distance moved, per unit of the mesh's size
+static const float SIMPLIFIER_ATTRIBUTE_WEIGHT = 0.01f;
+// A level is kept if it has at most this fraction of the triangles of the one before
+static const float SIMPLIFIER_MIN_REDUCTION = 0.8f;
+// Tries at a level, halving the simplifier's error bound each time, to keep within max_error
+static const int SIMPLIFIER_ATTEMPTS = 3;
+
+// Sum of squared distances to planes, weighted by the area of their triangles:
+// p^T A p + 2 b.p + c, with A symmetric (stored as its upper triangle)
+struct Quadric
+{
+	double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	double b0 = 0, b1 = 0, b2 = 0;
+	double c = 0;
+	double area = 0;
+
+	void addPlane(const glm::dvec3 &n, double d, double weight)
+	{
+		a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z;
+		a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a22 += weight * n.z * n.z;
+		b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+		c += weight * d * d;
+		area += weight;
+	}
+
+	void add(const Quadric &q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		area += q.area;
+	}
+
+	// mean squared distance of p to the planes
+	double evaluate(const glm::vec3 &p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return area > 0.0 ? std::max(e, 0.0) / area : 0.0;
+	}
+};
+
+struct Collapse
+{
+	uint32_t from, to;		// vertices
+	float cost;
+	float distance2;		// part of the cost from the quadric
+};
+
+// Bitwise hash & equality of positions, for finding the vertices at one position
+struct PositionBitsHash
+{
+	size_t operator()(const glm::vec3 &p) const
+	{
+		uint32_t words[3];
+		memcpy(words, &p, sizeof(words));
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (uint32_t word : words)
+		{
+			h = (h ^ word) * 0x100000001b3ull;
+		}
+		return (size_t)(h ^ (h >> 32));
+	}
+};
+
+struct PositionBitsEqual
+{
+	bool operator()(const glm::vec3 &a, const glm::vec3 &b) const
+	{
+		return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+	}
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+	return ((uint64_t)a << 32) | b;
+}
+
+// A connected piece of a mesh (a leaf card, a twig): its triangles share positions
+struct Piece
+{
+	float area = 0.0f;
+	glm::vec3 box_min = glm::vec3(1e30f), box_max = glm::vec3(-1e30f);
+};
+
+// The piece of every triangle, and the pieces
+static std::vector<uint32_t> findPieces(const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &indices, std::vector<Piece> &pieces)
+{
+	std::vector<uint32_t> parent(vertices.size());
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionBitsHash, PositionBitsEqual> first;
+		first.reserve(vertices.size());
+		for (uint32_t v = 0; v < vertices.size(); v++)
+		{
+			parent[v] = first.emplace(vertices[v].position, v).first->second;
+		}
+	}
+	auto root = [&](uint32_t v)
+	{
+		while (parent[v] != v)
+		{
+			v = parent[v] = parent[parent[v]];
+		}
+		return v;
+	};
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t a = root(indices[i]);
+		for (int k = 1; k < 3; k++)
+		{
+			uint32_t b = root(indices[i + k]);
+			parent[std::max(a, b)] = std::min(a, b);
+			a = std::min(a, b);
+		}
+	}
+
+	std::vector<uint32_t> piece_of(vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> triangle_piece(indices.size() / 3);
+	pieces.clear();
+	for (size_t t = 0; t < triangle_piece.size(); t++)
+	{
+		uint32_t &piece = piece_of[root(indices[3 * t])];
+		if (piece == UINT32_MAX)
+		{
+			piece = (uint32_t)pieces.size();
+			pieces.emplace_back();
+		}
+		triangle_piece[t] = piece;
+		const glm::vec3 &a = vertices[indices[3 * t]].position, &b = vertices[indices[3 * t + 1]].position, &c = vertices[indices[3 * t + 2]].position;
+		Piece &p = pieces[piece];
+		p.area += 0.5f * glm::length(glm::cross(b - a, c - a));
+		p.box_min = glm::min(p.box_min, glm::min(a, glm::min(b, c)));
+		p.box_max = glm::max(p.box_max, glm::max(a, glm::max(b, c)));
+	}
+	return triangle_piece;
+}
+
+// The triangles of the pieces kept when at most one piece, the largest, is kept per cell of a
+// grid of cell_size (by the centre of its box)
+static void keepPieces(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &triangle_piece, const std::vector<Piece> &pieces,
+	float cell_size, std::vector<uint32_t> &result)
+{
+	std::unordered_map<uint64_t, uint32_t> cell_piece;
+	for (uint32_t i = 0; i < pieces.size(); i++)
+	{
+		glm::ivec3 cell = glm::ivec3(glm::floor((pieces[i].box_min + pieces[i].box_max) * 0.5f / cell_size)) + (1 << 20);
+		uint64_t key = ((uint64_t)cell.x << 42) | ((uint64_t)cell.y << 21) | (uint64_t)cell.z;
+		auto found = cell_piece.emplace(key, i);
+		if (!found.second && pieces[i].area > pieces[found.first->second].area)
+		{
+			found.first->second = i;
+		}
+	}
+	std::vector<bool> kept(pieces.size(), false);
+	for (const auto &cell : cell_piece)
+	{
+		kept[cell.second] = true;
+	}
+	result.clear();
+	for (size_t t = 0; t < triangle_piece.size(); t++)
+	{
+		if (kept[triangle_piece[t]])
+		{
+			result.insert(result.end(), indices.begin() + 3 * t, indices.begin() + 3 * t + 3);
+		}
+	}
+}
+
+
+// ------------------------------------------
+// --- MeshSimplifier ---
+
+float MeshSimplifier::simplify(const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &indices, std::vector<uint32_t> &result,
+	size_t target_index_count, float target_error)
+{
+	result = indices;
+	size_t num_vertices = vertices.size();
+	if (indices.size() <= target_index_count || num_vertices == 0)
+	{
+		return 0.0f;
+	}
+
+	// one id per position: the first vertex there (vertices on a seam share a position)
+	std::vector<uint32_t> position_id(num_vertices);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionBitsHash, PositionBitsEqual> first;
+		first.reserve(num_vertices);
+		for (uint32_t v = 0; v < num_vertices; v++)
+		{
+			position_id[v] = first.emplace(vertices[v].position, v).first->second;
+		}
+	}
+
+	// locked: positions on an edge without exactly one triangle each way
+	std::vector<bool> locked(num_vertices, false);
+	{
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				edges[edgeKey(position_id[indices[i + k]], position_id[indices[i + (k + 1) % 3]])]++;
+			}
+		}
+		for (const auto &edge : edges)
+		{
+			uint32_t a = (uint32_t)(edge.first >> 32), b = (uint32_t)edge.first;
+			auto reverse = edges.find(edgeKey(b, a));
+			if (edge.second != 1 || reverse == edges.end() || reverse->second != 1)
+			{
+				locked[a] = locked[b] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(num_vertices);
+	glm::vec3 box_min = vertices[indices[0]].position, box_max = box_min;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		glm::dvec3 p0 = vertices[indices[i]].position, p1 = vertices[indices[i + 1]].position, p2 = vertices[indices[i + 2]].position;
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if (length > 0.0)
+		{
+			normal /= length;
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[position_id[indices[i + k]]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+			}
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			box_min = glm::min(box_min, vertices[indices[i + k]].position);
+			box_max = glm::max(box_max, vertices[indices[i + k]].position);
+		}
+	}
+	float attribute_weight = SIMPLIFIER_ATTRIBUTE_WEIGHT * glm::length(box_max - box_min);
+	float target_distance2 = target_error * target_error;
+
+	std::vector<uint32_t> collapse_to(num_vertices);
+	std::vector<bool> pass_locked(num_vertices);
+	std::vector<uint32_t> offsets(num_vertices + 1);
+	std::vector<uint32_t> triangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> ring_from, ring_to;
+	std::vector<std::pair<uint32_t, uint32_t>> moves;
+	float error2 = 0.0f;
+	while (result.size() > target_index_count)
+	{
+		// triangles around every position
+		size_t num_triangles = result.size() / 3;
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index : result)
+		{
+			offsets[position_id[index] + 1]++;
+		}
+		for (size_t v = 0; v < num_vertices; v++)
+		{
+			offsets[v + 1] += offsets[v];
+		}
+		triangles.resize(result.size());
+		std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			triangles[filled[position_id[result[i]]]++] = (uint32_t)(i / 3);
+		}
+
+		// every edge, moving one end onto the other (each way, from its two triangles)
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t from = result[i + k], to = result[i + (k + 1) % 3];
+				if (locked[position_id[from]] || position_id[from] == position_id[to])
+				{
+					continue;
+				}
+				const ObjVertex &a = vertices[from], &b = vertices[to];
+				float distance2 = (float)quadrics[position_id[from]].evaluate(b.position);
+				glm::vec3 normal_change = a.normal - b.normal;
+				glm::vec2 tex_coord_change = a.tex_coord - b.tex_coord;
+				float attributes = attribute_weight * attribute_weight
+					* (glm::dot(normal_change, normal_change) + glm::dot(tex_coord_change, tex_coord_change));
+				collapses.push_back({ from, to, distance2 + attributes, distance2 });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		// the cheapest collapses whose triangles do not overlap, enough to reach the target
+		// (each removes two triangles)
+		size_t wanted = (num_triangles - target_index_count / 3 + 1) / 2;
+		size_t done = 0;
+		for (uint32_t v = 0; v < num_vertices; v++)
+		{
+			collapse_to[v] = v;
+		}
+		std::fill(pass_locked.begin(), pass_locked.end(), false);
+		for (const Collapse &collapse : collapses)
+		{
+			if (done >= wanted)
+			{
+				break;
+			}
+			uint32_t from = position_id[collapse.from], to = position_id[collapse.to];
+			if (collapse.distance2 > target_distance2 || pass_locked[from] || pass_locked[to])
+			{
+				continue;
+			}
+
+			// no triangle of the moved end may flip; every vertex there moves onto the vertex it
+			// shares a triangle with at the other end, so an edge along a seam collapses on both
+			// sides of it, but one crossing a seam cannot
+			const glm::vec3 &target = vertices[collapse.to].position;
+			bool flips = false;
+			ring_from.clear();
+			moves.clear();
+			for (uint32_t j = offsets[from]; j < offsets[from + 1] && !flips; j++)
+			{
+				const uint32_t *corners = &result[3 * triangles[j]];
+				glm::vec3 p[3];
+				uint32_t moved = 0, onto = num_vertices;
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t id = position_id[corners[k]];
+					moved = id == from ? corners[k] : moved;
+					onto = id == to ? corners[k] : onto;
+					p[k] = vertices[corners[k]].position;
+					if (id != from)
+					{
+						ring_from.push_back(id);
+					}
+				}
+				moves.push_back({ moved, onto });
+				if (onto != num_vertices)
+				{
+					continue;
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (int k = 0; k < 3; k++)
+				{
+					if (position_id[corners[k]] == from)
+					{
+						p[k] = target;
+					}
+				}
+				glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			std::sort(moves.begin(), moves.end());
+			for (size_t j = 0; j < moves.size() && !flips; j++)
+			{
+				// sorted, so a vertex's first move is onto a vertex if any is, and all of them
+				// must be onto the same one
+				bool first = j == 0 || moves[j - 1].first != moves[j].first;
+				flips = first ? moves[j].second == num_vertices
+					: moves[j].second != num_vertices && moves[j].second != moves[j - 1].second;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			// the two ends may only share the two neighbours of the edge, or the surface pinches
+			ring_to.clear();
+			for (uint32_t j = offsets[to]; j < offsets[to + 1]; j++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t id = position_id[result[3 * triangles[j] + k]];
+					if (id != to)
+					{
+						ring_to.push_back(id);
+					}
+				}
+			}
+			std::sort(ring_from.begin(), ring_from.end());
+			ring_from.erase(std::unique(ring_from.begin(), ring_from.end()), ring_from.end());
+			std::sort(ring_to.begin(), ring_to.end());
+			ring_to.erase(std::unique(ring_to.begin(), ring_to.end()), ring_to.end());
+			size_t shared = 0;
+			for (uint32_t id : ring_from)
+			{
+				shared += id != to && std::binary_search(ring_to.begin(), ring_to.end(), id);
+			}
+			if (shared != 2)
+			{
+				continue;
+			}
+
+			for (const auto &move : moves)
+			{
+				if (move.second != num_vertices)
+				{
+					collapse_to[move.first] = move.second;
+				}
+			}
+			quadrics[to].add(quadrics[from]);
+			error2 = std::max(error2, collapse.distance2);
+			pass_locked[from] = pass_locked[to] = true;
+			for (uint32_t id : ring_from)
+			{
+				pass_locked[id] = true;
+			}
+			done++;
+		}
+		if (done == 0)
+		{
+			break;
+		}
+
+		// move the collapsed vertices, dropping the triangles left without an area
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = collapse_to[result[i]], b = collapse_to[result[i + 1]], c = collapse_to[result[i + 2]];
+			if (position_id[a] != position_id[b] && position_id[b] != position_id[c] && position_id[a] != position_id[c])
+			{
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+	}
+	return std::sqrt(error2);
+}
+
+glm::vec3 MeshSimplifier::closestPointOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+	// Ericson, "Real-Time Collision Detection" 5.1.5: which vertex, edge or the face is closest
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return a;
+	}
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return a + ab * (d1 / (d1 - d3));
+	}
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+	{
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+float MeshSimplifier::measureDistance(const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &simplified)
+{
+	size_t num_triangles = simplified.size() / 3;
+	if (indices.empty() || num_triangles == 0)
+	{
+		return 0.0f;
+	}
+
+	// the simplified triangles in a grid of about one cell per triangle, each in the cells
+	// its box overlaps
+	glm::vec3 box_min = vertices[simplified[0]].position, box_max = box_min;
+	for (uint32_t index : simplified)
+	{
+		box_min = glm::min(box_min, vertices[index].position);
+		box_max = glm::max(box_max, vertices[index].position);
+	}
+	glm::vec3 box_size = box_max - box_min;
+	float cell_size = std::max(std::cbrt(std::max(box_size.x, 1e-6f) * std::max(box_size.y, 1e-6f) * std::max(box_size.z, 1e-6f) / num_triangles),
+		std::max({ box_size.x, box_size.y, box_size.z }) / 256.0f);
+	glm::ivec3 cells = glm::max(glm::ivec3(box_size / cell_size) + 1, 1);
+	auto cellOf = [&](const glm::vec3 &p)
+	{
+		return glm::clamp(glm::ivec3((p - box_min) / cell_size), glm::ivec3(0), cells - 1);
+	};
+	std::vector<uint32_t> offsets((size_t)cells.x * cells.y * cells.z + 1, 0);
+	std::vector<uint32_t> cell_triangles;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		// counted, then filled
+		std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < num_triangles; t++)
+		{
+			const glm::vec3 &a = vertices[simplified[3 * t]].position, &b = vertices[simplified[3 * t + 1]].position,
+				&c = vertices[simplified[3 * t + 2]].position;
+			glm::ivec3 low = cellOf(glm::min(a, glm::min(b, c))), high = cellOf(glm::max(a, glm::max(b, c)));
+			for (int z = low.z; z <= high.z; z++)
+			{
+				for (int y = low.y; y <= high.y; y++)
+				{
+					for (int x = low.x; x <= high.x; x++)
+					{
+						size_t cell = ((size_t)z * cells.y + y) * cells.x + x;
+						if (pass == 0)
+						{
+							offsets[cell + 1]++;
+						}
+						else
+						{
+							cell_triangles[filled[cell]++] = (uint32_t)t;
+						}
+					}
+				}
+			}
+		}
+		if (pass == 0)
+		{
+			for (size_t cell = 0; cell + 1 < offsets.size(); cell++)
+			{
+				offsets[cell + 1] += offsets[cell];
+			}
+			cell_triangles.resize(offsets.back());
+		}
+	}
+
+	// search rings of cells around each sample until the closest triangle found is nearer
+	// than any in the next ring
+	std::vector<size_t> visited(num_triangles, 0);
+	size_t sample_count = 0;
+	float largest2 = 0.0f;
+	auto measure = [&](const glm::vec3 &p)
+	{
+		sample_count++;
+		glm::ivec3 centre = cellOf(p);
+		glm::vec3 outside = glm::max(glm::max(box_min - p, p - box_max), 0.0f);
+		float closest2 = 1e30f;
+		int max_ring = std::max({ cells.x, cells.y, cells.z });
+		for (int ring = 0; ring <= max_ring; ring++)
+		{
+			// (triangles not seen yet are all at least this far; nor is there a point in finding
+			// one nearer than the largest distance so far)
+			float reach = std::max((ring - 1) * cell_size, glm::length(outside));
+			if ((ring > 0 && reach * reach >= closest2) || closest2 <= largest2)
+			{
+				break;
+			}
+			glm::ivec3 low = glm::max(centre - ring, 0), high = glm::min(centre + ring, cells - 1);
+			for (int z = low.z; z <= high.z; z++)
+			{
+				for (int y = low.y; y <= high.y; y++)
+				{
+					for (int x = low.x; x <= high.x; x++)
+					{
+						if (std::max({ std::abs(x - centre.x), std::abs(y - centre.y), std::abs(z - centre.z) }) != ring)
+						{
+							continue;
+						}
+						size_t cell = ((size_t)z * cells.y + y) * cells.x + x;
+						for (uint32_t j = offsets[cell]; j < offsets[cell + 1]; j++)
+						{
+							uint32_t t = cell_triangles[j];
+							if (visited[t] == sample_count)
+							{
+								continue;
+							}
+							visited[t] = sample_count;
+							glm::vec3 q = closestPointOnTriangle(p, vertices[simplified[3 * t]].position,
+								vertices[simplified[3 * t + 1]].position, vertices[simplified[3 * t + 2]].position);
+							closest2 = std::min(closest2, glm::dot(q - p, q - p));
+						}
+					}
+				}
+			}
+		}
+		largest2 = std::max(largest2, closest2);
+	};
+	// (vertices still used are on the simplified mesh)
+	std::vector<bool> sampled(vertices.size(), false);
+	for (uint32_t index : simplified)
+	{
+		sampled[index] = true;
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const glm::vec3 &a = vertices[indices[i]].position, &b = vertices[indices[i + 1]].position, &c = vertices[indices[i + 2]].position;
+		for (int k = 0; k < 3; k++)
+		{
+			if (!sampled[indices[i + k]])
+			{
+				sampled[indices[i + k]] = true;
+				measure(vertices[indices[i + k]].position);
+			}
+		}
+		measure((a + b + c) / 3.0f);
+	}
+	return std::sqrt(largest2);
+}
+
+void MeshSimplifier::buildLods(ObjMeshPart &part, float max_error)
+{
+	part.lods.clear();
+	if (part.vertices.empty())
+	{
+		return;
+	}
+	glm::vec3 box_min = part.vertices[0].position, box_max = box_min;
+	for (const ObjVertex &vertex : part.vertices)
+	{
+		box_min = glm::min(box_min, vertex.position);
+		box_max = glm::max(box_max, vertex.position);
+	}
+	float max_distance = max_error * glm::length(box_max - box_min);
+
+	// each level from the full mesh, so the quadrics measure against the original surface;
+	// when the surface moved further than the quadrics told (they measure the distance to
+	// planes, not triangles), again with a tighter bound
+	size_t previous_count = part.indices.size();
+	float previous_error = 0.0f;
+	for (int level = 1; level < MESH_MAX_LODS; level++)
+	{
+		ObjMeshLod lod;
+		size_t target_count = previous_count / 6 * 3;
+		float target_error = max_distance;
+		float error = 0.0f, distance = 0.0f;
+		for (int attempt = 0; attempt < SIMPLIFIER_ATTEMPTS; attempt++, target_error *= 0.5f)
+		{
+			error = simplify(part.vertices, part.indices, lod.indices, target_count, target_error);
+			distance = measureDistance(part.vertices, part.indices, lod.indices);
+			if (distance <= max_distance)
+			{
+				break;
+			}
+		}
+		if (lod.indices.empty() || lod.indices.size() > previous_count * SIMPLIFIER_MIN_REDUCTION || distance > max_distance)
+		{
+			// collapses stop at open edges, so a part of many small pieces (leaf cards) drops
+			// whole pieces of the level before instead: the smallest grid cell that keeps at
+			// most the target, aiming lower first and taking the first within max_distance
+			const std::vector<uint32_t> &source = part.lods.empty() ? part.indices : part.lods.back().indices;
+			std::vector<Piece> pieces;
+			std::vector<uint32_t> triangle_piece = findPieces(part.vertices, source, pieces);
+			error = 0.0f;
+			distance = max_distance + 1.0f;
+			lod.indices.clear();
+			float piece_target = 0.5f;
+			for (int attempt = 0; attempt < SIMPLIFIER_ATTEMPTS && pieces.size() > 1 && distance > max_distance; attempt++)
+			{
+				size_t piece_target_count = (size_t)(previous_count / 3 * piece_target) * 3;
+				float low = 0.0f, high = glm::length(box_max - box_min);
+				for (int step = 0; step < 20; step++)
+				{
+					float cell_size = 0.5f * (low + high);
+					keepPieces(source, triangle_piece, pieces, cell_size, lod.indices);
+					(lod.indices.size() > piece_target_count ? low : high) = cell_size;
+				}
+				keepPieces(source, triangle_piece, pieces, high, lod.indices);
+				distance = measureDistance(part.vertices, part.indices, lod.indices);
+				piece_target += (SIMPLIFIER_MIN_REDUCTION - 0.5f) / (SIMPLIFIER_ATTEMPTS - 1);
+			}
+		}
+		if (lod.indices.empty() || lod.indices.size() > previous_count * SIMPLIFIER_MIN_REDUCTION || distance > max_distance)
+		{
+			break;
+		}
+		MeshOptimiser::optimiseVertexCache(lod.indices, part.vertices.size());
+		lod.error = std::max({ error, distance, previous_error });
+		previous_count = lod.indices.size();
+		previous_error = lod.error;
+		part.lods.push_back(std::move(lod));
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_SIMPLIFIER
+#define MESH_SIMPLIFIER
+#pragma once
+
+#include "obj_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Levels of detail of indexed triangle meshes, after Garland & Heckbert's "Surface
+// Simplification Using Quadric Error Metrics". Edges are collapsed, cheapest first, by moving
+// one end onto the other, so every level indexes the vertices of the full mesh and can share
+// its vertex buffer. The cost of a collapse is the distance the moved end is from the planes
+// of the triangles merged into it (its quadric), plus the change of normal & uv, so collapses
+// across shading or texture detail go last. Vertices on open edges (where a part meets
+// another material, or a hole) never move, vertices on a uv / normal seam only move along it
+// (both sides together), and no edge collapses that would flip a triangle or pinch the surface.
+
+#define MESH_MAX_LODS 4		// levels of a part, the full one included
+
+namespace MeshSimplifier
+{
+	// Triangles of the simplified mesh, over the same vertices: edges are collapsed until at
+	// most target_index_count indices are left, or the next collapse would move the surface
+	// more than target_error (in model units). Returns the largest error of the collapses done.
+	float simplify(const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &indices, std::vector<uint32_t> &result,
+		size_t target_index_count, float target_error);
+
+	// Largest distance from the vertices & triangle centres of the full mesh to the simplified
+	// triangles: a sampled, one-sided Hausdorff distance (the other way round is 0 for meshes
+	// from simplify, whose vertices all lie on the full mesh)
+	float measureDistance(const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &simplified);
+	glm::vec3 closestPointOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+
+	// The part's lods: levels with about half the triangles of the one before, until
+	// MESH_MAX_LODS or the part stops simplifying (each one reordered for the vertex cache).
+	// Where collapses stop short, as on leaf cards, whose edges are all open, a level drops
+	// whole connected pieces of the one before instead, keeping the largest of those close
+	// together.
+	// The error of a level is the larger of the simplifier's & the measured distance, and is
+	// at most max_error of the part's size (the diagonal of its box).
+	void buildLods(ObjMeshPart &part, float max_error = 0.05f);
+}
+#endif
@@ -0,0 +1,725 @@
+#include "obj_loader.h"
+
+#include "mesh_optimiser.h"
+#include "mesh_simplifier.h"
+
+#include "../volumerendering/mapped_file.hpp"
+#include "../volumerendering/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+static_assert(sizeof(ObjVertex) == 32, "ObjVertex is stored as is in .mesh files");
+
+static const size_t CHUNK_BYTES = 1 << 20;
+
+enum ObjLineType
+{
+	OBJ_LINE_OTHER,
+	OBJ_LINE_POSITION,
+	OBJ_LINE_TEX_COORD,
+	OBJ_LINE_NORMAL,
+	OBJ_LINE_FACE,
+	OBJ_LINE_MATERIAL
+};
+
+// Face corner: 0-based indices, -1 when missing or invalid
+struct ObjCorner
+{
+	int32_t position;
+	int32_t tex_coord;
+	int32_t normal;
+
+	bool operator==(const ObjCorner &other) const
+	{
+		return position == other.position && tex_coord == other.tex_coord && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner &corner) const
+	{
+		uint64_t h = ((uint64_t)(uint32_t)corner.position << 32 | (uint32_t)corner.tex_coord) * 0x9E3779B97F4A7C15ull;
+		h ^= (uint64_t)(uint32_t)corner.normal * 0xC2B2AE3D27D4EB4Full;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
+// usemtl line: the chunk's triangles from triangle on use material
+struct ObjMaterialSwitch
+{
+	size_t triangle;
+	string material;
+};
+
+struct ObjChunk
+{
+	const char *begin;
+	const char *end;
+	size_t num_positions = 0;	// counting pass
+	size_t num_tex_coords = 0;
+	size_t num_normals = 0;
+	size_t first_position = 0;
+	size_t first_tex_coord = 0;
+	size_t first_normal = 0;
+	std::vector<ObjCorner> corners;		// 3 per triangle
+	std::vector<ObjMaterialSwitch> switches;
+	bool missing_normals = false;
+};
+
+// Triangles [begin, end) of a chunk, all of one material
+struct ObjRun
+{
+	const ObjChunk *chunk;
+	size_t begin;
+	size_t end;
+};
+
+static bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skipBlanks(const char *p, const char *end)
+{
+	while (p < end && isBlank(*p))
+	{
+		p++;
+	}
+	return p;
+}
+
+static const char *skipLine(const char *p, const char *end)
+{
+	p = (const char *)memchr(p, '\n', end - p);
+	return p != nullptr ? p + 1 : end;
+}
+
+static bool isKeyword(const char *p, const char *end, const char *keyword, size_t length)
+{
+	return (size_t)(end - p) >= length && memcmp(p, keyword, length) == 0
+		&& (p + length == end || isBlank(p[length]) || p[length] == '\n');
+}
+
+// Type of the line starting at p, which is moved past the keyword
+static ObjLineType getLineType(const char *&p, const char *end)
+{
+	p = skipBlanks(p, end);
+	if (p == end)
+	{
+		return OBJ_LINE_OTHER;
+	}
+	if (*p == 'v')
+	{
+		if (isKeyword(p, end, "v", 1))
+		{
+			p += 1;
+			return OBJ_LINE_POSITION;
+		}
+		if (isKeyword(p, end, "vt", 2))
+		{
+			p += 2;
+			return OBJ_LINE_TEX_COORD;
+		}
+		if (isKeyword(p, end, "vn", 2))
+		{
+			p += 2;
+			return OBJ_LINE_NORMAL;
+		}
+	}
+	else if (*p == 'f' && isKeyword(p, end, "f", 1))
+	{
+		p += 1;
+		return OBJ_LINE_FACE;
+	}
+	else if (*p == 'u' && isKeyword(p, end, "usemtl", 6))
+	{
+		p += 6;
+		return OBJ_LINE_MATERIAL;
+	}
+	return OBJ_LINE_OTHER;
+}
+
+// Next number of the line (0 when there is none or it is out of float range)
+static const char *parseFloat(const char *p, const char *end, float &value)
+{
+	p = skipBlanks(p, end);
+	if (p < end && *p == '+')
+	{
+		p++;	// from_chars takes no plus sign
+	}
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+	{
+		value = 0.0f;
+	}
+	return result.ptr;
+}
+
+static const char *parseIndex(const char *p, const char *end, int64_t &value)
+{
+	if (p < end && *p == '+')
+	{
+		p++;
+	}
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+	{
+		value = 0;
+	}
+	return result.ptr;
+}
+
+// 1-based or negative (relative to the count so far) OBJ index to 0-based, -1 if invalid
+static int32_t resolveIndex(int64_t index, size_t count)
+{
+	int64_t resolved = index > 0 ? index - 1 : (int64_t)count + index;
+	return index != 0 && resolved >= 0 && resolved < INT32_MAX ? (int32_t)resolved : -1;
+}
+
+// Chunks of about CHUNK_BYTES, each ending just past a newline
+static std::vector<ObjChunk> splitChunks(const char *begin, const char *end)
+{
+	std::vector<ObjChunk> chunks;
+	const char *p = begin;
+	while (p < end)
+	{
+		const char *q = p + std::min((size_t)(end - p), CHUNK_BYTES);
+		if (q < end)
+		{
+			q = skipLine(q - 1, end);
+		}
+		ObjChunk chunk;
+		chunk.begin = p;
+		chunk.end = q;
+		chunks.push_back(std::move(chunk));
+		p = q;
+	}
+	return chunks;
+}
+
+static void countChunk(ObjChunk &chunk)
+{
+	for (const char *p = chunk.begin; p < chunk.end; p = skipLine(p, chunk.end))
+	{
+		switch (getLineType(p, chunk.end))
+		{
+		case OBJ_LINE_POSITION:
+			chunk.num_positions++;
+			break;
+		case OBJ_LINE_TEX_COORD:
+			chunk.num_tex_coords++;
+			break;
+		case OBJ_LINE_NORMAL:
+			chunk.num_normals++;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// Parse the chunk's v / vt / vn lines into the arrays at the offsets of the counting pass,
+// and its faces into triangles
+static void parseChunk(ObjChunk &chunk, glm::vec3 *positions, glm::vec2 *tex_coords, glm::vec3 *normals)
+{
+	size_t position = chunk.first_position;
+	size_t tex_coord = chunk.first_tex_coord;
+	size_t normal = chunk.first_normal;
+	std::vector<ObjCorner> polygon;
+	const char *end = chunk.end;
+	for (const char *p = chunk.begin; p < end; p = skipLine(p, end))
+	{
+		switch (getLineType(p, end))
+		{
+		case OBJ_LINE_POSITION:
+		{
+			glm::vec3 &v = positions[position++];
+			p = parseFloat(p, end, v.x);
+			p = parseFloat(p, end, v.y);
+			p = parseFloat(p, end, v.z);
+			break;
+		}
+		case OBJ_LINE_TEX_COORD:
+		{
+			glm::vec2 &vt = tex_coords[tex_coord++];
+			p = parseFloat(p, end, vt.x);
+			p = parseFloat(p, end, vt.y);
+			break;
+		}
+		case OBJ_LINE_NORMAL:
+		{
+			glm::vec3 &vn = normals[normal++];
+			p = parseFloat(p, end, vn.x);
+			p = parseFloat(p, end, vn.y);
+			p = parseFloat(p, end, vn.z);
+			break;
+		}
+		case OBJ_LINE_FACE:
+		{
+			// p[/[t][/n]] corners, fanned into triangles
+			polygon.clear();
+			while (true)
+			{
+				p = skipBlanks(p, end);
+				if (p == end || *p == '\n')
+				{
+					break;
+				}
+				int64_t v = 0, t = 0, n = 0;
+				const char *next = parseIndex(p, end, v);
+				if (next == p)
+				{
+					while (p < end && !isBlank(*p) && *p != '\n')
+					{
+						p++;	// not a number, skip the token
+					}
+					continue;
+				}
+				p = next;
+				if (p < end && *p == '/')
+				{
+					p++;
+					if (p < end && *p != '/')
+					{
+						p = parseIndex(p, end, t);
+					}
+					if (p < end && *p == '/')
+					{
+						p = parseIndex(p + 1, end, n);
+					}
+				}
+				ObjCorner corner = { resolveIndex(v, position), resolveIndex(t, tex_coord), resolveIndex(n, normal) };
+				chunk.missing_normals |= corner.normal < 0;
+				polygon.push_back(corner);
+			}
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+			break;
+		}
+		case OBJ_LINE_MATERIAL:
+		{
+			p = skipBlanks(p, end);
+			const char *name = p;
+			while (p < end && !isBlank(*p) && *p != '\n')
+			{
+				p++;
+			}
+			chunk.switches.push_back({ chunk.corners.size() / 3, string(name, p) });
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+// Smoothed (area weighted) normals of every position, for corners without one
+static std::vector<glm::vec3> computeNormals(const std::vector<ObjChunk> &chunks, const std::vector<glm::vec3> &positions)
+{
+	std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+	for (const ObjChunk &chunk : chunks)
+	{
+		for (size_t i = 0; i + 2 < chunk.corners.size(); i += 3)
+		{
+			const ObjCorner *c = &chunk.corners[i];
+			if ((size_t)c[0].position >= positions.size() || (size_t)c[1].position >= positions.size() || (size_t)c[2].position >= positions.size())
+			{
+				continue;
+			}
+			glm::vec3 v0 = positions[c[0].position];
+			glm::vec3 face_normal = glm::cross(positions[c[1].position] - v0, positions[c[2].position] - v0);
+			for (int k = 0; k < 3; k++)
+			{
+				normals[c[k].position] += face_normal;
+			}
+		}
+	}
+	for (glm::vec3 &normal : normals)
+	{
+		float length = glm::length(normal);
+		normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+	return normals;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start_time)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+
+// ------------------------------------------
+// --- ObjLoader ---
+
+bool ObjLoader::loadObj(const string &path, ObjMeshData &mesh, ObjLoadStats *stats)
+{
+	auto start_time = std::chrono::steady_clock::now();
+	mesh.parts.clear();
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::OBJ_LOADER::FILE_NOT_READ" << std::endl << "Could not open '" << path << "'" << std::endl;
+		return false;
+	}
+	const char *begin = (const char *)file.Data();
+	std::vector<ObjChunk> chunks = splitChunks(begin, begin + file.Size());
+	int num_chunks = (int)chunks.size();
+	parallel::Stats count_pass, parse_pass, weld_pass;
+
+	// count the v / vt / vn lines of every chunk, so that each one knows where its own go
+	parallel::parallel_for(num_chunks, [&](int i) {
+		countChunk(chunks[i]);
+	}, 1, &count_pass);
+
+	size_t num_positions = 0, num_tex_coords = 0, num_normals = 0;
+	for (ObjChunk &chunk : chunks)
+	{
+		chunk.first_position = num_positions;
+		chunk.first_tex_coord = num_tex_coords;
+		chunk.first_normal = num_normals;
+		num_positions += chunk.num_positions;
+		num_tex_coords += chunk.num_tex_coords;
+		num_normals += chunk.num_normals;
+	}
+	std::vector<glm::vec3> positions(num_positions);
+	std::vector<glm::vec2> tex_coords(num_tex_coords);
+	std::vector<glm::vec3> normals(num_normals);
+
+	parallel::parallel_for(num_chunks, [&](int i) {
+		parseChunk(chunks[i], positions.data(), tex_coords.data(), normals.data());
+	}, 1, &parse_pass);
+
+	bool missing_normals = false;
+	for (const ObjChunk &chunk : chunks)
+	{
+		missing_normals |= chunk.missing_normals;
+	}
+	std::vector<glm::vec3> smooth_normals;
+	if (missing_normals)
+	{
+		smooth_normals = computeNormals(chunks, positions);
+	}
+
+	// material groups: the name of a run of triangles is looked up once per usemtl line
+	std::unordered_map<string, size_t> part_indices;
+	std::vector<std::vector<ObjRun>> part_runs;
+	string material;
+	auto addRun = [&](const ObjChunk &chunk, size_t begin, size_t end) {
+		if (begin == end)
+		{
+			return;
+		}
+		auto found = part_indices.emplace(material, mesh.parts.size());
+		if (found.second)
+		{
+			mesh.parts.emplace_back();
+			mesh.parts.back().material = material;
+			part_runs.emplace_back();
+		}
+		part_runs[found.first->second].push_back({ &chunk, begin, end });
+	};
+	for (const ObjChunk &chunk : chunks)
+	{
+		size_t triangle = 0;
+		for (const ObjMaterialSwitch &material_switch : chunk.switches)
+		{
+			addRun(chunk, triangle, material_switch.triangle);
+			material = material_switch.material;
+			triangle = material_switch.triangle;
+		}
+		addRun(chunk, triangle, chunk.corners.size() / 3);
+	}
+
+	// weld the corners of each part into vertices & optimise them, parts in parallel
+	int num_parts = (int)mesh.parts.size();
+	std::atomic<size_t> skipped(0);
+	parallel::parallel_for(num_parts, [&](int i) {
+		ObjMeshPart &part = mesh.parts[i];
+		size_t num_corners = 0;
+		for (const ObjRun &run : part_runs[i])
+		{
+			num_corners += 3 * (run.end - run.begin);
+		}
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> welded;
+		welded.reserve(num_corners / 2);
+		part.indices.reserve(num_corners);
+		size_t part_skipped = 0;
+
+		for (const ObjRun &run : part_runs[i])
+		{
+			for (size_t t = run.begin; t < run.end; t++)
+			{
+				const ObjCorner *triangle = &run.chunk->corners[3 * t];
+				if ((size_t)triangle[0].position >= num_positions || (size_t)triangle[1].position >= num_positions || (size_t)triangle[2].position >= num_positions)
+				{
+					part_skipped++;
+					continue;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					ObjCorner corner = triangle[k];
+					if ((size_t)corner.tex_coord >= num_tex_coords)
+					{
+						corner.tex_coord = -1;
+					}
+					if ((size_t)corner.normal >= num_normals)
+					{
+						corner.normal = -1;
+					}
+					auto found = welded.emplace(corner, (uint32_t)part.vertices.size());
+					if (found.second)
+					{
+						ObjVertex vertex;
+						vertex.position = positions[corner.position];
+						vertex.normal = corner.normal >= 0 ? normals[corner.normal] : smooth_normals[corner.position];
+						vertex.tex_coord = corner.tex_coord >= 0 ? tex_coords[corner.tex_coord] : glm::vec2(0.0f);
+						part.vertices.push_back(vertex);
+					}
+					part.indices.push_back(found.first->second);
+				}
+			}
+		}
+		skipped += part_skipped;
+
+		// identical vertices merged, triangles in post-transform cache order, then vertices in
+		// the order they are fetched
+		MeshOptimiser::weldVertices(part.vertices, part.indices);
+		MeshOptimiser::optimiseVertexCache(part.indices, part.vertices.size());
+		MeshOptimiser::optimiseVertexFetch(part.vertices, part.indices);
+	}, 1, &weld_pass);
+
+	if (stats != nullptr)
+	{
+		*stats = ObjLoadStats();
+		stats->bytes = file.Size();
+		stats->chunks = num_chunks;
+		stats->threads = std::max({ count_pass.threads, parse_pass.threads, weld_pass.threads });
+		for (const ObjMeshPart &part : mesh.parts)
+		{
+			stats->corners += part.indices.size();
+			stats->vertices += part.vertices.size();
+		}
+		stats->skipped = skipped;
+		stats->seconds = secondsSince(start_time);
+	}
+	if (skipped > 0)
+	{
+		std::cout << "ObjLoader: skipped " << skipped << " triangles of '" << path << "' with invalid vertex indices" << std::endl;
+	}
+	return true;
+}
+
+// Indices as 16 or 32 bit, padded to 4 bytes
+static bool writeIndices(FILE *file, const std::vector<uint32_t> &indices, bool short_index)
+{
+	if (!short_index)
+	{
+		return fwrite(indices.data(), 4, indices.size(), file) == indices.size();
+	}
+	const char padding[2] = {};
+	std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+	return fwrite(short_indices.data(), 2, short_indices.size(), file) == short_indices.size()
+		&& fwrite(padding, 1, short_indices.size() % 2 * 2, file) == short_indices.size() % 2 * 2;
+}
+
+// Indices written by writeIndices, if they lie inside the file
+static bool readIndices(const std::vector<unsigned char> &data, size_t &offset, uint32_t count, uint32_t index_size, std::vector<uint32_t> &indices)
+{
+	size_t size = ((size_t)count * index_size + 3) / 4 * 4;
+	if (offset + size > data.size())
+	{
+		return false;
+	}
+	indices.resize(count);
+	if (index_size == 2)
+	{
+		const uint16_t *short_indices = (const uint16_t *)(data.data() + offset);
+		std::copy(short_indices, short_indices + count, indices.begin());
+	}
+	else
+	{
+		memcpy(indices.data(), data.data() + offset, (size_t)count * 4);
+	}
+	offset += size;
+	return true;
+}
+
+bool ObjLoader::saveMesh(const string &path, const ObjMeshData &mesh, uint64_t source_size, int64_t source_time)
+{
+	FILE *file = fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::cout << "ObjLoader: could not write '" << path << "'" << std::endl;
+		return false;
+	}
+
+	const char padding[4] = {};
+	MeshFileHeader header = { MESH_FILE_MAGIC, MESH_FILE_VERSION, (uint32_t)mesh.parts.size(), 0, source_size, source_time };
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const ObjMeshPart &part : mesh.parts)
+	{
+		bool short_index = part.vertices.size() <= 65536;
+		MeshFilePart part_header = { (uint32_t)part.material.size(), (uint32_t)part.vertices.size(), (uint32_t)part.indices.size(), short_index ? 2u : 4u,
+			(uint32_t)part.lods.size() };
+		ok = ok && fwrite(&part_header, sizeof(part_header), 1, file) == 1;
+		ok = ok && fwrite(part.material.data(), 1, part.material.size(), file) == part.material.size();
+		ok = ok && fwrite(padding, 1, (4 - part.material.size() % 4) % 4, file) == (4 - part.material.size() % 4) % 4;
+		ok = ok && fwrite(part.vertices.data(), sizeof(ObjVertex), part.vertices.size(), file) == part.vertices.size();
+		ok = ok && writeIndices(file, part.indices, short_index);
+		for (const ObjMeshLod &lod : part.lods)
+		{
+			MeshFileLod lod_header = { (uint32_t)lod.indices.size(), lod.error };
+			ok = ok && fwrite(&lod_header, sizeof(lod_header), 1, file) == 1;
+			ok = ok && writeIndices(file, lod.indices, short_index);
+		}
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+	{
+		std::cout << "ObjLoader: could not write '" << path << "'" << std::endl;
+		remove(path.c_str());
+	}
+	return ok;
+}
+
+bool ObjLoader::loadMesh(const string &path, ObjMeshData &mesh, uint64_t source_size, int64_t source_time, ObjLoadStats *stats)
+{
+	auto start_time = std::chrono::steady_clock::now();
+	mesh.parts.clear();
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	std::vector<unsigned char> data;
+	bool ok = fseek(file, 0, SEEK_END) == 0;
+	long size = ok ? ftell(file) : -1;
+	ok = size >= (long)sizeof(MeshFileHeader) && fseek(file, 0, SEEK_SET) == 0;
+	if (ok)
+	{
+		data.resize((size_t)size);
+		ok = fread(data.data(), 1, data.size(), file) == data.size();
+	}
+	fclose(file);
+
+	MeshFileHeader header;
+	if (ok)
+	{
+		memcpy(&header, data.data(), sizeof(header));
+		ok = header.magic == MESH_FILE_MAGIC && header.version == MESH_FILE_VERSION
+			&& (source_size == 0 || header.source_size == source_size)
+			&& (source_time == 0 || header.source_time == source_time);
+	}
+
+	// every part must lie inside the file
+	size_t offset = sizeof(MeshFileHeader);
+	for (uint32_t i = 0; ok && i < header.num_parts; i++)
+	{
+		MeshFilePart part_header;
+		ok = offset + sizeof(part_header) <= data.size();
+		if (!ok)
+		{
+			break;
+		}
+		memcpy(&part_header, data.data() + offset, sizeof(part_header));
+		offset += sizeof(part_header);
+		size_t name_size = ((size_t)part_header.name_length + 3) / 4 * 4;
+		size_t vertices_size = (size_t)part_header.num_vertices * sizeof(ObjVertex);
+		ok = (part_header.index_size == 2 || part_header.index_size == 4)
+			&& offset + name_size + vertices_size <= data.size();
+		if (!ok)
+		{
+			break;
+		}
+
+		ObjMeshPart part;
+		part.material.assign((const char *)data.data() + offset, part_header.name_length);
+		offset += name_size;
+		part.vertices.resize(part_header.num_vertices);
+		memcpy(part.vertices.data(), data.data() + offset, vertices_size);
+		offset += vertices_size;
+		ok = readIndices(data, offset, part_header.num_indices, part_header.index_size, part.indices);
+		for (uint32_t j = 0; ok && j < part_header.num_lods; j++)
+		{
+			MeshFileLod lod_header;
+			ok = offset + sizeof(lod_header) <= data.size();
+			if (ok)
+			{
+				memcpy(&lod_header, data.data() + offset, sizeof(lod_header));
+				offset += sizeof(lod_header);
+				ObjMeshLod lod;
+				lod.error = lod_header.error;
+				ok = readIndices(data, offset, lod_header.num_indices, part_header.index_size, lod.indices);
+				part.lods.push_back(std::move(lod));
+			}
+		}
+		mesh.parts.push_back(std::move(part));
+	}
+	if (!ok)
+	{
+		mesh.parts.clear();
+		return false;
+	}
+
+	if (stats != nullptr)
+	{
+		*stats = ObjLoadStats();
+		stats->bytes = data.size();
+		stats->from_cache = true;
+		for (const ObjMeshPart &part : mesh.parts)
+		{
+			stats->corners += part.indices.size();
+			stats->vertices += part.vertices.size();
+		}
+		stats->seconds = secondsSince(start_time);
+	}
+	return true;
+}
+
+bool ObjLoader::loadObjCached(const string &path, const string &cache_folder, ObjMeshData &mesh, ObjLoadStats *stats)
+{
+	std::error_code error;
+	uint64_t source_size = std::filesystem::file_size(path, error);
+	if (error || cache_folder.empty())
+	{
+		return loadObj(path, mesh, stats);
+	}
+	int64_t source_time = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	string cache_path = cache_folder + std::filesystem::path(path).stem().string() + ".mesh";
+	if (loadMesh(cache_path, mesh, source_size, source_time, stats))
+	{
+		return true;
+	}
+
+	if (!loadObj(path, mesh, stats))
+	{
+		return false;
+	}
+	auto start_time = std::chrono::steady_clock::now();
+	parallel::parallel_for((int)mesh.parts.size(), [&](int i) {
+		MeshSimplifier::buildLods(mesh.parts[i]);
+	});
+	if (stats != nullptr)
+	{
+		stats->seconds += secondsSince(start_time);
+	}
+	std::filesystem::create_directories(cache_folder, error);
+	if (!error)
+	{
+		saveMesh(cache_path, mesh, source_size, source_time);
+	}
+	return true;
+}
@@ -0,0 +1,109 @@
+#ifndef OBJ_LOADER
+#define OBJ_LOADER
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// Wavefront OBJ loading. The file is memory mapped and cut into chunks that end on a line
+// break; the chunks are parsed in parallel (v / vt / vn / f / usemtl, other lines are
+// skipped), then every material group welds its face corners into vertices, one hash map
+// lookup per (position, uv, normal) triplet. Polygons are fanned into triangles, negative
+// (relative) indices are resolved and corners without a normal get the smoothed normal of
+// their position. Each part is then reordered for the vertex caches (see MeshOptimiser).
+//
+// A loaded mesh can be saved as a .mesh file, which later runs read back in one go:
+//
+//   MeshFileHeader, then per part a MeshFilePart, the name (padded to 4 bytes), the
+//   interleaved vertices and the indices (16 bit when the part has at most 65536 vertices,
+//   padded to 4 bytes), then per lod a MeshFileLod and its indices (the same way)
+
+#define MESH_FILE_MAGIC 0x3148534D		// "MSH1"
+#define MESH_FILE_VERSION 4
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_parts;
+	uint32_t reserved;
+	uint64_t source_size;	// of the .obj it was made from, to notice edits
+	int64_t source_time;
+};
+
+struct MeshFilePart
+{
+	uint32_t name_length;
+	uint32_t num_vertices;
+	uint32_t num_indices;
+	uint32_t index_size;	// 2 or 4 bytes
+	uint32_t num_lods;
+};
+
+struct MeshFileLod
+{
+	uint32_t num_indices;
+	float error;
+};
+
+struct ObjVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 tex_coord;
+};
+
+// Simplified triangles of a part, over the part's vertices (see MeshSimplifier)
+struct ObjMeshLod
+{
+	std::vector<uint32_t> indices;
+	float error = 0.0f;		// how far the surface may have moved, in model units
+};
+
+// Triangles of one material (usemtl group), indexing their own vertices
+struct ObjMeshPart
+{
+	string material;		// empty for faces before the first usemtl
+	std::vector<ObjVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<ObjMeshLod> lods;	// coarser levels of detail, finest first
+};
+
+struct ObjMeshData
+{
+	std::vector<ObjMeshPart> parts;		// in order of first use in the file
+};
+
+struct ObjLoadStats
+{
+	size_t bytes = 0;		// of the file read (.obj or .mesh)
+	bool from_cache = false;
+	int chunks = 0;
+	int threads = 0;
+	size_t corners = 0;		// face corners, after triangulation
+	size_t vertices = 0;	// after welding
+	size_t skipped = 0;		// triangles with an out of range position index
+	double seconds = 0;
+};
+
+namespace ObjLoader
+{
+	// Fail (with a message) when the file cannot be opened
+	bool loadObj(const string &path, ObjMeshData &mesh, ObjLoadStats *stats = nullptr);
+
+	bool saveMesh(const string &path, const ObjMeshData &mesh, uint64_t source_size = 0, int64_t source_time = 0);
+	// Fail on a missing, truncated or outdated file, or one made from another version of the
+	// source (when source_size / source_time are given)
+	bool loadMesh(const string &path, ObjMeshData &mesh, uint64_t source_size = 0, int64_t source_time = 0, ObjLoadStats *stats = nullptr);
+
+	// The .mesh of path in cache_folder when it is up to date, else the .obj, with the lods of
+	// every part built (see MeshSimplifier), and the .mesh is written for the next run
+	bool loadObjCached(const string &path, const string &cache_folder, ObjMeshData &mesh, ObjLoadStats *stats = nullptr);
+}
+#endif
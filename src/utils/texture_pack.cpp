@@ -0,0 +1,104 @@
+#include "texture_pack.h"
+
+#include <cstring>
+#include <iostream>
+
+
+bool TexturePack::open(string path)
+{
+	m_header = nullptr;
+	if (!m_file.Open(path))
+	{
+		return false;
+	}
+
+	// check the header & that the directory and every level lie inside the file
+	const unsigned char *data = m_file.Data();
+	size_t size = m_file.Size();
+	const TexturePackHeader *header = (const TexturePackHeader *)data;
+	bool ok = size >= sizeof(TexturePackHeader)
+		&& header->magic == TEXTURE_PACK_MAGIC && header->version == TEXTURE_PACK_VERSION
+		&& header->directory_offset + (uint64_t)header->num_entries * sizeof(TexturePackEntry) <= header->names_offset
+		&& header->names_offset <= size;
+	for (uint32_t i = 0; ok && i < header->num_entries; i++)
+	{
+		const TexturePackEntry &entry = ((const TexturePackEntry *)(data + header->directory_offset))[i];
+		ok = entry.num_mips >= 1 && entry.num_mips <= TEXTURE_PACK_MAX_MIPS
+			&& header->names_offset + entry.name_offset + entry.name_length <= size;
+		for (uint32_t m = 0; ok && m < entry.num_mips; m++)
+		{
+			ok = entry.mip_offsets[m] + entry.mip_sizes[m] <= header->directory_offset;
+		}
+	}
+	if (!ok)
+	{
+		std::cout << "ERROR::TEXTURE_PACK::INVALID_FILE" << std::endl
+			<< "File '" << path << "' is not a texture pack of version " << TEXTURE_PACK_VERSION << ", rebake it with texture_baker" << std::endl;
+		m_file.Close();
+		return false;
+	}
+
+	m_header = header;
+	m_entries = (const TexturePackEntry *)(data + header->directory_offset);
+	m_names = (const char *)(data + header->names_offset);
+	return true;
+}
+
+bool TexturePack::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+// binary search, the directory is sorted by name
+const TexturePackEntry *TexturePack::find(string filename, bool flip_vertically) const
+{
+	if (m_header == nullptr)
+	{
+		return nullptr;
+	}
+
+	string name = normaliseName(filename);
+	int low = 0;
+	int high = (int)m_header->num_entries - 1;
+	while (low <= high)
+	{
+		int mid = (low + high) / 2;
+		const TexturePackEntry &entry = m_entries[mid];
+		int order = name.compare(0, string::npos, m_names + entry.name_offset, entry.name_length);
+		if (order == 0)
+		{
+			bool flipped = (entry.flags & TEXTURE_PACK_FLIPPED) != 0;
+			return flipped == flip_vertically ? &entry : nullptr;
+		}
+		if (order < 0)
+		{
+			high = mid - 1;
+		}
+		else
+		{
+			low = mid + 1;
+		}
+	}
+	return nullptr;
+}
+
+const unsigned char *TexturePack::getLevel(const TexturePackEntry &entry, int mip) const
+{
+	return m_file.Data() + entry.mip_offsets[mip];
+}
+
+string TexturePack::normaliseName(string filename)
+{
+	for (char &c : filename)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+	}
+	while (filename.compare(0, 2, "./") == 0)
+	{
+		filename.erase(0, 2);
+	}
+	return filename;
+}
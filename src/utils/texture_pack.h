@@ -0,0 +1,102 @@
+#ifndef TEXTURE_PACK
+#define TEXTURE_PACK
+#pragma once
+
+#include "../volumerendering/mapped_file.hpp"
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+// Texture pack: every image of resources/textures baked offline by texture_baker
+// (src/tools/texture_baker.cpp) into one file, with the mip chain precomputed and, by
+// default, block compressed, so loading a texture is a memory-mapped read & upload.
+//
+// Layout: TexturePackHeader, the level data (16-byte aligned), the directory (one
+// TexturePackEntry per image, sorted by name) and the names. Names are paths relative to
+// the textures folder, with '/' separators and no leading "./".
+
+#define TEXTURE_PACK_MAGIC 0x314B5054		// "TPK1"
+#define TEXTURE_PACK_VERSION 1
+#define TEXTURE_PACK_MAX_MIPS 16
+
+enum TexturePackFormat : uint32_t
+{
+	TEXTURE_PACK_RAW = 0,	// num_channels bytes per pixel, rows packed
+	TEXTURE_PACK_BC1,		// RGB, 8 bytes per 4x4 block
+	TEXTURE_PACK_BC3,		// RGBA, 16 bytes per block
+	TEXTURE_PACK_BC4,		// R, 8 bytes per block
+	TEXTURE_PACK_BC5		// RG, 16 bytes per block
+};
+
+enum TexturePackFlags : uint32_t
+{
+	TEXTURE_PACK_SRGB = 1,		// colour channels are sRGB encoded
+	TEXTURE_PACK_FLIPPED = 2	// rows flipped vertically, as Texture2D loads them
+};
+
+struct TexturePackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_entries;
+	uint32_t reserved;
+	uint64_t directory_offset;
+	uint64_t names_offset;
+};
+
+struct TexturePackEntry
+{
+	uint32_t name_offset;		// from names_offset
+	uint32_t name_length;
+	uint32_t format;			// TexturePackFormat
+	uint32_t flags;				// TexturePackFlags
+	uint32_t width;
+	uint32_t height;
+	uint32_t num_channels;		// of the pixels that were stored / compressed
+	uint32_t num_mips;
+	uint64_t mip_offsets[TEXTURE_PACK_MAX_MIPS];
+	uint32_t mip_sizes[TEXTURE_PACK_MAX_MIPS];
+};
+
+// Bytes of one level of a format
+inline size_t getTexturePackLevelSize(uint32_t format, int width, int height, int num_channels)
+{
+	size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	switch (format)
+	{
+	case TEXTURE_PACK_BC1:
+	case TEXTURE_PACK_BC4:
+		return blocks * 8;
+	case TEXTURE_PACK_BC3:
+	case TEXTURE_PACK_BC5:
+		return blocks * 16;
+	default:
+		return (size_t)width * height * num_channels;
+	}
+}
+
+// --- Texture Pack ---
+class TexturePack
+{
+private:
+	MappedFile m_file;
+	const TexturePackHeader *m_header = nullptr;
+	const TexturePackEntry *m_entries = nullptr;
+	const char *m_names = nullptr;
+
+public:
+	// Fails (leaving the pack closed) on a missing, truncated or outdated file
+	bool open(string path);
+	bool isOpen() const;
+
+	// Entry of filename (as passed to Texture2D), or null if it is not in the pack or was
+	// baked with the other vertical orientation
+	const TexturePackEntry *find(string filename, bool flip_vertically) const;
+	const unsigned char *getLevel(const TexturePackEntry &entry, int mip) const;
+
+	// filename as it is stored in the directory
+	static string normaliseName(string filename);
+};
+#endif
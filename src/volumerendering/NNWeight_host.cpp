@@ -0,0 +1,126 @@
+#include "cpu_nn.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+// Host copy of the MRPNN tables. NNWeight.cu is pulled in a second time with the CUDA
+// memory-space qualifiers stripped, so the CPU engine reads exactly the numbers the
+// kernels were built with and needs no device to copy them back from.
+
+#pragma push_macro("__device__")
+#pragma push_macro("__constant__")
+#undef __device__
+#undef __constant__
+#define __device__
+#define __constant__
+
+namespace host_weights {
+#include "NNWeight.cu"
+}
+
+#pragma pop_macro("__constant__")
+#pragma pop_macro("__device__")
+
+namespace {
+
+struct NNTensor {
+	const char* name;
+	const float* data;
+	int size;
+};
+
+#define NN_TENSOR(n) { #n, host_weights::n, (int)(sizeof(host_weights::n) / sizeof(float)) },
+
+const NNTensor mrpnn_tensors[] = {
+	NN_TENSOR(LD01W) NN_TENSOR(LD01B)
+	NN_TENSOR(LD11W) NN_TENSOR(LD11B)
+	NN_TENSOR(LD21W) NN_TENSOR(LD21B)
+	NN_TENSOR(LD31W) NN_TENSOR(LD31B)
+	NN_TENSOR(LD41W) NN_TENSOR(LD41B)
+	NN_TENSOR(LD_Tr01W) NN_TENSOR(LD_Tr01B)
+	NN_TENSOR(LD_Tr11W) NN_TENSOR(LD_Tr11B)
+	NN_TENSOR(LD_Tr21W) NN_TENSOR(LD_Tr21B)
+	NN_TENSOR(LD_Tr31W) NN_TENSOR(LD_Tr31B)
+	NN_TENSOR(LD_Tr41W) NN_TENSOR(LD_Tr41B)
+	NN_TENSOR(LD_Hg01W) NN_TENSOR(LD_Hg01B)
+	NN_TENSOR(LD_Hg11W) NN_TENSOR(LD_Hg11B)
+	NN_TENSOR(LD_Hg21W) NN_TENSOR(LD_Hg21B)
+	NN_TENSOR(LD_Hg31W) NN_TENSOR(LD_Hg31B)
+	NN_TENSOR(LD_Hg41W) NN_TENSOR(LD_Hg41B)
+	NN_TENSOR(L01W) NN_TENSOR(L01B)
+	NN_TENSOR(L11W) NN_TENSOR(L11B)
+	NN_TENSOR(L21W) NN_TENSOR(L21B)
+	NN_TENSOR(L31W) NN_TENSOR(L31B)
+	NN_TENSOR(L41W) NN_TENSOR(L41B)
+	NN_TENSOR(L51W) NN_TENSOR(L51B)
+	NN_TENSOR(L61W) NN_TENSOR(L61B)
+	NN_TENSOR(L71W) NN_TENSOR(L71B)
+	NN_TENSOR(L81W) NN_TENSOR(L81B)
+	NN_TENSOR(L_Tr01W) NN_TENSOR(L_Tr01B)
+	NN_TENSOR(L_Tr11W) NN_TENSOR(L_Tr11B)
+	NN_TENSOR(L_Tr21W) NN_TENSOR(L_Tr21B)
+	NN_TENSOR(L_Tr31W) NN_TENSOR(L_Tr31B)
+	NN_TENSOR(L_Tr41W) NN_TENSOR(L_Tr41B)
+	NN_TENSOR(L_Tr51W) NN_TENSOR(L_Tr51B)
+	NN_TENSOR(L_Tr61W) NN_TENSOR(L_Tr61B)
+	NN_TENSOR(L_Tr71W) NN_TENSOR(L_Tr71B)
+	NN_TENSOR(L_Tr81W) NN_TENSOR(L_Tr81B)
+	NN_TENSOR(L_Hg01W) NN_TENSOR(L_Hg01B)
+	NN_TENSOR(L_Hg11W) NN_TENSOR(L_Hg11B)
+	NN_TENSOR(L_Hg21W) NN_TENSOR(L_Hg21B)
+	NN_TENSOR(L_Hg31W) NN_TENSOR(L_Hg31B)
+	NN_TENSOR(L_Hg41W) NN_TENSOR(L_Hg41B)
+	NN_TENSOR(L_Hg51W) NN_TENSOR(L_Hg51B)
+	NN_TENSOR(L_Hg61W) NN_TENSOR(L_Hg61B)
+	NN_TENSOR(L_Hg71W) NN_TENSOR(L_Hg71B)
+	NN_TENSOR(L_Hg81W) NN_TENSOR(L_Hg81B)
+	NN_TENSOR(LDSE01W) NN_TENSOR(LDSE02W)
+	NN_TENSOR(LDSE11W) NN_TENSOR(LDSE12W)
+	NN_TENSOR(LDSE21W) NN_TENSOR(LDSE22W)
+	NN_TENSOR(LDSE31W) NN_TENSOR(LDSE32W)
+	NN_TENSOR(LSE01W) NN_TENSOR(LSE02W)
+	NN_TENSOR(LSE11W) NN_TENSOR(LSE12W)
+	NN_TENSOR(LSE21W) NN_TENSOR(LSE22W)
+	NN_TENSOR(LSE31W) NN_TENSOR(LSE32W)
+	NN_TENSOR(LSE41W) NN_TENSOR(LSE42W)
+	NN_TENSOR(LSE51W) NN_TENSOR(LSE52W)
+	NN_TENSOR(LSE61W) NN_TENSOR(LSE62W)
+	NN_TENSOR(LSE71W) NN_TENSOR(LSE72W)
+	NN_TENSOR(LSEFin1W) NN_TENSOR(LSEFin2W)
+	NN_TENSOR(LGGSW) NN_TENSOR(LGGSB)
+	NN_TENSOR(LC0W) NN_TENSOR(LC0B)
+	NN_TENSOR(LC1W) NN_TENSOR(LC1B)
+	NN_TENSOR(LC2W) NN_TENSOR(LC2B)
+	NN_TENSOR(LXW) NN_TENSOR(LXB)
+	NN_TENSOR(LX0W) NN_TENSOR(LX0B)
+	NN_TENSOR(LX1W) NN_TENSOR(LX1B)
+	NN_TENSOR(LX2W) NN_TENSOR(LX2B)
+	NN_TENSOR(LX3W) NN_TENSOR(LX3B)
+	NN_TENSOR(LX4W) NN_TENSOR(LX4B)
+	NN_TENSOR(LX5W) NN_TENSOR(LX5B)
+	NN_TENSOR(LX6W) NN_TENSOR(LX6B)
+	NN_TENSOR(LX7W) NN_TENSOR(LX7B)
+	NN_TENSOR(LX8W) NN_TENSOR(LX8B)
+	NN_TENSOR(LX9W) NN_TENSOR(LX9B)
+	NN_TENSOR(LX10W) NN_TENSOR(LX10B)
+	NN_TENSOR(LX11W) NN_TENSOR(LX11B)
+	NN_TENSOR(LX12W) NN_TENSOR(LX12B)
+};
+
+#undef NN_TENSOR
+
+}
+
+const float* MRPNNHostWeight(const char* name, int size) {
+	for (const NNTensor& t : mrpnn_tensors) {
+		if (strcmp(t.name, name) != 0)
+			continue;
+		if (t.size != size) {
+			printf("MRPNN weight %s has %d entries, expected %d.\n", name, t.size, size);
+			return nullptr;
+		}
+		return t.data;
+	}
+	printf("MRPNN weight %s not found.\n", name);
+	return nullptr;
+}
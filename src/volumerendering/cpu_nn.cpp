@@ -0,0 +1,738 @@
+#include "cpu_nn.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+// Activations are kept feature-major for a whole batch: row r holds feature r of all B
+// sample points, so every Linear layer becomes a [to x from] * [from x B] GEMM whose
+// columns are SIMD lanes. Weights are broadcast from the packed panels (see CPUDense),
+// four outputs and K vectors of samples accumulate in registers, and bias, ReLU/sigmoid
+// and the residual adds are applied before the panel is stored.
+
+namespace {
+
+using simd::vfloat;
+
+const int W = simd::Width;
+const int K = 2;
+const int B = W * K;
+
+const int PC = MRPNN_SAMPLES;
+const int DI = 160;
+const int POOL = 36;
+const int P_DI = 24;
+
+float* AlignedFloats(size_t count) {
+	return (float*)::operator new(count * sizeof(float), align_val_t(64));
+}
+
+void AlignedFree(void* p) {
+	::operator delete(p, align_val_t(64));
+}
+
+enum Activation { Identity, ReLU, Sigmoid };
+
+template<Activation act>
+inline vfloat Activate(vfloat v) {
+	if (act == ReLU)
+		return simd::max(v, simd::set1(0.0f));
+	if (act == Sigmoid)
+		return simd::set1(1.0f) / (simd::exp(0.0f - v) + 1.0f);
+	return v;
+}
+
+inline float ActivateScalar(float v, Activation act) {
+	if (act == ReLU)
+		return v >= 0.0f ? v : 0.0f;
+	if (act == Sigmoid)
+		return 1.0f / (1.0f + exp(-v));
+	return v;
+}
+
+// out = act(W * in + b), or act(out + W * in + b) with accumulate.
+template<Activation act, bool accumulate = false>
+void Dense(const CPUDense& l, const float* in, float* out) {
+	const float* panel = l.packed;
+	for (int i0 = 0; i0 < l.to; i0 += 4, panel += l.from * 4) {
+		int n = min(4, l.to - i0);
+
+		vfloat acc[4][K];
+		for (int o = 0; o < 4; o++)
+			for (int k = 0; k < K; k++)
+				acc[o][k] = simd::set1(l.packedBias[i0 + o]);
+		if (accumulate) {
+			for (int o = 0; o < n; o++)
+				for (int k = 0; k < K; k++)
+					acc[o][k] = acc[o][k] + simd::load(out + (i0 + o) * B + k * W);
+		}
+
+		const float* w = panel;
+		const float* x = in;
+		for (int j = 0; j < l.from; j++, w += 4, x += B) {
+			vfloat xv[K];
+			for (int k = 0; k < K; k++)
+				xv[k] = simd::load(x + k * W);
+			for (int o = 0; o < 4; o++) {
+				vfloat wv = simd::set1(w[o]);
+				for (int k = 0; k < K; k++)
+					acc[o][k] = simd::fmadd(wv, xv[k], acc[o][k]);
+			}
+		}
+
+		for (int o = 0; o < n; o++)
+			for (int k = 0; k < K; k++)
+				simd::store(out + (i0 + o) * B + k * W, Activate<act>(acc[o][k]));
+	}
+}
+
+inline float* Row(float* rows, int r) {
+	return rows + r * B;
+}
+
+inline void Copy(float* dst, const float* src, int rows) {
+	memcpy(dst, src, rows * B * sizeof(float));
+}
+
+inline void Add(float* dst, const float* src, int rows) {
+	for (int i = 0; i < rows * B; i += W)
+		simd::store(dst + i, simd::load(dst + i) + simd::load(src + i));
+}
+
+// dst row r = src row r * s, lane by lane.
+inline void Scale(float* dst, const float* src, const float* s, int rows) {
+	for (int r = 0; r < rows; r++)
+		for (int k = 0; k < K; k++)
+			simd::store(dst + r * B + k * W, simd::load(src + r * B + k * W) * simd::load(s + k * W));
+}
+
+inline void AvgMax(const float* src, int rows, float* avg, float* mx) {
+	for (int k = 0; k < K; k++) {
+		vfloat sum = simd::set1(0.0f);
+		vfloat m = simd::set1(-10000.0f);
+		for (int r = 0; r < rows; r++) {
+			vfloat v = simd::load(src + r * B + k * W);
+			sum = sum + v;
+			m = simd::max(m, v);
+		}
+		simd::store(avg + k * W, sum * (1.0f / rows));
+		simd::store(mx + k * W, m);
+	}
+}
+
+// One SE / SERES block of RadiancePredict followed by its ADD3 or REP3; last < 0 is SE.
+struct SEStage {
+	int last, from, to, size, pid;
+	bool rep;
+	int post_from, post_to;
+};
+
+const SEStage main_stages[8] = {
+	{ -1, 0, 0, 8, 0, false, 0, 0 },
+	{ 0, 8, 8, 8, 3, true, 0, 8 },
+	{ 0, 16, 16, 16, 6, false, 16, 16 },
+	{ 16, 32, 32, 16, 9, false, 32, 32 },
+	{ 32, 48, 48, 16, 12, true, 32, 48 },
+	{ 32, 64, 64, 32, 15, false, 64, 64 },
+	{ 64, 96, 96, 32, 18, false, 96, 96 },
+	{ 96, 128, 128, 32, 21, false, 128, 128 },
+};
+
+const SEStage di_stages[4] = {
+	{ -1, DI + 0, 0, 8, P_DI + 0, false, DI + 0, 0 },
+	{ 0, DI + 8, 8, 8, P_DI + 3, false, DI + 8, 8 },
+	{ 8, DI + 16, 16, 8, P_DI + 6, false, DI + 16, 16 },
+	{ 16, DI + 24, 24, 8, P_DI + 9, false, DI + 24, 24 },
+};
+
+// Scratch rows of one worker; allocated once per thread.
+struct Rows {
+	float* data;
+	int used = 0;
+
+	explicit Rows(int rows) : data(AlignedFloats((size_t)rows * B)) {}
+	~Rows() { AlignedFree(data); }
+
+	float* Take(int rows) {
+		float* r = data + used * B;
+		used += rows;
+		return r;
+	}
+};
+
+struct MRPNNBatch {
+	const CPUNN::MRPNNLayers& n;
+	Rows rows;
+	float* x[3];
+	float* xa[3];
+	float* xa2[3];
+	float* pool;
+	float* hidden;
+	float* weight;
+	float* temp;
+	float* comb;
+	float* srp;
+	float* result;
+
+	explicit MRPNNBatch(const CPUNN::MRPNNLayers& layers) : n(layers), rows(3 * PC + 6 * 160 + 75 + 16 + 6 + 8 + 128 + 3 + 3) {
+		for (int b = 0; b < 3; b++) x[b] = rows.Take(PC);
+		for (int b = 0; b < 3; b++) xa[b] = rows.Take(160);
+		for (int b = 0; b < 3; b++) xa2[b] = rows.Take(160);
+		pool = rows.Take(75);
+		hidden = rows.Take(16);
+		weight = rows.Take(6);
+		temp = rows.Take(8);
+		comb = rows.Take(128);
+		srp = rows.Take(3);
+		result = rows.Take(3);
+	}
+
+	void RunStage(const SEStage& s, const CPUNN::SEBlock& blk) {
+		for (int b = 0; b < 3; b++)
+			AvgMax(Row(x[b], s.from), s.size, Row(pool, s.pid + b), Row(pool, POOL + s.pid + b));
+		Copy(Row(temp, 0), Row(pool, s.pid), 3);
+		Copy(Row(temp, 3), Row(pool, POOL + s.pid), 3);
+		Dense<ReLU>(blk.se0, temp, hidden);
+		Dense<Sigmoid>(blk.se1, hidden, weight);
+
+		const CPUDense* dense[3] = { &blk.main, &blk.tr, &blk.hg };
+		for (int b = 0; b < 3; b++) {
+			Scale(Row(xa[b], s.to), Row(x[b], s.from), Row(weight, b), s.size);
+			if (s.last >= 0)
+				Add(Row(xa[b], s.to), Row(xa2[b], s.last), s.size);
+			Dense<ReLU>(*dense[b], Row(xa[b], s.to), Row(xa2[b], s.to));
+		}
+
+		for (int b = 0; b < 3; b++) {
+			if (s.rep) {
+				Copy(Row(xa2[b], s.post_from), Row(xa2[b], s.post_to), s.size);
+				Copy(Row(xa2[b], s.post_to), Row(x[b], s.post_to), s.size);
+			}
+			else {
+				Add(Row(xa2[b], s.post_to), Row(x[b], s.post_from), s.size);
+			}
+		}
+	}
+
+	// SC macro: the shared tail, evaluated once per distinct scatter rate channel.
+	void RunTail(int channel, float* out) {
+		float* a = xa[0];
+		float* b = xa[1];
+		float* c = xa[2];
+
+		Copy(Row(pool, POOL + POOL + 2), Row(srp, channel), 1);
+		Copy(a, comb, 120);
+		Dense<ReLU>(n.ggs, Row(pool, POOL + POOL), Row(a, 120));
+		Dense<ReLU>(n.fin1, pool, hidden);
+		Dense<Sigmoid>(n.fin2, hidden, weight);
+		const int seg_at[6] = { 0, 32, 64, 96, 104, 112 };
+		const int seg_size[6] = { 32, 32, 32, 8, 8, 8 };
+		for (int s = 0; s < 6; s++)
+			Scale(Row(a, seg_at[s]), Row(a, seg_at[s]), Row(weight, s), seg_size[s]);
+
+		Dense<ReLU>(n.c0, a, b);
+		Dense<ReLU>(n.c1, b, a);
+		Dense<ReLU>(n.c2, a, b);
+		Dense<ReLU>(n.x, b, a);
+		for (int r = 0; r < 6; r++) {
+			Dense<ReLU>(n.xres[r * 2], a, b);
+			Dense<ReLU>(n.xres[r * 2 + 1], b, c);
+			Add(a, c, 16);
+		}
+		Dense<ReLU>(n.out, a, out);
+	}
+
+	void Run(const MRPNNInput* in, int count, float3* out) {
+		for (int l = 0; l < B; l++) {
+			const MRPNNInput& s = in[min(l, count - 1)];
+			for (int i = 0; i < PC; i++) {
+				x[0][i * B + l] = s.density[i];
+				x[1][i * B + l] = s.transmittance[i];
+				x[2][i * B + l] = s.phase[i];
+			}
+			temp[6 * B + l] = s.g;
+			temp[7 * B + l] = s.gamma;
+			pool[(POOL + POOL) * B + l] = s.g;
+			pool[(POOL + POOL + 1) * B + l] = s.gamma;
+			srp[0 * B + l] = powf(s.scatterRate.x, 4.0f);
+			srp[1 * B + l] = powf(s.scatterRate.y, 4.0f);
+			srp[2 * B + l] = powf(s.scatterRate.z, 4.0f);
+		}
+
+		for (int i = 0; i < 8; i++)
+			RunStage(main_stages[i], n.l[i]);
+		Dense<ReLU>(n.l8, Row(xa2[0], 128), Row(comb, 0));
+		Dense<ReLU>(n.l8_tr, Row(xa2[1], 128), Row(comb, 32));
+		Dense<ReLU>(n.l8_hg, Row(xa2[2], 128), Row(comb, 64));
+
+		for (int i = 0; i < 4; i++)
+			RunStage(di_stages[i], n.ld[i]);
+		Dense<ReLU>(n.ld4, Row(xa2[0], 24), Row(comb, 96));
+		Dense<ReLU>(n.ld4_tr, Row(xa2[1], 24), Row(comb, 104));
+		Dense<ReLU>(n.ld4_hg, Row(xa2[2], 24), Row(comb, 112));
+
+		// Same reuse rule as the device: a channel equal to an earlier one is not re-run.
+		bool same_y = true, same_zx = true, same_zy = true;
+		for (int l = 0; l < count; l++) {
+			same_y = same_y && in[l].scatterRate.y == in[l].scatterRate.x;
+			same_zx = same_zx && in[l].scatterRate.z == in[l].scatterRate.x;
+			same_zy = same_zy && in[l].scatterRate.z == in[l].scatterRate.y;
+		}
+		RunTail(0, Row(result, 0));
+		if (same_y) Copy(Row(result, 1), Row(result, 0), 1);
+		else RunTail(1, Row(result, 1));
+		if (same_zx) Copy(Row(result, 2), Row(result, 0), 1);
+		else if (same_zy) Copy(Row(result, 2), Row(result, 1), 1);
+		else RunTail(2, Row(result, 2));
+
+		for (int c = 0; c < 3; c++) {
+			for (int k = 0; k < K; k++) {
+				float* r = Row(result, c) + k * W;
+				vfloat v = simd::max(simd::exp(simd::load(r)) - 1.0f, simd::set1(0.0f));
+				simd::store(r, v * simd::load(Row(srp, c) + k * W));
+			}
+		}
+		for (int l = 0; l < count; l++)
+			out[l] = float3{ result[l], result[B + l], result[2 * B + l] };
+	}
+};
+
+struct RPNNBatch {
+	const CPUNN::RPNNLayers& n;
+	Rows rows;
+	float* xa;
+	float* xb;
+	float* xc;
+
+	explicit RPNNBatch(const CPUNN::RPNNLayers& layers) : n(layers), rows(RPNN_STENCIL + 1 + 200 + 200) {
+		xa = rows.Take(RPNN_STENCIL + 1);
+		xb = rows.Take(200);
+		xc = rows.Take(200);
+	}
+
+	void Run(const RPNNInput* in, int count, float3* out) {
+		for (int l = 0; l < B; l++)
+			xa[RPNN_STENCIL * B + l] = in[min(l, count - 1)].gamma;
+
+		for (int level = 0; level < RPNN_LEVELS; level++) {
+			for (int l = 0; l < B; l++) {
+				const float* d = in[min(l, count - 1)].density + level * RPNN_STENCIL;
+				for (int i = 0; i < RPNN_STENCIL; i++)
+					xa[i * B + l] = d[i];
+			}
+			if (level == 0) {
+				Dense<ReLU>(n.v[0], xa, xb);
+				Dense<ReLU>(n.u[0], xb, xc);
+			}
+			else {
+				Dense<Identity>(n.v[level], xa, xb);
+				Dense<ReLU, true>(n.w[level], xc, xb);
+				Dense<ReLU, true>(n.u[level], xb, xc);
+			}
+		}
+		Dense<ReLU>(n.f0, xc, xb);
+		Dense<ReLU>(n.f1, xb, xc);
+		Dense<ReLU>(n.f2, xc, xb);
+
+		for (int k = 0; k < K; k++)
+			simd::store(xb + k * W, simd::max(simd::exp(simd::load(xb + k * W)) - 1.0f, simd::set1(0.0f)));
+		for (int l = 0; l < count; l++)
+			out[l] = float3{ xb[l], xb[l], xb[l] };
+	}
+};
+
+template<class Batch, class Layers, class Input>
+void RunBatches(const Layers& layers, const Input* input, int count, float3* output, int threads) {
+	int batch_num = (count + B - 1) / B;
+	if (batch_num == 0)
+		return;
+	if (threads <= 0)
+		threads = (int)thread::hardware_concurrency();
+	threads = max(1, min(threads, batch_num));
+
+	atomic<int> next_batch(0);
+	auto worker = [&]() {
+		Batch batch(layers);
+		int i;
+		while ((i = next_batch++) < batch_num)
+			batch.Run(input + i * B, min(B, count - i * B), output + i * B);
+	};
+
+	vector<thread> pool;
+	for (int i = 1; i < threads; i++)
+		pool.emplace_back(worker);
+	worker();
+	for (auto& t : pool)
+		t.join();
+}
+
+void RefDense(const CPUDense& l, const float* in, float* out, int readAt, int writeAt, Activation act) {
+	for (int i = 0; i < l.to; i++) {
+		float v = 0.0f;
+		for (int j = 0; j < l.from; j++)
+			v += in[j + readAt] * l.weight[j + i * l.from];
+		if (l.bias != nullptr)
+			v += l.bias[i];
+		out[i + writeAt] = ActivateScalar(v, act);
+	}
+}
+
+template<class F>
+double Seconds(F func) {
+	auto start_time = chrono::steady_clock::now();
+	func();
+	return chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+}
+
+float MaxRelativeError(const vector<float3>& a, const vector<float3>& ref, int count) {
+	float err = 0;
+	for (int i = 0; i < count; i++) {
+		float scale = max(fabsf(ref[i].x), 1e-3f);
+		err = max(err, fabsf(a[i].x - ref[i].x) / scale);
+		err = max(err, fabsf(a[i].y - ref[i].y) / max(fabsf(ref[i].y), 1e-3f));
+		err = max(err, fabsf(a[i].z - ref[i].z) / max(fabsf(ref[i].z), 1e-3f));
+	}
+	return err;
+}
+
+}
+
+CPUNN::CPUNN() {
+	char name[32];
+	bool ok = true;
+	const int l_size[8] = { 8, 8, 16, 16, 16, 32, 32, 32 };
+	for (int i = 0; i < 8; i++) {
+		SEBlock& b = mrpnn.l[i];
+		sprintf(name, "LSE%d1", i); ok &= PackMRPNN(b.se0, name, 8, 8, false);
+		sprintf(name, "LSE%d2", i); ok &= PackMRPNN(b.se1, name, 8, 3, false);
+		sprintf(name, "L%d1", i); ok &= PackMRPNN(b.main, name, l_size[i], l_size[i]);
+		sprintf(name, "L_Tr%d1", i); ok &= PackMRPNN(b.tr, name, l_size[i], l_size[i]);
+		sprintf(name, "L_Hg%d1", i); ok &= PackMRPNN(b.hg, name, l_size[i], l_size[i]);
+	}
+	ok &= PackMRPNN(mrpnn.l8, "L81", 32, 32);
+	ok &= PackMRPNN(mrpnn.l8_tr, "L_Tr81", 32, 32);
+	ok &= PackMRPNN(mrpnn.l8_hg, "L_Hg81", 32, 32);
+	for (int i = 0; i < 4; i++) {
+		SEBlock& b = mrpnn.ld[i];
+		sprintf(name, "LDSE%d1", i); ok &= PackMRPNN(b.se0, name, 8, 8, false);
+		sprintf(name, "LDSE%d2", i); ok &= PackMRPNN(b.se1, name, 8, 3, false);
+		sprintf(name, "LD%d1", i); ok &= PackMRPNN(b.main, name, 8, 8);
+		sprintf(name, "LD_Tr%d1", i); ok &= PackMRPNN(b.tr, name, 8, 8);
+		sprintf(name, "LD_Hg%d1", i); ok &= PackMRPNN(b.hg, name, 8, 8);
+	}
+	ok &= PackMRPNN(mrpnn.ld4, "LD41", 8, 8);
+	ok &= PackMRPNN(mrpnn.ld4_tr, "LD_Tr41", 8, 8);
+	ok &= PackMRPNN(mrpnn.ld4_hg, "LD_Hg41", 8, 8);
+	ok &= PackMRPNN(mrpnn.ggs, "LGGS", 3, 8);
+	ok &= PackMRPNN(mrpnn.fin1, "LSEFin1", POOL + POOL + 3, 16, false);
+	ok &= PackMRPNN(mrpnn.fin2, "LSEFin2", 16, 6, false);
+	ok &= PackMRPNN(mrpnn.c0, "LC0", 128, 128);
+	ok &= PackMRPNN(mrpnn.c1, "LC1", 128, 64);
+	ok &= PackMRPNN(mrpnn.c2, "LC2", 64, 32);
+	ok &= PackMRPNN(mrpnn.x, "LX", 32, 16);
+	for (int i = 0; i < 12; i++) {
+		sprintf(name, "LX%d", i); ok &= PackMRPNN(mrpnn.xres[i], name, 16, 16);
+	}
+	ok &= PackMRPNN(mrpnn.out, "LX12", 16, 1);
+	mrpnn_ready = ok;
+}
+
+CPUNN::~CPUNN() {
+	for (void* p : blocks)
+		AlignedFree(p);
+}
+
+bool CPUNN::Pack(CPUDense& l, const float* weight, const float* bias, int from, int to) {
+	if (weight == nullptr)
+		return false;
+	int panels = (to + 3) / 4;
+	l.from = from;
+	l.to = to;
+	l.weight = weight;
+	l.bias = bias;
+	l.packed = AlignedFloats((size_t)panels * from * 4);
+	l.packedBias = AlignedFloats(panels * 4);
+	blocks.push_back(l.packed);
+	blocks.push_back(l.packedBias);
+
+	for (int p = 0; p < panels; p++) {
+		for (int j = 0; j < from; j++) {
+			for (int o = 0; o < 4; o++) {
+				int i = p * 4 + o;
+				l.packed[(p * from + j) * 4 + o] = i < to ? weight[j + i * from] : 0.0f;
+			}
+		}
+	}
+	for (int i = 0; i < panels * 4; i++)
+		l.packedBias[i] = (bias != nullptr && i < to) ? bias[i] : 0.0f;
+	return true;
+}
+
+bool CPUNN::PackMRPNN(CPUDense& layer, const string& name, int from, int to, bool bias) {
+	const float* w = MRPNNHostWeight((name + "W").c_str(), from * to);
+	const float* b = bias ? MRPNNHostWeight((name + "B").c_str(), to) : nullptr;
+	if (bias && b == nullptr)
+		return false;
+	return Pack(layer, w, b, from, to);
+}
+
+bool CPUNN::LoadRPNN(string path) {
+	const int N = RPNN_STENCIL + 1;
+	const int H = 200;
+
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file.is_open()) {
+		printf("Failed to open RPNN weights: %s\n", path.c_str());
+		return false;
+	}
+	size_t expected = RPNN_LEVELS * N * H + (RPNN_LEVELS - 1) * (H * H + H) + RPNN_LEVELS * (H * H + H) + 2 * (H * H + H) + H + 1;
+	size_t bytes = (size_t)file.tellg();
+	if (bytes != expected * sizeof(float)) {
+		printf("RPNN weights %s: %zu bytes, expected %zu.\n", path.c_str(), bytes, expected * sizeof(float));
+		return false;
+	}
+	rpnn_data.resize(expected);
+	file.seekg(0);
+	file.read((char*)rpnn_data.data(), bytes);
+
+	const float* p = rpnn_data.data();
+	auto take = [&](int size) { const float* r = p; p += size; return r; };
+	for (int i = 0; i < RPNN_LEVELS; i++)
+		Pack(rpnn.v[i], take(N * H), nullptr, N, H);
+	for (int i = 1; i < RPNN_LEVELS; i++) {
+		const float* w = take(H * H);
+		Pack(rpnn.w[i], w, take(H), H, H);
+	}
+	for (int i = 0; i < RPNN_LEVELS; i++) {
+		const float* w = take(H * H);
+		Pack(rpnn.u[i], w, take(H), H, H);
+	}
+	const float* w = take(H * H);
+	Pack(rpnn.f0, w, take(H), H, H);
+	w = take(H * H);
+	Pack(rpnn.f1, w, take(H), H, H);
+	w = take(H);
+	Pack(rpnn.f2, w, take(1), H, 1);
+
+	rpnn_ready = true;
+	return true;
+}
+
+void CPUNN::PredictMRPNN(const MRPNNInput* input, int count, float3* output, int threads) const {
+	if (!mrpnn_ready) {
+		for (int i = 0; i < count; i++) output[i] = { 0, 0, 0 };
+		return;
+	}
+	RunBatches<MRPNNBatch>(mrpnn, input, count, output, threads);
+}
+
+void CPUNN::PredictRPNN(const RPNNInput* input, int count, float3* output, int threads) const {
+	// Matches the device stub when no weights are present.
+	if (!rpnn_ready) {
+		for (int i = 0; i < count; i++) output[i] = { 0, 0, 0 };
+		return;
+	}
+	RunBatches<RPNNBatch>(rpnn, input, count, output, threads);
+}
+
+float3 CPUNN::ReferenceMRPNN(const MRPNNInput& in) const {
+	if (!mrpnn_ready)
+		return { 0, 0, 0 };
+
+	const float* x[3] = { in.density, in.transmittance, in.phase };
+	float xa[3][160];
+	float xa2[3][160];
+	float pool[75];
+	float hidden[16];
+	float weight[6];
+	float temp[8];
+	float comb[128];
+
+	temp[6] = in.g;
+	temp[7] = in.gamma;
+	pool[POOL + POOL] = in.g;
+	pool[POOL + POOL + 1] = in.gamma;
+
+	auto stage = [&](const SEStage& s, const SEBlock& blk) {
+		for (int b = 0; b < 3; b++) {
+			float sum = 0, mx = -10000.0f;
+			for (int i = 0; i < s.size; i++) {
+				sum += x[b][s.from + i];
+				mx = max(mx, x[b][s.from + i]);
+			}
+			pool[s.pid + b] = sum / s.size;
+			pool[POOL + s.pid + b] = mx;
+		}
+		memcpy(temp, pool + s.pid, 3 * sizeof(float));
+		memcpy(temp + 3, pool + POOL + s.pid, 3 * sizeof(float));
+		RefDense(blk.se0, temp, hidden, 0, 0, ReLU);
+		RefDense(blk.se1, hidden, weight, 0, 0, Sigmoid);
+
+		const CPUDense* dense[3] = { &blk.main, &blk.tr, &blk.hg };
+		for (int b = 0; b < 3; b++) {
+			for (int i = 0; i < s.size; i++) {
+				xa[b][s.to + i] = x[b][s.from + i] * weight[b];
+				if (s.last >= 0)
+					xa[b][s.to + i] += xa2[b][s.last + i];
+			}
+			RefDense(*dense[b], xa[b], xa2[b], s.to, s.to, ReLU);
+		}
+		for (int b = 0; b < 3; b++) {
+			if (s.rep) {
+				memcpy(xa2[b] + s.post_from, xa2[b] + s.post_to, s.size * sizeof(float));
+				memcpy(xa2[b] + s.post_to, x[b] + s.post_to, s.size * sizeof(float));
+			}
+			else {
+				for (int i = 0; i < s.size; i++)
+					xa2[b][s.post_to + i] += x[b][s.post_from + i];
+			}
+		}
+	};
+
+	for (int i = 0; i < 8; i++)
+		stage(main_stages[i], mrpnn.l[i]);
+	RefDense(mrpnn.l8, xa2[0], comb, 128, 0, ReLU);
+	RefDense(mrpnn.l8_tr, xa2[1], comb, 128, 32, ReLU);
+	RefDense(mrpnn.l8_hg, xa2[2], comb, 128, 64, ReLU);
+	for (int i = 0; i < 4; i++)
+		stage(di_stages[i], mrpnn.ld[i]);
+	RefDense(mrpnn.ld4, xa2[0], comb, 24, 96, ReLU);
+	RefDense(mrpnn.ld4_tr, xa2[1], comb, 24, 104, ReLU);
+	RefDense(mrpnn.ld4_hg, xa2[2], comb, 24, 112, ReLU);
+
+	auto tail = [&](float scbase) {
+		float* a = xa[0];
+		float* b = xa[1];
+		float* c = xa[2];
+		pool[POOL + POOL + 2] = scbase;
+		memcpy(a, comb, 120 * sizeof(float));
+		RefDense(mrpnn.ggs, pool, a, POOL + POOL, 120, ReLU);
+		RefDense(mrpnn.fin1, pool, hidden, 0, 0, ReLU);
+		RefDense(mrpnn.fin2, hidden, weight, 0, 0, Sigmoid);
+		for (int i = 0; i < 120; i++)
+			a[i] *= weight[i < 96 ? i / 32 : 3 + (i - 96) / 8];
+		RefDense(mrpnn.c0, a, b, 0, 0, ReLU);
+		RefDense(mrpnn.c1, b, a, 0, 0, ReLU);
+		RefDense(mrpnn.c2, a, b, 0, 0, ReLU);
+		RefDense(mrpnn.x, b, a, 0, 0, ReLU);
+		for (int r = 0; r < 6; r++) {
+			RefDense(mrpnn.xres[r * 2], a, b, 0, 0, ReLU);
+			RefDense(mrpnn.xres[r * 2 + 1], b, c, 0, 0, ReLU);
+			for (int i = 0; i < 16; i++)
+				a[i] += c[i];
+		}
+		RefDense(mrpnn.out, a, b, 0, 0, ReLU);
+		return b[0];
+	};
+
+	float3 srp = pow(in.scatterRate, 4.0f);
+	float X, Y, Z;
+	X = tail(srp.x);
+	if (in.scatterRate.y == in.scatterRate.x) Y = X;
+	else Y = tail(srp.y);
+	if (in.scatterRate.z == in.scatterRate.x) Z = X;
+	else if (in.scatterRate.z == in.scatterRate.y) Z = Y;
+	else Z = tail(srp.z);
+
+	return float3{ max(expf(X) - 1.0f, 0.0f) * srp.x, max(expf(Y) - 1.0f, 0.0f) * srp.y, max(expf(Z) - 1.0f, 0.0f) * srp.z };
+}
+
+float3 CPUNN::ReferenceRPNN(const RPNNInput& in) const {
+	if (!rpnn_ready)
+		return { 0, 0, 0 };
+
+	float xa[RPNN_STENCIL + 1];
+	float xb[200];
+	float xc[200];
+	float xc2[200];
+
+	xa[RPNN_STENCIL] = in.gamma;
+	for (int level = 0; level < RPNN_LEVELS; level++) {
+		memcpy(xa, in.density + level * RPNN_STENCIL, RPNN_STENCIL * sizeof(float));
+		if (level == 0) {
+			RefDense(rpnn.v[0], xa, xb, 0, 0, ReLU);
+			RefDense(rpnn.u[0], xb, xc, 0, 0, ReLU);
+			continue;
+		}
+		RefDense(rpnn.v[level], xa, xb, 0, 0, Identity);
+		RefDense(rpnn.w[level], xc, xc2, 0, 0, Identity);
+		for (int i = 0; i < 200; i++)
+			xb[i] = ActivateScalar(xb[i] + xc2[i], ReLU);
+		RefDense(rpnn.u[level], xb, xc2, 0, 0, Identity);
+		for (int i = 0; i < 200; i++)
+			xc[i] = ActivateScalar(xc[i] + xc2[i], ReLU);
+	}
+	RefDense(rpnn.f0, xc, xc2, 0, 0, ReLU);
+	RefDense(rpnn.f1, xc2, xc, 0, 0, ReLU);
+	RefDense(rpnn.f2, xc, xc2, 0, 0, ReLU);
+
+	float output = max(expf(xc2[0]) - 1.0f, 0.0f);
+	return float3{ output, output, output };
+}
+
+void CPUNN::Benchmark(int count) const {
+	int threads = (int)thread::hardware_concurrency();
+	int ref_count = min(count, 1024);
+	printf("CPU NN benchmark (%s, %d lanes, batch %d, %d threads)\n", simd::Name(), W, B, threads);
+
+	mt19937 rng(350);
+	uniform_real_distribution<float> u01(0.0f, 1.0f);
+
+	if (mrpnn_ready) {
+		vector<MRPNNInput> input(count);
+		for (auto& s : input) {
+			for (int i = 0; i < PC; i++) {
+				s.density[i] = logf(1.0f + 4.0f * u01(rng));
+				s.transmittance[i] = u01(rng);
+				s.phase[i] = logf(1.0f + 0.5f * u01(rng));
+			}
+			s.g = 0.857f;
+			s.gamma = u01(rng) * 3.1415926f;
+			s.scatterRate = float3{ 1, 1, 1 };
+		}
+		vector<float3> ref(ref_count), out(count);
+
+		double t_ref = Seconds([&]() { for (int i = 0; i < ref_count; i++) ref[i] = ReferenceMRPNN(input[i]); });
+		double t_one = Seconds([&]() { PredictMRPNN(input.data(), count, out.data(), 1); });
+		double t_all = Seconds([&]() { PredictMRPNN(input.data(), count, out.data(), threads); });
+
+		double r_ref = ref_count / t_ref, r_one = count / t_one, r_all = count / t_all;
+		printf("  MRPNN scalar reference: %.0f predictions/s (1 thread)\n", r_ref);
+		printf("  MRPNN batched: %.0f predictions/s (1 thread, %.1fx), %.0f predictions/s (%d threads, %.1fx)\n", r_one, r_one / r_ref, r_all, threads, r_all / r_ref);
+		printf("  MRPNN max relative difference: %.2e\n", MaxRelativeError(out, ref, ref_count));
+	}
+	else {
+		printf("  MRPNN weights not available.\n");
+	}
+
+	if (rpnn_ready) {
+		vector<RPNNInput> input(count);
+		for (auto& s : input) {
+			for (int i = 0; i < RPNN_LEVELS * RPNN_STENCIL; i++)
+				s.density[i] = u01(rng) * 0.25f;
+			s.gamma = u01(rng) * 3.1415926f;
+		}
+		vector<float3> ref(ref_count), out(count);
+
+		double t_ref = Seconds([&]() { for (int i = 0; i < ref_count; i++) ref[i] = ReferenceRPNN(input[i]); });
+		double t_one = Seconds([&]() { PredictRPNN(input.data(), count, out.data(), 1); });
+		double t_all = Seconds([&]() { PredictRPNN(input.data(), count, out.data(), threads); });
+
+		double r_ref = ref_count / t_ref, r_one = count / t_one, r_all = count / t_all;
+		printf("  RPNN scalar reference: %.0f predictions/s (1 thread)\n", r_ref);
+		printf("  RPNN batched: %.0f predictions/s (1 thread, %.1fx), %.0f predictions/s (%d threads, %.1fx)\n", r_one, r_one / r_ref, r_all, threads, r_all / r_ref);
+		printf("  RPNN max relative difference: %.2e\n", MaxRelativeError(out, ref, ref_count));
+	}
+	else {
+		printf("  RPNN weights not loaded (LoadRPNN).\n");
+	}
+}
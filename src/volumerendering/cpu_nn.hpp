@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "vector.cuh"
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// Host inference for the radiance predictors in radiancePredict.cu. Features are gathered
+// by the caller exactly as RadiancePredict / RadiancePredict_RPNN gather them; the engine
+// only runs the networks, a SIMD batch of sample points at a time.
+
+#define MRPNN_SAMPLES 192
+#define RPNN_LEVELS 10
+#define RPNN_STENCIL 225
+
+struct MRPNNInput {
+	float density[MRPNN_SAMPLES];		// X_Val: log(1 + alpha * density / 64)
+	float transmittance[MRPNN_SAMPLES];	// X_Val_Sub: ShadowTerm_TRTex
+	float phase[MRPNN_SAMPLES];			// X_Val_Hg: log(hg + 1)
+	float g;
+	float gamma;						// acos(dot(XMain, LXMain))
+	float3 scatterRate;					// scatter_rate / 1.001
+};
+
+struct RPNNInput {
+	float density[RPNN_LEVELS * RPNN_STENCIL];	// density * alpha / 64, 5x5x9 stencil per level
+	float gamma;
+};
+
+// Host copy of an MRPNN table from NNWeight.cu (see NNWeight_host.cpp); nullptr if the
+// name is unknown or its size does not match.
+const float* MRPNNHostWeight(const char* name, int size);
+
+// One Linear layer, re-packed for the batch kernel: outputs are grouped in panels of 4
+// and each panel stores its weights input-major, so the inner loop reads one contiguous,
+// 64-byte aligned stream. Bias is zero for the *_Unbias layers.
+struct CPUDense {
+	int from = 0;
+	int to = 0;
+	const float* weight = nullptr;	// row-major [to][from], as on the device (scalar reference)
+	const float* bias = nullptr;
+	float* packed = nullptr;		// panel p: packed[(p * from + j) * 4 + o] = weight[j + (p * 4 + o) * from]
+	float* packedBias = nullptr;	// padded to a multiple of 4
+};
+
+class CPUNN {
+public:
+	CPUNN();
+	~CPUNN();
+	CPUNN(const CPUNN&) = delete;
+	CPUNN& operator=(const CPUNN&) = delete;
+
+	bool HasMRPNN() const { return mrpnn_ready; }
+	bool HasRPNN() const { return rpnn_ready; }
+
+	// Raw float32 dump of the NNWeight_RPNN.cuh tables in declaration order
+	// (V0W..V9W, W1W/B..W9W/B, U0W/B..U9W/B, F0W/B, F1W/B, F2W/B).
+	bool LoadRPNN(string path);
+
+	// Batched SIMD evaluation on `threads` cores (0 = all). Outputs match the networks'
+	// return value, i.e. before the single-scatter term and light colour are added.
+	void PredictMRPNN(const MRPNNInput* input, int count, float3* output, int threads = 0) const;
+	void PredictRPNN(const RPNNInput* input, int count, float3* output, int threads = 0) const;
+
+	// Scalar ports of the device loops, one sample at a time.
+	float3 ReferenceMRPNN(const MRPNNInput& input) const;
+	float3 ReferenceRPNN(const RPNNInput& input) const;
+
+	// Predictions/sec of the scalar reference vs the batch kernels on random features.
+	void Benchmark(int count = 8192) const;
+
+	struct SEBlock {
+		CPUDense se0, se1;	// 8 -> 8 ReLU, 8 -> 3 sigmoid
+		CPUDense main, tr, hg;
+	};
+
+	struct MRPNNLayers {
+		SEBlock l[8];
+		CPUDense l8, l8_tr, l8_hg;
+		SEBlock ld[4];
+		CPUDense ld4, ld4_tr, ld4_hg;
+		CPUDense ggs, fin1, fin2;
+		CPUDense c0, c1, c2, x;
+		CPUDense xres[12];
+		CPUDense out;
+	};
+
+	struct RPNNLayers {
+		CPUDense v[RPNN_LEVELS];
+		CPUDense w[RPNN_LEVELS];	// w[0] unused
+		CPUDense u[RPNN_LEVELS];
+		CPUDense f0, f1, f2;
+	};
+
+private:
+	bool mrpnn_ready = false;
+	bool rpnn_ready = false;
+	MRPNNLayers mrpnn;
+	RPNNLayers rpnn;
+	vector<float> rpnn_data;
+	vector<void*> blocks;
+
+	bool Pack(CPUDense& layer, const float* weight, const float* bias, int from, int to);
+	bool PackMRPNN(CPUDense& layer, const string& name, int from, int to, bool bias = true);
+};
@@ -0,0 +1,925 @@
+#include "cpu_render.hpp"
+#include "cpu_nn.hpp"
+#include "volume.hpp"
+#include "simd.hpp"
+#include "sparse_volume.hpp"
+#include "volume_stats.hpp"
+
+#include "platform.h"
+
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+// Host copy of the SphereRandom3 directions, pulled in with the CUDA qualifiers stripped
+// as NNWeight_host.cpp does for the weights.
+
+#pragma push_macro("__device__")
+#pragma push_macro("__constant__")
+#undef __device__
+#undef __constant__
+#define __device__
+#define __constant__
+
+namespace host_samples {
+#include "sphere_samples.cuh"
+}
+
+#pragma pop_macro("__constant__")
+#pragma pop_macro("__device__")
+
+// Host port of Tr / DeterminateNextVertex / CalculateRadiance in render.cu. Each worker
+// keeps simd::Width paths in flight; lanes whose path terminates are refilled from the
+// tile's remaining (item, sample) jobs so the packet stays full until the tile drains.
+
+namespace {
+
+using simd::vfloat;
+using simd::vint;
+using simd::vmask;
+
+const int W = simd::Width;
+
+inline int PopCount(unsigned bits) {
+	return (int)bitset<32>(bits).count();
+}
+
+float3 SkyBoxCPU(const CPUScene& s, float3 dir) {
+	if (s.hdri == nullptr || s.hdri->data == 0)
+		return { 0, 0, 0 };
+	float2 uv = float2{ atan2f(-dir.z, dir.x) * (float)(0.5 / 3.1415926) + 0.5f, acosf(fmaxf(fminf(dir.y, 1.0f), -1.0f)) * (float)(1.0 / 3.1415926) };
+	return s.hdri->Sample(uv) * s.hdriExp;
+}
+
+// tex3D with linear filtering on a res^3 x-major volume at uv = pos + 0.5, as the mip
+// textures are bound: border addressing reads 0 outside, clamp repeats the edge voxels.
+float SampleVolume(const float* v, int res, float3 pos, bool border) {
+	float cx = (pos.x + 0.5f) * res - 0.5f, cy = (pos.y + 0.5f) * res - 0.5f, cz = (pos.z + 0.5f) * res - 0.5f;
+	float fx = floorf(cx), fy = floorf(cy), fz = floorf(cz);
+	float wx = cx - fx, wy = cy - fy, wz = cz - fz;
+	int ix = (int)fx, iy = (int)fy, iz = (int)fz;
+	auto at = [&](int x, int y, int z) {
+		if (border) {
+			if (x < 0 || y < 0 || z < 0 || x >= res || y >= res || z >= res)
+				return 0.0f;
+		}
+		else {
+			x = min(max(x, 0), res - 1);
+			y = min(max(y, 0), res - 1);
+			z = min(max(z, 0), res - 1);
+		}
+		return v[((size_t)x * res + y) * res + z];
+	};
+	float c00 = lerp(at(ix, iy, iz), at(ix, iy, iz + 1), wz);
+	float c01 = lerp(at(ix, iy + 1, iz), at(ix, iy + 1, iz + 1), wz);
+	float c10 = lerp(at(ix + 1, iy, iz), at(ix + 1, iy, iz + 1), wz);
+	float c11 = lerp(at(ix + 1, iy + 1, iz), at(ix + 1, iy + 1, iz + 1), wz);
+	return lerp(lerp(c00, c01, wy), lerp(c10, c11, wy), wx);
+}
+
+// MipDensityDynamic / MipTrDynamic.
+float MipDensity(const CPUScene& s, int mip, float3 pos) {
+	if (mip < 0 || mip >= 9)
+		return 0.0f;
+	// Same border lookup; the mips hold no negatives for the sparse copy to clamp.
+	if (s.mips[mip] == nullptr)
+		return s.sparseMips[mip].Sample(pos + 0.5f);
+	return SampleVolume(s.mips[mip], 256 >> mip, pos, true);
+}
+
+float MipTr(const CPUScene& s, int mip, float3 pos) {
+	return mip >= 0 && mip < 8 ? SampleVolume(s.trMips[mip], 128 >> mip, pos, false) : 0.0f;
+}
+
+// ShadowTerm_TRTex: points outside the volume read the face the light enters it through.
+float ShadowTermTR(const CPUScene& s, float3 pos, float3 lightDir, int mip) {
+	if (pos.x < -0.5f || pos.y < -0.5f || pos.z < -0.5f || pos.x > 0.5f || pos.y > 0.5f || pos.z > 0.5f) {
+		float offset = RayBoxOffset(pos, lightDir);
+		return offset >= 0 ? MipTr(s, mip, pos + lightDir * offset) : 1.0f;
+	}
+	return MipTr(s, mip, pos);
+}
+
+// tex2D on _HGLut: linear, clamped, u = cos * 0.5 + 0.5, v = angle / 60 degrees.
+float SampleHGLut(const CPUScene& s, float u, float v) {
+	const int n = s.hgLutSize;
+	float cx = u * n - 0.5f, cy = v * n - 0.5f;
+	float fx = floorf(cx), fy = floorf(cy);
+	float wx = cx - fx, wy = cy - fy;
+	int x0 = min(max((int)fx, 0), n - 1), x1 = min(max((int)fx + 1, 0), n - 1);
+	int y0 = min(max((int)fy, 0), n - 1), y1 = min(max((int)fy + 1, 0), n - 1);
+	return lerp(lerp(s.hgLut[y0 * n + x0], s.hgLut[y0 * n + x1], wx), lerp(s.hgLut[y1 * n + x0], s.hgLut[y1 * n + x1], wx), wy);
+}
+
+float3 SphereSample(int index, float radius, const float3x3& basis) {
+	using namespace host_samples;
+	float3 local = { 0, 0, 0 };
+	if (index < 8) local = Spn0[index];
+	else if (index < 16) local = Spn1[index - 8];
+	else if (index < 32) local = Spn2[index - 16];
+	else if (index < 48) local = Spn3[index - 32];
+	else if (index < 64) local = Spn4[index - 48];
+	else if (index < 96) local = SpVn5[index - 64];
+	else if (index < 128) local = SpVn6[index - 96];
+	else if (index < 160) local = SpVn7[index - 128];
+	return (basis.x * local.x + basis.y * local.y + basis.z * local.z) * radius;
+}
+
+float Gamma(float3 dir, float3 lightDir) {
+	return acosf(fmaxf(fminf(dot(dir, lightDir), 1.0f), -1.0f));
+}
+
+// The sample loop of RadiancePredict; main is the view basis, main.x the view direction.
+void GatherMRPNN(const CPUScene& s, const CPURenderParams& p, float3 pos, const float3x3& main, MRPNNInput& in) {
+	int randIndex = 0;
+	for (int i = 0; i < MRPNN_SAMPLES; i++) {
+		Offset_Layer_ info = GetSamples23_(i);
+		info.Layer += 0.1f;
+		int layer = (int)info.Layer;
+		float3 sample = info.type >= 4 ? pos + SphereSample(randIndex++, info.Offset, main) : pos + p.lightDir * info.Offset;
+		in.density[i] = logf(1.0f + p.alpha * MipDensity(s, layer, sample) / 64.0f);
+
+		if (info.localindex == 0) {
+			in.phase[i] = logf(HenyeyGreenstein(dot(main.x, p.lightDir), p.g) + 1.0f);
+		}
+		else {
+			float3 msDir = normalize(sample - pos);
+			float radius = float(1 << layer) / 256.0f;
+			float v = atanf(0.5f * radius / info.Offset) / (3.1415926535f * 60.0f / 180.0f);
+			float hg0 = SampleHGLut(s, dot(main.x, msDir) * 0.5f + 0.5f, v);
+			float hg1 = SampleHGLut(s, dot(p.lightDir, msDir) * 0.5f + 0.5f, v);
+			in.phase[i] = logf(hg0 * hg1 + 1.0f);
+		}
+		in.transmittance[i] = ShadowTermTR(s, sample, p.lightDir, max(layer - 1, 0));
+	}
+	in.g = p.g;
+	in.gamma = Gamma(main.x, p.lightDir);
+	in.scatterRate = s.scatterRate / 1.001f;
+}
+
+// The stencil loop of RadiancePredict_RPNN: 5x5x9 samples per level in the light's frame.
+void GatherRPNN(const CPUScene& s, const CPURenderParams& p, float3 pos, const float3x3& main, RPNNInput& in) {
+	const float3 eX = normalize(cross(p.lightDir, main.x));
+	const float3 eY = normalize(cross(eX, p.lightDir));
+	float scale = 0.5f * (0.5f / 1024.0f);
+	float* out = in.density;
+	for (int level = 0; level < RPNN_LEVELS; level++) {
+		int mip = (int)(fmaxf(fminf(level - 2.0f, 9.0f), 0.0f) + 0.001f);
+		for (int z = -2; z <= 6; z++)
+			for (int y = -2; y <= 2; y++)
+				for (int x = -2; x <= 2; x++)
+					*out++ = MipDensity(s, mip, pos + (eX * x + eY * y + p.lightDir * z) * scale) * p.alpha / 64.0f;
+		scale *= 2.0f;
+	}
+	in.gamma = Gamma(main.x, p.lightDir);
+}
+
+// Unscrambled radical inverse; Fill_Hg's dimensions 0, 1, 2 and 4 are bases 2, 3, 5, 11.
+float RadicalInverse(unsigned int base, unsigned int a) {
+	const float invBase = 1.0f / base;
+	unsigned int reversed = 0;
+	float invBaseN = 1;
+	while (a) {
+		unsigned int next = a / base;
+		reversed = reversed * base + (a - next * base);
+		invBaseN *= invBase;
+		a = next;
+	}
+	return fminf(reversed * invBaseN, 0.99999994f);
+}
+
+// One texel of Fill_Hg: the phase function averaged over a ball of radius tan(angle) at
+// distance 1, with the same 1024-sample MIS estimator. The sequence is plain Halton with a
+// hashed per-texel rotation instead of the device's scrambled Halton and curand rotation,
+// so texels differ from the device LUT by its noise only.
+float FillHgTexel(int i, int j, float g) {
+	float costheta = ((i + 0.5f) / LUT_SIZE) * 2.0f - 1.0f;
+	float angle = ((j + 0.5f) / LUT_SIZE) * 3.1415926535f * 60.0f / 180.0f;
+
+	unsigned int h = (unsigned int)(j * LUT_SIZE + i) * 0x9E3779B9u;
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	float bn = (h >> 8) * (1.0f / 16777216.0f);
+
+	float hg = 0.0f;
+	float Radius = tanf(angle);
+	float3 ViewDir = float3{ 1.0f, 0.0f, 0.0f };
+	float3 Dir = float3{ costheta, sqrtf(1.0f - costheta * costheta), 0.0f };
+
+	float mis_coef = 0;
+	{
+		float p = Radius * Radius - 1 + Dir.x * Dir.x;
+		if (p > 0) {
+			float sdotl = g > 0 ? Dir.x : -Dir.x;
+			float w = sqrtf(p);
+			float d0 = fmaxf(0.0f, sdotl - w) / Radius;
+			float d1 = (sdotl + w) / Radius;
+			float d = d1 * d1 * d1 - d0 * d0 * d0;
+			mis_coef = (d1 > d0) * d;
+		}
+		mis_coef = fminf(fmaxf(mis_coef, 1e-8f), 1.0f);
+		float a = fabsf(g);
+		a = a < 0.6f ? 0 : (a < 0.7f ? (a - 0.6f) * 9 : (powf((a - 0.7f) / 0.3f, 0.05f) * 0.1f + 0.9f));
+		mis_coef = 1 - 1 / (1 + a * mis_coef / (1 - a));
+	}
+
+	for (unsigned int k = 0; k < 1024; k++) {
+		if (frac(RadicalInverse(11, k) + bn) < mis_coef) {
+			float3 rnd = frac(float3{ RadicalInverse(2, k), RadicalInverse(3, k), 0 } + bn);
+			float3 l = SampleHenyeyGreenstein(rnd.x, rnd.y, ViewDir, g);
+
+			float sdotl = dot(Dir, l);
+			float p = Radius * Radius - 1 + sdotl * sdotl;
+			if (p <= 0) continue;
+			float w = sqrtf(p);
+			float d0 = fmaxf(0.0f, sdotl - w) / Radius;
+			float d1 = (sdotl + w) / Radius;
+			float d = d1 * d1 * d1 - d0 * d0 * d0;
+			hg += fmaxf(0.0f, d / 4);
+		}
+		else {
+			float3 rnd = frac(float3{ RadicalInverse(2, k), RadicalInverse(3, k), RadicalInverse(5, k) } + bn);
+			float theta = rnd.x * 2.0f * 3.1415926535f;
+			float phi = acosf(2.0f * rnd.y - 1.0f);
+			float r = powf(rnd.z, 1 / 3.0f);
+			float3 RandomPoint = float3{ Radius * r * sinf(phi) * cosf(theta), Radius * r * sinf(phi) * sinf(theta), Radius * r * cosf(phi) } + Dir;
+			hg += HenyeyGreenstein(dot(normalize(RandomPoint), ViewDir), g);
+		}
+	}
+	return hg / 1024;
+}
+
+// Sample point of one NNPredict path, and its single-scatter term once traced.
+struct PredictPoint {
+	float3 pos;
+	float3 dir;
+	int item;
+	float single;
+};
+
+const int PREDICT_BATCH = 64;
+
+struct PacketTracer {
+	const CPUScene& s;
+	const CPURenderParams& p;
+	CPURenderStats stats;
+	simd::vrand rng;
+
+	float toVoxel, toVoxelOffset;
+	vfloat invMajorant, invMaxDensity;
+
+	PacketTracer(const CPUScene& scene, const CPURenderParams& params) : s(scene), p(params) {
+		toVoxel = s.resolution / s.scaleFactor;
+		toVoxelOffset = s.resolution * 0.5f - 0.5f;
+		invMajorant = simd::set1(1.0f / (s.maxDensity * p.alpha));
+		invMaxDensity = simd::set1(1.0f / s.maxDensity);
+	}
+
+	// Trilinear lookup into mips[0] (its sparse copy once VolumeRender has released it) with
+	// border addressing, matching Sample() in volume.cu.
+	vfloat Density(vfloat x, vfloat y, vfloat z, vmask m) {
+		const int res = s.resolution;
+		vfloat cx = simd::fmadd(x, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat cy = simd::fmadd(y, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat cz = simd::fmadd(z, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat fx = simd::floor(cx), fy = simd::floor(cy), fz = simd::floor(cz);
+		vfloat wx = cx - fx, wy = cy - fy, wz = cz - fz;
+		vint ix = simd::to_int(fx), iy = simd::to_int(fy), iz = simd::to_int(fz);
+
+		vmask x0 = m & (ix > -1) & (ix < res), x1 = m & (ix > -2) & (ix < res - 1);
+		vmask y0 = (iy > -1) & (iy < res), y1 = (iy > -2) & (iy < res - 1);
+		vmask z0 = (iz > -1) & (iz < res), z1 = (iz > -2) & (iz < res - 1);
+
+		vfloat c000, c001, c010, c011, c100, c101, c110, c111;
+		if (s.density != nullptr) {
+			vint base = (ix * res + iy) * res + iz;
+			vint dy = simd::set1i(res), dx = simd::set1i(res * res), dz = simd::set1i(1);
+
+			c000 = simd::gather(s.density, base, x0 & y0 & z0);
+			c001 = simd::gather(s.density, base + dz, x0 & y0 & z1);
+			c010 = simd::gather(s.density, base + dy, x0 & y1 & z0);
+			c011 = simd::gather(s.density, base + dy + dz, x0 & y1 & z1);
+			c100 = simd::gather(s.density, base + dx, x1 & y0 & z0);
+			c101 = simd::gather(s.density, base + dx + dz, x1 & y0 & z1);
+			c110 = simd::gather(s.density, base + dx + dy, x1 & y1 & z0);
+			c111 = simd::gather(s.density, base + dx + dy + dz, x1 & y1 & z1);
+		}
+		else {
+			vint jx = ix + 1, jy = iy + 1, jz = iz + 1;
+			c000 = SparseVoxel(ix, iy, iz, x0 & y0 & z0);
+			c001 = SparseVoxel(ix, iy, jz, x0 & y0 & z1);
+			c010 = SparseVoxel(ix, jy, iz, x0 & y1 & z0);
+			c011 = SparseVoxel(ix, jy, jz, x0 & y1 & z1);
+			c100 = SparseVoxel(jx, iy, iz, x1 & y0 & z0);
+			c101 = SparseVoxel(jx, iy, jz, x1 & y0 & z1);
+			c110 = SparseVoxel(jx, jy, iz, x1 & y1 & z0);
+			c111 = SparseVoxel(jx, jy, jz, x1 & y1 & z1);
+		}
+
+		vfloat c00 = simd::fmadd(c001 - c000, wz, c000);
+		vfloat c01 = simd::fmadd(c011 - c010, wz, c010);
+		vfloat c10 = simd::fmadd(c101 - c100, wz, c100);
+		vfloat c11 = simd::fmadd(c111 - c110, wz, c110);
+		vfloat c0 = simd::fmadd(c01 - c00, wy, c00);
+		vfloat c1 = simd::fmadd(c11 - c10, wy, c10);
+
+		stats.densityLookups += PopCount(simd::bits(m));
+		return simd::max(simd::set1(0.0f), simd::fmadd(c1 - c0, wx, c0));
+	}
+
+	// Voxel (x, y, z) of s.sparse, all in range where m is set: the leaf's offset, then the
+	// voxel inside it; empty leaves read 0 like the dense grid's empty space.
+	vfloat SparseVoxel(vint x, vint y, vint z, vmask m) {
+		const int dims = s.sparse->LeafDims();
+		const vint local_mask = simd::set1i(SPARSE_LEAF_SIZE - 1);
+		vint leaf = (simd::shr<SPARSE_LEAF_LOG2>(x) * dims + simd::shr<SPARSE_LEAF_LOG2>(y)) * dims + simd::shr<SPARSE_LEAF_LOG2>(z);
+		vint offset = simd::gatheri(s.sparse->LeafOffsets(), leaf, m);
+		vint local = simd::shl<2 * SPARSE_LEAF_LOG2>(x & local_mask) | simd::shl<SPARSE_LEAF_LOG2>(y & local_mask) | (z & local_mask);
+		return simd::gather(s.sparse->LeafData(), offset + local, m & (offset > -1));
+	}
+
+	// A tentative collision in a cell no lookup can see density in is a null collision;
+	// those lanes jump to where their ray next enters a supported cell (or to dis) and
+	// take no density sample this round. Returns the lanes that still need one.
+	vmask SkipEmpty(vfloat px, vfloat py, vfloat pz, vfloat dx, vfloat dy, vfloat dz, vfloat dis, vmask remain, vfloat& t) {
+		if (s.sparse == nullptr)
+			return remain;
+
+		// Support cell of each lane's tentative collision, gathered in one go; only lanes
+		// that land in an empty cell take the scalar skip.
+		vfloat ox = simd::fmadd(px, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat oy = simd::fmadd(py, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat oz = simd::fmadd(pz, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		const int dims = s.sparse->SupportDims();
+		vfloat top = simd::set1((float)(dims - 1));
+		auto cell = [&](vfloat o, vfloat d) {
+			vfloat c = simd::floor((simd::floor(simd::fmadd(d, t * toVoxel, o)) + 1.0f) * 0.125f);
+			return simd::to_int(simd::min(top, simd::max(simd::set1(0.0f), c)));
+		};
+		vint index = (cell(ox, dx) * dims + cell(oy, dy)) * dims + cell(oz, dz);
+		vmask empty = remain & (simd::gather(s.sparse->EmptyDistance(), index, remain) > 0.5f);
+		if (simd::none(empty))
+			return remain;
+
+		alignas(64) float vox[W], voy[W], voz[W], vx[W], vy[W], vz[W], tt[W], dd[W];
+		simd::store(vox, ox);
+		simd::store(voy, oy);
+		simd::store(voz, oz);
+		simd::store(vx, dx * toVoxel);
+		simd::store(vy, dy * toVoxel);
+		simd::store(vz, dz * toVoxel);
+		simd::store(tt, t);
+		simd::store(dd, dis);
+		unsigned lanes = simd::bits(empty);
+		unsigned moved = 0;
+		for (int l = 0; l < W; l++) {
+			if (!((lanes >> l) & 1)) continue;
+			float next = s.sparse->SkipEmpty(float3{ vox[l], voy[l], voz[l] }, float3{ vx[l], vy[l], vz[l] }, tt[l], dd[l]);
+			if (next > tt[l]) {
+				tt[l] = next;
+				moved |= 1u << l;
+			}
+		}
+		if (moved == 0)
+			return remain;
+		stats.emptySkips += PopCount(moved);
+		t = simd::load(tt);
+		return simd::andnot(remain, simd::from_bits(moved));
+	}
+
+	// Majorant (density units) of the brick each lane is in at t, and the t at which its
+	// ray leaves that brick; infinite towards a face of the volume, where the outermost
+	// bricks also cover the border lookups.
+	void LocalMajorant(vfloat ox, vfloat oy, vfloat oz, vfloat vx, vfloat vy, vfloat vz, vfloat t, vmask m, vfloat& majorant, vfloat& exit) {
+		const int dims = s.majorants->BrickDims();
+		const vfloat inf = simd::set1(INFINITY);
+		const vfloat top = simd::set1((float)(dims - 1));
+		const vfloat size = simd::set1((float)VOLUME_STATS_BRICK);
+		exit = inf;
+		auto axis = [&](vfloat o, vfloat v) {
+			vfloat c = simd::floor(simd::fmadd(v, t, o) * (1.0f / VOLUME_STATS_BRICK));
+			c = simd::min(top, simd::max(simd::set1(0.0f), c));
+			vmask up = v > 1e-12f, down = v < -1e-12f;
+			vfloat plane = simd::select(up, (c + 1.0f) * size, c * size);
+			vmask open = (up & (c < top)) | (down & (c > 0.5f));
+			exit = simd::min(exit, simd::select(open, (plane - o) / v, inf));
+			return simd::to_int(c);
+		};
+		vint ix = axis(ox, vx), iy = axis(oy, vy), iz = axis(oz, vz);
+		majorant = simd::gather(s.majorants->Majorants(), (ix * dims + iy) * dims + iz, m);
+	}
+
+	// One free-flight step for the lanes in remain (lanes past dis leave it). Against the
+	// global majorant the step is the GPU's; with a majorant grid it is sampled against the
+	// lane's brick, and a step that would leave the brick stops on its face instead, which
+	// the memoryless exponential allows, so the lane just takes no lookup this round.
+	// Returns the lanes that need a density lookup, and 1 / majorant for their accept test.
+	vmask FreeFlight(vfloat px, vfloat py, vfloat pz, vfloat dx, vfloat dy, vfloat dz, vfloat dis, float scale, vmask& remain, vfloat& t, vfloat& invDensity) {
+		stats.freeFlights += PopCount(simd::bits(remain));
+		vfloat rk = rng.rand01();
+		if (s.majorants == nullptr) {
+			t = simd::select(remain, t - simd::log(1.0f - rk) * invMajorant * scale, t);
+			remain = simd::andnot(remain, t > dis);
+			invDensity = invMaxDensity;
+			return SkipEmpty(px, py, pz, dx, dy, dz, dis, remain, t);
+		}
+
+		vfloat ox = simd::fmadd(px, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat oy = simd::fmadd(py, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat oz = simd::fmadd(pz, simd::set1(toVoxel), simd::set1(toVoxelOffset));
+		vfloat vx = dx * toVoxel, vy = dy * toVoxel, vz = dz * toVoxel;
+		vfloat majorant, exit;
+		LocalMajorant(ox, oy, oz, vx, vy, vz, t, remain, majorant, exit);
+
+		// Lanes in an empty brick jump straight to the next occupied leaf when there is one.
+		vmask empty = remain & (majorant < 1e-20f);
+		vmask moved = simd::none_mask();
+		if (simd::any(empty))
+			moved = simd::andnot(empty, SkipEmpty(px, py, pz, dx, dy, dz, dis, empty, t));
+		vmask step = simd::andnot(remain, moved);
+
+		vmask positive = majorant > 1e-20f;
+		vfloat flight = simd::select(positive, simd::log(1.0f - rk) * scale / (majorant * (-p.alpha)), simd::set1(INFINITY));
+		vfloat next = t + flight;
+		vmask inside = next < exit;
+		vfloat across = simd::max(exit, t) + simd::set1(1e-3f / toVoxel);
+		t = simd::select(step, simd::select(inside, next, across), t);
+		stats.brickCrossings += PopCount(simd::bits(simd::andnot(step, inside)));
+
+		remain = simd::andnot(remain, t > dis);
+		invDensity = simd::select(positive, simd::set1(1.0f) / majorant, simd::set1(0.0f));
+		return remain & step & inside;
+	}
+
+	// Delta tracking; returns the lanes that scattered, with the free-flight distance in t.
+	vmask NextVertex(vfloat px, vfloat py, vfloat pz, vfloat dx, vfloat dy, vfloat dz, vfloat dis, vmask active, vfloat& t) {
+		t = simd::set1(0.0f);
+		vmask remain = active;
+		vmask hit = simd::none_mask();
+		int loop_num = 0;
+		while (loop_num++ < 10000 && simd::any(remain)) {
+			vfloat invDensity;
+			vmask lookup = FreeFlight(px, py, pz, dx, dy, dz, dis, 1.0f, remain, t, invDensity);
+			if (simd::none(remain))
+				break;
+
+			vfloat density = Density(simd::fmadd(dx, t, px), simd::fmadd(dy, t, py), simd::fmadd(dz, t, pz), lookup);
+			vmask accept = lookup & (density * invDensity > rng.rand01());
+			hit = hit | accept;
+			remain = simd::andnot(remain, accept);
+		}
+		return hit | remain;
+	}
+
+	// Ratio tracking while tr > 0.5, delta tracking afterwards, as Tr() does on the GPU.
+	vfloat Transmittance(vfloat px, vfloat py, vfloat pz, vfloat dis, vmask active) {
+		vfloat dx = simd::set1(p.lightDir.x), dy = simd::set1(p.lightDir.y), dz = simd::set1(p.lightDir.z);
+		vfloat tr = simd::set1(1.0f);
+		vfloat t = simd::set1(0.0f);
+		vmask remain = active;
+		int loop_num = 0;
+		while (loop_num++ < 10000 && simd::any(remain)) {
+			vfloat invDensity;
+			vmask lookup = FreeFlight(px, py, pz, dx, dy, dz, dis, s.trScale, remain, t, invDensity);
+			if (simd::none(remain))
+				break;
+
+			vfloat ratio = Density(simd::fmadd(dx, t, px), simd::fmadd(dy, t, py), simd::fmadd(dz, t, pz), lookup) * invDensity;
+			vmask ratio_lanes = lookup & (tr > 0.5f);
+			tr = simd::select(ratio_lanes, tr * (1.0f - ratio), tr);
+
+			vmask absorbed = simd::andnot(lookup, ratio_lanes) & (rng.rand01() < ratio);
+			tr = simd::select(absorbed, simd::set1(0.0f), tr);
+			remain = simd::andnot(remain, absorbed) & (tr > 0.001f);
+		}
+		return tr;
+	}
+
+	void TraceTile(int begin, int end, const CPURayGen& gen, float3* result) {
+		alignas(64) float px[W], py[W], pz[W], dx[W], dy[W], dz[W], dis[W], tv[W];
+		alignas(64) float e0[W], e1[W];
+		float3 weight[W];
+		float phase[W];
+		int bounce[W], item[W];
+
+		int count = end - begin;
+		vector<float3> acc(count, float3{ 0, 0, 0 });
+
+		int jobs = count * p.sampleNum;
+		int next_job = 0;
+		unsigned active = 0;
+
+		const float3 lightDir = p.lightDir;
+
+		while (true) {
+			// Refill finished lanes.
+			for (int l = 0; l < W && next_job <= jobs; l++) {
+				if ((active >> l) & 1) continue;
+				while (next_job < jobs) {
+					int job = next_job++;
+					int it = job / p.sampleNum;
+
+					simd::store(e0, rng.rand01());
+					float3 ori, dir;
+					gen(begin + it, e0[0], e0[1], ori, dir);
+					dir = normalize(dir);
+					stats.paths++;
+					stats.primaryRays++;
+
+					float offset = RayBoxOffset(ori, dir, s.scaleFactor);
+					if (offset < 0) {
+						acc[it] = acc[it] + SkyBoxCPU(s, dir);
+						continue;
+					}
+					float3 start = ori + dir * offset;
+					px[l] = start.x; py[l] = start.y; pz[l] = start.z;
+					dx[l] = dir.x; dy[l] = dir.y; dz[l] = dir.z;
+					weight[l] = { 1, 1, 1 };
+					bounce[l] = 0;
+					item[l] = it;
+					active |= 1u << l;
+					break;
+				}
+			}
+			if (active == 0)
+				break;
+
+			for (int l = 0; l < W; l++) {
+				if ((active >> l) & 1) {
+					dis[l] = RayBoxDistance(float3{ px[l], py[l], pz[l] }, float3{ dx[l], dy[l], dz[l] }, s.scaleFactor);
+					if (bounce[l] > 0) stats.scatterRays++;
+				}
+				else {
+					px[l] = py[l] = pz[l] = 0;
+					dx[l] = 1; dy[l] = dz[l] = 0;
+					dis[l] = 0;
+				}
+			}
+
+			vfloat vpx = simd::load(px), vpy = simd::load(py), vpz = simd::load(pz);
+			vfloat vdx = simd::load(dx), vdy = simd::load(dy), vdz = simd::load(dz);
+			vfloat t;
+			unsigned hit = simd::bits(NextVertex(vpx, vpy, vpz, vdx, vdy, vdz, simd::load(dis), simd::from_bits(active), t)) & active;
+			simd::store(tv, t);
+
+			for (int l = 0; l < W; l++) {
+				if (!((active >> l) & 1)) continue;
+				float3 dir = { dx[l], dy[l], dz[l] };
+				if (!((hit >> l) & 1)) {
+					acc[item[l]] = acc[item[l]] + SkyBoxCPU(s, dir) * weight[l];
+					active &= ~(1u << l);
+					continue;
+				}
+				px[l] += dx[l] * tv[l]; py[l] += dy[l] * tv[l]; pz[l] += dz[l] * tv[l];
+				weight[l] = weight[l] * s.scatterRate;
+				dis[l] = RayBoxDistance(float3{ px[l], py[l], pz[l] }, lightDir, s.scaleFactor);
+				phase[l] = HenyeyGreenstein(dot(dir, lightDir), p.g);
+			}
+			if (hit == 0)
+				continue;
+
+			stats.shadowRays += PopCount(hit);
+			simd::store(tv, Transmittance(simd::load(px), simd::load(py), simd::load(pz), simd::load(dis), simd::from_bits(hit)));
+			simd::store(e0, rng.rand01());
+			simd::store(e1, rng.rand01());
+
+			for (int l = 0; l < W; l++) {
+				if (!((hit >> l) & 1)) continue;
+				acc[item[l]] = acc[item[l]] + p.lightColor * weight[l] * (tv[l] * phase[l]);
+
+				float3 next = SampleHenyeyGreenstein(e0[l], e1[l], float3{ dx[l], dy[l], dz[l] }, p.g);
+				dx[l] = next.x; dy[l] = next.y; dz[l] = next.z;
+				if (++bounce[l] >= p.multiScatter)
+					active &= ~(1u << l);
+			}
+		}
+
+		for (int i = 0; i < count; i++)
+			result[begin + i] = acc[i] / (float)p.sampleNum;
+	}
+
+	// GetMatrixFromNormal: v and two axes perpendicular to it at a random angle.
+	float3x3 RandomBasis(float3 v) {
+		alignas(64) float e0[W], e1[W];
+		while (true) {
+			simd::store(e0, rng.rand01());
+			simd::store(e1, rng.rand01());
+			for (int l = 0; l < W; l++) {
+				float3 r = UniformSampleSphere(float2{ e0[l], e1[l] });
+				if (fabsf(dot(r, v)) < 0.01f) continue;
+				float3 v2 = normalize(cross(v, r));
+				return float3x3(v, v2, cross(v2, v));
+			}
+		}
+	}
+
+	// NNPredict for outputs [begin, end): the camera rays find their sample points W at a
+	// time, the points take their shadow rays W at a time, then their features are gathered
+	// and predicted PREDICT_BATCH at a time on this thread.
+	void PredictTile(int begin, int end, const CPURayGen& gen, bool mrpnn, float3* result) {
+		alignas(64) float px[W], py[W], pz[W], dx[W], dy[W], dz[W], dis[W], tv[W];
+		alignas(64) float e0[W];
+		int item[W];
+
+		int count = end - begin;
+		vector<float3> acc(count, float3{ 0, 0, 0 });
+		vector<PredictPoint> points;
+
+		int jobs = count * p.sampleNum;
+		int next_job = 0;
+		while (next_job < jobs) {
+			unsigned active = 0;
+			int l = 0;
+			while (l < W && next_job < jobs) {
+				int it = next_job++ / p.sampleNum;
+
+				simd::store(e0, rng.rand01());
+				float3 ori, dir;
+				gen(begin + it, e0[0], e0[1], ori, dir);
+				dir = normalize(dir);
+				stats.paths++;
+				stats.primaryRays++;
+
+				float offset = RayBoxOffset(ori, dir, s.scaleFactor);
+				if (offset < 0) {
+					acc[it] = acc[it] + SkyBoxCPU(s, dir);
+					continue;
+				}
+				float3 start = ori + dir * offset;
+				px[l] = start.x; py[l] = start.y; pz[l] = start.z;
+				dx[l] = dir.x; dy[l] = dir.y; dz[l] = dir.z;
+				dis[l] = RayBoxDistance(start, dir, s.scaleFactor);
+				item[l] = it;
+				active |= 1u << l;
+				l++;
+			}
+			if (active == 0)
+				continue;
+			for (; l < W; l++) {
+				px[l] = py[l] = pz[l] = 0;
+				dx[l] = 1; dy[l] = dz[l] = 0;
+				dis[l] = 0;
+			}
+
+			vfloat t;
+			unsigned hit = simd::bits(NextVertex(simd::load(px), simd::load(py), simd::load(pz), simd::load(dx), simd::load(dy), simd::load(dz), simd::load(dis), simd::from_bits(active), t)) & active;
+			simd::store(tv, t);
+			for (l = 0; l < W; l++) {
+				if (!((active >> l) & 1)) continue;
+				float3 dir = { dx[l], dy[l], dz[l] };
+				if ((hit >> l) & 1)
+					points.push_back({ float3{ px[l] + dx[l] * tv[l], py[l] + dy[l] * tv[l], pz[l] + dz[l] * tv[l] }, dir, item[l], 0 });
+				else
+					acc[item[l]] = acc[item[l]] + SkyBoxCPU(s, dir);
+			}
+		}
+
+		for (size_t first = 0; first < points.size(); first += W) {
+			int n = (int)min((size_t)W, points.size() - first);
+			for (int l = 0; l < W; l++) {
+				float3 pos = l < n ? points[first + l].pos : float3{ 0, 0, 0 };
+				px[l] = pos.x; py[l] = pos.y; pz[l] = pos.z;
+				dis[l] = l < n ? RayBoxDistance(pos, p.lightDir, s.scaleFactor) : 0;
+			}
+			stats.shadowRays += n;
+			simd::store(tv, Transmittance(simd::load(px), simd::load(py), simd::load(pz), simd::load(dis), simd::from_bits((1u << n) - 1)));
+			for (int l = 0; l < n; l++) {
+				PredictPoint& point = points[first + l];
+				point.single = tv[l] * HenyeyGreenstein(dot(point.dir, p.lightDir), p.g);
+			}
+		}
+
+		vector<MRPNNInput> mrpnn_input(mrpnn ? PREDICT_BATCH : 0);
+		vector<RPNNInput> rpnn_input(mrpnn ? 0 : PREDICT_BATCH);
+		float3 predict[PREDICT_BATCH];
+		for (size_t first = 0; first < points.size(); first += PREDICT_BATCH) {
+			int n = (int)min((size_t)PREDICT_BATCH, points.size() - first);
+			for (int k = 0; k < n; k++) {
+				const PredictPoint& point = points[first + k];
+				float3x3 basis = RandomBasis(point.dir);
+				if (mrpnn)
+					GatherMRPNN(s, p, point.pos, basis, mrpnn_input[k]);
+				else
+					GatherRPNN(s, p, point.pos, basis, rpnn_input[k]);
+			}
+			if (mrpnn)
+				s.nn->PredictMRPNN(mrpnn_input.data(), n, predict, 1);
+			else
+				s.nn->PredictRPNN(rpnn_input.data(), n, predict, 1);
+			stats.predictions += n;
+
+			for (int k = 0; k < n; k++) {
+				const PredictPoint& point = points[first + k];
+				acc[point.item] = acc[point.item] + (predict[k] + point.single) * p.lightColor * s.scatterRate;
+			}
+		}
+
+		for (int i = 0; i < count; i++)
+			result[begin + i] = acc[i] / (float)p.sampleNum;
+	}
+};
+
+// Spreads [0, count) over all cores in tiles of tileSize; tile(tracer, begin, end) runs on
+// the worker's tracer, reseeded per tile so results do not depend on the schedule.
+template<class TileFunc>
+void RunTiles(const CPUScene& scene, const CPURenderParams& params, int count, int tileSize, CPURenderStats* stats, bool progress, const TileFunc& tile_func) {
+	int tile_num = (count + tileSize - 1) / tileSize;
+	int thread_num = max(1, min((int)thread::hardware_concurrency(), tile_num));
+
+	atomic<int> next_tile(0);
+	atomic<int> finished(0);
+	mutex stats_lock;
+	CPURenderStats total;
+	total.threads = thread_num;
+
+	auto worker = [&]() {
+		PacketTracer tracer(scene, params);
+		int tile;
+		while ((tile = next_tile++) < tile_num) {
+			tracer.rng.seed(params.seed * 7919u + (unsigned)tile);
+			tile_func(tracer, tile * tileSize, min(count, (tile + 1) * tileSize));
+			finished++;
+		}
+		lock_guard<mutex> lock(stats_lock);
+		total.paths += tracer.stats.paths;
+		total.primaryRays += tracer.stats.primaryRays;
+		total.scatterRays += tracer.stats.scatterRays;
+		total.shadowRays += tracer.stats.shadowRays;
+		total.densityLookups += tracer.stats.densityLookups;
+		total.emptySkips += tracer.stats.emptySkips;
+		total.freeFlights += tracer.stats.freeFlights;
+		total.brickCrossings += tracer.stats.brickCrossings;
+		total.predictions += tracer.stats.predictions;
+	};
+
+	auto start_time = chrono::steady_clock::now();
+
+	thread call_back;
+	if (progress) {
+		call_back = thread([&]() {
+			int value = 0;
+			do {
+				int value1 = finished;
+				if (value1 > value) {
+					printf("Rendering (CPU): %6.2f%%\n", value1 * 100.0f / tile_num);
+					value = value1;
+				}
+				wait(1000);
+			} while (value < tile_num);
+		});
+	}
+
+	vector<thread> pool;
+	for (int i = 1; i < thread_num; i++)
+		pool.emplace_back(worker);
+	worker();
+	for (auto& t : pool)
+		t.join();
+
+	if (progress)
+		call_back.join();
+
+	total.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	if (stats != nullptr)
+		*stats = total;
+}
+
+}
+
+const char* CPUSimdName() {
+	return simd::Name();
+}
+
+int CPUSimdWidth() {
+	return simd::Width;
+}
+
+void CPUTraceTiles(const CPUScene& scene, const CPURenderParams& params, int count, int tileSize, CPURayGen gen, float3* result, CPURenderStats* stats, bool progress) {
+	RunTiles(scene, params, count, tileSize, stats, progress, [&](PacketTracer& tracer, int begin, int end) {
+		tracer.TraceTile(begin, end, gen, result);
+	});
+}
+
+void CPUPredictTiles(const CPUScene& scene, const CPURenderParams& params, bool mrpnn, int count, int tileSize, CPURayGen gen, float3* result, CPURenderStats* stats, bool progress) {
+	RunTiles(scene, params, count, tileSize, stats, progress, [&](PacketTracer& tracer, int begin, int end) {
+		tracer.PredictTile(begin, end, gen, mrpnn, result);
+	});
+}
+
+CPUScene VolumeRender::GetCPUScene(float scaleFactor) {
+	return CPUScene{ mips[0], 256, max_density, tr_scale_host, scatter_rate_host, &hdri_img, hdri_exp, scaleFactor, sparse_mips[0].IsBuilt() ? &sparse_mips[0] : nullptr,
+		cpu_majorants && mip_stats.IsBuilt() ? &mip_stats : nullptr, mips, sparse_mips, tr_mips, hglut, LUT_SIZE, cpu_nn.get() };
+}
+
+void VolumeRender::UpdateHGLutCPU(float g) {
+	if (g == hginlut_host)
+		return;
+	ParallelFor(hglut, LUT_SIZE * LUT_SIZE, [&](int index) { return FillHgTexel(index % LUT_SIZE, index / LUT_SIZE, g); });
+	hginlut_host = g;
+}
+
+void VolumeRender::UpdateTRCPU(float3 lightDir, float alpha) {
+	// The sweep path of Update_TR, with its budget; it stops short of the device upload.
+	if (tr_sweep) {
+		Update_TR(lightDir, alpha, true);
+		return;
+	}
+	if (lightDir.x == tr_host_dir.x && lightDir.y == tr_host_dir.y && lightDir.z == tr_host_dir.z && alpha == tr_host_alpha)
+		return;
+	float level_alpha[8];
+	for (int tr_mip = 0; tr_mip < 8; tr_mip++)
+		level_alpha[tr_mip] = alpha / pow(1.73f, tr_mip + 1.0f);
+	tr_solver.Solve(lightDir, level_alpha, tr_mips);
+	tr_host_dir = lightDir;
+	tr_host_alpha = alpha;
+}
+
+bool VolumeRender::LoadRPNNWeights(string path) {
+	if (!cpu_nn)
+		cpu_nn.reset(new CPUNN());
+	return cpu_nn->LoadRPNN(path);
+}
+
+void VolumeRender::PrepareCPUPredict(RenderType rt, float3 lightDir, float alpha, float g) {
+	if (!cpu_nn)
+		cpu_nn.reset(new CPUNN());
+	if (rt == RenderType::RPNN) {
+		if (!cpu_nn->HasRPNN())
+			printf("RPNN weights not loaded (LoadRPNNWeights), the CPU predicts single scattering only.\n");
+		return;
+	}
+	UpdateHGLutCPU(g);
+	UpdateTRCPU(normalize(lightDir), alpha);
+}
+
+vector<float3> VolumeRender::GetRadiancesCPU(vector<float3> ori, vector<float3> dir, float3 lightDir, float3 lightColor, float alpha, int multiScatter, float g, int sampleNum, RenderType rt, CPURenderStats* stats) {
+	if (rt != RenderType::PT)
+		PrepareCPUPredict(rt, lightDir, alpha, g);
+	CPUScene scene = GetCPUScene(1);
+	CPURenderParams params = { normalize(lightDir), lightColor, alpha, multiScatter, g, sampleNum, (unsigned int)rand() };
+
+	vector<float3> res_cpu(ori.size());
+	auto gen = [&](int item, float, float, float3& o, float3& d) {
+		o = ori[item];
+		d = dir[item];
+	};
+	if (rt == RenderType::PT)
+		CPUTraceTiles(scene, params, (int)ori.size(), 64, gen, res_cpu.data(), stats, true);
+	else
+		CPUPredictTiles(scene, params, rt == RenderType::MRPNN, (int)ori.size(), 64, gen, res_cpu.data(), stats, true);
+
+	return res_cpu;
+}
+
+vector<float3> VolumeRender::RenderCPU(int2 size, float3 ori, float3 up, float3 right, float3 lightDir, float g, float alpha, float3 lightColor, int multiScatter, int sampleNum, RenderType rt, CPURenderStats* stats) {
+	if (rt != RenderType::PT)
+		PrepareCPUPredict(rt, lightDir, alpha, g);
+	CPUScene scene = GetCPUScene(1);
+	CPURenderParams params = { normalize(lightDir), lightColor, alpha, multiScatter, g, sampleNum, (unsigned int)rand() };
+
+	float3 forward = normalize(-ori);
+
+	vector<float3> res_cpu(size.x * size.y);
+	auto gen = [&](int item, float jx, float jy, float3& o, float3& d) {
+		int i = item / size.x;
+		int j = item % size.x;
+		float u = 1 - (j + jx) / size.x;
+		float v = 1 - (i + jy) / size.y;
+		o = ori;
+		d = forward + (right * (u * 2 - 1)) + (up * (v * 2 - 1));
+	};
+	if (rt == RenderType::PT)
+		CPUTraceTiles(scene, params, size.x * size.y, 64, gen, res_cpu.data(), stats);
+	else
+		CPUPredictTiles(scene, params, rt == RenderType::MRPNN, size.x * size.y, 64, gen, res_cpu.data(), stats);
+
+	return res_cpu;
+}
+
+void VolumeRender::BenchmarkCPU(int2 size, int multiScatter, int sampleNum) {
+	CPURenderStats stats;
+	RenderCPU(size, float3{ 0, 0, 1.2f }, float3{ 0, 0.5f, 0 }, float3{ 0.5f, 0, 0 }, float3{ 0.34f, 0.8f, 0.5f }, 0.857f, 1, float3{ 1, 1, 1 }, multiScatter, sampleNum, RenderType::PT, &stats);
+
+	double rays_per_sec = stats.Rays() / stats.seconds;
+	printf("CPU path tracer benchmark (%s, %d lanes, %d threads)\n", CPUSimdName(), CPUSimdWidth(), stats.threads);
+	printf("  %dx%d, %d spp, %d bounces: %.3f s\n", size.x, size.y, sampleNum, multiScatter, stats.seconds);
+	printf("  paths: %lld, rays: %lld (primary %lld, scatter %lld, shadow %lld)\n", stats.paths, stats.Rays(), stats.primaryRays, stats.scatterRays, stats.shadowRays);
+	printf("  %.3f Mrays/s total, %.3f Mrays/s per core, %.1f M density lookups/s\n", rays_per_sec * 1e-6, rays_per_sec * 1e-6 / stats.threads, stats.densityLookups / stats.seconds * 1e-6);
+	printf("  %lld empty-space skips (%s)\n", stats.emptySkips, sparse_mips[0].IsBuilt() ? "sparse volume" : "dense only");
+
+	// Same frame against the global majorant only, for the free-flight step count.
+	if (cpu_majorants && mip_stats.IsBuilt()) {
+		CPURenderStats global;
+		cpu_majorants = false;
+		RenderCPU(size, float3{ 0, 0, 1.2f }, float3{ 0, 0.5f, 0 }, float3{ 0.5f, 0, 0 }, float3{ 0.34f, 0.8f, 0.5f }, 0.857f, 1, float3{ 1, 1, 1 }, multiScatter, sampleNum, RenderType::PT, &global);
+		cpu_majorants = true;
+		double local_steps = (double)stats.freeFlights / stats.Rays(), global_steps = (double)global.freeFlights / global.Rays();
+		printf("  free-flight steps per ray: %.2f with %d^3 brick majorants (%.1f%% brick crossings), %.2f with the global one (%.3f s), %.1f%% fewer\n",
+			local_steps, mip_stats.BrickDims(), stats.brickCrossings * 100.0 / max(stats.freeFlights, 1LL), global_steps, global.seconds, (1 - local_steps / global_steps) * 100);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "vector.cuh"
+
+#include <functional>
+#include <vector>
+using namespace std;
+
+struct Image_host;
+class SparseVolume;
+class VolumeStats;
+class CPUNN;
+
+// Everything the host path tracer reads; filled by VolumeRender from its CPU-side copies.
+struct CPUScene {
+	const float* density;		// mips[0], x-major ((x * res) + y) * res + z; null when released (sparse only)
+	int resolution;
+	float maxDensity;
+	float trScale;
+	float3 scatterRate;
+	Image_host* hdri;
+	float hdriExp;
+	float scaleFactor;
+	const SparseVolume* sparse;	// sparse copy of mips[0] or null; skips empty space, and serves lookups when density is null
+	const VolumeStats* majorants;	// brick majorants of mips[0]; maxDensity everywhere when null
+
+	// Read by CPUPredictTiles only.
+	const float* const* mips;		// density mips 0..8, (256 >> l)^3
+	const SparseVolume* sparseMips;	// sparse copies of mips 0..8, read where mips[l] is null
+	const float* const* trMips;		// transmittance mips 0..7, (128 >> l)^3, at lightDir and alpha
+	const float* hgLut;				// hgLutSize^2 cone-averaged phase, [angle][cos], see Fill_Hg
+	int hgLutSize;
+	const CPUNN* nn;
+};
+
+struct CPURenderParams {
+	float3 lightDir;
+	float3 lightColor;
+	float alpha;
+	int multiScatter;
+	float g;
+	int sampleNum;
+	unsigned int seed;
+};
+
+struct CPURenderStats {
+	long long paths = 0;
+	long long primaryRays = 0;
+	long long scatterRays = 0;
+	long long shadowRays = 0;
+	long long densityLookups = 0;
+	long long emptySkips = 0;		// tentative collisions moved past empty cells
+	long long freeFlights = 0;		// delta / ratio tracking steps, all rays
+	long long brickCrossings = 0;	// steps cut short at a majorant brick boundary
+	long long predictions = 0;		// network evaluations (CPUPredictTiles)
+	int threads = 0;
+	double seconds = 0;
+
+	long long Rays() const { return primaryRays + scatterRays + shadowRays; }
+};
+
+// Builds the camera/task ray for output `item`; jx, jy are per-sample jitter in [0, 1).
+typedef function<void(int item, float jx, float jy, float3& ori, float3& dir)> CPURayGen;
+
+// Traces `count` outputs (each averaged over params.sampleNum paths) in tiles of `tileSize`
+// items spread over all cores. Results are written to result[item].
+void CPUTraceTiles(const CPUScene& scene, const CPURenderParams& params, int count, int tileSize, CPURayGen gen, float3* result, CPURenderStats* stats = nullptr, bool progress = false);
+
+// Same outputs through the radiance predictors, as NNPredict does: one free-flight sample
+// point per path, its features gathered as RadiancePredict (mrpnn) or RadiancePredict_RPNN
+// gather them, the network run by scene.nn a batch at a time, plus the single-scatter term.
+void CPUPredictTiles(const CPUScene& scene, const CPURenderParams& params, bool mrpnn, int count, int tileSize, CPURayGen gen, float3* result, CPURenderStats* stats = nullptr, bool progress = false);
+
+const char* CPUSimdName();
+int CPUSimdWidth();
@@ -0,0 +1,157 @@
+#include "env_sampler.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+const float PI = 3.14159265359f;
+
+inline float Luminance(float4 c) {
+	float l = 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+	return l > 0 ? l : 0;	// also drops NaNs
+}
+
+// Vose's alias method: out[i] keeps i with probability prob, else takes alias.
+template<class Alias>
+void BuildAlias(const float* weight, int n, double total, Alias* out) {
+	if (total <= 0) {
+		for (int i = 0; i < n; i++)
+			out[i] = { 1.0f, i };
+		return;
+	}
+	vector<double> scaled(n);
+	vector<int> small, large;
+	for (int i = 0; i < n; i++) {
+		scaled[i] = weight[i] * n / total;
+		(scaled[i] < 1 ? small : large).push_back(i);
+	}
+	while (!small.empty() && !large.empty()) {
+		int s = small.back(), l = large.back();
+		small.pop_back();
+		out[s] = { (float)scaled[s], l };
+		scaled[l] += scaled[s] - 1;
+		if (scaled[l] < 1) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// Whatever is left is 1 up to rounding.
+	for (int i : small)
+		out[i] = { 1.0f, i };
+	for (int i : large)
+		out[i] = { 1.0f, i };
+}
+
+// Picks an entry of an alias table and returns the leftover of u, again uniform in [0, 1).
+template<class Alias>
+int PickAlias(const Alias* table, int n, float u, float& rest) {
+	float scaled = u * n;
+	int i = min((int)scaled, n - 1);
+	float f = scaled - i;
+	const Alias& a = table[i];
+	if (f < a.prob) {
+		rest = f / a.prob;
+		return i;
+	}
+	rest = (f - a.prob) / max(1.0f - a.prob, 1e-20f);
+	return a.alias;
+}
+
+}
+
+float2 EnvSampler::DirToUV(float3 dir) {
+	return float2{ atan2f(-dir.z, dir.x) * (float)(0.5 / 3.1415926) + 0.5f, acosf(fmaxf(fminf(dir.y, 1.0f), -1.0f)) * (float)(1.0 / 3.1415926) };
+}
+
+float3 EnvSampler::UVToDir(float2 uv) {
+	float theta = uv.y * PI, phi = (uv.x - 0.5f) * 2 * PI;
+	float s = sinf(theta);
+	return float3{ s * cosf(phi), cosf(theta), -s * sinf(phi) };
+}
+
+void EnvSampler::Clear() {
+	width = height = 0;
+	rows.clear();
+	columns.clear();
+	density.clear();
+}
+
+bool EnvSampler::Build(const float4* pixels, int w, int h) {
+	auto start_time = chrono::steady_clock::now();
+	Clear();
+	if (pixels == nullptr || w <= 0 || h <= 0)
+		return false;
+
+	vector<float> lum((size_t)w * h);
+	parallel::parallel_for(h, [&](int y) {
+		for (int x = 0; x < w; x++)
+			lum[(size_t)y * w + x] = Luminance(pixels[(size_t)y * w + x]);
+	});
+
+	// Pixel weights (dilated luminance x sin(theta)) and the conditional table of every row.
+	vector<float> weight((size_t)w * h);
+	vector<float> row_weight(h);
+	columns.resize((size_t)w * h);
+	parallel::parallel_for(h, [&](int y) {
+		float sin_theta = sinf((y + 0.5f) / h * PI);
+		float* row = &weight[(size_t)y * w];
+		double sum = 0;
+		for (int x = 0; x < w; x++) {
+			float m = 0;
+			for (int dy = max(y - 1, 0); dy <= min(y + 1, h - 1); dy++) {
+				const float* l = &lum[(size_t)dy * w];
+				m = max(m, max(l[(x + w - 1) % w], max(l[x], l[(x + 1) % w])));
+			}
+			row[x] = m * sin_theta;
+			sum += row[x];
+		}
+		row_weight[y] = (float)sum;
+		BuildAlias(row, w, sum, &columns[(size_t)y * w]);
+	});
+
+	double total = 0;
+	for (float r : row_weight)
+		total += r;
+	if (!(total > 0)) {
+		printf("Environment map has no light to sample, falling back to uniform sampling\n");
+		return false;
+	}
+	rows.resize(h);
+	BuildAlias(row_weight.data(), h, total, rows.data());
+
+	density.resize((size_t)w * h);
+	float scale = (float)((double)w * h / total);
+	parallel::parallel_for(h, [&](int y) {
+		for (int x = 0; x < w; x++)
+			density[(size_t)y * w + x] = weight[(size_t)y * w + x] * scale;
+	});
+
+	width = w;
+	height = h;
+	seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	return true;
+}
+
+float3 EnvSampler::Sample(float2 u, float& pdf) const {
+	float jy, jx;
+	int y = PickAlias(rows.data(), height, u.y, jy);
+	int x = PickAlias(&columns[(size_t)y * width], width, u.x, jx);
+	float2 uv = { (x + jx) / width, (y + jy) / height };
+	float sin_theta = max(sinf(uv.y * PI), 1e-6f);
+	pdf = density[(size_t)y * width + x] / (2 * PI * PI * sin_theta);
+	return UVToDir(uv);
+}
+
+float EnvSampler::Pdf(float3 dir) const {
+	float2 uv = DirToUV(dir);
+	int x = max(0, min((int)(uv.x * width), width - 1));
+	int y = max(0, min((int)(uv.y * height), height - 1));
+	float sin_theta = max(sqrtf(max(0.0f, 1 - dir.y * dir.y)), 1e-6f);
+	return density[(size_t)y * width + x] / (2 * PI * PI * sin_theta);
+}
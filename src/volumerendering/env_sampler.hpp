@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "vector.cuh"
+
+#include <vector>
+using namespace std;
+
+// Importance sampling of an equirectangular environment map, in the mapping SkyBox uses:
+// u = atan2(-z, x) / 2pi + 0.5, v = acos(y) / pi.
+//
+// The map is a 2D piecewise-constant distribution over its pixels, weighted by luminance
+// times sin(theta), with Vose alias tables for the rows (marginal) and for the pixels of
+// every row (conditional), so a sample costs two table lookups. A pixel's weight is the
+// largest luminance of its 3x3 neighbourhood, so the pdf is non-zero wherever the bilinear
+// lookup of Image_host::Sample can be. Rows are built in parallel.
+
+class EnvSampler {
+public:
+	// pixels: width x height RGBA, row-major from v = 0 (+y). Fails on an all-black map.
+	bool Build(const float4* pixels, int width, int height);
+	void Clear();
+	bool IsBuilt() const { return width > 0; }
+	double Seconds() const { return seconds; }
+
+	// Direction for two uniform numbers in [0, 1), with its solid-angle pdf.
+	float3 Sample(float2 u, float& pdf) const;
+	// Solid-angle pdf of Sample() returning dir, for MIS weights.
+	float Pdf(float3 dir) const;
+
+	static float2 DirToUV(float3 dir);
+	static float3 UVToDir(float2 uv);
+
+private:
+	struct Alias {
+		float prob;
+		int alias;
+	};
+
+	int width = 0, height = 0;
+	double seconds = 0;
+	vector<Alias> rows;			// height entries
+	vector<Alias> columns;		// width x height, one table per row
+	vector<float> density;		// per pixel, pdf over the unit uv square
+};
@@ -0,0 +1,227 @@
+#include "hdr_image.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+using simd::vfloat;
+using simd::vint;
+
+const int W = simd::Width;
+const int ROWS_PER_TASK = 16;
+
+// Next header line of [p, end) without its '\n'; false at the end of the data.
+bool NextLine(const unsigned char*& p, const unsigned char* end, string& line) {
+	if (p >= end)
+		return false;
+	const unsigned char* eol = (const unsigned char*)memchr(p, '\n', end - p);
+	if (eol == nullptr)
+		return false;
+	line.assign((const char*)p, eol - p);
+	p = eol + 1;
+	return true;
+}
+
+bool ParseHeader(const unsigned char*& p, const unsigned char* end, int& width, int& height) {
+	string line;
+	if (!NextLine(p, end, line) || line.compare(0, 2, "#?") != 0)
+		return false;
+	// Variables up to the blank line, then the resolution string.
+	while (NextLine(p, end, line) && !line.empty()) {
+		if (line.compare(0, 7, "FORMAT=") == 0 && line.compare(7, 15, "32-bit_rle_rgbe") != 0 && line.compare(7, 15, "32-bit_rle_xyze") != 0)
+			return false;
+	}
+	if (!NextLine(p, end, line))
+		return false;
+	// The loader ignores the orientation flags as hdr_loader.h does.
+	size_t x = line.find('X'), y = line.find('Y');
+	if (x == string::npos || y == string::npos || x == 0 || y == 0)
+		return false;
+	width = atoi(line.c_str() + x + 1);
+	height = atoi(line.c_str() + y + 1);
+	return width > 0 && height > 0;
+}
+
+inline bool IsRLE(const unsigned char* p, const unsigned char* end, int width) {
+	return width >= 8 && width <= 0x7fff && end - p >= 4 && p[0] == 2 && p[1] == 2 && !(p[2] & 128);
+}
+
+// Bytes taken by the scanline at p, reading only run headers; 0 if it is malformed.
+size_t ScanlineBytes(const unsigned char* p, const unsigned char* end, int width) {
+	if (!IsRLE(p, end, width))
+		return end - p >= (ptrdiff_t)width * 4 ? (size_t)width * 4 : 0;
+	if ((p[2] << 8 | p[3]) != width)
+		return 0;
+	const unsigned char* q = p + 4;
+	for (int c = 0; c < 4; c++) {
+		for (int pos = 0; pos < width;) {
+			if (q >= end)
+				return 0;
+			int num = *q;
+			if (num > 128) {
+				pos += num & 127;
+				q += 2;
+			}
+			else if (num > 0) {
+				pos += num;
+				q += 1 + num;
+			}
+			else
+				return 0;
+			if (pos > width)
+				return 0;
+		}
+	}
+	return q <= end ? q - p : 0;
+}
+
+// Scanline into packed RGBE (byte 0 red, byte 3 exponent), already validated.
+void DecodeScanline(const unsigned char* p, int width, uint32_t* rgbe) {
+	if (!IsRLE(p, p + 4, width)) {
+		memcpy(rgbe, p, (size_t)width * 4);
+		return;
+	}
+	unsigned char* out = (unsigned char*)rgbe;
+	const unsigned char* q = p + 4;
+	for (int c = 0; c < 4; c++) {
+		for (int pos = 0; pos < width;) {
+			int num = *q++;
+			if (num > 128) {
+				num &= 127;
+				unsigned char value = *q++;
+				for (int j = 0; j < num; j++)
+					out[(pos + j) * 4 + c] = value;
+			}
+			else {
+				for (int j = 0; j < num; j++)
+					out[(pos + j) * 4 + c] = q[j];
+				q += num;
+			}
+			pos += num;
+		}
+	}
+}
+
+// (mantissa + 0.5) * 2^(e - 136), the exponent bits masked as hdr_rgbe_to_color does.
+inline float ToFloat(uint32_t rgbe, int channel) {
+	uint32_t e = rgbe >> 24;
+	if (e == 0)
+		return 0;
+	uint32_t bits = ((e - 9) << 23) & 0x7f800000;
+	float scale;
+	memcpy(&scale, &bits, 4);
+	return ((float)((rgbe >> (channel * 8)) & 0xff) + 0.5f) * scale;
+}
+
+void ConvertScanline(const uint32_t* rgbe, int width, float4* out) {
+	alignas(64) float r[W], g[W], b[W];
+	const vint byte = simd::set1i(0xff);
+	int x = 0;
+	for (; x + W <= width; x += W) {
+		vint v = simd::loadi((const int*)rgbe + x);
+		vint e = simd::shr<24>(v);
+		vfloat scale = simd::as_float(simd::shl<23>(e - simd::set1i(9)) & simd::set1i(0x7f800000));
+		scale = simd::select(e < 1, simd::set1(0.0f), scale);
+		simd::store(r, (simd::to_float(v & byte) + 0.5f) * scale);
+		simd::store(g, (simd::to_float(simd::shr<8>(v) & byte) + 0.5f) * scale);
+		simd::store(b, (simd::to_float(simd::shr<16>(v) & byte) + 0.5f) * scale);
+		for (int l = 0; l < W; l++)
+			out[x + l] = float4{ r[l], g[l], b[l], 0 };
+	}
+	for (; x < width; x++)
+		out[x] = float4{ ToFloat(rgbe[x], 0), ToFloat(rgbe[x], 1), ToFloat(rgbe[x], 2), 0 };
+}
+
+// FNV-1a over 8-byte words, then the tail bytes and the size.
+uint64_t HashBytes(const unsigned char* data, size_t bytes) {
+	const uint64_t prime = 0x100000001b3ull;
+	uint64_t h = 0xcbf29ce484222325ull;
+	size_t i = 0;
+	for (; i + 8 <= bytes; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h = (h ^ word) * prime;
+	}
+	for (; i < bytes; i++)
+		h = (h ^ data[i]) * prime;
+	return (h ^ bytes) * prime;
+}
+
+}
+
+bool DecodeHDR(const unsigned char* data, size_t bytes, HDRImage& image) {
+	const unsigned char* p = data;
+	const unsigned char* end = data + bytes;
+	int width, height;
+	if (!ParseHeader(p, end, width, height))
+		return false;
+
+	vector<size_t> starts(height);
+	for (int y = 0; y < height; y++) {
+		size_t length = ScanlineBytes(p, end, width);
+		if (length == 0)
+			return false;
+		starts[y] = p - data;
+		p += length;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height);
+	int groups = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+	parallel::parallel_for(groups, [&](int group) {
+		vector<uint32_t> rgbe(width);
+		int y1 = min(height, (group + 1) * ROWS_PER_TASK);
+		for (int y = group * ROWS_PER_TASK; y < y1; y++) {
+			DecodeScanline(data + starts[y], width, rgbe.data());
+			ConvertScanline(rgbe.data(), width, &image.pixels[(size_t)y * width]);
+		}
+	});
+	return true;
+}
+
+shared_ptr<const HDRImage> LoadHDRCached(const string& path) {
+	static mutex cache_lock;
+	static list<pair<uint64_t, shared_ptr<const HDRImage>>> cache;		// most recent first
+
+	auto start_time = chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.Open(path))
+		return nullptr;
+	uint64_t key = HashBytes(file.Data(), file.Size());
+	{
+		lock_guard<mutex> lock(cache_lock);
+		for (auto it = cache.begin(); it != cache.end(); ++it) {
+			if (it->first == key) {
+				cache.splice(cache.begin(), cache, it);
+				return it->second;
+			}
+		}
+	}
+
+	shared_ptr<HDRImage> image = make_shared<HDRImage>();
+	if (!DecodeHDR(file.Data(), file.Size(), *image)) {
+		printf("Failed to decode %s\n", path.c_str());
+		return nullptr;
+	}
+	double decode_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	image->sampler.Build(image->pixels.data(), image->width, image->height);
+	printf("Loaded %s: %dx%d, decoded in %.3f s, sampling table %.3f s\n", path.c_str(), image->width, image->height, decode_seconds, image->sampler.Seconds());
+
+	lock_guard<mutex> lock(cache_lock);
+	cache.emplace_front(key, image);
+	if (cache.size() > HDR_CACHE_ENTRIES)
+		cache.pop_back();
+	return image;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "env_sampler.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Radiance .hdr (RGBE) environment maps, decoded from a mapped file: one serial pass finds
+// where every scanline starts (only run headers are read), then groups of scanlines are
+// run-length decoded and converted to float with SIMD in parallel. Produces the same
+// pixels as load_hdr_float4 in hdr_loader.h (alpha 0).
+
+struct HDRImage {
+	int width = 0, height = 0;
+	vector<float4> pixels;		// row-major, first scanline (v = 0) first
+	EnvSampler sampler;			// built by LoadHDRCached
+};
+
+// Fails on anything that is not a complete RGBE / XYZE image.
+bool DecodeHDR(const unsigned char* data, size_t bytes, HDRImage& image);
+
+// Decoded image and sampling table for the file at path, from a process-wide cache keyed by
+// a hash of the file's contents, so switching back to a map skips decoding and the table
+// build. Holds the last HDR_CACHE_ENTRIES maps. Null when the file cannot be read.
+#define HDR_CACHE_ENTRIES 6
+shared_ptr<const HDRImage> LoadHDRCached(const string& path);
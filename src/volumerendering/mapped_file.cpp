@@ -0,0 +1,76 @@
+#include "mapped_file.hpp"
+
+#if LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const string& path) {
+	Close();
+
+#if LINUX
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+	file_handle = fd;
+	bytes = (size_t)st.st_size;
+#else
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (view == NULL) {
+		if (mapping != NULL) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	file_handle = (intptr_t)file;
+	map_handle = (intptr_t)mapping;
+	bytes = (size_t)size.QuadPart;
+#endif
+	data = (const unsigned char*)view;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data == nullptr)
+		return;
+#if LINUX
+	munmap((void*)data, bytes);
+	close((int)file_handle);
+#else
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)map_handle);
+	CloseHandle((HANDLE)file_handle);
+#endif
+	data = nullptr;
+	bytes = 0;
+	file_handle = -1;
+	map_handle = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile). Pages are only
+// read from disk when first touched.
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Fails for missing or empty files.
+	bool Open(const string& path);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return bytes; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t bytes = 0;
+	intptr_t file_handle = -1;
+	intptr_t map_handle = 0;
+};
@@ -0,0 +1,273 @@
+#include "mip_builder.hpp"
+#include "simd.hpp"
+
+#include "vector.cuh"
+#include "omp.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using simd::vfloat;
+
+const int W = simd::Width;
+const int BRICK = 32;	// mip 0 voxels per brick edge; mip 5 is one voxel per brick
+
+// max(0.0f, v) as Sample() applies it, NaN included.
+inline float Clamp0(float v) {
+	return v > 0 ? v : 0.0f;
+}
+
+// lerp(a, b, 0.5f) is a * 0.5f + b * 0.5f; both products are exact, so this rounds the
+// same way with or without FMA contraction.
+inline float Half(float a, float b) {
+	return a * 0.5f + b * 0.5f;
+}
+
+// One output row of n voxels from the four source rows of a 2x2 (x, y) block.
+void DownsampleRow(const float* r00, const float* r01, const float* r10, const float* r11, float* out, int n) {
+	const vfloat half = simd::set1(0.5f), zero = simd::set1(0.0f);
+	auto pairs = [&](const float* r, int z) {
+		vfloat a = simd::max(simd::load(r + 2 * z), zero);
+		vfloat b = simd::max(simd::load(r + 2 * z + W), zero);
+		return simd::pair_add(a * half, b * half);
+	};
+	int z = 0;
+	for (; z + W <= n; z += W) {
+		vfloat y0 = pairs(r00, z) * half + pairs(r01, z) * half;
+		vfloat y1 = pairs(r10, z) * half + pairs(r11, z) * half;
+		simd::store(out + z, y0 * half + y1 * half);
+	}
+	for (; z < n; z++) {
+		float y0 = Half(Half(Clamp0(r00[2 * z]), Clamp0(r00[2 * z + 1])), Half(Clamp0(r01[2 * z]), Clamp0(r01[2 * z + 1])));
+		float y1 = Half(Half(Clamp0(r10[2 * z]), Clamp0(r10[2 * z + 1])), Half(Clamp0(r11[2 * z]), Clamp0(r11[2 * z + 1])));
+		out[z] = Half(y0, y1);
+	}
+}
+
+void CopyRow(const float* src, float* out, int n) {
+	const vfloat zero = simd::set1(0.0f);
+	int z = 0;
+	for (; z + W <= n; z += W)
+		simd::store(out + z, simd::max(simd::load(src + z), zero));
+	for (; z < n; z++)
+		out[z] = Clamp0(src[z]);
+}
+
+// Rows [x0, x0 + n) x [y0, y0 + n), z from z0, of the level below `res` into the level
+// at `res`.
+void DownsampleBlock(const float* src, int res, float* dst, int x0, int y0, int z0, int n) {
+	int src_res = res * 2;
+	for (int x = x0; x < x0 + n; x++) {
+		for (int y = y0; y < y0 + n; y++) {
+			const float* r00 = src + ((size_t)(2 * x) * src_res + 2 * y) * src_res + 2 * z0;
+			const float* r10 = r00 + (size_t)src_res * src_res;
+			DownsampleRow(r00, r00 + src_res, r10, r10 + src_res, dst + ((size_t)x * res + y) * res + z0, n);
+		}
+	}
+}
+
+// Sample() from volume.cu at the voxel centres of a res^3 target is separable: per axis,
+// voxel i reads source voxels low[i] and low[i] + 1 (0 outside) with these lerp weights.
+// Lerping along z, then y, then x is exactly the nested lerps Sample() does, in its order.
+struct AxisTaps {
+	vector<int> low;
+	vector<float> w, w1;	// w and 1 - w, as lerp() forms them
+};
+
+AxisTaps MakeTaps(int src_res, int res) {
+	AxisTaps taps;
+	for (int i = 0; i < res; i++) {
+		float uv = (i + 0.5) / res;
+		float pos = uv * src_res - 0.5f;
+		int low = floor(pos);
+		float w = pos - low;
+		taps.low.push_back(low);
+		taps.w.push_back(w);
+		taps.w1.push_back(float(1) - w);
+	}
+	return taps;
+}
+
+// lerp() is a * (1 - w) + b * w, which the compiler may contract into an FMA on either
+// product. The vector loops round it the way lerp() was built, found once by probing it.
+enum LerpForm { LERP_SEPARATE, LERP_FUSE_A, LERP_FUSE_B };
+
+LerpForm FindLerpForm() {
+	// (volatile, so the probes are not folded at compile time, before any contraction)
+	// operands on which only fusing a * (1 - w), or only fusing b * w, changes the result
+	volatile float a1 = 0x1.55d556p-2f, b1 = 0x1.664666p-1f, w1 = 0x1.335334p-2f;
+	volatile float a2 = 0x1.565556p-2f, b2 = 0x1.662666p-1f, w2 = 0x1.337334p-2f;
+	auto separate = [](float a, float b, float w) { return fmaf(a, float(1) - w, 0.0f) + fmaf(b, w, 0.0f); };
+	if (lerp(a1, b1, w1) != separate(a1, b1, w1))
+		return LERP_FUSE_A;
+	if (lerp(a2, b2, w2) != separate(a2, b2, w2))
+		return LERP_FUSE_B;
+	return LERP_SEPARATE;
+}
+
+// Every product rounded on its own (fmadd with 0 adds nothing to these non-negative
+// values) unless the form fuses it, so nothing is left for the compiler to contract.
+template<LerpForm F>
+inline vfloat Lerp(vfloat a, vfloat b, vfloat w, vfloat w1) {
+	const vfloat zero = simd::set1(0.0f);
+	if (F == LERP_FUSE_A)
+		return simd::fmadd(a, w1, simd::fmadd(b, w, zero));
+	if (F == LERP_FUSE_B)
+		return simd::fmadd(b, w, simd::fmadd(a, w1, zero));
+	return simd::fmadd(a, w1, zero) + simd::fmadd(b, w, zero);
+}
+
+// One source row resampled along z into n voxels.
+template<LerpForm F>
+void ResampleRow(const float* row, int src_res, const AxisTaps& taps, float* out, int n) {
+	const vfloat zero = simd::set1(0.0f);
+	int z = 0;
+	for (; z + W <= n; z += W) {
+		simd::vint low = simd::loadi(taps.low.data() + z), high = low + 1;
+		vfloat a = simd::max(simd::gather(row, low, (low > -1) & (low < src_res)), zero);
+		vfloat b = simd::max(simd::gather(row, high, high < src_res), zero);
+		simd::store(out + z, Lerp<F>(a, b, simd::load(taps.w.data() + z), simd::load(taps.w1.data() + z)));
+	}
+	for (; z < n; z++) {
+		int low = taps.low[z];
+		float a = low >= 0 ? Clamp0(row[low]) : 0.0f;
+		float b = low + 1 < src_res ? Clamp0(row[low + 1]) : 0.0f;
+		out[z] = lerp(a, b, taps.w[z]);
+	}
+}
+
+// out = lerp(a, b, w) over n voxels.
+template<LerpForm F>
+void LerpRows(const float* a, const float* b, float w, float w1, float* out, size_t n) {
+	const vfloat vw = simd::set1(w), vw1 = simd::set1(w1);
+	size_t i = 0;
+	for (; i + W <= n; i += W)
+		simd::store(out + i, Lerp<F>(simd::load(a + i), simd::load(b + i), vw, vw1));
+	for (; i < n; i++)
+		out[i] = lerp(a[i], b[i], w);
+}
+
+// Source plane x resampled along z and y into res^2 voxels; zeros outside the source.
+template<LerpForm F>
+void ResamplePlane(const float* src, int src_res, int x, const AxisTaps& taps, int res, vector<float>& rows, float* plane) {
+	if (x < 0 || x >= src_res) {
+		fill_n(plane, (size_t)res * res, 0.0f);
+		return;
+	}
+	rows.resize((size_t)(src_res + 1) * res);
+	for (int y = 0; y < src_res; y++)
+		ResampleRow<F>(src + ((size_t)x * src_res + y) * src_res, src_res, taps, rows.data() + (size_t)y * res, res);
+	// row src_res is the zeros a lookup past either end reads
+	fill_n(rows.data() + (size_t)src_res * res, res, 0.0f);
+	for (int y = 0; y < res; y++) {
+		int low = taps.low[y];
+		const float* a = rows.data() + (size_t)(low >= 0 ? low : src_res) * res;
+		const float* b = rows.data() + (size_t)(low + 1) * res;
+		LerpRows<F>(a, b, taps.w[y], taps.w1[y], plane + (size_t)y * res, res);
+	}
+}
+
+// A block of output planes at a time, each the x lerp of two resampled source planes, which
+// neighbouring outputs share.
+template<LerpForm F>
+void ResampleSeparable(const float* src, int src_res, float* dst, int res) {
+	const AxisTaps taps = MakeTaps(src_res, res);
+	const int block = 8;
+	size_t area = (size_t)res * res;
+	parallel::parallel_for((res + block - 1) / block, [&](int b) {
+		vector<float> rows, planes(2 * area);
+		int held[2] = { INT_MIN, INT_MIN };
+		// plane x, computed into the slot that does not hold `keep`
+		auto plane = [&](int x, int keep) {
+			for (int k = 0; k < 2; k++)
+				if (held[k] == x)
+					return planes.data() + k * area;
+			int k = held[0] == keep ? 1 : 0;
+			ResamplePlane<F>(src, src_res, x, taps, res, rows, planes.data() + k * area);
+			held[k] = x;
+			return planes.data() + k * area;
+		};
+		for (int x = b * block; x < min(res, (b + 1) * block); x++) {
+			int low = taps.low[x];
+			const float* a = plane(low, low + 1);
+			const float* c = plane(low + 1, low);
+			LerpRows<F>(a, c, taps.w[x], taps.w1[x], dst + (size_t)x * area, area);
+		}
+	});
+}
+
+// For source sizes that are not 1x or 2x the target.
+void Resample(const float* src, int src_res, float* dst, int res) {
+	if (src_res == res * 2) {
+		Downsample2x(src, src_res, dst);
+		return;
+	}
+	switch (FindLerpForm()) {
+	case LERP_FUSE_A: ResampleSeparable<LERP_FUSE_A>(src, src_res, dst, res); break;
+	case LERP_FUSE_B: ResampleSeparable<LERP_FUSE_B>(src, src_res, dst, res); break;
+	default: ResampleSeparable<LERP_SEPARATE>(src, src_res, dst, res); break;
+	}
+}
+
+}
+
+void Downsample2x(const float* src, int res, float* dst) {
+	int half = res / 2;
+	parallel::parallel_for(half, [&](int x) {
+		for (int y = 0; y < half; y++) {
+			const float* r00 = src + ((size_t)(2 * x) * res + 2 * y) * res;
+			const float* r10 = r00 + (size_t)res * res;
+			DownsampleRow(r00, r00 + res, r10, r10 + res, dst + ((size_t)x * half + y) * half, half);
+		}
+	});
+}
+
+void BuildMips(const float* source, int resolution, float* const* mips) {
+	// Same reduction schedule as before: halve (or resample) down to 512 or 256 first.
+	int res = 256;
+	while (res * 2 < resolution) res <<= 1;
+
+	const float* src = source;
+	int src_res = resolution;
+	vector<float> temp[2];
+	for (int i = 0; res > 256; res >>= 1, i ^= 1) {
+		temp[i].resize((size_t)res * res * res);
+		Resample(src, src_res, temp[i].data(), res);
+		src = temp[i].data();
+		src_res = res;
+	}
+
+	// Mip 0 comes straight from src inside the brick loop when it is a box or a copy.
+	bool fused = src_res == 512 || src_res == 256;
+	if (!fused)
+		Resample(src, src_res, mips[0], 256);
+
+	const int bricks = 256 / BRICK;
+	parallel::parallel_for(bricks * bricks * bricks, [&](int b) {
+		int bx = b / (bricks * bricks), by = (b / bricks) % bricks, bz = b % bricks;
+		if (src_res == 512)
+			DownsampleBlock(src, 256, mips[0], bx * BRICK, by * BRICK, bz * BRICK, BRICK);
+		else if (src_res == 256) {
+			for (int x = bx * BRICK; x < (bx + 1) * BRICK; x++)
+				for (int y = by * BRICK; y < (by + 1) * BRICK; y++) {
+					size_t row = ((size_t)x * 256 + y) * 256 + bz * BRICK;
+					CopyRow(src + row, mips[0] + row, BRICK);
+				}
+		}
+		for (int level = 1; level <= 5; level++) {
+			int n = BRICK >> level;
+			DownsampleBlock(mips[level - 1], 256 >> level, mips[level], bx * n, by * n, bz * n, n);
+		}
+	});
+
+	for (int level = 6; level < MIP_LEVELS; level++)
+		Downsample2x(mips[level - 1], 256 >> (level - 1), mips[level]);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Mip pyramid for VolumeRender: mips[i] is (256 >> i)^3, x-major.
+//
+// Each level used to be a trilinear Sample() of the level above at its voxel centres.
+// From a source twice the size that is exactly a 2x2x2 box (lerps by 0.5, z then y then
+// x), and from a source of the same size it is a clamped copy. Both cases run here as
+// flat SIMD loops over 32^3 bricks of mip 0, each brick producing its whole sub-pyramid
+// while it is still in cache, so the source is read once and every level written once.
+// Other source sizes are resampled first, as before, but one axis at a time: z rows, then
+// y, then x planes, which are the nested lerps of the trilinear lookup in the same order,
+// so a source voxel is read twice rather than eight times. Output is bit-identical to the
+// per-voxel path.
+
+#define MIP_LEVELS 9
+
+void BuildMips(const float* source, int resolution, float* const* mips);
+
+// dst is (res / 2)^3; negative source values count as 0, as in Sample().
+void Downsample2x(const float* src, int res, float* dst);
@@ -1,14 +1,23 @@
 #pragma once
 
-#include <functional>
-#include <vector>
-#include <string>
-using namespace std;
+#include "parallel.hpp"
 
-typedef function<float(int x, int y, int z, float u, float v, float w)> FillFunc;
+// datas[(x * resolution + y) * resolution + z] = fillFunc(x, y, z, u, v, w), uvw at the
+// voxel centre, in 16^3 tiles over the parallel:: scheduler.
+template<class Func>
+void ParallelFill(float* datas, int resolution, const Func& fillFunc, parallel::Stats* stats = nullptr) {
+	parallel::parallel_for_3d(resolution, resolution, resolution, [&](int i, int j, int k) {
+		float u, v, w;
+		u = (i + 0.5) / resolution;
+		v = (j + 0.5) / resolution;
+		w = (k + 0.5) / resolution;
+		datas[((size_t)i * resolution + j) * resolution + k] = fillFunc(i, j, k, u, v, w);
+	}, 16, stats);
+}
 
-void ParallelFill(float* datas, int resolution, function<float(int x, int y, int z, float u, float v, float w)> fillFunc);
-
-typedef function<float(int index)> LoopFunc;
-
-void ParallelFor(float* result, int length, LoopFunc func);
\ No newline at end of file
+template<class Func>
+void ParallelFor(float* result, int length, const Func& func, parallel::Stats* stats = nullptr) {
+	parallel::parallel_for(length, [&](int i) {
+		result[i] = func(i);
+	}, 1024, stats);
+}
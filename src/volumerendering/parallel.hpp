@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Header-only work-stealing scheduler for the host-side volume loops.
+//
+// A call is split into tasks (tiles, bricks, chunks of an index range); each thread starts
+// on an even, contiguous share of them and, once that runs dry, steals the upper half of
+// whatever share has the most left. Worker threads are created once and parked between
+// calls, and the calling thread works too. The loop body is a template parameter, so it is
+// inlined into the per-task loop; only the per-task call goes through a function pointer.
+//
+// A call made from inside a task, or while another thread is using the scheduler, runs
+// serially on the calling thread.
+
+namespace parallel {
+
+struct Stats {
+	int tasks = 0;
+	int threads = 0;		// threads that ran at least one task
+	int steals = 0;
+	double seconds = 0;
+};
+
+class Scheduler {
+public:
+	// threads includes the caller; <= 0 means one per hardware thread.
+	explicit Scheduler(int threads = 0) {
+		if (threads <= 0)
+			threads = (int)thread::hardware_concurrency();
+		threads = max(threads, 1);
+		slots.reset(new Slot[threads]);
+		slot_num = threads;
+		for (int i = 1; i < threads; i++)
+			workers.emplace_back([this, i]() { WorkerLoop(i); });
+	}
+	~Scheduler() {
+		{
+			lock_guard<mutex> lock(job_lock);
+			stop = true;
+		}
+		job_signal.notify_all();
+		for (auto& t : workers)
+			t.join();
+	}
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	static Scheduler& Instance() {
+		static Scheduler scheduler;
+		return scheduler;
+	}
+
+	int ThreadCount() const { return slot_num; }
+
+	// task(i) for every i in [0, count), returns when all have run.
+	template<class Task>
+	void Run(int count, const Task& task, Stats* stats = nullptr) {
+		auto start_time = chrono::steady_clock::now();
+		Stats local;
+		local.tasks = max(count, 0);
+		bool serial = count <= 1 || slot_num == 1 || in_task();
+		unique_lock<mutex> run(run_lock, defer_lock);
+		if (!serial && !run.try_lock())
+			serial = true;
+		if (serial) {
+			for (int i = 0; i < count; i++)
+				task(i);
+			local.threads = count > 0 ? 1 : 0;
+		}
+		else {
+			Job job;
+			job.invoke = [](const void* context, int i) { (*(const Task*)context)(i); };
+			job.context = &task;
+			job.remaining = count;
+			for (int s = 0; s < slot_num; s++) {
+				slots[s].begin = (int)((long long)count * s / slot_num);
+				slots[s].end = (int)((long long)count * (s + 1) / slot_num);
+				slots[s].ran = 0;
+				slots[s].steals = 0;
+			}
+			{
+				lock_guard<mutex> lock(job_lock);
+				current = &job;
+				generation++;
+			}
+			job_signal.notify_all();
+
+			Work(job, 0);
+			while (job.remaining > 0)
+				this_thread::yield();
+			{
+				lock_guard<mutex> lock(job_lock);
+				current = nullptr;
+			}
+			while (job.workers > 0)
+				this_thread::yield();
+
+			for (int s = 0; s < slot_num; s++) {
+				local.threads += slots[s].ran > 0;
+				local.steals += slots[s].steals;
+			}
+		}
+		local.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+		if (stats != nullptr)
+			*stats = local;
+	}
+
+private:
+	struct Job {
+		void (*invoke)(const void* context, int i);
+		const void* context;
+		atomic<int> remaining;
+		atomic<int> workers{ 0 };
+	};
+
+	// Tasks [begin, end) still owned by one thread.
+	struct Slot {
+		mutex lock;
+		atomic<int> begin{ 0 }, end{ 0 };	// written under lock, read without it as a hint
+		int ran = 0;
+		int steals = 0;
+	};
+
+	unique_ptr<Slot[]> slots;
+	int slot_num = 1;
+	vector<thread> workers;
+
+	mutex run_lock;		// one parallel call at a time
+	mutex job_lock;
+	condition_variable job_signal;
+	Job* current = nullptr;
+	unsigned generation = 0;
+	bool stop = false;
+
+	static bool& in_task() {
+		static thread_local bool flag = false;
+		return flag;
+	}
+
+	bool Pop(int s, int& i) {
+		lock_guard<mutex> lock(slots[s].lock);
+		if (slots[s].begin >= slots[s].end)
+			return false;
+		i = slots[s].begin++;
+		return true;
+	}
+
+	// Moves the upper half of the fullest other share into slot s.
+	bool Steal(int s) {
+		for (;;) {
+			int victim = -1, most = 0;
+			for (int v = 0; v < slot_num; v++) {
+				if (v == s)
+					continue;
+				int left = slots[v].end - slots[v].begin;
+				if (left > most) {
+					most = left;
+					victim = v;
+				}
+			}
+			if (victim < 0)
+				return false;
+			int begin, end;
+			{
+				lock_guard<mutex> lock(slots[victim].lock);
+				int left = slots[victim].end - slots[victim].begin;
+				if (left <= 0)
+					continue;
+				end = slots[victim].end;
+				begin = end - (left + 1) / 2;
+				slots[victim].end = begin;
+			}
+			lock_guard<mutex> lock(slots[s].lock);
+			slots[s].begin = begin;
+			slots[s].end = end;
+			slots[s].steals++;
+			return true;
+		}
+	}
+
+	void Work(Job& job, int s) {
+		in_task() = true;
+		int i;
+		for (;;) {
+			while (Pop(s, i)) {
+				job.invoke(job.context, i);
+				slots[s].ran++;
+				job.remaining--;
+			}
+			if (!Steal(s))
+				break;
+		}
+		in_task() = false;
+	}
+
+	void WorkerLoop(int s) {
+		unsigned seen = 0;
+		for (;;) {
+			Job* job;
+			{
+				unique_lock<mutex> lock(job_lock);
+				job_signal.wait(lock, [&]() { return stop || (current != nullptr && generation != seen); });
+				if (stop)
+					return;
+				seen = generation;
+				job = current;
+				job->workers++;
+			}
+			Work(*job, s);
+			job->workers--;
+		}
+	}
+};
+
+// body(i) for i in [0, count), `grain` consecutive indices per task.
+template<class Body>
+void parallel_for(int count, const Body& body, int grain = 1, Stats* stats = nullptr) {
+	grain = max(grain, 1);
+	int tasks = (count + grain - 1) / grain;
+	Scheduler::Instance().Run(tasks, [&](int t) {
+		int end = min(count, (t + 1) * grain);
+		for (int i = t * grain; i < end; i++)
+			body(i);
+	}, stats);
+}
+
+// body(x, y, z) over [0, nx) x [0, ny) x [0, nz), in tile^3 blocks with z innermost, which
+// keeps each task on a few pages of an x-major grid. Tiles are numbered x-major, so every
+// thread's initial share is a contiguous slab.
+template<class Body>
+void parallel_for_3d(int nx, int ny, int nz, const Body& body, int tile = 16, Stats* stats = nullptr) {
+	tile = max(tile, 1);
+	int tx = (nx + tile - 1) / tile, ty = (ny + tile - 1) / tile, tz = (nz + tile - 1) / tile;
+	Scheduler::Instance().Run(tx * ty * tz, [&](int t) {
+		int x0 = t / (ty * tz) * tile, y0 = t / tz % ty * tile, z0 = t % tz * tile;
+		int x1 = min(nx, x0 + tile), y1 = min(ny, y0 + tile), z1 = min(nz, z0 + tile);
+		for (int x = x0; x < x1; x++)
+			for (int y = y0; y < y1; y++)
+				for (int z = z0; z < z1; z++)
+					body(x, y, z);
+	}, stats);
+}
+
+// body(begin, end, value) folds [begin, end) into value and returns it; the per-task
+// results are combined in index order, so the result does not depend on scheduling.
+template<class T, class Body, class Combine>
+T parallel_reduce(int count, T identity, const Body& body, const Combine& combine, int grain = 4096, Stats* stats = nullptr) {
+	grain = max(grain, 1);
+	int tasks = (count + grain - 1) / grain;
+	vector<T> partial(tasks, identity);
+	Scheduler::Instance().Run(tasks, [&](int t) {
+		partial[t] = body(t * grain, min(count, (t + 1) * grain), identity);
+	}, stats);
+	T result = identity;
+	for (const T& p : partial)
+		result = combine(result, p);
+	return result;
+}
+
+}
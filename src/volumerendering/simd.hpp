@@ -0,0 +1,317 @@
+#pragma once
+
+// Thin packet wrappers for the host-side render paths. The lane count follows the
+// widest instruction set the host compiler was allowed to use (see CPU_AVX2 /
+// CPU_AVX512 in CMakeLists.txt); without either, plain arrays are used and left
+// to the compiler's auto-vectoriser so the same code still runs everywhere.
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+namespace simd {
+
+#if defined(__AVX512F__)
+
+constexpr int Width = 16;
+inline const char* Name() { return "AVX-512"; }
+
+struct vmask { __mmask16 m; };
+struct vfloat { __m512 v; };
+struct vint { __m512i v; };
+
+inline vfloat set1(float a) { return { _mm512_set1_ps(a) }; }
+inline vint set1i(int a) { return { _mm512_set1_epi32(a) }; }
+inline vfloat load(const float* p) { return { _mm512_loadu_ps(p) }; }
+inline vint loadi(const int* p) { return { _mm512_loadu_si512(p) }; }
+inline void store(float* p, vfloat a) { _mm512_storeu_ps(p, a.v); }
+inline void storei(int* p, vint a) { _mm512_storeu_si512(p, a.v); }
+inline vint lane_index() { return { _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) }; }
+
+inline vfloat operator+(vfloat a, vfloat b) { return { _mm512_add_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a, vfloat b) { return { _mm512_sub_ps(a.v, b.v) }; }
+inline vfloat operator*(vfloat a, vfloat b) { return { _mm512_mul_ps(a.v, b.v) }; }
+inline vfloat operator/(vfloat a, vfloat b) { return { _mm512_div_ps(a.v, b.v) }; }
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return { _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+inline vfloat min(vfloat a, vfloat b) { return { _mm512_min_ps(a.v, b.v) }; }
+inline vfloat max(vfloat a, vfloat b) { return { _mm512_max_ps(a.v, b.v) }; }
+inline vfloat floor(vfloat a) { return { _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+
+inline vmask operator<(vfloat a, vfloat b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+inline vmask operator>(vfloat a, vfloat b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+inline vfloat select(vmask m, vfloat a, vfloat b) { return { _mm512_mask_blend_ps(m.m, b.v, a.v) }; }
+
+inline vint operator+(vint a, vint b) { return { _mm512_add_epi32(a.v, b.v) }; }
+inline vint operator-(vint a, vint b) { return { _mm512_sub_epi32(a.v, b.v) }; }
+inline vint operator*(vint a, vint b) { return { _mm512_mullo_epi32(a.v, b.v) }; }
+inline vint operator^(vint a, vint b) { return { _mm512_xor_si512(a.v, b.v) }; }
+inline vint operator&(vint a, vint b) { return { _mm512_and_si512(a.v, b.v) }; }
+inline vint operator|(vint a, vint b) { return { _mm512_or_si512(a.v, b.v) }; }
+template<int N> inline vint shl(vint a) { return { _mm512_slli_epi32(a.v, N) }; }
+template<int N> inline vint shr(vint a) { return { _mm512_srli_epi32(a.v, N) }; }
+inline vmask operator<(vint a, vint b) { return { _mm512_cmplt_epi32_mask(a.v, b.v) }; }
+inline vmask operator>(vint a, vint b) { return { _mm512_cmpgt_epi32_mask(a.v, b.v) }; }
+inline vint select(vmask m, vint a, vint b) { return { _mm512_mask_blend_epi32(m.m, b.v, a.v) }; }
+
+inline vint to_int(vfloat a) { return { _mm512_cvttps_epi32(a.v) }; }
+inline vfloat to_float(vint a) { return { _mm512_cvtepi32_ps(a.v) }; }
+inline vint as_int(vfloat a) { return { _mm512_castps_si512(a.v) }; }
+inline vfloat as_float(vint a) { return { _mm512_castsi512_ps(a.v) }; }
+
+inline vmask operator&(vmask a, vmask b) { return { (__mmask16)(a.m & b.m) }; }
+inline vmask operator|(vmask a, vmask b) { return { (__mmask16)(a.m | b.m) }; }
+inline vmask andnot(vmask a, vmask b) { return { (__mmask16)(a.m & ~b.m) }; }
+inline vmask all_mask() { return { (__mmask16)0xFFFF }; }
+inline vmask none_mask() { return { (__mmask16)0 }; }
+inline vmask from_bits(unsigned bits) { return { (__mmask16)bits }; }
+inline unsigned bits(vmask m) { return m.m; }
+
+// Lanes outside the mask are not touched in memory and read back as 0.
+inline vfloat gather(const float* base, vint index, vmask m) {
+	return { _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m.m, index.v, base, 4) };
+}
+inline vint gatheri(const int32_t* base, vint index, vmask m) {
+	return { _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), m.m, index.v, base, 4) };
+}
+
+// { a0 + a1, a2 + a3, ..., b0 + b1, b2 + b3, ... }
+inline vfloat pair_add(vfloat a, vfloat b) {
+	const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+	const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+	return { _mm512_add_ps(_mm512_permutex2var_ps(a.v, even, b.v), _mm512_permutex2var_ps(a.v, odd, b.v)) };
+}
+
+#elif defined(__AVX2__)
+
+constexpr int Width = 8;
+inline const char* Name() { return "AVX2"; }
+
+struct vmask { __m256 m; };
+struct vfloat { __m256 v; };
+struct vint { __m256i v; };
+
+inline vfloat set1(float a) { return { _mm256_set1_ps(a) }; }
+inline vint set1i(int a) { return { _mm256_set1_epi32(a) }; }
+inline vfloat load(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline vint loadi(const int* p) { return { _mm256_loadu_si256((const __m256i*)p) }; }
+inline void store(float* p, vfloat a) { _mm256_storeu_ps(p, a.v); }
+inline void storei(int* p, vint a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+inline vint lane_index() { return { _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) }; }
+
+inline vfloat operator+(vfloat a, vfloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a, vfloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline vfloat operator*(vfloat a, vfloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline vfloat operator/(vfloat a, vfloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+#if defined(__FMA__)
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+#else
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return { _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v) }; }
+#endif
+inline vfloat min(vfloat a, vfloat b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline vfloat max(vfloat a, vfloat b) { return { _mm256_max_ps(a.v, b.v) }; }
+inline vfloat floor(vfloat a) { return { _mm256_floor_ps(a.v) }; }
+
+inline vmask operator<(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline vmask operator>(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline vfloat select(vmask m, vfloat a, vfloat b) { return { _mm256_blendv_ps(b.v, a.v, m.m) }; }
+
+inline vint operator+(vint a, vint b) { return { _mm256_add_epi32(a.v, b.v) }; }
+inline vint operator-(vint a, vint b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+inline vint operator*(vint a, vint b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+inline vint operator^(vint a, vint b) { return { _mm256_xor_si256(a.v, b.v) }; }
+inline vint operator&(vint a, vint b) { return { _mm256_and_si256(a.v, b.v) }; }
+inline vint operator|(vint a, vint b) { return { _mm256_or_si256(a.v, b.v) }; }
+template<int N> inline vint shl(vint a) { return { _mm256_slli_epi32(a.v, N) }; }
+template<int N> inline vint shr(vint a) { return { _mm256_srli_epi32(a.v, N) }; }
+inline vmask operator<(vint a, vint b) { return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(b.v, a.v)) }; }
+inline vmask operator>(vint a, vint b) { return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(a.v, b.v)) }; }
+inline vint select(vmask m, vint a, vint b) { return { _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b.v), _mm256_castsi256_ps(a.v), m.m)) }; }
+
+inline vint to_int(vfloat a) { return { _mm256_cvttps_epi32(a.v) }; }
+inline vfloat to_float(vint a) { return { _mm256_cvtepi32_ps(a.v) }; }
+inline vint as_int(vfloat a) { return { _mm256_castps_si256(a.v) }; }
+inline vfloat as_float(vint a) { return { _mm256_castsi256_ps(a.v) }; }
+
+inline vmask operator&(vmask a, vmask b) { return { _mm256_and_ps(a.m, b.m) }; }
+inline vmask operator|(vmask a, vmask b) { return { _mm256_or_ps(a.m, b.m) }; }
+inline vmask andnot(vmask a, vmask b) { return { _mm256_andnot_ps(b.m, a.m) }; }
+inline vmask all_mask() { return { _mm256_castsi256_ps(_mm256_set1_epi32(-1)) }; }
+inline vmask none_mask() { return { _mm256_setzero_ps() }; }
+inline vmask from_bits(unsigned bits) {
+	__m256i b = _mm256_and_si256(_mm256_set1_epi32((int)bits), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128));
+	return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, _mm256_setzero_si256())) };
+}
+inline unsigned bits(vmask m) { return (unsigned)_mm256_movemask_ps(m.m); }
+
+// Lanes outside the mask are not touched in memory and read back as 0.
+inline vfloat gather(const float* base, vint index, vmask m) {
+	return { _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, index.v, m.m, 4) };
+}
+inline vint gatheri(const int32_t* base, vint index, vmask m) {
+	return { _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)base, index.v, _mm256_castps_si256(m.m), 4) };
+}
+
+// { a0 + a1, a2 + a3, ..., b0 + b1, b2 + b3, ... }
+inline vfloat pair_add(vfloat a, vfloat b) {
+	__m256 h = _mm256_hadd_ps(a.v, b.v);
+	return { _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(h), 0xD8)) };
+}
+
+#else
+
+constexpr int Width = 8;
+inline const char* Name() { return "scalar"; }
+
+struct vmask { unsigned m; };
+struct vfloat { float v[Width]; };
+struct vint { int32_t v[Width]; };
+
+#define SIMD_LANES(expr) for (int l = 0; l < Width; l++) { expr; }
+
+inline vfloat set1(float a) { vfloat r; SIMD_LANES(r.v[l] = a); return r; }
+inline vint set1i(int a) { vint r; SIMD_LANES(r.v[l] = a); return r; }
+inline vfloat load(const float* p) { vfloat r; SIMD_LANES(r.v[l] = p[l]); return r; }
+inline vint loadi(const int* p) { vint r; SIMD_LANES(r.v[l] = p[l]); return r; }
+inline void store(float* p, vfloat a) { SIMD_LANES(p[l] = a.v[l]); }
+inline void storei(int* p, vint a) { SIMD_LANES(p[l] = a.v[l]); }
+inline vint lane_index() { vint r; SIMD_LANES(r.v[l] = l); return r; }
+
+inline vfloat operator+(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] + b.v[l]); return r; }
+inline vfloat operator-(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] - b.v[l]); return r; }
+inline vfloat operator*(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] * b.v[l]); return r; }
+inline vfloat operator/(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] / b.v[l]); return r; }
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] * b.v[l] + c.v[l]); return r; }
+inline vfloat min(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] < b.v[l] ? a.v[l] : b.v[l]); return r; }
+inline vfloat max(vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = a.v[l] > b.v[l] ? a.v[l] : b.v[l]); return r; }
+inline vfloat floor(vfloat a) { vfloat r; SIMD_LANES(r.v[l] = std::floor(a.v[l])); return r; }
+
+inline vmask operator<(vfloat a, vfloat b) { vmask r = { 0 }; SIMD_LANES(r.m |= (a.v[l] < b.v[l] ? 1u : 0u) << l); return r; }
+inline vmask operator>(vfloat a, vfloat b) { vmask r = { 0 }; SIMD_LANES(r.m |= (a.v[l] > b.v[l] ? 1u : 0u) << l); return r; }
+inline vfloat select(vmask m, vfloat a, vfloat b) { vfloat r; SIMD_LANES(r.v[l] = (m.m >> l) & 1 ? a.v[l] : b.v[l]); return r; }
+
+inline vint operator+(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = (int32_t)((uint32_t)a.v[l] + (uint32_t)b.v[l])); return r; }
+inline vint operator-(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = (int32_t)((uint32_t)a.v[l] - (uint32_t)b.v[l])); return r; }
+inline vint operator*(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = (int32_t)((uint32_t)a.v[l] * (uint32_t)b.v[l])); return r; }
+inline vint operator^(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = a.v[l] ^ b.v[l]); return r; }
+inline vint operator&(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = a.v[l] & b.v[l]); return r; }
+inline vint operator|(vint a, vint b) { vint r; SIMD_LANES(r.v[l] = a.v[l] | b.v[l]); return r; }
+template<int N> inline vint shl(vint a) { vint r; SIMD_LANES(r.v[l] = (int32_t)((uint32_t)a.v[l] << N)); return r; }
+template<int N> inline vint shr(vint a) { vint r; SIMD_LANES(r.v[l] = (int32_t)((uint32_t)a.v[l] >> N)); return r; }
+inline vmask operator<(vint a, vint b) { vmask r = { 0 }; SIMD_LANES(r.m |= (a.v[l] < b.v[l] ? 1u : 0u) << l); return r; }
+inline vmask operator>(vint a, vint b) { vmask r = { 0 }; SIMD_LANES(r.m |= (a.v[l] > b.v[l] ? 1u : 0u) << l); return r; }
+inline vint select(vmask m, vint a, vint b) { vint r; SIMD_LANES(r.v[l] = (m.m >> l) & 1 ? a.v[l] : b.v[l]); return r; }
+
+inline vint to_int(vfloat a) { vint r; SIMD_LANES(r.v[l] = (int32_t)a.v[l]); return r; }
+inline vfloat to_float(vint a) { vfloat r; SIMD_LANES(r.v[l] = (float)a.v[l]); return r; }
+inline vint as_int(vfloat a) { vint r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+inline vfloat as_float(vint a) { vfloat r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+
+inline vmask operator&(vmask a, vmask b) { return { a.m & b.m }; }
+inline vmask operator|(vmask a, vmask b) { return { a.m | b.m }; }
+inline vmask andnot(vmask a, vmask b) { return { a.m & ~b.m }; }
+inline vmask all_mask() { return { (1u << Width) - 1 }; }
+inline vmask none_mask() { return { 0 }; }
+inline vmask from_bits(unsigned bits) { return { bits & ((1u << Width) - 1) }; }
+inline unsigned bits(vmask m) { return m.m; }
+
+inline vfloat gather(const float* base, vint index, vmask m) {
+	vfloat r; SIMD_LANES(r.v[l] = (m.m >> l) & 1 ? base[index.v[l]] : 0.0f); return r;
+}
+inline vint gatheri(const int32_t* base, vint index, vmask m) {
+	vint r; SIMD_LANES(r.v[l] = (m.m >> l) & 1 ? base[index.v[l]] : 0); return r;
+}
+
+inline vfloat pair_add(vfloat a, vfloat b) {
+	vfloat r; SIMD_LANES(r.v[l] = l < Width / 2 ? a.v[2 * l] + a.v[2 * l + 1] : b.v[2 * l - Width] + b.v[2 * l - Width + 1]); return r;
+}
+
+#undef SIMD_LANES
+
+#endif
+
+inline vfloat operator+(vfloat a, float b) { return a + set1(b); }
+inline vfloat operator-(vfloat a, float b) { return a - set1(b); }
+inline vfloat operator*(vfloat a, float b) { return a * set1(b); }
+inline vfloat operator-(float a, vfloat b) { return set1(a) - b; }
+inline vint operator+(vint a, int b) { return a + set1i(b); }
+inline vint operator*(vint a, int b) { return a * set1i(b); }
+inline vmask operator<(vfloat a, float b) { return a < set1(b); }
+inline vmask operator>(vfloat a, float b) { return a > set1(b); }
+inline vmask operator<(vint a, int b) { return a < set1i(b); }
+inline vmask operator>(vint a, int b) { return a > set1i(b); }
+
+inline bool any(vmask m) { return bits(m) != 0; }
+inline bool none(vmask m) { return bits(m) == 0; }
+inline bool lane(vmask m, int l) { return (bits(m) >> l) & 1; }
+
+// Natural log for x > 0 (Cephes logf polynomial, ~1 ulp over the range used by free-flight sampling).
+inline vfloat log(vfloat x) {
+	x = max(x, set1(1.17549435e-38f));
+	vint xi = as_int(x);
+	vint e = shr<23>(xi) - set1i(126);
+	vfloat m = as_float((xi & set1i(0x007FFFFF)) | set1i(0x3F000000));
+	vfloat ef = to_float(e);
+
+	vmask small = m < 0.707106781186547524f;
+	ef = select(small, ef - 1.0f, ef);
+	m = select(small, m + m, m) - 1.0f;
+
+	vfloat z = m * m;
+	vfloat y = set1(7.0376836292E-2f);
+	y = fmadd(y, m, set1(-1.1514610310E-1f));
+	y = fmadd(y, m, set1(1.1676998740E-1f));
+	y = fmadd(y, m, set1(-1.2420140846E-1f));
+	y = fmadd(y, m, set1(1.4249322787E-1f));
+	y = fmadd(y, m, set1(-1.6668057665E-1f));
+	y = fmadd(y, m, set1(2.0000714765E-1f));
+	y = fmadd(y, m, set1(-2.4999993993E-1f));
+	y = fmadd(y, m, set1(3.3333331174E-1f));
+	y = y * m * z;
+	y = fmadd(ef, set1(-2.12194440e-4f), y);
+	y = fmadd(z, set1(-0.5f), y);
+	return fmadd(ef, set1(0.693359375f), m + y);
+}
+
+// e^x (Cephes expf polynomial), inputs clamped to the finite float range.
+inline vfloat exp(vfloat x) {
+	x = min(max(x, set1(-87.3f)), set1(88.3f));
+	vfloat fx = floor(fmadd(x, set1(1.44269504088896341f), set1(0.5f)));
+	x = fmadd(fx, set1(-0.693359375f), x);
+	x = fmadd(fx, set1(2.12194440e-4f), x);
+
+	vfloat z = x * x;
+	vfloat y = set1(1.9875691500E-4f);
+	y = fmadd(y, x, set1(1.3981999507E-3f));
+	y = fmadd(y, x, set1(8.3334519073E-3f));
+	y = fmadd(y, x, set1(4.1665795894E-2f));
+	y = fmadd(y, x, set1(1.6666665459E-1f));
+	y = fmadd(y, x, set1(5.0000001201E-1f));
+	y = fmadd(y, z, x + 1.0f);
+	return y * as_float(shl<23>(to_int(fx) + set1i(127)));
+}
+
+// Per-lane xorshift32 stream; rand01 returns values in [0, 1).
+struct vrand {
+	vint state;
+
+	void seed(uint32_t base) {
+		vint s = lane_index() * set1i((int)0x9E3779B9u) + set1i((int)(base * 0x85EBCA6Bu + 0x27D4EB2Du));
+		s = s ^ shr<16>(s);
+		s = s * set1i((int)0x7FEB352Du);
+		s = s ^ shr<15>(s);
+		state = s | set1i(1);
+	}
+
+	vfloat rand01() {
+		state = state ^ shl<13>(state);
+		state = state ^ shr<17>(state);
+		state = state ^ shl<5>(state);
+		return to_float(shr<8>(state)) * (1.0f / 16777216.0f);
+	}
+};
+
+}
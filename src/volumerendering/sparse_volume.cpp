@@ -0,0 +1,308 @@
+#include "sparse_volume.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+
+// Distance along dir from p to the exit of the box [lo, hi); inv is 1 / dir, 0 where
+// dir is 0.
+inline float ExitDistance(float3 p, float3 dir, float3 inv, float3 lo, float3 hi) {
+	float t = 1e30f;
+	if (dir.x != 0) t = min(t, ((dir.x > 0 ? hi.x : lo.x) - p.x) * inv.x);
+	if (dir.y != 0) t = min(t, ((dir.y > 0 ? hi.y : lo.y) - p.y) * inv.y);
+	if (dir.z != 0) t = min(t, ((dir.z > 0 ? hi.z : lo.z) - p.z) * inv.z);
+	return max(t, 0.0f);
+}
+
+inline int SupportCell(float p, int dims) {
+	return max(0, min(dims - 1, ((int)floorf(p) + 1) >> SPARSE_LEAF_LOG2));
+}
+
+}
+
+void SparseVolume::Clear() {
+	resolution = leaf_dims = root_dims = support_dims = 0;
+	root.clear();
+	nodes.clear();
+	leaves.clear();
+	leaf_offset.clear();
+	empty_distance.clear();
+}
+
+void SparseVolume::Build(const float* dense, int res, float threshold) {
+	Clear();
+	resolution = res;
+	leaf_dims = (res + SPARSE_LEAF_SIZE - 1) >> SPARSE_LEAF_LOG2;
+	root_dims = (leaf_dims + (1 << SPARSE_NODE_LOG2) - 1) >> SPARSE_NODE_LOG2;
+	support_dims = leaf_dims + 1;
+
+	// Per leaf: occupancy, and which of its faces hold non-zero voxels. Bit (rx, ry, rz)
+	// of face_mask is set if a non-zero voxel exists with local coordinate 7 on every
+	// axis where r is 1, i.e. one that a lookup from the next cell up can read.
+	int leaf_count = leaf_dims * leaf_dims * leaf_dims;
+	vector<unsigned char> occupied(leaf_count), face_mask(leaf_count);
+	parallel::parallel_for(leaf_dims, [&](int lx) {
+		for (int ly = 0; ly < leaf_dims; ly++) {
+			for (int lz = 0; lz < leaf_dims; lz++) {
+				bool occ = false;
+				unsigned mask = 0;
+				int ex = min(SPARSE_LEAF_SIZE, res - lx * SPARSE_LEAF_SIZE);
+				int ey = min(SPARSE_LEAF_SIZE, res - ly * SPARSE_LEAF_SIZE);
+				int ez = min(SPARSE_LEAF_SIZE, res - lz * SPARSE_LEAF_SIZE);
+				for (int x = 0; x < ex; x++) {
+					for (int y = 0; y < ey; y++) {
+						const float* row = dense + ((size_t)(lx * SPARSE_LEAF_SIZE + x) * res + ly * SPARSE_LEAF_SIZE + y) * res + lz * SPARSE_LEAF_SIZE;
+						for (int z = 0; z < ez; z++) {
+							occ |= row[z] > threshold;
+							if (row[z] > 0) {
+								unsigned at = ((x == SPARSE_LEAF_SIZE - 1) << 2) | ((y == SPARSE_LEAF_SIZE - 1) << 1) | (z == SPARSE_LEAF_SIZE - 1);
+								// every restriction r that is a subset of `at`
+								for (unsigned r = 0; r < 8; r++)
+									if ((r & at) == r)
+										mask |= 1u << r;
+							}
+						}
+					}
+				}
+				int index = (lx * leaf_dims + ly) * leaf_dims + lz;
+				occupied[index] = occ;
+				face_mask[index] = occ ? (unsigned char)mask : 0;
+			}
+		}
+	});
+
+	// Tree topology, leaves numbered in x-major order.
+	root.assign((size_t)root_dims * root_dims * root_dims, -1);
+	vector<int> leaf_index(leaf_count, -1);
+	int leaf_num = 0;
+	for (int lx = 0; lx < leaf_dims; lx++) {
+		for (int ly = 0; ly < leaf_dims; ly++) {
+			for (int lz = 0; lz < leaf_dims; lz++) {
+				int index = (lx * leaf_dims + ly) * leaf_dims + lz;
+				if (!occupied[index])
+					continue;
+				int32_t& n = root[((lx >> SPARSE_NODE_LOG2) * root_dims + (ly >> SPARSE_NODE_LOG2)) * root_dims + (lz >> SPARSE_NODE_LOG2)];
+				if (n < 0) {
+					n = (int32_t)nodes.size();
+					nodes.emplace_back();
+					fill_n(nodes.back().childMask, SPARSE_NODE_CHILDREN / 64, 0ull);
+					fill_n(nodes.back().child, SPARSE_NODE_CHILDREN, -1);
+				}
+				const int node_mask = (1 << SPARSE_NODE_LOG2) - 1;
+				int c = (((lx & node_mask) << SPARSE_NODE_LOG2 | (ly & node_mask)) << SPARSE_NODE_LOG2) | (lz & node_mask);
+				nodes[n].childMask[c >> 6] |= 1ull << (c & 63);
+				nodes[n].child[c] = leaf_num;
+				leaf_index[index] = leaf_num++;
+			}
+		}
+	}
+
+	leaf_offset.resize(leaf_count);
+	for (int i = 0; i < leaf_count; i++)
+		leaf_offset[i] = leaf_index[i] < 0 ? -1 : leaf_index[i] * SPARSE_LEAF_VOXELS;
+
+	leaves.assign((size_t)leaf_num * SPARSE_LEAF_VOXELS, 0.0f);
+	parallel::parallel_for(leaf_dims, [&](int lx) {
+		for (int ly = 0; ly < leaf_dims; ly++) {
+			for (int lz = 0; lz < leaf_dims; lz++) {
+				int l = leaf_index[(lx * leaf_dims + ly) * leaf_dims + lz];
+				if (l < 0)
+					continue;
+				float* leaf = leaves.data() + (size_t)l * SPARSE_LEAF_VOXELS;
+				int ex = min(SPARSE_LEAF_SIZE, res - lx * SPARSE_LEAF_SIZE);
+				int ey = min(SPARSE_LEAF_SIZE, res - ly * SPARSE_LEAF_SIZE);
+				int ez = min(SPARSE_LEAF_SIZE, res - lz * SPARSE_LEAF_SIZE);
+				for (int x = 0; x < ex; x++)
+					for (int y = 0; y < ey; y++) {
+						const float* row = dense + ((size_t)(lx * SPARSE_LEAF_SIZE + x) * res + ly * SPARSE_LEAF_SIZE + y) * res + lz * SPARSE_LEAF_SIZE;
+						float* dst = leaf + (x * SPARSE_LEAF_SIZE + y) * SPARSE_LEAF_SIZE;
+						for (int z = 0; z < ez; z++)
+							dst[z] = max(0.0f, row[z]);
+					}
+			}
+		}
+	});
+
+	// Support cell s reads leaf s on an axis (any voxel) and leaf s - 1 (its last voxel).
+	const int n = support_dims;
+	const float far = (float)n;
+	empty_distance.assign((size_t)n * n * n, far);
+	for (int sx = 0; sx < support_dims; sx++) {
+		for (int sy = 0; sy < support_dims; sy++) {
+			for (int sz = 0; sz < support_dims; sz++) {
+				bool any = false;
+				for (unsigned r = 0; r < 8 && !any; r++) {
+					int lx = sx - ((r >> 2) & 1), ly = sy - ((r >> 1) & 1), lz = sz - (r & 1);
+					if (lx < 0 || ly < 0 || lz < 0 || lx >= leaf_dims || ly >= leaf_dims || lz >= leaf_dims)
+						continue;
+					any = (face_mask[(lx * leaf_dims + ly) * leaf_dims + lz] >> r) & 1;
+				}
+				if (any)
+					empty_distance[((size_t)sx * n + sy) * n + sz] = 0;
+			}
+		}
+	}
+
+	// Chebyshev distance transform, one axis at a time: d(x) = min over x' of
+	// max(|x - x'|, d(x')). The grid is at most 33^3, so the quadratic 1D pass is fine.
+	vector<float> line(n);
+	for (int axis = 0; axis < 3; axis++) {
+		size_t stride = axis == 0 ? (size_t)n * n : axis == 1 ? n : 1;
+		for (int a = 0; a < n; a++) {
+			for (int b = 0; b < n; b++) {
+				size_t base = axis == 0 ? ((size_t)a * n + b) : axis == 1 ? ((size_t)a * n * n + b) : ((size_t)a * n + b) * n;
+				for (int i = 0; i < n; i++)
+					line[i] = empty_distance[base + i * stride];
+				for (int i = 0; i < n; i++) {
+					float d = line[i];
+					for (int j = 0; j < n && d > 0; j++)
+						d = min(d, max((float)abs(i - j), line[j]));
+					empty_distance[base + i * stride] = d;
+				}
+			}
+		}
+	}
+}
+
+size_t SparseVolume::MemoryBytes() const {
+	return root.size() * sizeof(int32_t) + nodes.size() * sizeof(Node) + leaves.size() * sizeof(float)
+		+ leaf_offset.size() * sizeof(int32_t) + empty_distance.size() * sizeof(float);
+}
+
+const float* SparseVolume::Leaf(int lx, int ly, int lz) const {
+	int n = root[((lx >> SPARSE_NODE_LOG2) * root_dims + (ly >> SPARSE_NODE_LOG2)) * root_dims + (lz >> SPARSE_NODE_LOG2)];
+	if (n < 0)
+		return nullptr;
+	const int node_mask = (1 << SPARSE_NODE_LOG2) - 1;
+	int c = (((lx & node_mask) << SPARSE_NODE_LOG2 | (ly & node_mask)) << SPARSE_NODE_LOG2) | (lz & node_mask);
+	int l = nodes[n].child[c];
+	return l < 0 ? nullptr : leaves.data() + (size_t)l * SPARSE_LEAF_VOXELS;
+}
+
+float SparseVolume::Voxel(int x, int y, int z) const {
+	if (x < 0 || y < 0 || z < 0 || x >= resolution || y >= resolution || z >= resolution)
+		return 0;
+	const float* leaf = Leaf(x >> SPARSE_LEAF_LOG2, y >> SPARSE_LEAF_LOG2, z >> SPARSE_LEAF_LOG2);
+	if (leaf == nullptr)
+		return 0;
+	const int m = SPARSE_LEAF_SIZE - 1;
+	return leaf[(((x & m) << SPARSE_LEAF_LOG2 | (y & m)) << SPARSE_LEAF_LOG2) | (z & m)];
+}
+
+float SparseVolume::Sample(float3 uv) const {
+	int res = resolution;
+	float3 pos = uv * res - 0.5;
+	int x = floor(pos.x);
+	int y = floor(pos.y);
+	int z = floor(pos.z);
+	float3 w = pos - make_float3(x, y, z);
+
+	float c000, c001, c010, c011, c100, c101, c110, c111;
+	const int m = SPARSE_LEAF_SIZE - 1;
+	// All eight corners in one leaf: one tree walk instead of eight.
+	if (x >= 0 && y >= 0 && z >= 0 && (x & m) != m && (y & m) != m && (z & m) != m && x + 1 < res && y + 1 < res && z + 1 < res) {
+		const float* leaf = Leaf(x >> SPARSE_LEAF_LOG2, y >> SPARSE_LEAF_LOG2, z >> SPARSE_LEAF_LOG2);
+		if (leaf == nullptr)
+			return 0;
+		const float* c = leaf + ((((x & m) << SPARSE_LEAF_LOG2 | (y & m)) << SPARSE_LEAF_LOG2) | (z & m));
+		const int dy = SPARSE_LEAF_SIZE, dx = SPARSE_LEAF_SIZE * SPARSE_LEAF_SIZE;
+		c000 = c[0]; c001 = c[1]; c010 = c[dy]; c011 = c[dy + 1];
+		c100 = c[dx]; c101 = c[dx + 1]; c110 = c[dx + dy]; c111 = c[dx + dy + 1];
+	}
+	else {
+		c000 = Voxel(x, y, z); c001 = Voxel(x, y, z + 1); c010 = Voxel(x, y + 1, z); c011 = Voxel(x, y + 1, z + 1);
+		c100 = Voxel(x + 1, y, z); c101 = Voxel(x + 1, y, z + 1); c110 = Voxel(x + 1, y + 1, z); c111 = Voxel(x + 1, y + 1, z + 1);
+	}
+
+	return
+		lerp(
+			lerp(
+				lerp(c000, c001, w.z),
+				lerp(c010, c011, w.z),
+				w.y),
+			lerp(
+				lerp(c100, c101, w.z),
+				lerp(c110, c111, w.z),
+				w.y),
+			w.x);
+}
+
+void SparseVolume::Decode(float* dense) const {
+	const int res = resolution;
+	parallel::parallel_for(leaf_dims, [&](int lx) {
+		for (int ly = 0; ly < leaf_dims; ly++) {
+			for (int lz = 0; lz < leaf_dims; lz++) {
+				int offset = leaf_offset[(lx * leaf_dims + ly) * leaf_dims + lz];
+				int ex = min(SPARSE_LEAF_SIZE, res - lx * SPARSE_LEAF_SIZE);
+				int ey = min(SPARSE_LEAF_SIZE, res - ly * SPARSE_LEAF_SIZE);
+				int ez = min(SPARSE_LEAF_SIZE, res - lz * SPARSE_LEAF_SIZE);
+				for (int x = 0; x < ex; x++)
+					for (int y = 0; y < ey; y++) {
+						float* row = dense + ((size_t)(lx * SPARSE_LEAF_SIZE + x) * res + ly * SPARSE_LEAF_SIZE + y) * res + lz * SPARSE_LEAF_SIZE;
+						if (offset < 0)
+							fill_n(row, ez, 0.0f);
+						else
+							copy_n(leaves.data() + offset + (x * SPARSE_LEAF_SIZE + y) * SPARSE_LEAF_SIZE, ez, row);
+					}
+			}
+		}
+	});
+}
+
+bool SparseVolume::Supported(float3 pos) const {
+	float hi = (float)(support_dims << SPARSE_LEAF_LOG2) - 1;
+	if (!(pos.x >= -1 && pos.y >= -1 && pos.z >= -1 && pos.x < hi && pos.y < hi && pos.z < hi))
+		return false;
+	return CellDistance(SupportCell(pos.x, support_dims), SupportCell(pos.y, support_dims), SupportCell(pos.z, support_dims)) == 0;
+}
+
+float SparseVolume::SkipEmpty(float3 pos, float3 dir, float tmin, float tmax) const {
+	if (resolution == 0)
+		return tmin;
+
+	// Clip to the support grid, everything outside it reads zeros.
+	float lo = -1, hi = (float)(support_dims << SPARSE_LEAF_LOG2) - 1;
+	float t0 = tmin, t1 = tmax;
+	float p[3] = { pos.x, pos.y, pos.z }, d[3] = { dir.x, dir.y, dir.z };
+	for (int a = 0; a < 3; a++) {
+		if (d[a] == 0) {
+			if (p[a] < lo || p[a] >= hi)
+				return tmax;
+			continue;
+		}
+		float ta = (lo - p[a]) / d[a], tb = (hi - p[a]) / d[a];
+		t0 = max(t0, min(ta, tb));
+		t1 = min(t1, max(ta, tb));
+	}
+	if (t0 >= t1)
+		return tmax;
+
+	float max_dir = max(fabsf(dir.x), max(fabsf(dir.y), fabsf(dir.z)));
+	if (max_dir == 0)
+		return Supported(pos) ? tmin : tmax;
+	// Probes sit a thousandth of a voxel past each cell boundary so floor() picks the
+	// cell being entered; the boundary itself is what gets returned.
+	float nudge = 1e-3f / max_dir;
+	float3 inv = make_float3(dir.x != 0 ? 1 / dir.x : 0, dir.y != 0 ? 1 / dir.y : 0, dir.z != 0 ? 1 / dir.z : 0);
+
+	float t = t0, probe = t0;
+	while (t < t1) {
+		float3 q = pos + dir * probe;
+		int sx = SupportCell(q.x, support_dims), sy = SupportCell(q.y, support_dims), sz = SupportCell(q.z, support_dims);
+		float d = CellDistance(sx, sy, sz);
+		if (d == 0)
+			return t;
+		// every cell within d - 1 of this one is empty
+		float reach = (d - 1) * SPARSE_LEAF_SIZE;
+		float3 c = make_float3(sx * SPARSE_LEAF_SIZE - 1, sy * SPARSE_LEAF_SIZE - 1, sz * SPARSE_LEAF_SIZE - 1);
+		float dt = ExitDistance(q, dir, inv, c - reach, c + (reach + SPARSE_LEAF_SIZE));
+		t = probe + dt;
+		probe = t + nudge;
+	}
+	return tmax;
+}
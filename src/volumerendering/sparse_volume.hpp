@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "vector.cuh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Sparse copy of a dense x-major density grid, laid out like a two-level VDB tree:
+//
+//   root     dense grid of node indices, one per 64^3 region (-1 when empty)
+//   node     8^3 children: occupancy bitmask and leaf indices (-1 when empty)
+//   leaf     8^3 voxels, allocated only when one of them is above the threshold
+//
+// Memory is ~2 KB per occupied leaf plus a few KB per node, and 4 bytes per leaf cell for
+// the flat offset table. Lookups return exactly what
+// Sample() in volume.cu returns on the dense grid (negatives clamped to 0, border 0).
+//
+// A second grid marks the cells in which a trilinear lookup can be non-zero ("support").
+// Cell s covers positions whose floor lies in [8s - 1, 8s + 6], so it reads voxels
+// [8s - 1, 8s + 7]. Empty cells store their Chebyshev distance (in cells) to the nearest
+// supported one, so a ray can leave the whole empty cube around it in one step.
+// Delta/ratio tracking and the TR march use this to jump over empty space; that is
+// exact, since every collision there would be a null collision.
+
+#define SPARSE_LEAF_LOG2 3
+#define SPARSE_NODE_LOG2 3
+#define SPARSE_LEAF_SIZE (1 << SPARSE_LEAF_LOG2)
+#define SPARSE_LEAF_VOXELS (SPARSE_LEAF_SIZE * SPARSE_LEAF_SIZE * SPARSE_LEAF_SIZE)
+#define SPARSE_NODE_CHILDREN (1 << (3 * SPARSE_NODE_LOG2))
+
+class SparseVolume {
+public:
+	struct Node {
+		uint64_t childMask[SPARSE_NODE_CHILDREN / 64];
+		int32_t child[SPARSE_NODE_CHILDREN];
+	};
+
+	// Voxels <= threshold do not make a leaf; values inside a leaf are kept as they are.
+	void Build(const float* dense, int resolution, float threshold = 0);
+	void Clear();
+	bool IsBuilt() const { return resolution > 0; }
+
+	int Resolution() const { return resolution; }
+	int LeafCount() const { return (int)(leaves.size() / SPARSE_LEAF_VOXELS); }
+	int NodeCount() const { return (int)nodes.size(); }
+	size_t MemoryBytes() const;
+
+	float Voxel(int x, int y, int z) const;
+	// Trilinear lookup, uv in [0, 1]^3.
+	float Sample(float3 uv) const;
+	// Writes the dense grid back, res^3 x-major; negatives come back as 0.
+	void Decode(float* dense) const;
+
+	// Flat form of the tree for the packet tracer to gather: per leaf (lx, ly, lz), x-major
+	// over LeafDims()^3, the offset of its first voxel in LeafData(), -1 when empty.
+	const int32_t* LeafOffsets() const { return leaf_offset.data(); }
+	const float* LeafData() const { return leaves.data(); }
+	int LeafDims() const { return leaf_dims; }
+
+	// pos is in voxel space (uv * res - 0.5), dir need not be normalised.
+	bool Supported(float3 pos) const;
+	// Smallest t in [tmin, tmax] at which pos + dir * t is in a supported cell, tmax if
+	// there is none.
+	float SkipEmpty(float3 pos, float3 dir, float tmin, float tmax) const;
+
+	// Per support cell, 0 if supported, else the distance described above; x-major, as
+	// floats for the packet tracer to gather. Cell (sx, sy, sz) holds the positions with
+	// (floor(pos) + 1) >> 3 == (sx, sy, sz).
+	const float* EmptyDistance() const { return empty_distance.data(); }
+	int SupportDims() const { return support_dims; }
+
+private:
+	int resolution = 0;
+	int leaf_dims = 0;		// leaves per axis
+	int root_dims = 0;		// nodes per axis
+	int support_dims = 0;	// support cells per axis, one more than leaf_dims
+
+	vector<int32_t> root;
+	vector<Node> nodes;
+	vector<float> leaves;				// SPARSE_LEAF_VOXELS per leaf, x-major inside the leaf
+	vector<int32_t> leaf_offset;
+	vector<float> empty_distance;
+
+	const float* Leaf(int lx, int ly, int lz) const;
+	float CellDistance(int sx, int sy, int sz) const { return empty_distance[((size_t)sx * support_dims + sy) * support_dims + sz]; }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+// Unit-sphere sample directions for SphereRandom3 (radiancePredict's MRPNN stencil).
+// Included by vector.cu for the kernels, and by cpu_render.cpp with the CUDA qualifiers
+// stripped for the host feature gathering.
+
+__device__ __constant__ float3 Spn0[8] = {
+float3{0.000000,0.000000,0.000000},
+float3{1.000000,0.000000,0.000000},
+float3{0.666667,-0.549602,0.503481},
+float3{0.333333,0.082426,-0.939199},
+float3{0.000000,0.608439,0.793601},
+float3{-0.333333,-0.928397,-0.164220},
+float3{-0.666667,0.628898,-0.400053},
+float3{-1.000000,-0.000000,0.000000},
+};
+
+__device__ __constant__ float3 Spn1[8] = {
+float3{0.000000,1.000000,0.000000},float3{-0.516051,0.714286,0.472745},float3{0.078990,0.428571,-0.900048},float3{0.602198,0.142857,0.785461},
+float3{-0.974614,-0.142857,-0.172395},float3{0.762340,-0.428571,-0.484938},float3{-0.181685,-0.714286,0.675860},float3{-0.000000,-1.000000,-0.000000},
+};
+
+__device__ __constant__ float3 Spn2[16] = {
+float3{0.000000,0.000000,1.000000},float3{0.336994,-0.367864,0.866667},float3{-0.677266,0.059438,0.733333},float3{0.634881,0.486751,0.600000},
+float3{-0.154052,-0.870913,0.466667},float3{-0.506032,0.795500,0.333333},float3{0.946204,-0.254359,0.200000},float3{-0.885474,-0.459882,0.066667},
+float3{0.342275,0.937232,-0.066667},float3{0.373847,-0.905670,-0.200000},float3{-0.853934,0.399606,-0.333333},float3{0.843895,0.264697,-0.466667},
+float3{-0.401126,-0.692169,-0.600000},float3{-0.145981,0.664012,-0.733333},float3{0.408121,-0.286925,-0.866667},float3{-0.000000,-0.000000,-1.000000},
+};
+
+__device__ __constant__ float3 Spn3[16] = {
+float3{0.628945,0.674911,-0.385907},float3{0.418351,0.439884,-0.794660},float3{0.926019,0.329212,0.184683},float3{-0.225970,0.925107,-0.305147},
+float3{0.672535,-0.317517,-0.668490},float3{0.324828,0.606254,0.725908},float3{-0.470630,0.251300,-0.845787},float3{0.815736,-0.533206,0.224201},
+float3{-0.575729,0.689246,0.439859},float3{-0.112624,-0.630502,-0.767974},float3{0.276062,-0.215587,0.936649},float3{-0.977336,0.119351,-0.174841},
+float3{0.122688,-0.992256,0.019382},float3{-0.562275,-0.092724,0.821736},float3{-0.747574,-0.653927,-0.116242},float3{-0.628945,-0.674911,0.385907},
+};
+
+__device__ __constant__ float3 Spn4[16] = {
+float3{-0.513486,-0.802627,-0.303516},float3{-0.329417,-0.930220,0.161785},float3{-0.113287,-0.521353,-0.845788},float3{-0.950328,-0.222046,0.218111},
+float3{0.464981,-0.885166,0.016571},float3{-0.521976,0.229310,-0.821558},float3{-0.345623,-0.356336,0.868084},float3{0.701860,-0.285260,-0.652701},
+float3{-0.803928,0.594684,0.007127},float3{0.593662,-0.395610,0.700755},float3{0.266437,0.545373,-0.794719},float3{-0.335359,0.492208,0.803284},
+float3{0.994251,0.088891,0.059699},float3{-0.041402,0.990302,-0.132615},float3{0.469425,0.505778,0.723761},float3{0.513486,0.802627,0.303516},
+};
+
+//0.662213
+__device__ __constant__ float3 SpVn5[32] = {
+float3{0.382081,0.918886,-0.098303},float3{0.650970,0.595892,0.470267},
+float3{0.550136,-0.754869,0.357104},float3{-0.181620,-0.226392,0.315110},
+float3{0.896833,0.419476,-0.138502},float3{-0.846077,0.475248,0.241414},
+float3{-0.118985,-0.729624,-0.673418},float3{-0.202309,0.321186,-0.001336},
+float3{-0.387992,0.920914,0.037136},float3{-0.651299,-0.241163,-0.719479},
+float3{-0.226884,0.258907,-0.938876},float3{0.217251,0.314177,0.919230},
+float3{0.823361,-0.030952,0.566674},float3{-0.648360,-0.662882,0.374455},
+float3{0.292507,0.335440,-0.491240},float3{-0.256196,-0.179743,0.949766},
+float3{0.353981,-0.354754,0.865359},float3{0.543675,-0.709539,-0.448299},
+float3{0.248602,-0.236637,-0.939250},float3{-0.072767,-0.771426,0.632144},
+float3{0.376908,0.055425,0.107197},float3{-0.152183,0.820610,-0.550854},
+float3{-0.762858,0.434625,-0.478684},float3{-0.604668,-0.753714,-0.257473},
+float3{0.800153,-0.074823,-0.595110},float3{0.047339,0.850153,0.524403},
+float3{-0.789310,-0.083667,0.608267},float3{-0.435870,0.459988,0.773575},
+float3{0.940615,-0.339424,-0.005972},float3{-0.939158,-0.149618,-0.079873},
+float3{0.017382,-0.945689,-0.034440},float3{-0.045413,-0.211751,-0.306299}
+};
+
+//0.658209
+__device__ __constant__ float3 SpVn6[32] = {
+float3{-0.727243,-0.193675,0.567283},float3{-0.295083,-0.828711,0.475567},
+float3{-0.995703,-0.076032,-0.052861},float3{0.406178,0.627644,0.664141},
+float3{0.453177,-0.018639,0.891226},float3{0.034613,0.066587,0.389293},
+float3{-0.211494,0.858032,0.468029},float3{-0.805961,0.499459,0.317753},
+float3{-0.711991,-0.228635,-0.654137},float3{0.720579,0.535021,-0.441042},
+float3{0.373046,-0.669333,0.642518},float3{0.683159,-0.730082,0.016564},
+float3{-0.386891,0.323358,0.863571},float3{0.948147,-0.134710,-0.287874},
+float3{-0.129105,0.402723,-0.050831},float3{0.437607,-0.645013,-0.626465},
+float3{0.876379,-0.234138,0.420880},float3{0.881941,0.419503,0.214937},
+float3{-0.295534,-0.763040,-0.574830},float3{0.201295,-0.357166,0.034116},
+float3{0.090924,-0.992554,-0.081048},float3{-0.329153,-0.143500,-0.075175},
+float3{0.110731,0.736193,-0.667652},float3{0.527626,0.025130,-0.849105},
+float3{-0.721017,-0.690451,-0.058410},float3{-0.161251,-0.320616,0.933383},
+float3{-0.046937,-0.277278,-0.959643},float3{0.344410,0.938620,0.019314},
+float3{0.127436,0.018955,-0.397832},float3{-0.793211,0.464290,-0.394019},
+float3{-0.358985,0.309343,-0.880589},float3{-0.337826,0.918535,-0.205349}
+};
+
+//0.644014
+__device__ __constant__ float3 SpVn7[32] = {
+float3{-0.410460,-0.591758,-0.693790},float3{0.345327,0.801148,0.488785},
+float3{-0.331667,-0.940133,-0.075232},float3{-0.862656,-0.487171,-0.126874},
+float3{0.369731,0.254916,0.014690},float3{-0.744325,0.659225,0.106789},
+float3{-0.053761,-0.828511,0.557386},float3{-0.125478,-0.240730,0.962237},
+float3{0.062130,-0.197417,-0.351812},float3{-0.657577,-0.492287,0.570303},
+float3{0.353328,0.715205,-0.602790},float3{-0.383008,-0.047040,0.228408},
+float3{0.816554,-0.436954,-0.377240},float3{0.557326,-0.800918,0.218903},
+float3{-0.818517,0.251103,-0.505864},float3{0.829851,0.427577,0.358505},
+float3{-0.194640,0.403027,-0.118038},float3{0.177782,-0.232706,0.295433},
+float3{-0.253527,0.068370,-0.947231},float3{0.017371,0.305274,0.491131},
+float3{0.934119,-0.225524,0.276239},float3{-0.260850,0.723730,-0.638884},
+float3{0.264240,-0.861446,-0.433692},float3{-0.555007,0.258905,0.790529},
+float3{0.597648,0.800227,-0.049532},float3{0.510981,0.224669,0.829338},
+float3{-0.250464,0.888485,0.384352},float3{0.513797,-0.376265,0.770998},
+float3{0.539898,0.053152,-0.840034},float3{0.947216,0.229984,-0.223358},
+float3{-0.966975,0.104162,0.232617},float3{0.021570,0.986682,-0.159492}
+};
@@ -0,0 +1,182 @@
+#include "tr_solver.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+inline float Component(float3 v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+inline bool SameDir(float3 a, float3 b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+float AngleDegrees(float3 a, float3 b) {
+	float c = dot(a, b) / max(length(a) * length(b), 1e-20f);
+	return acos(min(max(c, -1.0f), 1.0f)) * (180.0f / 3.1415926535f);
+}
+
+}
+
+void TRSolver::Reset(float* const* density, int level_num, int baseResolution) {
+	levels.resize(level_num);
+	total_slices = 0;
+	for (int l = 0; l < level_num; l++) {
+		Level& level = levels[l];
+		level.resolution = baseResolution >> l;
+		level.density = density[l];
+		size_t voxels = (size_t)level.resolution * level.resolution * level.resolution;
+		level.depth.assign(voxels, 0.0f);
+		level.next.assign(voxels, 0.0f);
+		total_slices += level.resolution;
+	}
+	published = false;
+	sweeping = false;
+	published_alpha.clear();
+}
+
+void TRSolver::StartSweep(float3 lightDir) {
+	float3 a = abs(lightDir);
+	axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+	float major = Component(lightDir, axis);
+	toward = major > 0 ? 1 : -1;
+	inv_major = 1.0f / abs(major);
+	// Both in [-1, 1] voxels, since axis is the dominant one.
+	offset_a = Component(lightDir, (axis + 1) % 3) * inv_major;
+	offset_b = Component(lightDir, (axis + 2) % 3) * inv_major;
+
+	sweep_dir = lightDir;
+	sweep_level = 0;
+	sweep_slice = 0;
+	sweeping = true;
+}
+
+void TRSolver::BeginLevel(const Level& level) {
+	// Enough rays that every voxel of every slice has all four around it.
+	float far = level.resolution - 1.0f;
+	lo_a = (int)floor(min(0.0f, far * offset_a));
+	lo_b = (int)floor(min(0.0f, far * offset_b));
+	lines_a = (int)ceil(far + max(0.0f, far * offset_a)) + 2 - lo_a;
+	lines_b = (int)ceil(far + max(0.0f, far * offset_b)) + 2 - lo_b;
+	ray_depth.assign((size_t)lines_a * lines_b, 0.0f);
+	ray_density.assign((size_t)lines_a * lines_b, 0.0f);
+}
+
+void TRSolver::SweepSlice(Level& level, int k) {
+	const int n = level.resolution;
+	const size_t stride[3] = { (size_t)n * n, (size_t)n, 1 };
+	const size_t sd = stride[axis], sa = stride[(axis + 1) % 3], sb = stride[(axis + 2) % 3];
+	// Slice k counts from the lit face inwards.
+	const size_t slice = (size_t)(toward > 0 ? n - 1 - k : k) * sd;
+	// Ray parameter per slice, in the same units Sample_TR integrates in (box size 1).
+	const float half_dt = 0.5f * inv_major / n;
+
+	const float* rho = level.density;
+	auto Density = [&](int a, int b) {
+		if (a < 0 || b < 0 || a >= n || b >= n)
+			return 0.0f;
+		return max(0.0f, rho[slice + a * sa + b * sb]);
+	};
+
+	// Rays: one trapezoid step from the previous slice to this one. The bilinear weights
+	// are the same for the whole slice.
+	float shift_a = -k * offset_a, shift_b = -k * offset_b;
+	int fa = (int)floor(shift_a), fb = (int)floor(shift_b);
+	float wa = shift_a - fa, wb = shift_b - fb;
+	parallel::parallel_for(lines_a, [&](int i) {
+		int a = lo_a + i + fa;
+		for (int j = 0; j < lines_b; j++) {
+			int b = lo_b + j + fb;
+			float r = lerp(lerp(Density(a, b), Density(a, b + 1), wb), lerp(Density(a + 1, b), Density(a + 1, b + 1), wb), wa);
+			size_t ray = (size_t)i * lines_b + j;
+			ray_depth[ray] += half_dt * (ray_density[ray] + r);
+			ray_density[ray] = r;
+		}
+	});
+
+	// Voxels: depth of the four rays around them.
+	int ga = (int)floor(-shift_a), gb = (int)floor(-shift_b);
+	float va = -shift_a - ga, vb = -shift_b - gb;
+	float* tau = level.next.data();
+	parallel::parallel_for(n, [&](int a) {
+		const float* row0 = ray_depth.data() + (size_t)(a + ga - lo_a) * lines_b + gb - lo_b;
+		const float* row1 = row0 + lines_b;
+		for (int b = 0; b < n; b++)
+			tau[slice + a * sa + b * sb] = lerp(lerp(row0[b], row0[b + 1], vb), lerp(row1[b], row1[b + 1], vb), va);
+	});
+}
+
+bool TRSolver::ContinueSweep(int budget) {
+	stats.slices = 0;
+	while (budget-- > 0 && sweep_level < (int)levels.size()) {
+		if (sweep_slice == 0)
+			BeginLevel(levels[sweep_level]);
+		SweepSlice(levels[sweep_level], sweep_slice);
+		stats.slices++;
+		if (++sweep_slice == levels[sweep_level].resolution) {
+			sweep_level++;
+			sweep_slice = 0;
+		}
+	}
+	if (sweep_level < (int)levels.size())
+		return false;
+
+	for (auto& level : levels)
+		level.depth.swap(level.next);
+	sweeping = false;
+	published = true;
+	published_dir = sweep_dir;
+	stats.sweeps++;
+	return true;
+}
+
+void TRSolver::Publish(const float* alpha, float* const* tr) {
+	published_alpha.assign(alpha, alpha + levels.size());
+	for (int l = 0; l < (int)levels.size(); l++) {
+		const Level& level = levels[l];
+		const int n = level.resolution;
+		const float a = alpha[l];
+		const float* depth = level.depth.data();
+		float* out = tr[l];
+		parallel::parallel_for(n, [&](int x) {
+			size_t begin = (size_t)x * n * n, end = begin + (size_t)n * n;
+			for (size_t i = begin; i < end; i++)
+				out[i] = exp(-a * depth[i]);
+		});
+	}
+}
+
+void TRSolver::Solve(float3 lightDir, const float* alpha, float* const* tr) {
+	StartSweep(lightDir);
+	ContinueSweep(total_slices);
+	Publish(alpha, tr);
+}
+
+bool TRSolver::Advance(float3 lightDir, const float* alpha, float* const* tr, float fraction, float maxAngle) {
+	if (published && !sweeping && !SameDir(lightDir, published_dir))
+		StartSweep(lightDir);
+
+	bool rewritten = false;
+	if (sweeping && ContinueSweep(max(1, (int)ceil(fraction * total_slices)))) {
+		Publish(alpha, tr);
+		rewritten = true;
+	}
+
+	if (!published || AngleDegrees(lightDir, published_dir) > maxAngle) {
+		if (published)
+			stats.syncSolves++;
+		Solve(lightDir, alpha, tr);
+		return true;
+	}
+
+	if (!rewritten && !equal(published_alpha.begin(), published_alpha.end(), alpha)) {
+		Publish(alpha, tr);
+		rewritten = true;
+	}
+	return rewritten;
+}
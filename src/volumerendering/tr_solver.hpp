@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector_types.h>
+
+#include "vector.cuh"
+
+#include <vector>
+using namespace std;
+
+// Light-space solver for the transmittance volumes (tr_mips). Instead of marching 128
+// samples towards the light from every voxel, it walks the slices perpendicular to the
+// dominant axis of the light, starting at the lit face, carrying a grid of parallel light
+// rays one voxel apart. Each slice adds one trapezoid step of density to every ray, and
+// the voxels of the slice interpolate their optical depth between the four rays around
+// them. Depth is only interpolated once per voxel, never from an interpolated slice, so
+// shadow edges do not smear as the sweep goes on. O(N^3) per level, and the depth is
+// kept, so a change of alpha alone is only an exp() per voxel.
+//
+// Advance() spreads a sweep over several calls for animated lights: the published volumes
+// stay at the direction of the last finished sweep, and if the light gets more than
+// maxAngle degrees away from it the sweep is abandoned for a full synchronous Solve().
+
+struct TRSolveStats {
+	int slices = 0;			// slices swept by the last call
+	int sweeps = 0;			// finished sweeps, total
+	int syncSolves = 0;		// Advance() calls that had to fall back to Solve()
+};
+
+class TRSolver {
+public:
+	// density[l] is (baseResolution >> l)^3, x-major, and must outlive the solver.
+	// Drops any published or partial result.
+	void Reset(float* const* density, int levels, int baseResolution);
+
+	// tr[l] = exp(-alpha[l] * depth) for lightDir, every level in one go.
+	void Solve(float3 lightDir, const float* alpha, float* const* tr);
+	// fraction: share of a full sweep to do in this call. Returns true when tr was
+	// rewritten; always keeps the published direction within maxAngle of lightDir.
+	bool Advance(float3 lightDir, const float* alpha, float* const* tr, float fraction, float maxAngle);
+
+	bool Busy() const { return sweeping; }
+	const TRSolveStats& Stats() const { return stats; }
+
+private:
+	struct Level {
+		int resolution;
+		const float* density;
+		vector<float> depth;	// published
+		vector<float> next;		// sweep in progress
+	};
+	vector<Level> levels;
+	int total_slices = 0;
+
+	bool published = false;
+	float3 published_dir;
+	vector<float> published_alpha;
+
+	bool sweeping = false;
+	float3 sweep_dir;
+	int sweep_level = 0;
+	int sweep_slice = 0;
+	int axis = 0;			// dominant axis of sweep_dir
+	int toward = 1;			// slice step towards the light
+	float inv_major = 1;	// 1 / |sweep_dir[axis]|
+	float offset_a = 0;		// in-plane ray offset per slice away from the light
+	float offset_b = 0;
+
+	// Rays of the level being swept: depth and last density sample, lines_a x lines_b,
+	// ray (i, j) passes slice k at (lo_a + i - k * offset_a, lo_b + j - k * offset_b).
+	int lo_a = 0, lo_b = 0, lines_a = 0, lines_b = 0;
+	vector<float> ray_depth, ray_density;
+
+	TRSolveStats stats;
+
+	void StartSweep(float3 lightDir);
+	void BeginLevel(const Level& level);
+	void SweepSlice(Level& level, int slice);
+	// Runs up to `budget` slices; true when the sweep finished and next became depth.
+	bool ContinueSweep(int budget);
+	void Publish(const float* alpha, float* const* tr);
+};
@@ -1,15 +1,15 @@
 #include "volume.hpp"
 
-#include "hdr_loader.h"
-
 #include "render.cuh"
+#include "volume_parser.hpp"
+#include "mip_builder.hpp"
 
 #include "platform.h"
+#include <chrono>
 #include <thread>
+#include <random>
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 
 #include <direct.h>
 #include <cerrno>
@@ -366,6 +366,9 @@ float3 VolumeRender::GetTr(float3 ori, float3 dir, float3 lightDir, float alpha,
 
 vector<float3> VolumeRender::GetRadiances(vector<float3> ori, vector<float3> dir, float3 lightDir, float3 lightColor, float alpha, int multiScatter, float g, int sampleNum, RenderType rt) {
 
+    if (cpu_backend)
+        return GetRadiancesCPU(ori, dir, lightDir, lightColor, alpha, multiScatter, g, sampleNum, rt);
+
     if (rt != RenderType::PT) {
         UpdateHGLut(g);
         Update_TR(lightDir, alpha);
@@ -448,6 +451,9 @@ float3 last_ori, last_forward, last_up, last_right;
 
 vector<float3> VolumeRender::Render(int2 size, float3 ori, float3 up, float3 right, float3 lightDir, RenderType rt, float g, float alpha, float3 lightColor, int multiScatter, int sampleNum) {
 
+    if (cpu_backend)
+        return RenderCPU(size, ori, up, right, lightDir, g, alpha, lightColor, multiScatter, sampleNum, rt);
+
     float3* results;
     cudaMalloc(&results, size.x * size.y * sizeof(float3));
 
@@ -459,12 +465,7 @@ vector<float3> VolumeRender::Render(int2 size, float3 ori, float3 up, float3 rig
 
             if (static_cast <float> (rand()) / static_cast <float> (RAND_MAX) < rate) {
                 float3 rnd = Roberts2(rand_cpu);
-                float3 dir = UniformSampleSphere(float2{ rnd.x, rnd.y });
-
-                float2 uv = float2{ atan2f(-dir.z, dir.x) * (float)(0.5 / 3.1415926) + 0.5f, acosf(fmaxf(fminf(dir.y, 1.0f), -1.0f)) * (float)(1.0 / 3.1415926) };
-
-                lightDir = dir;
-                lightColor = hdri_img.Sample(uv) * hdri_exp * 4 / rate;
+                lightColor = SampleEnvironment(float2{ rnd.x, rnd.y }, lightDir) / rate;
             }
             else
                 lightColor = lightColor / (1 - rate);
@@ -513,12 +514,7 @@ void VolumeRender::Render(float4* target, Histogram* histo_buffer, unsigned int*
 
         if (static_cast <float> (rand()) / static_cast <float> (RAND_MAX) < rate) {
             float3 rnd = Roberts2(rand_cpu);
-            float3 dir = UniformSampleSphere(float2{ rnd.x, rnd.y });
-
-            float2 uv = float2{ atan2f(-dir.z, dir.x) * (float)(0.5 / 3.1415926) + 0.5f, acosf(fmaxf(fminf(dir.y, 1.0f), -1.0f)) * (float)(1.0 / 3.1415926) };
-
-            lightDir = dir;
-            lightColor = hdri_img.Sample(uv) * hdri_exp * 4 / rate;
+            lightColor = SampleEnvironment(float2{ rnd.x, rnd.y }, lightDir) / rate;
         }
         else
             lightColor = lightColor / (1 - rate);
@@ -782,33 +778,76 @@ inline float Sample_TR(float* data, int res, float3 uv,float alpha,float3 lightD
     return TR_MUL * shadowterm;//
 }
 
+inline float Sample(const SparseVolume& volume, float3 uv) {
+    return volume.Sample(uv);
+}
+// Same march as above on the sparse tree; steps in cells no lookup can see density in
+// read zero, so runs of them are skipped in one go.
+inline float Sample_TR(const SparseVolume& volume, float3 uv, float alpha, float3 lightDir) {
+    const int MaxStep = 128;
+    float3 ori = uv - 0.5;
+    float dis = RayBoxDistance(ori, lightDir);
+    float MaxStepInv = dis / MaxStep;
+    float phase = 1.0;
+    int res = volume.Resolution();
+    // voxel space, parameterised by step index
+    float3 vox_ori = uv * res - 0.5;
+    float3 vox_dir = lightDir * (MaxStepInv * res);
+    float shadowdist = 0;
+    for (int i = 1; i <= MaxStep; i++)
+    {
+        float t = volume.SkipEmpty(vox_ori, vox_dir, (float)i, MaxStep + 1.0f);
+        if (t > i) {
+            i = (int)ceil(t);
+            if (i > MaxStep) break;
+        }
+        shadowdist = shadowdist + Sample(volume, ori + lightDir * (MaxStepInv * i) + 0.5f);
+    }
+    float shadowterm = exp(-shadowdist * alpha * MaxStepInv) * phase;
+    return TR_MUL * shadowterm;
+}
+
 struct InitWeight {
     InitWeight();
 };
 
 void VolumeRender::MallocMemory() {
-    cudaFree(0);
+    int device_count = 0;
+    if (cudaGetDeviceCount(&device_count) != cudaSuccess || device_count == 0) {
+        printf("No CUDA device found, using the CPU renderer.\n");
+        cpu_backend = true;
+    }
+    else
+        cudaFree(0);
 
+    dense_released = false;
+    sparse_datas.Clear();
     datas = new float[resolution * resolution * resolution];
     hglut = new float[LUT_SIZE * LUT_SIZE];
     channel_desc = cudaCreateChannelDesc<float>();
     size = cudaExtent{ (size_t)resolution, (size_t)resolution, (size_t)resolution };
-    cudaMalloc3DArray(&datas_dev, &channel_desc, size);
+    if (!cpu_backend)
+        cudaMalloc3DArray(&datas_dev, &channel_desc, size);
 
     for (int i = 0; i < 9; i++) {
         int reso = 256 >> i;
         mips[i] = new float[reso * reso * reso];
         mip_size[i] = cudaExtent{ (size_t)reso, (size_t)reso, (size_t)reso };
-        cudaMalloc3DArray(mips_dev + i, &channel_desc, mip_size[i]);
+        mips_dev[i] = 0;
+        if (!cpu_backend)
+            cudaMalloc3DArray(mips_dev + i, &channel_desc, mip_size[i]);
     }
     for (int i = 0; i < 8; i++) {
         int reso = 128 >> i;
         tr_mips[i] = new float[reso * reso * reso];
         tr_mip_size[i] = cudaExtent{ (size_t)reso, (size_t)reso, (size_t)reso };
-        cudaMalloc3DArray(tr_mips_dev + i, &channel_desc, tr_mip_size[i], cudaArraySurfaceLoadStore);
+        tr_mips_dev[i] = 0;
+        if (!cpu_backend)
+            cudaMalloc3DArray(tr_mips_dev + i, &channel_desc, tr_mip_size[i], cudaArraySurfaceLoadStore);
     }
 
-    cudaMallocArray(&hglut_dev, &channel_desc, LUT_SIZE, LUT_SIZE, cudaArraySurfaceLoadStore);
+    if (!cpu_backend)
+        cudaMallocArray(&hglut_dev, &channel_desc, LUT_SIZE, LUT_SIZE, cudaArraySurfaceLoadStore);
 }
 
 //InitWeight weight;
@@ -824,6 +863,11 @@ VolumeRender::VolumeRender(string path) {
     } else {
         printf("getcwd() error: %s\n", strerror(errno));
     }
+    string cachePath = path + ".cvol";
+    if (LoadVolumeFile(cachePath))
+        return;
+
+    // Older caches are still read once and converted.
     string filePath = path + ".bin";
     printf("Attempting to open file at: %s\n", filePath.c_str());
     if (FILE* file = fopen(filePath.c_str(), "rb")) {
@@ -832,107 +876,110 @@ VolumeRender::VolumeRender(string path) {
         fread(datas, sizeof(float), resolution * resolution * resolution, file);
         fclose(file);
         Update();
+        SaveVolumeFile(cachePath);
         return;
     }
 
     string format = path.substr(path.size() - 3, 3);
-    if (format == "txt") {
-        FILE* f = fopen(path.c_str(), "r");
-        fscanf(f, "%d", &resolution);
-        int total = resolution * resolution * resolution;
-        MallocMemory();
-        int index = 0;
-        int loop_num = (total / 8) + (total % 8 != 0 ? 1 : 0);
-        while (index < loop_num) {
-            fscanf(f, "%f %f %f %f %f %f %f %f", datas + index * 8,
-                datas + index * 8 + 1,
-                datas + index * 8 + 2,
-                datas + index * 8 + 3,
-                datas + index * 8 + 4,
-                datas + index * 8 + 5,
-                datas + index * 8 + 6,
-                datas + index * 8 + 7);
-            index++;
+    int reported = -1;
+    auto progress = [&](float p) {
+        int step = (int)(p * 8);
+        if (step > reported) {
+            reported = step;
+            printf("Loading %s percent:%.2f%%\n", format.c_str(), 100.0 * p);
         }
-        fclose(f);
+    };
+    VolumeParseStats stats;
+    long long values = -1;
+    long long expected = 0;
+    if (format == "txt") {
+        values = ParseTxtFile(path, [&](int res) {
+            resolution = res;
+            expected = (long long)res * res * res;
+            MallocMemory();
+            return datas;
+        }, progress, &stats);
     }
     else if (format == "vox") {
         resolution = 256;
         MallocMemory();
-        ifstream infile(path);
-        string line;
-        int i = 0;
-        float inv = 64.0 / 255.0;
-        while (!infile.eof()) {
-            getline(infile, line); 
-            string firstc = line.substr(0, 1);
-            if (firstc != std::string("w") && firstc != std::string("h") && firstc != std::string("d")) {
-                if (i >= 256 * 256 * 256) break;
-                if (i % (256 * 256 * 32) == 0) printf("Loading vox percent:%.2f%%\n", 100.0 * (float)i / (256 * 256 * 256));
-                stringstream data(line);
-                int d[64];
-                data >> d[0] >> d[1] >> d[2] >> d[3] >> d[4] >> d[5] >> d[6] >> d[7]
-                    >> d[8] >> d[9] >> d[10] >> d[11] >> d[12] >> d[13] >> d[14] >> d[15]
-                    >> d[16] >> d[17] >> d[18] >> d[19] >> d[20] >> d[21] >> d[22] >> d[23]
-                    >> d[24] >> d[25] >> d[26] >> d[27] >> d[28] >> d[29] >> d[30] >> d[31]
-                    >> d[32] >> d[33] >> d[34] >> d[35] >> d[36] >> d[37] >> d[38] >> d[39]
-                    >> d[40] >> d[41] >> d[42] >> d[43] >> d[44] >> d[45] >> d[46] >> d[47]
-                    >> d[48] >> d[49] >> d[50] >> d[51] >> d[52] >> d[53] >> d[54] >> d[55]
-                    >> d[56] >> d[57] >> d[58] >> d[59] >> d[60] >> d[61] >> d[62] >> d[63];
-                for (int j = 0; j < 64; j++)
-                    datas[i + j] = (float)d[j] * inv;
-                i += 64;
-            }
-        }
-        infile.close();
+        expected = 256 * 256 * 256;
+        values = ParseVoxFile(path, datas, expected, progress, &stats);
     }
-    else
+    if (values < 0)
     {
         printf("File not found!\n");
         return;
     }
+    if (values < expected)
+        printf("%s holds %lld of %lld voxels, the rest are left empty.\n", path.c_str(), values, expected);
+    printf("Parsed %.1f MB in %.3f s (%.1f MB/s, %d threads).\n", stats.bytes / (1024.0 * 1024.0), stats.seconds, stats.bytes / (1024.0 * 1024.0) / stats.seconds, stats.threads);
 
     Update();
 
-    {
-        FILE* file = fopen((path + ".bin").c_str(), "wb");
-        fwrite(&resolution, sizeof(int), 1, file);
-        fwrite(datas, sizeof(float), resolution * resolution * resolution, file);
-        fclose(file);
-    }
+    SaveVolumeFile(cachePath);
+}
+
+bool VolumeRender::LoadVolumeFile(string path) {
+    auto start_time = chrono::steady_clock::now();
+    VolumeFile file;
+    if (!file.Open(path))
+        return false;
+
+    // The renderer, the GPU upload and the host structures below all want dense grids, so
+    // every level is decoded here and every page of the mapping is read.
+    resolution = file.Header().resolution;
+    MallocMemory();
+    file.DecodeLevel(0, datas);
+    for (int i = 0; i < 9; i++)
+        file.DecodeLevel(i + 1, mips[i]);
+    max_density = file.Header().maxDensity;
+    BuildStats();
+    BuildSparse();
+    tr_solver.Reset(mips + 1, 8, 128);
+    tr_alpha = -1;
+    tr_host_alpha = -1;
+    UploadVolume();
+    ReleaseDense();
+
+    printf("Loaded %s: %d^3, %.1f MB mapped, %.3f s\n", path.c_str(), resolution, file.MappedBytes() / (1024.0 * 1024.0),
+        chrono::duration<double>(chrono::steady_clock::now() - start_time).count());
+    return true;
+}
+
+bool VolumeRender::SaveVolumeFile(string path, VolumeFileEncoding encoding) {
+    bool released = dense_released;
+    RestoreDense();
+    bool saved = VolumeFile::Write(path, datas, resolution, mips, max_density, encoding);
+    if (released)
+        ReleaseDense();
+    return saved;
 }
 
 VolumeRender::~VolumeRender() {
-    cudaFreeArray(datas_dev);
-    cudaFreeArray(hglut_dev);
+    if (datas_dev != 0) cudaFreeArray(datas_dev);
+    if (hglut_dev != 0) cudaFreeArray(hglut_dev);
     delete[]datas;
     delete[]hglut;
     for (int i = 0; i < 9; i++) {
         delete[] mips[i];
-        cudaFreeArray(mips_dev[i]);
+        if (mips_dev[i] != 0) cudaFreeArray(mips_dev[i]);
     }
     for (int i = 0; i < 8; i++) {
         delete[] tr_mips[i];
-        cudaFreeArray(tr_mips_dev[i]);
+        if (tr_mips_dev[i] != 0) cudaFreeArray(tr_mips_dev[i]);
     }
 
     if (env_tex_dev != 0) {
         cudaFreeArray(env_tex_dev);
     }
-    if (hdri_img.data != 0) {
-        delete hdri_img.data;
-    }
-
 }
 
 void VolumeRender::SetData(int x, int y, int z, float value) {
+    RestoreDense();
     datas[(x * resolution + y) * resolution + z] = value;
 }
 
-void VolumeRender::SetDatas(FillFunc func) {
-    ParallelFill(datas, resolution, func);
-}
-
 __device__ static const float FloatOneMinusEpsilon = 0.99999994;
 #define OneMinusEpsilon FloatOneMinusEpsilon
 __device__ static const unsigned int PrimeTableSize = 46;
@@ -1191,6 +1238,90 @@ float VolumeRender::GetHGLut(float cos, float angle)
     return axx;
 }
 void VolumeRender::Update() {
+    RestoreDense();
+    BuildMips(datas, resolution, mips);
+    BuildStats();
+    max_density = density_stats.MaxDensity();
+
+    BuildSparse();
+    tr_solver.Reset(mips + 1, 8, 128);
+    tr_alpha = -1;
+    tr_host_alpha = -1;
+    UploadVolume();
+    ReleaseDense();
+}
+
+void VolumeRender::BuildStats() {
+    density_stats.Build(datas, resolution);
+    mip_stats.Build(mips[0], 256);
+    printf("Volume stats: max density %g, %d^3 bricks, mean majorant %.1f%% of max, %.3f s\n",
+        density_stats.MaxDensity(), mip_stats.BrickDims(), mip_stats.MajorantRatio() * 100.0,
+        density_stats.Seconds() + mip_stats.Seconds());
+}
+
+void VolumeRender::BuildSparse() {
+    auto start_time = chrono::steady_clock::now();
+    size_t sparse_bytes = 0;
+    size_t dense_bytes = 0;
+    for (int mip = 0; mip < 9; mip++)
+    {
+        int res = 256 >> mip;
+        sparse_mips[mip].Build(mips[mip], res);
+        sparse_bytes += sparse_mips[mip].MemoryBytes();
+        dense_bytes += (size_t)res * res * res * sizeof(float);
+    }
+    printf("Sparse volume: %d of %d leaves occupied at mip 0, %.1f MB vs %.1f MB dense, %.3f s\n",
+        sparse_mips[0].LeafCount(), 32 * 32 * 32, sparse_bytes / (1024.0 * 1024.0), dense_bytes / (1024.0 * 1024.0),
+        chrono::duration<double>(chrono::steady_clock::now() - start_time).count());
+}
+
+void VolumeRender::ReleaseDense() {
+    if (!cpu_backend || dense_released || !sparse_mips[0].IsBuilt())
+        return;
+    auto host_bytes = [&](size_t& dense, size_t& sparse) {
+        dense = datas != nullptr ? (size_t)resolution * resolution * resolution * sizeof(float) : 0;
+        sparse = sparse_datas.MemoryBytes();
+        for (int mip = 0; mip < 9; mip++) {
+            int res = 256 >> mip;
+            dense += mips[mip] != nullptr ? (size_t)res * res * res * sizeof(float) : 0;
+            sparse += sparse_mips[mip].MemoryBytes();
+        }
+    };
+    size_t dense_before, sparse_before, dense_after, sparse_after;
+    host_bytes(dense_before, sparse_before);
+
+    // At 256^3, mips[0] is datas with negatives clamped, so its sparse copy serves both.
+    if (resolution != 256)
+        sparse_datas.Build(datas, resolution);
+    delete[] datas;
+    delete[] mips[0];
+    datas = nullptr;
+    mips[0] = nullptr;
+    dense_released = true;
+
+    host_bytes(dense_after, sparse_after);
+    printf("Host volume: %.1f MB dense + %.1f MB sparse, was %.1f MB dense + %.1f MB sparse (CPU backend keeps datas and mip 0 sparse only)\n",
+        dense_after / (1024.0 * 1024.0), sparse_after / (1024.0 * 1024.0), dense_before / (1024.0 * 1024.0), sparse_before / (1024.0 * 1024.0));
+}
+
+void VolumeRender::RestoreDense() {
+    if (!dense_released)
+        return;
+    size_t count = (size_t)resolution * resolution * resolution;
+    datas = new float[count];
+    mips[0] = new float[256 * 256 * 256];
+    sparse_mips[0].Decode(mips[0]);
+    if (sparse_datas.IsBuilt())
+        sparse_datas.Decode(datas);
+    else
+        memcpy(datas, mips[0], count * sizeof(float));
+    sparse_datas.Clear();
+    dense_released = false;
+}
+
+void VolumeRender::UploadVolume() {
+    if (cpu_backend)
+        return;
     cudaMemcpy3DParms copyParams = { 0 };
     copyParams.srcPtr = make_cudaPitchedPtr((void*)datas, resolution * sizeof(float), resolution, resolution);
     copyParams.dstArray = datas_dev;
@@ -1206,54 +1337,24 @@ void VolumeRender::Update() {
 
     cudaBindTextureToArray(_DensityVolume, datas_dev, channel_desc);
     CheckError;
-    float md = 0.00001;
-    for (int i = 0; i < resolution * resolution * resolution; i++)
-    {
-        md = max(md, datas[i]);
-    }
-    max_density = md;
+
     cudaMemcpyToSymbol(Resolution, &resolution, sizeof(int), 0, cudaMemcpyHostToDevice);
-    cudaMemcpyToSymbol(maxDensity, &md, sizeof(float), 0, cudaMemcpyHostToDevice);
+    cudaMemcpyToSymbol(maxDensity, &max_density, sizeof(float), 0, cudaMemcpyHostToDevice);
     CheckError;
-    int res = 256;
-    while (res * 2 < resolution) res <<= 1;
 
-    float* source = datas;
-    int source_res = resolution;
-    for (;res > 256; res >>= 1)
-    {
-        float* temp = new float[res * res * res];
-
-        ParallelFill(temp, res, [&](int x, int y, int z, float u, float v, float w) {
-            return Sample(source, source_res, float3{ u,v,w });
-        });
-
-        if (source != datas)
-            delete[] source;
-        source = temp;
-        source_res = res;
-    }
     for (int mip = 0; mip < 9; mip++)
     {
-        res = 256 >> mip;
-
-        ParallelFill(mips[mip], res, [&](int x, int y, int z, float u, float v, float w) {
-            return Sample(source, source_res, float3{ u,v,w });
-            });
-
-        if (mip == 0 && source != datas)
-            delete[] source;
-        source = mips[mip];
-        source_res = res;
+        int res = 256 >> mip;
         cudaMemcpy3DParms copyParams = { 0 };
-        copyParams.srcPtr = make_cudaPitchedPtr((void*)source, source_res * sizeof(float), source_res, source_res);
+        copyParams.srcPtr = make_cudaPitchedPtr((void*)mips[mip], res * sizeof(float), res, res);
         copyParams.dstArray = mips_dev[mip];
-        copyParams.extent = make_cudaExtent(source_res, source_res, source_res);
+        copyParams.extent = make_cudaExtent(res, res, res);
         copyParams.kind = cudaMemcpyHostToDevice;
         cudaMemcpy3D(&copyParams);
 
         CheckError;
     }
+
     #define BindMip(i)  Mip(i).normalized = true;\
                         Mip(i).filterMode = cudaFilterModeLinear;\
                         Mip(i).addressMode[0] = cudaAddressModeBorder;\
@@ -1301,42 +1402,38 @@ __global__ void Fill_TR(int res, float alpha, float3 lightDir) {
 void VolumeRender::Update_TR(float3 lightDir,float alpha, bool CPU) 
 {
 
-    if (lightDir.x == tr_lightDir.x && lightDir.y == tr_lightDir.y && lightDir.z == tr_lightDir.z && alpha == tr_alpha)
+    if (lightDir.x == tr_lightDir.x && lightDir.y == tr_lightDir.y && lightDir.z == tr_lightDir.z && alpha == tr_alpha && !tr_solver.Busy())
         return;
     tr_lightDir = lightDir;
     tr_alpha = alpha;
 
-    if (CPU) {
-        int res = 256;
+    if (CPU || tr_sweep) {
+        float level_alpha[8];
         for (int tr_mip = 0; tr_mip < 8; tr_mip++)
-        {
-            float* source = nullptr;
-            res = 128 >> tr_mip;
-            int source_res = res;
-            if (true)//(tr_mip == 0)//(true)//
-            {
-                source = mips[tr_mip + 1];
-                //float alphaScale = float(2 << tr_mip);
-                float alphaScale = pow(1.73f, tr_mip + 1.0f);
+            level_alpha[tr_mip] = alpha / pow(1.73f, tr_mip + 1.0f);
 
-                //todo : float alphaScale = tr_mip == 0? 1.0:pow(1.41, tr_mip);
+        // Plain transmittance; TR_MUL is 1.
+        if (tr_budget >= 1) {
+            tr_solver.Solve(lightDir, level_alpha, tr_mips);
+            tr_host_dir = lightDir;
+            tr_host_alpha = alpha;
+        }
+        else if (tr_solver.Advance(lightDir, level_alpha, tr_mips, tr_budget, tr_max_angle))
+            tr_host_alpha = -1;
+        else
+            return;
+        if (cpu_backend)
+            return;
 
-                ParallelFill(tr_mips[tr_mip], res, [&](int x, int y, int z, float u, float v, float w) {
-                    return Sample_TR(source, source_res, float3{ u,v,w }, alpha / alphaScale, lightDir);
-                    });
-            }
-            else
-            {
-                source = tr_mips[tr_mip - 1];
-                ParallelFill(tr_mips[tr_mip], res, [&](int x, int y, int z, float u, float v, float w) {
-                    return Sample(source, source_res << 1, float3{ u,v,w });
-                    });
-            }
-            source = tr_mips[tr_mip];
+        for (int tr_mip = 0; tr_mip < 8; tr_mip++)
+        {
+            if (tr_mips_dev[tr_mip] == 0)
+                continue;
+            int res = 128 >> tr_mip;
             cudaMemcpy3DParms copyParams = { 0 };
-            copyParams.srcPtr = make_cudaPitchedPtr((void*)source, source_res * sizeof(float), source_res, source_res);
+            copyParams.srcPtr = make_cudaPitchedPtr((void*)tr_mips[tr_mip], res * sizeof(float), res, res);
             copyParams.dstArray = tr_mips_dev[tr_mip];
-            copyParams.extent = make_cudaExtent(source_res, source_res, source_res);
+            copyParams.extent = make_cudaExtent(res, res, res);
             copyParams.kind = cudaMemcpyHostToDevice;
             cudaMemcpy3D(&copyParams);
 
@@ -1378,26 +1475,123 @@ void VolumeRender::Update_TR(float3 lightDir,float alpha, bool CPU)
 
 }
 
-void VolumeRender::SetHDRI(string path) {
-    unsigned int rx, ry;
-    float* pixels;
-    load_hdr_float4(&pixels, &rx, &ry, path.c_str());
+void VolumeRender::SetTRBudget(float fraction, float maxAngle)
+{
+    tr_budget = max(fraction, 0.0f);
+    tr_max_angle = maxAngle;
+}
 
+void VolumeRender::SetTRSweep(bool sweep)
+{
+    if (sweep == tr_sweep)
+        return;
+    tr_sweep = sweep;
+    // The device volumes came from the other path: solve from scratch on the next call.
+    tr_solver.Reset(mips + 1, 8, 128);
+    tr_alpha = -1;
+    tr_host_alpha = -1;
+}
+
+void VolumeRender::BenchmarkTR(float3 lightDir, float alpha, int frames)
+{
+    lightDir = normalize(lightDir);
+    float level_alpha[8];
+    vector<float> reference[8], solved[8];
+    float* solved_ptr[8];
+    for (int tr_mip = 0; tr_mip < 8; tr_mip++) {
+        int res = 128 >> tr_mip;
+        level_alpha[tr_mip] = alpha / pow(1.73f, tr_mip + 1.0f);
+        reference[tr_mip].resize(res * res * res);
+        solved[tr_mip].resize(res * res * res);
+        solved_ptr[tr_mip] = solved[tr_mip].data();
+    }
+
+    TRSolver solver;
+    solver.Reset(mips + 1, 8, 128);
+    auto start_time = chrono::steady_clock::now();
+    solver.Solve(lightDir, level_alpha, solved_ptr);
+    double sweep_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+    printf("TR volumes, light (%.2f, %.2f, %.2f), alpha %.1f:\n", lightDir.x, lightDir.y, lightDir.z, alpha);
+    printf("  level  res   Sample_TR   rms err   max err\n");
+    double march_seconds = 0;
+    for (int tr_mip = 0; tr_mip < 8; tr_mip++) {
+        int res = 128 >> tr_mip;
+        const SparseVolume& sparse = sparse_mips[tr_mip + 1];
+        float* source = mips[tr_mip + 1];
+        start_time = chrono::steady_clock::now();
+        ParallelFill(reference[tr_mip].data(), res, [&](int x, int y, int z, float u, float v, float w) {
+            if (sparse.IsBuilt())
+                return Sample_TR(sparse, float3{ u,v,w }, level_alpha[tr_mip], lightDir);
+            return Sample_TR(source, res, float3{ u,v,w }, level_alpha[tr_mip], lightDir);
+            });
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        march_seconds += seconds;
+
+        double squared = 0, worst = 0;
+        for (int i = 0; i < res * res * res; i++) {
+            double e = abs(reference[tr_mip][i] - solved[tr_mip][i]);
+            squared += e * e;
+            worst = max(worst, e);
+        }
+        printf("  %5d %4d %9.2f ms %9.5f %9.5f\n", tr_mip, res, seconds * 1000, sqrt(squared / (res * res * res)), worst);
+    }
+    printf("  all levels: Sample_TR %.1f ms, sweep %.1f ms, speedup %.1fx\n", march_seconds * 1000, sweep_seconds * 1000, march_seconds / sweep_seconds);
+
+    // Time of day: the light turns a quarter degree per frame. Error is against a full
+    // solve for the current light, so it is what amortisation adds on top of the sweep.
+    const float budget = 1.0f / 8, max_angle = 2.0f, step = 0.25f * 3.1415926535f / 180;
+    vector<float> exact(128 * 128 * 128);
+    float* exact_ptr[8] = { exact.data() };
+    for (int tr_mip = 1; tr_mip < 8; tr_mip++)
+        exact_ptr[tr_mip] = reference[tr_mip].data();
+    double amortised_seconds = 0, squared = 0, worst = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        float angle = step * frame;
+        float3 dir = { lightDir.x * cos(angle) + lightDir.z * sin(angle), lightDir.y, lightDir.z * cos(angle) - lightDir.x * sin(angle) };
+        start_time = chrono::steady_clock::now();
+        solver.Advance(dir, level_alpha, solved_ptr, budget, max_angle);
+        amortised_seconds += chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+        TRSolver full;
+        full.Reset(mips + 1, 8, 128);
+        full.Solve(dir, level_alpha, exact_ptr);
+        for (int i = 0; i < 128 * 128 * 128; i++) {
+            double e = abs(exact[i] - solved[0][i]);
+            squared += e * e;
+            worst = max(worst, e);
+        }
+    }
+    printf("  animated, %d frames at budget %.3f: %.2f ms/frame vs %.2f ms full sweep, rms err %.5f, max err %.5f, %d sync solves\n",
+        frames, budget, amortised_seconds * 1000 / frames, sweep_seconds * 1000, sqrt(squared / (128.0 * 128 * 128 * max(frames, 1))), worst, solver.Stats().syncSolves);
+}
+
+void VolumeRender::SetHDRI(string path) {
+    shared_ptr<const HDRImage> image = LoadHDRCached(path);
+    if (image == nullptr) {
+        printf("Failed to load HDRI %s\n", path.c_str());
+        return;
+    }
     if (env_tex_dev != 0)
         cudaFreeArray(env_tex_dev);
-    if (hdri_img.data != 0)
-        delete hdri_img.data;
-    
-    hdri_img.data = reinterpret_cast<float4*>(pixels);
-    hdri_img.sx = rx;
-    hdri_img.sy = ry;
+    env_tex_dev = 0;
+
+    // Read-only view; the cache entry owns the pixels.
+    hdri = image;
+    hdri_img.data = const_cast<float4*>(hdri->pixels.data());
+    hdri_img.sx = hdri->width;
+    hdri_img.sy = hdri->height;
+    unsigned int rx = hdri->width, ry = hdri->height;
+
+    if (cpu_backend)
+        return;
 
     const cudaChannelFormatDesc hdri_desc = cudaCreateChannelDesc<float4>();
     cudaMallocArray(&env_tex_dev, &hdri_desc, rx, ry);
 
     CheckError;
 
-    cudaMemcpyToArray(env_tex_dev, 0, 0, pixels, rx * ry * sizeof(float4), cudaMemcpyHostToDevice);
+    cudaMemcpyToArray(env_tex_dev, 0, 0, hdri_img.data, rx * ry * sizeof(float4), cudaMemcpyHostToDevice);
 
     CheckError;
 
@@ -1412,6 +1606,81 @@ void VolumeRender::SetHDRI(string path) {
     CheckError;
 }
 
+float3 VolumeRender::SampleEnvironment(float2 u, float3& dir) {
+    if (hdri == nullptr || !hdri->sampler.IsBuilt()) {
+        dir = UniformSampleSphere(u);
+        return hdri_img.Sample(EnvSampler::DirToUV(dir)) * hdri_exp * 4;
+    }
+    // Same scale as the uniform path, which divides by its pdf 1 / 4pi as a factor of 4.
+    float pdf;
+    dir = hdri->sampler.Sample(u, pdf);
+    return hdri_img.Sample(EnvSampler::DirToUV(dir)) * hdri_exp / (3.14159265359f * pdf);
+}
+
+void VolumeRender::BenchmarkHDRI(string path, int trials) {
+    shared_ptr<const HDRImage> env = path.empty() ? hdri : LoadHDRCached(path);
+    if (env == nullptr || !env->sampler.IsBuilt()) {
+        printf("No environment map to benchmark\n");
+        return;
+    }
+    const EnvSampler& sampler = env->sampler;
+    Image_host image;
+    image.data = const_cast<float4*>(env->pixels.data());
+    image.sx = env->width;
+    image.sy = env->height;
+
+    // Integrands over the sphere: the luminance itself (what the environment light of the NN
+    // render types estimates) and its irradiance for six normals. References by quadrature
+    // over a grid of twice the map's resolution.
+    const int F = 7;
+    const float PI = 3.14159265359f;
+    const float3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    auto Integrands = [&](float3 dir, float weight, double* f) {
+        float3 c = image.Sample(EnvSampler::DirToUV(dir));
+        float l = (0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z) * weight;
+        f[0] += l;
+        for (int n = 0; n < 6; n++)
+            f[n + 1] += l * max(0.0f, dot(dir, normals[n]));
+    };
+    int qx = image.sx * 2, qy = image.sy * 2;
+    vector<double> row_sums((size_t)qy * F, 0.0);
+    parallel::parallel_for(qy, [&](int y) {
+        float v = (y + 0.5f) / qy;
+        float area = (2 * PI / qx) * (PI / qy) * sinf(v * PI);
+        for (int x = 0; x < qx; x++)
+            Integrands(EnvSampler::UVToDir(float2{ (x + 0.5f) / qx, v }), area, &row_sums[(size_t)y * F]);
+    });
+    double reference[F] = {};
+    for (int y = 0; y < qy; y++)
+        for (int f = 0; f < F; f++)
+            reference[f] += row_sums[(size_t)y * F + f];
+
+    printf("HDRI sampling benchmark: %s, %dx%d, table built in %.3f s\n", path.empty() ? "current map" : path.c_str(), image.sx, image.sy, sampler.Seconds());
+    printf("  relative RMSE over %d trials   radiance: uniform / importance   irradiance: uniform / importance\n", trials);
+    for (int samples = 16; samples <= 4096; samples *= 4) {
+        double error[2][2] = {};    // [uniform, importance][radiance, irradiance]
+        for (int t = 0; t < trials; t++) {
+            mt19937 rng(t * 7919u + samples);
+            uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            double sums[2][F] = {};
+            for (int i = 0; i < samples; i++) {
+                float2 u = { uniform(rng), uniform(rng) };
+                Integrands(UniformSampleSphere(u), 4 * PI, sums[0]);
+                float pdf;
+                float3 dir = sampler.Sample(u, pdf);
+                Integrands(dir, 1 / pdf, sums[1]);
+            }
+            for (int m = 0; m < 2; m++)
+                for (int f = 0; f < F; f++) {
+                    double ref = max(reference[f], 1e-12);
+                    error[m][f > 0] += pow((sums[m][f] / samples - ref) / ref, 2) / (f > 0 ? 6 : 1);
+                }
+        }
+        printf("  %5d samples %32.5f / %.5f %24.5f / %.5f\n", samples, sqrt(error[0][0] / trials), sqrt(error[1][0] / trials),
+            sqrt(error[0][1] / trials), sqrt(error[1][1] / trials));
+    }
+}
+
 void VolumeRender::SetEnvExp(float exp)
 {
     hdri_exp = exp;
@@ -1425,6 +1694,7 @@ void VolumeRender::SetCheckboard(bool checkboard)
 }
 void VolumeRender::SetTrScale(float scale)
 {
+    tr_scale_host = scale;
     cudaMemcpyToSymbol(tr_scale, &scale, sizeof(float), 0, cudaMemcpyHostToDevice);
 }
 
@@ -1435,9 +1705,28 @@ void VolumeRender::SetScatterRate(float rate)
 
 void VolumeRender::SetScatterRate(float3 rate)
 {
+    scatter_rate_host = rate;
     cudaMemcpyToSymbol(scatter_rate, &rate, sizeof(float3), 0, cudaMemcpyHostToDevice);
 }
 
+void VolumeRender::SetCPUBackend(bool cpu)
+{
+    if (!cpu && datas_dev == 0) {
+        printf("No CUDA device found, staying on the CPU renderer.\n");
+        return;
+    }
+    bool upload = cpu_backend && !cpu;
+    cpu_backend = cpu;
+    // Device copies are skipped while on the CPU backend; the host mips are current, but
+    // datas and mips[0] may only be held sparse there.
+    if (cpu)
+        ReleaseDense();
+    else
+        RestoreDense();
+    if (upload)
+        UploadVolume();
+}
+
 void VolumeRender::SetExposure(float exp)
 {
     cudaMemcpyToSymbol(exposure, &exp, sizeof(float), 0, cudaMemcpyHostToDevice);
@@ -1448,6 +1737,8 @@ void VolumeRender::SetSurfaceIOR(float ior)
 }
 
 float VolumeRender::DensityAtPosition(int mip, float3 pos) {
+    if (sparse_mips[mip].IsBuilt())
+        return Sample(sparse_mips[mip], pos + 0.5);
     return Sample(mips[mip], 256 >> mip, pos + 0.5);
 }
 float VolumeRender::TrAtPosition(int mip, float3 pos, float3 lightDir) {
@@ -1476,6 +1767,8 @@ float VolumeRender::DensityAtPosition(float mip, float3 pos) {
 }
 
 float VolumeRender::DensityAtUV(int mip, float3 uv) {
+    if (sparse_mips[mip].IsBuilt())
+        return Sample(sparse_mips[mip], uv);
     return Sample(mips[mip], 256 >> mip, uv);
 }
 
@@ -5,7 +5,15 @@
 
 #include "vector.cuh"
 #include "omp.hpp"
-
+#include "cpu_render.hpp"
+#include "cpu_nn.hpp"
+#include "volume_file.hpp"
+#include "sparse_volume.hpp"
+#include "tr_solver.hpp"
+#include "volume_stats.hpp"
+#include "hdr_image.hpp"
+
+#include <memory>
 #include <vector>
 #include <iostream>
 using namespace std;
@@ -54,12 +62,44 @@ class VolumeRender {
 	float hginlut = -100;
 	float3 tr_lightDir;
 	float tr_alpha;
+	// What hglut and tr_mips hold on the host, for the CPU predictors.
+	float hginlut_host = -100;
+	float3 tr_host_dir = { 0, 0, 0 };
+	float tr_host_alpha = -1;
 
 	float* mips[9];
 	float* tr_mips[8];
 	float* tr_mips2[8];
+	// Sparse copies of mips[], rebuilt with them; host lookups and the CPU tracer use these.
+	SparseVolume sparse_mips[9];
+	// On the CPU backend nothing needs datas or mips[0] dense once the sparse copies exist,
+	// so ReleaseDense frees them (sparse_datas keeps datas when it is not 256^3) and
+	// RestoreDense decodes them again for anything that writes, saves or uploads them. Mips
+	// 1..8 stay dense for the TR solver. Negatives in datas come back as 0, which every
+	// lookup clamps them to anyway.
+	SparseVolume sparse_datas;
+	bool dense_released = false;
+	// CPU path of Update_TR, taken every frame when tr_sweep is on; tr_budget < 1 spreads
+	// each sweep over several calls.
+	TRSolver tr_solver;
+	bool tr_sweep = false;
+	float tr_budget = 1;
+	float tr_max_angle = 2;
+	// Brick statistics of datas (max_density comes from it) and of mips[0], whose
+	// majorants the CPU tracer tracks against unless cpu_majorants is off.
+	VolumeStats density_stats;
+	VolumeStats mip_stats;
+	bool cpu_majorants = true;
 
 	float hdri_exp = 1;
+	// Decoded map and sampling table behind hdri_img, shared with the HDR cache.
+	shared_ptr<const HDRImage> hdri;
+
+	bool cpu_backend = false;
+	float tr_scale_host = 1;
+	float3 scatter_rate_host = { 1.001, 1.001, 1.001 };
+	// Host networks for the RPNN / MRPNN render types, created on first use.
+	unique_ptr<CPUNN> cpu_nn;
 
 	cudaArray* hglut_dev = 0;
 
@@ -77,12 +117,29 @@ class VolumeRender {
 
 	VolumeRender(const VolumeRender& obj) = delete;
 	void MallocMemory();
+	void UploadVolume();
+	void BuildSparse();
+	void BuildStats();
+	void ReleaseDense();
+	void RestoreDense();
+	bool LoadVolumeFile(string path);
+	CPUScene GetCPUScene(float scaleFactor);
+	void UpdateHGLutCPU(float g);
+	void UpdateTRCPU(float3 lightDir, float alpha);
+	// Environment light direction for the NN render types, and its radiance over the pdf.
+	float3 SampleEnvironment(float2 u, float3& dir);
 
 public:
 	enum RenderType {
 		PT, RPNN, MRPNN
 	};
 
+private:
+	// Host HG LUT and TR volumes the predictor features read, and the networks.
+	void PrepareCPUPredict(RenderType rt, float3 lightDir, float alpha, float g);
+
+public:
+
 	Image_host hdri_img;
 
 	float max_density = 0.00001;
@@ -94,12 +151,35 @@ public:
 
 	void SetData(int x, int y, int z, float value);
 
-	void SetDatas(FillFunc func);
+	// func(x, y, z, u, v, w) for every voxel, see ParallelFill; call Update() afterwards.
+	template<class Func>
+	void SetDatas(const Func& func) {
+		RestoreDense();
+		ParallelFill(datas, resolution, func);
+	}
 
 	void Update();
+	// Writes datas, the mip pyramid and max_density as a .cvol (see volume_file.hpp);
+	// lossless unless a quantised encoding is asked for.
+	bool SaveVolumeFile(string path, VolumeFileEncoding encoding = VOLUME_FLOAT32);
 	void Update_TR(float3 lightDir,float alpha = 64.0f, bool CPU = false);
+	// Share of a full TR sweep the CPU path may spend per Update_TR call (1 = all of it),
+	// and how far in degrees the published volumes may lag behind the light.
+	void SetTRBudget(float fraction, float maxAngle = 2.0f);
+	// Solve the TR volumes with the light-space sweep on the host (and upload them) rather
+	// than the Fill_TR kernel, whoever calls Update_TR.
+	void SetTRSweep(bool sweep);
+	// Light-space solver against the per-voxel Sample_TR march, then an animated light.
+	void BenchmarkTR(float3 lightDir = { 0.3f, 0.8f, 0.52f }, float alpha = 64.0f, int frames = 64);
+
+	const VolumeStats& GetDensityStats() const { return density_stats; }
+	const VolumeStats& GetMajorants() const { return mip_stats; }
 
 	void SetHDRI(string path);
+	const HDRImage* GetHDRI() const { return hdri.get(); }
+	// Relative RMSE of uniform vs importance-sampled irradiance estimates against sample
+	// count, for the map at path (the current one when empty).
+	void BenchmarkHDRI(string path = "", int trials = 32);
 
 	void SetCheckboard(bool checkboard);
 	void SetEnvExp(float exp);
@@ -131,5 +211,15 @@ public:
 	vector<float3> GetTrs(float alpha, vector<float3> ori, vector<float3> dir, float3 lightDir, float3 lightColor,float g = 0, int sampleNum = 1) const;
 
 	vector<float3> Render(int2 size, float3 ori, float3 up, float3 right, float3 lightDir, RenderType rt = RenderType::PT, float g = 0.857, float alpha = 1, float3 lightColor = { 1, 1, 1 }, int multiScatter = 512, int sampleNum = 1024);
+	// Host-side path tracer over mips[0], or the host networks for the NN render types; used
+	// by GetRadiances/Render when no CUDA device is present.
+	void SetCPUBackend(bool cpu);
+	bool GetCPUBackend() const { return cpu_backend; }
+	// Raw RPNN weight dump for the CPU predictor (see CPUNN::LoadRPNN).
+	bool LoadRPNNWeights(string path);
+	vector<float3> GetRadiancesCPU(vector<float3> ori, vector<float3> dir, float3 lightDir, float3 lightColor = { 1, 1, 1 }, float alpha = 1, int multiScatter = 1, float g = 0, int sampleNum = 1, RenderType rt = RenderType::PT, CPURenderStats* stats = nullptr);
+	vector<float3> RenderCPU(int2 size, float3 ori, float3 up, float3 right, float3 lightDir, float g = 0.857, float alpha = 1, float3 lightColor = { 1, 1, 1 }, int multiScatter = 512, int sampleNum = 1024, RenderType rt = RenderType::PT, CPURenderStats* stats = nullptr);
+	void BenchmarkCPU(int2 size = { 128, 128 }, int multiScatter = 16, int sampleNum = 4);
+
 	void Render(float4* target, Histogram* histo_buffer, unsigned int* target2, int2 size, float3 ori, float3 forward, float3 up, float3 right, float3 lightDir, float3 lightColor = { 1,1,1 }, float alpha = 1, int multiScatter = 1, float g = 0, int randseed = 0, RenderType rt = RenderType::PT, int toneType = 2, bool denoise = false, float scaleFactor = 1);
 };
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "volume_file.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+int VoxelBytes(uint32_t encoding) {
+	switch (encoding) {
+	case VOLUME_FLOAT32: return 4;
+	case VOLUME_UNORM16: return 2;
+	case VOLUME_UNORM8: return 1;
+	default: return 0;
+	}
+}
+
+float QuantMax(uint32_t encoding) {
+	return encoding == VOLUME_UNORM16 ? 65535.0f : 255.0f;
+}
+
+int ExpectedResolution(int level, int source_res) {
+	return level == 0 ? source_res : 256 >> (level - 1);
+}
+
+int BrickEdge(int brick_size, int res) {
+	return min(brick_size, res);
+}
+
+struct BrickExtent {
+	int x0, y0, z0;
+	int ex, ey, ez;
+};
+
+BrickExtent Extent(int index, int bricks, int edge, int res) {
+	int bx = index / (bricks * bricks);
+	int by = (index / bricks) % bricks;
+	int bz = index % bricks;
+	BrickExtent e = { bx * edge, by * edge, bz * edge, 0, 0, 0 };
+	e.ex = min(edge, res - e.x0);
+	e.ey = min(edge, res - e.y0);
+	e.ez = min(edge, res - e.z0);
+	return e;
+}
+
+}
+
+VolumeFile::~VolumeFile() {
+	Close();
+}
+
+bool VolumeFile::Open(const string& path) {
+	Close();
+	if (!file.Open(path) || file.Size() < sizeof(VolumeFileHeader)) {
+		file.Close();
+		return false;
+	}
+	data = file.Data();
+	bytes = file.Size();
+
+	const VolumeFileHeader& h = Header();
+	bool valid = memcmp(h.magic, "CVOL", 4) == 0 && h.version == VOLUME_FILE_VERSION && h.levelCount == VOLUME_FILE_LEVELS
+		&& VoxelBytes(h.encoding) != 0 && h.brickSize > 0 && h.resolution > 0
+		&& sizeof(VolumeFileHeader) + VOLUME_FILE_LEVELS * sizeof(VolumeFileLevel) <= bytes;
+	for (int i = 0; valid && i < VOLUME_FILE_LEVELS; i++) {
+		const VolumeFileLevel& l = Level(i);
+		int edge = BrickEdge(h.brickSize, l.resolution);
+		valid = l.resolution == ExpectedResolution(i, h.resolution) && l.bricks == (l.resolution + edge - 1) / edge
+			&& l.tableOffset + (uint64_t)l.bricks * l.bricks * l.bricks * sizeof(VolumeFileBrick) <= bytes;
+	}
+	if (!valid) {
+		printf("%s is not a version %d volume file, ignoring it.\n", path.c_str(), VOLUME_FILE_VERSION);
+		Close();
+		return false;
+	}
+
+	// Every payload must lie inside the file, so a truncated one is not decoded as zeros.
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		const VolumeFileLevel& l = Level(i);
+		int edge = BrickEdge(h.brickSize, l.resolution);
+		int count = l.bricks * l.bricks * l.bricks;
+		for (int index = 0; index < count; index++) {
+			const VolumeFileBrick& b = Brick(i, index);
+			if (b.offset == 0)
+				continue;
+			BrickExtent e = Extent(index, l.bricks, edge, l.resolution);
+			size_t payload = (size_t)e.ex * e.ey * e.ez * VoxelBytes(h.encoding);
+			if (b.offset > bytes || payload > bytes - b.offset) {
+				printf("%s is truncated (level %d, brick %d of %d ends past the file), ignoring it.\n", path.c_str(), i, index, count);
+				Close();
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void VolumeFile::Close() {
+	file.Close();
+	data = nullptr;
+	bytes = 0;
+}
+
+void VolumeFile::DecodeBrick(int level, int bx, int by, int bz, float* out) const {
+	const VolumeFileHeader& h = Header();
+	const VolumeFileLevel& l = Level(level);
+	int res = l.resolution;
+	int edge = BrickEdge(h.brickSize, res);
+	BrickExtent e = Extent((bx * l.bricks + by) * l.bricks + bz, l.bricks, edge, res);
+	const VolumeFileBrick& b = Brick(level, (bx * l.bricks + by) * l.bricks + bz);
+
+	// (Open checked that every payload is inside the file)
+	if (b.offset == 0) {
+		for (int x = 0; x < e.ex; x++)
+			for (int y = 0; y < e.ey; y++)
+				fill_n(out + ((size_t)(e.x0 + x) * res + e.y0 + y) * res + e.z0, e.ez, b.minValue);
+		return;
+	}
+
+	const unsigned char* p = data + b.offset;
+	for (int x = 0; x < e.ex; x++) {
+		for (int y = 0; y < e.ey; y++) {
+			float* row = out + ((size_t)(e.x0 + x) * res + e.y0 + y) * res + e.z0;
+			size_t at = ((size_t)x * e.ey + y) * e.ez;
+			switch (h.encoding) {
+			case VOLUME_FLOAT32:
+				memcpy(row, p + at * 4, e.ez * sizeof(float));
+				break;
+			case VOLUME_UNORM16: {
+				const uint16_t* q = (const uint16_t*)p + at;
+				for (int z = 0; z < e.ez; z++)
+					row[z] = b.minValue + q[z] * b.scale;
+				break;
+			}
+			default: {
+				const uint8_t* q = p + at;
+				for (int z = 0; z < e.ez; z++)
+					row[z] = b.minValue + q[z] * b.scale;
+				break;
+			}
+			}
+		}
+	}
+}
+
+void VolumeFile::DecodeLevel(int level, float* out) const {
+	int n = Level(level).bricks;
+	parallel::parallel_for(n * n * n, [&](int i) {
+		DecodeBrick(level, i / (n * n), (i / n) % n, i % n, out);
+	});
+}
+
+bool VolumeFile::Write(const string& path, const float* datas, int resolution, float* const* mips, float maxDensity, VolumeFileEncoding encoding, int brickSize) {
+	struct LevelData {
+		const float* grid;
+		VolumeFileLevel info;
+		int shared;		// index of the level whose bricks are reused, or -1
+		vector<VolumeFileBrick> table;
+		vector<vector<unsigned char>> payloads;
+	};
+	LevelData levels[VOLUME_FILE_LEVELS];
+
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		LevelData& l = levels[i];
+		int res = ExpectedResolution(i, resolution);
+		int edge = BrickEdge(brickSize, res);
+		l.grid = i == 0 ? datas : mips[i - 1];
+		l.info = { res, (res + edge - 1) / edge, 0 };
+		l.shared = -1;
+		if (i == 1 && resolution == 256 && memcmp(datas, mips[0], sizeof(float) * 256 * 256 * 256) == 0)
+			l.shared = 0;
+	}
+
+	int voxel_bytes = VoxelBytes(encoding);
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		LevelData& l = levels[i];
+		if (l.shared >= 0)
+			continue;
+		int res = l.info.resolution;
+		int n = l.info.bricks;
+		int edge = BrickEdge(brickSize, res);
+		l.table.resize((size_t)n * n * n);
+		l.payloads.resize((size_t)n * n * n);
+
+		parallel::parallel_for(n * n * n, [&](int index) {
+			BrickExtent e = Extent(index, n, edge, res);
+			auto voxel = [&](int x, int y, int z) { return l.grid[((size_t)(e.x0 + x) * res + e.y0 + y) * res + e.z0 + z]; };
+
+			float lo = voxel(0, 0, 0), hi = lo;
+			for (int x = 0; x < e.ex; x++)
+				for (int y = 0; y < e.ey; y++)
+					for (int z = 0; z < e.ez; z++) {
+						lo = min(lo, voxel(x, y, z));
+						hi = max(hi, voxel(x, y, z));
+					}
+
+			VolumeFileBrick& b = l.table[index];
+			b = { 0, lo, 0.0f };
+			if (lo == hi)
+				return;
+
+			vector<unsigned char>& out = l.payloads[index];
+			out.resize((size_t)e.ex * e.ey * e.ez * voxel_bytes);
+			float qmax = QuantMax(encoding);
+			b.scale = encoding == VOLUME_FLOAT32 ? 1.0f : (hi - lo) / qmax;
+			size_t at = 0;
+			for (int x = 0; x < e.ex; x++)
+				for (int y = 0; y < e.ey; y++)
+					for (int z = 0; z < e.ez; z++, at++) {
+						float v = voxel(x, y, z);
+						if (encoding == VOLUME_FLOAT32) {
+							memcpy(out.data() + at * 4, &v, sizeof(float));
+							continue;
+						}
+						float q = min(max(roundf((v - lo) / b.scale), 0.0f), qmax);
+						if (encoding == VOLUME_UNORM16)
+							((uint16_t*)out.data())[at] = (uint16_t)q;
+						else
+							out[at] = (uint8_t)q;
+					}
+		});
+	}
+
+	// Lay out tables, then payloads.
+	uint64_t offset = sizeof(VolumeFileHeader) + VOLUME_FILE_LEVELS * sizeof(VolumeFileLevel);
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		LevelData& l = levels[i];
+		if (l.shared >= 0)
+			continue;
+		l.info.tableOffset = offset;
+		offset += l.table.size() * sizeof(VolumeFileBrick);
+	}
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		LevelData& l = levels[i];
+		if (l.shared >= 0) {
+			l.info.tableOffset = levels[l.shared].info.tableOffset;
+			continue;
+		}
+		for (size_t b = 0; b < l.table.size(); b++) {
+			if (l.payloads[b].empty())
+				continue;
+			offset = (offset + 15) & ~(uint64_t)15;
+			l.table[b].offset = offset;
+			offset += l.payloads[b].size();
+		}
+	}
+
+	string temp_path = path + ".tmp";
+	FILE* file = fopen(temp_path.c_str(), "wb");
+	if (file == nullptr) {
+		printf("Failed to write volume file: %s\n", temp_path.c_str());
+		return false;
+	}
+
+	VolumeFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "CVOL", 4);
+	header.version = VOLUME_FILE_VERSION;
+	header.resolution = resolution;
+	header.brickSize = brickSize;
+	header.encoding = encoding;
+	header.levelCount = VOLUME_FILE_LEVELS;
+	header.maxDensity = maxDensity;
+	fwrite(&header, sizeof(header), 1, file);
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++)
+		fwrite(&levels[i].info, sizeof(VolumeFileLevel), 1, file);
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++)
+		if (!levels[i].table.empty())
+			fwrite(levels[i].table.data(), sizeof(VolumeFileBrick), levels[i].table.size(), file);
+
+	const unsigned char zeros[16] = { 0 };
+	uint64_t written = sizeof(VolumeFileHeader) + VOLUME_FILE_LEVELS * sizeof(VolumeFileLevel);
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++)
+		written += levels[i].table.size() * sizeof(VolumeFileBrick);
+	bool ok = true;
+	for (int i = 0; i < VOLUME_FILE_LEVELS; i++) {
+		LevelData& l = levels[i];
+		for (size_t b = 0; b < l.payloads.size(); b++) {
+			if (l.payloads[b].empty())
+				continue;
+			fwrite(zeros, 1, l.table[b].offset - written, file);
+			ok = ok && fwrite(l.payloads[b].data(), 1, l.payloads[b].size(), file) == l.payloads[b].size();
+			written = l.table[b].offset + l.payloads[b].size();
+		}
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok) {
+		printf("Failed to write volume file: %s\n", temp_path.c_str());
+		remove(temp_path.c_str());
+		return false;
+	}
+
+	remove(path.c_str());
+	if (rename(temp_path.c_str(), path.c_str()) != 0) {
+		printf("Failed to move %s into place.\n", temp_path.c_str());
+		return false;
+	}
+	printf("Wrote volume file %s (%.1f MB)\n", path.c_str(), written / (1024.0 * 1024.0));
+	return true;
+}
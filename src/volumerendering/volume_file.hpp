@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+#include "mapped_file.hpp"
+
+// Chunked on-disk cloud volume (.cvol). The file is memory mapped, so opening it only
+// reads the header and tables (checking that every payload lies inside the file); brick
+// payloads are paged in by the OS as they are decoded.
+// VolumeRender decodes every level densely when it loads one, so all of it is read then.
+//
+//   VolumeFileHeader
+//   VolumeFileLevel[levelCount]      level 0 is the source grid, levels 1..9 are mips 256..1
+//   VolumeFileBrick[...]             one table per level, bricks x-major ((bx * n) + by) * n + bz
+//   payloads                         16-byte aligned, voxels x-major inside the brick
+//
+// Bricks whose voxels are all equal (empty space, mostly) have no payload. Quantised
+// bricks store value = minValue + q * scale; they are lossy and only written on request.
+
+#define VOLUME_FILE_VERSION 1
+#define VOLUME_FILE_LEVELS 10
+
+enum VolumeFileEncoding : uint32_t {
+	VOLUME_FLOAT32 = 0,
+	VOLUME_UNORM16 = 1,
+	VOLUME_UNORM8 = 2,
+};
+
+struct VolumeFileHeader {
+	char magic[4];			// "CVOL"
+	uint32_t version;
+	int32_t resolution;
+	int32_t brickSize;
+	uint32_t encoding;
+	uint32_t levelCount;
+	float maxDensity;
+	uint32_t reserved[9];
+};
+
+struct VolumeFileLevel {
+	int32_t resolution;
+	int32_t bricks;			// per axis
+	uint64_t tableOffset;	// levels sharing a table (mip 0 of a 256^3 source) point at the same one
+};
+
+struct VolumeFileBrick {
+	uint64_t offset;		// payload offset, 0 for constant bricks
+	float minValue;
+	float scale;
+};
+
+static_assert(sizeof(VolumeFileHeader) == 64, "VolumeFileHeader must stay 64 bytes");
+static_assert(sizeof(VolumeFileLevel) == 16, "VolumeFileLevel must stay 16 bytes");
+static_assert(sizeof(VolumeFileBrick) == 16, "VolumeFileBrick must stay 16 bytes");
+
+class VolumeFile {
+public:
+	VolumeFile() {}
+	~VolumeFile();
+	VolumeFile(const VolumeFile&) = delete;
+	VolumeFile& operator=(const VolumeFile&) = delete;
+
+	// Maps the file and validates header and tables; returns false (and stays closed) for
+	// missing files, other versions or truncated files.
+	bool Open(const string& path);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+
+	const VolumeFileHeader& Header() const { return *(const VolumeFileHeader*)data; }
+	int LevelResolution(int level) const { return Level(level).resolution; }
+	size_t MappedBytes() const { return bytes; }
+
+	// Decodes one level into a dense x-major grid, bricks spread over all cores.
+	void DecodeLevel(int level, float* out) const;
+
+	// mips: the 9 levels VolumeRender keeps (256 >> i). Writes to path + ".tmp" first and
+	// renames, so a crash never leaves a half-written cache behind.
+	static bool Write(const string& path, const float* datas, int resolution, float* const* mips, float maxDensity, VolumeFileEncoding encoding = VOLUME_FLOAT32, int brickSize = 32);
+
+private:
+	MappedFile file;
+	const unsigned char* data = nullptr;
+	size_t bytes = 0;
+
+	const VolumeFileLevel& Level(int level) const { return ((const VolumeFileLevel*)(data + sizeof(VolumeFileHeader)))[level]; }
+	const VolumeFileBrick& Brick(int level, int index) const { return ((const VolumeFileBrick*)(data + Level(level).tableOffset))[index]; }
+	void DecodeBrick(int level, int bx, int by, int bz, float* out) const;
+};
@@ -245,6 +245,9 @@ void RenderCloud(Camera& cam, VolumeRender& volume, GLFWwindow* window)
         volume.SetExposure(gui->exposure);
         volume.SetSurfaceIOR(gui->render_surface ? gui->IOR : -1);
         volume.SetCheckboard(gui->checkboard);
+        // an animated light re-solves the TR volumes a share of a sweep per frame
+        volume.SetTRBudget(gui->tr_budget);
+        volume.SetTRSweep(gui->tr_sweep);
 
         if (gui->change_hdri) {
             volume.SetHDRI(gui->hdri_path);
@@ -0,0 +1,319 @@
+#include "volume_parser.hpp"
+
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t CHUNK_BYTES = 1 << 20;
+
+inline bool IsDigit(char c) {
+	return (unsigned)(c - '0') < 10u;
+}
+
+inline bool IsSpace(char c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+inline bool IsNumberStart(char c) {
+	return IsDigit(c) || c == '-' || c == '+' || c == '.';
+}
+
+inline const char* ScanInt(const char* p, const char* e, int& value) {
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+	int v = 0;
+	while (p < e && IsDigit(*p))
+		v = v * 10 + (*p++ - '0');
+	value = negative ? -v : v;
+	return p;
+}
+
+double Pow10(int e) {
+	static const double exact[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	return e <= 22 ? exact[e] : pow(10.0, e);
+}
+
+// Decimal or scientific notation. Up to 19 significant digits are kept in an integer and
+// scaled once by an exactly representable power of ten, which is well within float
+// precision of what fscanf returns.
+inline const char* ScanFloat(const char* p, const char* e, float& value) {
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	for (; p < e && IsDigit(*p); p++) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else
+			exponent++;
+	}
+	if (p < e && *p == '.') {
+		for (p++; p < e && IsDigit(*p); p++) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+	if (p < e && (*p == 'e' || *p == 'E') && p + 1 < e && (IsDigit(p[1]) || ((p[1] == '-' || p[1] == '+') && p + 2 < e && IsDigit(p[2])))) {
+		int power;
+		p = ScanInt(p + 1, e, power);
+		exponent += power;
+	}
+	double v = (double)mantissa;
+	if (exponent < 0)
+		v = -exponent > 308 ? 0.0 : v / Pow10(-exponent);
+	else if (exponent > 0)
+		v *= Pow10(min(exponent, 309));
+	value = (float)(negative ? -v : v);
+	return p;
+}
+
+// Both scanners count every number in [p, e) and store the ones below `limit` from
+// out[0] on; out == nullptr only counts.
+long long ScanVox(const char* p, const char* e, float* out, long long limit) {
+	const float inv = 64.0 / 255.0;
+	long long n = 0;
+	while (p < e) {
+		// p is at the start of a line here
+		if (*p == 'w' || *p == 'h' || *p == 'd') {
+			while (p < e && *p != '\n')
+				p++;
+			p++;
+			continue;
+		}
+		while (p < e && *p != '\n') {
+			if (IsDigit(*p) || *p == '-' || *p == '+') {
+				int d;
+				p = ScanInt(p, e, d);
+				if (out != nullptr && n < limit)
+					out[n] = (float)d * inv;
+				n++;
+			}
+			else
+				p++;
+		}
+		p++;
+	}
+	return n;
+}
+
+long long ScanFloats(const char* p, const char* e, float* out, long long limit) {
+	long long n = 0;
+	while (p < e) {
+		if (IsNumberStart(*p)) {
+			float v;
+			p = ScanFloat(p, e, v);
+			if (out != nullptr && n < limit)
+				out[n] = v;
+			n++;
+		}
+		else
+			p++;
+	}
+	return n;
+}
+
+struct Chunk {
+	const char* begin;
+	const char* end;
+	long long count;
+	long long offset;
+};
+
+// Chunks of about CHUNK_BYTES; each one ends just past a newline (vox, whose header lines
+// are recognised by their first character) or any whitespace (txt).
+vector<Chunk> SplitChunks(const char* begin, const char* end, bool lines) {
+	vector<Chunk> chunks;
+	const char* p = begin;
+	while (p < end) {
+		const char* q = p + min((size_t)(end - p), CHUNK_BYTES);
+		while (q < end && !(lines ? q[-1] == '\n' : IsSpace(q[-1])))
+			q++;
+		chunks.push_back({ p, q, 0, 0 });
+		p = q;
+	}
+	return chunks;
+}
+
+template<class Scan>
+long long ParseChunks(const char* begin, const char* end, float* out, long long count, bool lines, Scan scan, const VolumeParseProgress& progress, VolumeParseStats& stats) {
+	vector<Chunk> chunks = SplitChunks(begin, end, lines);
+	int chunk_num = (int)chunks.size();
+	parallel::Stats count_pass, parse_pass;
+
+	mutex progress_lock;
+	size_t done = 0;
+	double total = 2.0 * max((size_t)1, (size_t)(end - begin));
+	auto report = [&](const Chunk& c) {
+		if (!progress)
+			return;
+		lock_guard<mutex> lock(progress_lock);
+		done += c.end - c.begin;
+		progress((float)(done / total));
+	};
+
+	parallel::parallel_for(chunk_num, [&](int i) {
+		chunks[i].count = scan(chunks[i].begin, chunks[i].end, nullptr, 0);
+		report(chunks[i]);
+	}, 1, &count_pass);
+
+	long long values = 0;
+	for (auto& c : chunks) {
+		c.offset = values;
+		values += c.count;
+	}
+
+	parallel::parallel_for(chunk_num, [&](int i) {
+		const Chunk& c = chunks[i];
+		if (c.offset < count)
+			scan(c.begin, c.end, out + c.offset, count - c.offset);
+		report(c);
+	}, 1, &parse_pass);
+
+	if (values < count)
+		fill(out + values, out + count, 0.0f);
+
+	stats.chunks = chunk_num;
+	stats.threads = max(count_pass.threads, parse_pass.threads);
+	stats.values = values;
+	return values;
+}
+
+// The getline/stringstream loader ParseVoxFile replaced, kept as the benchmark baseline.
+void LegacyVox(const string& path, float* datas) {
+	ifstream infile(path);
+	string line;
+	int i = 0;
+	float inv = 64.0 / 255.0;
+	while (!infile.eof()) {
+		getline(infile, line);
+		string firstc = line.substr(0, 1);
+		if (firstc != std::string("w") && firstc != std::string("h") && firstc != std::string("d")) {
+			if (i >= 256 * 256 * 256) break;
+			stringstream data(line);
+			int d[64];
+			for (int j = 0; j < 64; j++)
+				data >> d[j];
+			for (int j = 0; j < 64; j++)
+				datas[i + j] = (float)d[j] * inv;
+			i += 64;
+		}
+	}
+}
+
+}
+
+long long ParseVoxFile(const string& path, float* out, long long count, VolumeParseProgress progress, VolumeParseStats* stats) {
+	auto start_time = chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.Open(path))
+		return -1;
+
+	VolumeParseStats local;
+	VolumeParseStats& s = stats != nullptr ? *stats : local;
+	const char* begin = (const char*)file.Data();
+	long long values = ParseChunks(begin, begin + file.Size(), out, count, true, ScanVox, progress, s);
+	s.bytes = file.Size();
+	s.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	return values;
+}
+
+long long ParseTxtFile(const string& path, function<float*(int resolution)> allocate, VolumeParseProgress progress, VolumeParseStats* stats) {
+	auto start_time = chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.Open(path))
+		return -1;
+
+	VolumeParseStats local;
+	VolumeParseStats& s = stats != nullptr ? *stats : local;
+	const char* p = (const char*)file.Data();
+	const char* end = p + file.Size();
+	while (p < end && !IsNumberStart(*p))
+		p++;
+	int resolution = 0;
+	if (p < end)
+		p = ScanInt(p, end, resolution);
+	resolution = max(resolution, 0);
+
+	long long count = (long long)resolution * resolution * resolution;
+	float* out = allocate(resolution);
+	long long values = ParseChunks(p, end, out, count, false, ScanFloats, progress, s);
+	s.bytes = file.Size();
+	s.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	return values;
+}
+
+void BenchmarkVolumeParser(const string& path) {
+	const int res = 256;
+	const long long count = (long long)res * res * res;
+
+	// Mostly empty space with dense lumps, like the exported clouds.
+	{
+		FILE* f = fopen(path.c_str(), "wb");
+		if (f == nullptr) {
+			printf("Cannot write %s\n", path.c_str());
+			return;
+		}
+		fprintf(f, "w %d\nh %d\nd %d\n", res, res, res);
+		mt19937 rng(350);
+		uniform_int_distribution<int> value(0, 255);
+		uniform_int_distribution<int> empty(0, 3);
+		vector<char> line;
+		for (long long i = 0; i < count; i += 64) {
+			line.clear();
+			for (int j = 0; j < 64; j++) {
+				char buffer[8];
+				int n = snprintf(buffer, sizeof(buffer), j == 0 ? "%d" : " %d", empty(rng) == 0 ? value(rng) : 0);
+				line.insert(line.end(), buffer, buffer + n);
+			}
+			line.push_back('\n');
+			fwrite(line.data(), 1, line.size(), f);
+		}
+		fclose(f);
+	}
+
+	vector<float> reference(count);
+	vector<float> parsed(count);
+
+	auto start_time = chrono::steady_clock::now();
+	LegacyVox(path, reference.data());
+	double legacy_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+	VolumeParseStats stats;
+	int reports = 0;
+	ParseVoxFile(path, parsed.data(), count, [&](float) { reports++; }, &stats);
+
+	long long mismatches = 0;
+	for (long long i = 0; i < count; i++)
+		mismatches += reference[i] != parsed[i];
+
+	double mb = stats.bytes / (1024.0 * 1024.0);
+	printf("Vox parser, %.1f MB synthetic 256^3 file:\n", mb);
+	printf("  getline/stringstream  %7.3f s  %8.1f MB/s\n", legacy_seconds, mb / legacy_seconds);
+	printf("  ParseVoxFile          %7.3f s  %8.1f MB/s  (%d chunks, %d threads, %d progress calls)\n", stats.seconds, mb / stats.seconds, stats.chunks, stats.threads, reports);
+	printf("  speedup %.1fx, %lld values, %lld mismatches\n", legacy_seconds / stats.seconds, stats.values, mismatches);
+
+	remove(path.c_str());
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <string>
+using namespace std;
+
+// Parallel loaders for the text volume formats. The file is memory mapped and cut into
+// chunks that end on a separator, so no number straddles two chunks; a counting pass
+// gives every chunk its output offset and a second pass parses the chunks straight into
+// the destination grid, both passes spread over all cores.
+//
+//   .txt   resolution, then resolution^3 floats separated by any whitespace
+//   .vox   header lines starting with 'w', 'h' or 'd', then integers 0..255 (64 per line)
+//          for a 256^3 grid, scaled by 64 / 255
+
+// Fraction of the work done, in [0, 1]. Called from the worker threads, one call at a
+// time, so the callback needs no locking of its own.
+typedef function<void(float progress)> VolumeParseProgress;
+
+struct VolumeParseStats {
+	size_t bytes = 0;
+	long long values = 0;	// numbers found in the file, including any beyond the grid
+	int chunks = 0;
+	int threads = 0;
+	double seconds = 0;
+};
+
+// Both return the number of values found, or -1 if the file cannot be opened. Voxels the
+// file does not cover are set to 0, values beyond the grid are ignored.
+long long ParseVoxFile(const string& path, float* out, long long count, VolumeParseProgress progress = nullptr, VolumeParseStats* stats = nullptr);
+// allocate(resolution) is called once the header is read and returns the resolution^3 grid.
+long long ParseTxtFile(const string& path, function<float*(int resolution)> allocate, VolumeParseProgress progress = nullptr, VolumeParseStats* stats = nullptr);
+
+// Writes a random 256^3 .vox file to `path` and compares MB/s of the getline/stringstream
+// loader this replaces against ParseVoxFile.
+void BenchmarkVolumeParser(const string& path = "volume_parser_bench.vox");
@@ -0,0 +1,103 @@
+#include "volume_stats.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+using namespace std;
+
+namespace {
+
+using simd::vfloat;
+
+const int B = VOLUME_STATS_BRICK;
+const int W = simd::Width;
+
+}
+
+void VolumeStats::Clear() {
+	resolution = dims = 0;
+	max_density = 0;
+	majorant.clear();
+	min_value.clear();
+	mean.clear();
+}
+
+void VolumeStats::Build(const float* data, int res, float floor) {
+	auto start_time = chrono::steady_clock::now();
+	Clear();
+	resolution = res;
+	dims = (res + B - 1) / B;
+	size_t bricks = (size_t)dims * dims * dims;
+	majorant.assign(bricks, 0.0f);
+	min_value.assign(bricks, 0.0f);
+	mean.assign(bricks, 0.0f);
+
+	// One task per column of bricks along z: the rows of the column (plus the one past it
+	// in x and y, for the majorant) are folded element-wise into row-long accumulators with
+	// SIMD, then each brick reduces its B (+1) entries.
+	parallel::parallel_for(dims * dims, [&](int column) {
+		int bx = column / dims, by = column % dims;
+		int x0 = bx * B, y0 = by * B;
+		int x_core = min(x0 + B, res), y_core = min(y0 + B, res);
+		int x_end = min(x0 + B + 1, res), y_end = min(y0 + B + 1, res);
+
+		vector<float> major(res, 0.0f), low(res, FLT_MAX), sum(res, 0.0f);
+		const vfloat zero = simd::set1(0.0f);
+		for (int x = x0; x < x_end; x++) {
+			for (int y = y0; y < y_end; y++) {
+				const float* row = data + ((size_t)x * res + y) * res;
+				bool core = x < x_core && y < y_core;
+				int z = 0;
+				for (; z + W <= res; z += W) {
+					vfloat v = simd::load(row + z);
+					simd::store(&major[z], simd::max(simd::load(&major[z]), simd::max(v, zero)));
+					if (core) {
+						simd::store(&low[z], simd::min(simd::load(&low[z]), v));
+						simd::store(&sum[z], simd::load(&sum[z]) + v);
+					}
+				}
+				for (; z < res; z++) {
+					float v = row[z];
+					major[z] = max(major[z], max(v, 0.0f));
+					if (core) {
+						low[z] = min(low[z], v);
+						sum[z] += v;
+					}
+				}
+			}
+		}
+
+		float voxels_xy = (float)((x_core - x0) * (y_core - y0));
+		for (int bz = 0; bz < dims; bz++) {
+			int z0 = bz * B, z_core = min(z0 + B, res), z_end = min(z0 + B + 1, res);
+			float m = 0, lo = FLT_MAX, s = 0;
+			for (int z = z0; z < z_end; z++)
+				m = max(m, major[z]);
+			for (int z = z0; z < z_core; z++) {
+				lo = min(lo, low[z]);
+				s += sum[z];
+			}
+			size_t i = Index(bx, by, bz);
+			majorant[i] = m;
+			min_value[i] = lo;
+			mean[i] = s / (voxels_xy * (z_core - z0));
+		}
+	});
+
+	max_density = floor;
+	for (float m : majorant)
+		max_density = max(max_density, m);
+	seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+}
+
+double VolumeStats::MajorantRatio() const {
+	if (majorant.empty())
+		return 1;
+	double total = 0;
+	for (float m : majorant)
+		total += m;
+	return total / majorant.size() / max_density;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+// Statistics of a dense x-major density grid, gathered in one parallel SIMD sweep: the
+// global maximum and, per brick of VOLUME_STATS_BRICK^3 voxels, min, mean and a majorant.
+//
+// The majorant of brick b bounds every trilinear lookup whose floor(pos) lies in the brick,
+// so it covers voxels [B * b, B * b + B] (one past the brick on the high side), with
+// negative values counted as 0. Delta and ratio tracking can sample free flights against
+// it instead of the global maximum; bricks with a majorant of 0 can be crossed outright.
+
+#define VOLUME_STATS_BRICK 8
+
+class VolumeStats {
+public:
+	// floor: lower bound of MaxDensity(), as the old max_density loop started from.
+	void Build(const float* data, int resolution, float floor = 0.00001f);
+	void Clear();
+	bool IsBuilt() const { return resolution > 0; }
+
+	int Resolution() const { return resolution; }
+	int BrickDims() const { return dims; }
+	float MaxDensity() const { return max_density; }
+	double Seconds() const { return seconds; }
+
+	// Per brick, x-major ((bx * dims) + by) * dims + bz.
+	const float* Majorants() const { return majorant.data(); }
+	float Majorant(int bx, int by, int bz) const { return majorant[Index(bx, by, bz)]; }
+	float MinDensity(int bx, int by, int bz) const { return min_value[Index(bx, by, bz)]; }
+	float MeanDensity(int bx, int by, int bz) const { return mean[Index(bx, by, bz)]; }
+
+	// Mean of the majorants over MaxDensity(): the share of global-majorant free-flight
+	// steps local majorants still take, for a uniform spread of rays.
+	double MajorantRatio() const;
+
+private:
+	int resolution = 0;
+	int dims = 0;
+	float max_density = 0;
+	double seconds = 0;
+	vector<float> majorant, min_value, mean;
+
+	size_t Index(int bx, int by, int bz) const { return ((size_t)bx * dims + by) * dims + bz; }
+};